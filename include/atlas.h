@@ -0,0 +1,51 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include "model.h"
+
+/*
+ * Border around every packed texture, in pixels, filled with copies of
+ * its edge. Packed textures start on multiples of it, which keeps their
+ * first log2(ATLAS_GUTTER) mip levels from bleeding into each other; the
+ * atlas mip chain stops there.
+ */
+#define ATLAS_GUTTER 16
+
+/*
+ * Largest atlas page and the most pages built.
+ */
+#define ATLAS_MAX_SIZE 4096
+#define ATLAS_MAX_PAGES 4
+
+/*
+ * Outcome of atlas_pack_models.
+ *
+ * textures      - distinct textures packed
+ * models        - models moved onto an atlas page
+ * skipped       - textured models left alone, because their UVs tile,
+ *                 they have an AO texture or their texture does not fit
+ *                 a page
+ * pages         - pages created
+ * page_width    - width of each page
+ * page_height   - height of each page
+ */
+typedef struct AtlasResult
+{
+    int textures;
+    int models;
+    int skipped;
+    int pages;
+    int page_width[ATLAS_MAX_PAGES];
+    int page_height[ATLAS_MAX_PAGES];
+} AtlasResult;
+
+/*
+ * Pack the main textures of the given models into as few atlas pages as
+ * possible and remap the models' UVs onto them. Models whose UVs leave
+ * [0, 1] rely on texture repeat and keep their own texture, as do models
+ * with an AO texture, which is sampled with the same UVs. Must be called
+ * on the thread that owns the OpenGL context.
+ */
+void atlas_pack_models(Model *const *models, int count, AtlasResult *out_result);
+
+#endif // ATLAS_H
@@ -0,0 +1,84 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * Command line benchmark modes.
+ * These print their results to stdout. All but bench_render, bench_ao and
+ * bench_sky run without creating a window.
+ */
+
+/*
+ * Banana physics stress test.
+ * Throws banana_count bananas into an empty zoo and runs scene_update
+ * for the given number of 60 Hz frames, then reports ns per banana.
+ * Returns a process exit code.
+ */
+int bench_bananas(int banana_count, int frames);
+
+/*
+ * Slot pool churn test.
+ * Performs operations random acquire/release calls on a pool with the
+ * given number of slots, verifies the free/live bookkeeping afterwards
+ * and reports ns per operation. Returns a process exit code.
+ */
+int bench_pool_churn(int slots, int operations);
+
+/*
+ * Water height-field throughput test.
+ * Runs the pond simulation on a size x size grid for the given number of
+ * steps, once per available stencil kernel (each checked against the
+ * scalar kernel), then with 2, 4, ... threads up to the CPU count, and
+ * reports cell updates per second. Also times a stirred and a calm pond
+ * with tile sleeping enabled. A size of 0 sweeps 64 to 1024.
+ * Returns non-zero if a SIMD kernel disagrees with the scalar one.
+ */
+int bench_water(int size, int steps);
+
+/*
+ * Analytic rain test.
+ * Advances drop_count drops for the given frames with the zoo ponds in
+ * place, reports update and vertex build time per frame, and checks the
+ * collected landings against the drop clocks. Returns a process exit code.
+ */
+int bench_rain(int drop_count, int frames);
+
+/*
+ * Random number generator test.
+ * Times count values from rand(), rng_float and rng_batch_fill, and checks
+ * range, seed reproducibility, stream independence and that a scene run
+ * twice with the same seed ends in the same state. Returns a process exit
+ * code.
+ */
+int bench_rng(int count);
+
+/*
+ * Offscreen render benchmark.
+ * Renders the zoo into a hidden window with vsync off while the camera
+ * flies a fixed spline, then reports min / avg / p99 / max frame time and
+ * the average time per render pass. If json_path is not NULL the results
+ * are also written there as one JSON object.
+ * Returns a process exit code.
+ */
+int bench_render(int frames, int width, int height, const char *json_path);
+
+/*
+ * Ambient occlusion benchmark.
+ * Runs the render benchmark twice, once drawing the models' AO maps on a
+ * second texture unit and once with them baked into vertex colors, and
+ * reports the frame time and the objects pass time of both.
+ * Returns a process exit code.
+ */
+int bench_ao(int frames, int width, int height);
+
+/*
+ * Sky fill benchmark.
+ * Runs the render benchmark twice, once clearing the screen and drawing
+ * the sky first and once drawing it behind the opaque scene after a
+ * depth-only clear, and reports the frame time and the combined sky and
+ * ground pass time of both. Run under a software rasterizer to see the
+ * fill-rate difference.
+ * Returns a process exit code.
+ */
+int bench_sky(int frames, int width, int height);
+
+#endif // BENCH_H
@@ -64,9 +64,10 @@ void camera_update_xy(Camera *camera, float delta_time);
 void camera_update_z(Camera *camera, float delta_time);
 
 /*
- * Apply the camera transformation to the OpenGL model-view matrix.
+ * Apply the camera transformation to the OpenGL model-view matrix and
+ * write it to out_view, 16 floats in column-major order.
  */
-void camera_apply_view(const Camera *camera);
+void camera_apply_view(const Camera *camera, float *out_view);
 
 /*
  * Get the forward direction of the camera on the X-Y plane.
@@ -74,4 +75,11 @@ void camera_apply_view(const Camera *camera);
  */
 void camera_get_forward(const Camera *camera, float *fx, float *fy);
 
+/*
+ * Sample a closed Catmull-Rom spline through count control points
+ * (count >= 2) at t in [0, 1); t wraps around. Writes the position and
+ * the unnormalised direction of travel.
+ */
+void camera_path_sample(const Vec3 *points, int count, float t, Vec3 *position, Vec3 *tangent);
+
 #endif // CAMERA_H
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef DRAW_SORT_H
+#define DRAW_SORT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * One entry of a draw list: a sort key and the caller's id of what to
+ * draw. Only the low 16 bits of the key are sorted on.
+ */
+typedef struct DrawItem
+{
+    uint32_t key;
+    uint32_t id;
+} DrawItem;
+
+/*
+ * Quantise a view depth in [0, max_depth] to a 16-bit key; nearer is
+ * smaller. Depths outside the range are clamped. With back_to_front the
+ * order is reversed, so farther depths get the smaller keys.
+ */
+uint32_t draw_depth_key(float depth, float max_depth, bool back_to_front);
+
+/*
+ * Sort items by ascending key with a stable two-pass radix sort over the
+ * 16-bit keys. scratch must hold count items; the result ends up in items.
+ */
+void draw_sort(DrawItem *items, DrawItem *scratch, int count);
+
+#endif // DRAW_SORT_H
@@ -8,7 +8,117 @@
 #include "scene.h"
 #include "input.h"
 #include "model.h"
+#include "jobs.h"
+#include "rng.h"
+#include "replay.h"
 
+/*
+ * Default simulation rate in steps per second.
+ */
+#define GAME_DEFAULT_SIM_RATE 60
+
+/*
+ * Render passes of one frame in drawing order, timed separately when
+ * profiling. The sky goes first instead with sky_first.
+ */
+typedef enum
+{
+    GAME_PASS_SHADOW,
+    GAME_PASS_PREPASS,
+    GAME_PASS_GROUND,
+    GAME_PASS_OBJECTS,
+    GAME_PASS_SKY,
+    GAME_PASS_WATER,
+    GAME_PASS_RAIN,
+    GAME_PASS_UI,
+    GAME_PASS_PRESENT,
+    GAME_PASS_COUNT
+} GamePass;
+
+/*
+ * Startup options, usually filled from the command line.
+ *
+ * water_size      - resolution of every pond grid, 0 = per-pond default
+ * worker_threads  - simulation worker threads, 0 = one per extra CPU core
+ * rain_drops      - number of rain drops
+ * seed            - random seed, 0 = derived from the current time
+ * sim_rate        - fixed simulation steps per second
+ * sim_thread      - run the simulation on its own thread
+ * vsync           - wait for vertical sync when presenting frames
+ * window_width    - initial window width in pixels
+ * window_height   - initial window height in pixels
+ * hidden_window   - create the window hidden, for offscreen benchmarks
+ * record_path     - record the input of the session to this file, or NULL
+ * replay_path     - replay a recorded session from this file, or NULL
+ * texture_compression - let the driver compress textures when it can
+ * texture_atlas   - pack the model textures into an atlas
+ * texture_disk_cache - keep converted textures on disk for the next start
+ * texture_streaming - upload textures in the background across frames
+ * ao_bake         - bake AO textures into vertex colors instead of
+ *                   multitexturing
+ * shaders         - light and fog the scene with GLSL instead of fixed
+ *                   function
+ * shadows         - cast shadows from the light, needs shaders
+ * sky_first       - clear the screen and draw the sky before the scene
+ *                   instead of behind it, for comparison
+ * depth_prepass   - lay down the depth of heavy meshes before shading
+ */
+typedef struct GameOptions
+{
+    int water_size;
+    int worker_threads;
+    int rain_drops;
+    uint64_t seed;
+    int sim_rate;
+    bool sim_thread;
+    bool vsync;
+    int window_width;
+    int window_height;
+    bool hidden_window;
+    const char *record_path;
+    const char *replay_path;
+    bool texture_compression;
+    bool texture_atlas;
+    bool texture_disk_cache;
+    bool texture_streaming;
+    bool ao_bake;
+    bool shaders;
+    bool shadows;
+    bool sky_first;
+    bool depth_prepass;
+} GameOptions;
+
+/*
+ * Game state.
+ *
+ * The simulation advances in fixed steps of sim_step seconds, either on
+ * the main thread between frames or on a separate thread when sim_lock is
+ * set. Rendering interpolates between the previous and the current step.
+ *
+ * render_context       - view matrix and draw lists of the frame being drawn
+ * render_scene         - copy of the scene drawn in threaded mode, taken
+ *                        under sim_lock so the frame is drawn unlocked
+ * prev_camera_position - camera position before the last step
+ * sim_ticks            - steps run so far, owned by the simulating thread
+ * sim_ticks_atomic     - copy of sim_ticks readable from any thread
+ * sim_running          - keeps the simulation thread alive
+ * sim_lock             - guards camera and scene in threaded mode
+ * last_tick_counter    - performance counter at the end of the last step
+ * stat_*               - frame and step counts for the title bar rates
+ * time_passes          - finish and time every render pass
+ * pass_mark            - performance counter at the end of the last pass
+ * pass_ticks           - counter ticks spent per pass while time_passes is set
+ * recorder, recording  - input recording in progress
+ * replay, replaying    - recorded input fed in place of SDL events
+ * replay_start         - performance counter when the replay started
+ * replay_mark          - performance counter at the last replayed frame
+ * replay_worst_ms      - longest frame of the replay
+ * atlas_pending        - pack the atlas once the textures finish streaming
+ * ao_bake              - bake the models' AO once their textures are in
+ * stream_start         - performance counter when asset loading started
+ * sky_first            - draw the sky before the scene, see GameOptions
+ * depth_prepass        - run the depth pre-pass, see GameOptions
+ */
 typedef struct Game
 {
     SDL_Window *window;
@@ -16,8 +126,40 @@ typedef struct Game
 
     Camera camera;
     Scene scene;
+    SceneRenderContext render_context;
+    Scene render_scene;
     InputState input;
 
+    JobPool jobs;
+    bool jobs_ready;
+
+    Rng rng;
+    uint64_t seed;
+
+    float sim_step;
+    Vec3 prev_camera_position;
+    int sim_ticks;
+    SDL_atomic_t sim_ticks_atomic;
+    SDL_atomic_t sim_running;
+    SDL_mutex *sim_lock;
+    uint64_t last_tick_counter;
+
+    uint64_t stat_start;
+    int stat_frames;
+    int stat_ticks;
+
+    bool time_passes;
+    uint64_t pass_mark;
+    uint64_t pass_ticks[GAME_PASS_COUNT];
+
+    ReplayWriter recorder;
+    bool recording;
+    ReplayReader replay;
+    bool replaying;
+    uint64_t replay_start;
+    uint64_t replay_mark;
+    double replay_worst_ms;
+
     Model rock_model;
     Model monkey_model;
     Model banana_model;
@@ -28,14 +170,37 @@ typedef struct Game
     bool banana_loaded;
     bool tree_loaded;
 
+    bool atlas_pending;
+    bool ao_bake;
+    uint64_t stream_start;
+    bool sky_first;
+    bool depth_prepass;
+
     bool running;
     bool show_help;
+    bool show_profiler;
+    bool show_stats;
+    uint64_t stats_mark;
 
     float light_intensity;
 } Game;
 
-bool game_init(Game *game);
+void game_default_options(GameOptions *options);
+bool game_init(Game *game, const GameOptions *options);
 void game_run(Game *game);
 void game_shutdown(Game *game);
 
+/*
+ * Return the display name of a render pass.
+ */
+const char *game_pass_name(GamePass pass);
+
+/*
+ * Fly the camera along a fixed spline through the zoo for the given number
+ * of frames, one simulation step per frame, without reading any input.
+ * Writes the render time of every frame to frame_ms and the summed time of
+ * every pass to pass_ms. Returns false if the window was closed early.
+ */
+bool game_run_render_benchmark(Game *game, int frames, double *frame_ms, double *pass_ms);
+
 #endif
\ No newline at end of file
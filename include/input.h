@@ -3,6 +3,29 @@
 
 #include <SDL2/SDL.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Distinct keys that can change state in one frame, and the number of
+ * 32-bit words of the held-key bitset. Changes to further keys in the
+ * same frame still update key_down but report no press or release.
+ */
+#define INPUT_MAX_KEY_EVENTS 32
+#define INPUT_KEY_WORDS ((SDL_NUM_SCANCODES + 31) / 32)
+
+/*
+ * A key that changed state this frame.
+ *
+ * scancode  - the key
+ * pressed   - went down this frame
+ * released  - went up this frame
+ */
+typedef struct InputKeyEvent
+{
+    uint16_t scancode;
+    bool pressed;
+    bool released;
+} InputKeyEvent;
 
 /*
  * Stores the complete input state of the current frame.
@@ -14,13 +37,16 @@
  * mouse_captured  - true if relative mouse mode is active
  * mouse_dx, mouse_dy - mouse movement delta for the current frame
  *
- * mouse_down      - current pressed state of mouse buttons
+ * mouse_down      - current pressed state of mouse buttons, one bit each
  * mouse_pressed   - buttons pressed this frame
  * mouse_released  - buttons released this frame
  *
- * key_down        - current pressed state of keyboard keys
- * key_pressed     - keys pressed this frame
- * key_released    - keys released this frame
+ * key_down        - current pressed state of keyboard keys, one bit each
+ * key_events      - keys pressed or released this frame
+ * key_event_count - number of entries in key_events
+ *
+ * Only the keys that changed are listed per frame, so starting a new
+ * frame costs the same however many keys exist.
  */
 typedef struct InputState
 {
@@ -34,13 +60,13 @@ typedef struct InputState
     int mouse_dx;
     int mouse_dy;
 
-    bool mouse_down[8];
-    bool mouse_pressed[8];
-    bool mouse_released[8];
+    uint8_t mouse_down;
+    uint8_t mouse_pressed;
+    uint8_t mouse_released;
 
-    bool key_down[SDL_NUM_SCANCODES];
-    bool key_pressed[SDL_NUM_SCANCODES];
-    bool key_released[SDL_NUM_SCANCODES];
+    uint32_t key_down[INPUT_KEY_WORDS];
+    InputKeyEvent key_events[INPUT_MAX_KEY_EVENTS];
+    int key_event_count;
 } InputState;
 
 /*
@@ -59,24 +85,51 @@ void input_begin_frame(InputState *in);
  */
 void input_poll_events(InputState *in);
 
+/*
+ * Record a key going down or up. Used by input_poll_events and to feed
+ * recorded input back in.
+ */
+void input_key_event(InputState *in, SDL_Scancode sc, bool down);
+
 /*
  * Enable or disable mouse capture (relative mouse mode).
  */
 void input_set_mouse_capture(InputState *in, bool capture);
 
+/*
+ * Return the entry of a key that changed this frame, or NULL.
+ */
+static inline const InputKeyEvent *input_find_key_event(const InputState *in, SDL_Scancode sc)
+{
+    for (int i = 0; i < in->key_event_count; i++)
+    {
+        if (in->key_events[i].scancode == sc)
+            return &in->key_events[i];
+    }
+    return NULL;
+}
+
 /*
  * Return true while the given key is being held down.
  */
-static inline bool input_down(const InputState *in, SDL_Scancode sc) { return in->key_down[sc]; }
+static inline bool input_down(const InputState *in, SDL_Scancode sc) { return (in->key_down[sc >> 5] >> (sc & 31)) & 1u; }
 
 /*
  * Return true only on the frame when the given key was pressed.
  */
-static inline bool input_pressed(const InputState *in, SDL_Scancode sc) { return in->key_pressed[sc]; }
+static inline bool input_pressed(const InputState *in, SDL_Scancode sc)
+{
+    const InputKeyEvent *e = input_find_key_event(in, sc);
+    return e && e->pressed;
+}
 
 /*
  * Return true only on the frame when the given key was released.
  */
-static inline bool input_released(const InputState *in, SDL_Scancode sc) { return in->key_released[sc]; }
+static inline bool input_released(const InputState *in, SDL_Scancode sc)
+{
+    const InputKeyEvent *e = input_find_key_event(in, sc);
+    return e && e->released;
+}
 
 #endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+
+/*
+ * Maximum number of worker threads a job pool can own.
+ */
+#define JOBS_MAX_WORKERS 31
+
+/*
+ * Work callback for jobs_parallel_for.
+ * Processes the half-open index range [begin, end).
+ */
+typedef void (*JobFunc)(void *data, int begin, int end);
+
+/*
+ * Small fork-join thread pool built on SDL threads.
+ *
+ * workers       - worker threads (the calling thread also takes part)
+ * worker_count  - number of worker threads
+ * start         - posted once per worker when a new job is published
+ * done          - posted by each worker when it finished the current job
+ * next_batch    - next unclaimed batch of the current job
+ * quit          - set when the pool is shutting down
+ *
+ * func, data, count, batch_size, batch_count describe the current job.
+ */
+typedef struct JobPool
+{
+    SDL_Thread *workers[JOBS_MAX_WORKERS];
+    int worker_count;
+
+    SDL_sem *start;
+    SDL_sem *done;
+
+    SDL_atomic_t next_batch;
+    SDL_atomic_t quit;
+
+    JobFunc func;
+    void *data;
+    int count;
+    int batch_size;
+    int batch_count;
+} JobPool;
+
+/*
+ * Start a pool with the given number of worker threads.
+ * A worker count below 1 creates one worker per additional CPU core.
+ * Returns false if the threads could not be created.
+ */
+bool jobs_init(JobPool *pool, int worker_count);
+
+/*
+ * Stop and join all worker threads.
+ */
+void jobs_shutdown(JobPool *pool);
+
+/*
+ * Return the number of threads that execute jobs, including the caller.
+ * A NULL pool counts as the calling thread only.
+ */
+int jobs_thread_count(const JobPool *pool);
+
+/*
+ * Split [0, count) into batches of at least min_batch indices and run
+ * func on them across the pool and the calling thread. Blocks until every
+ * batch is done. With a NULL pool, or when the range is too small to
+ * split, func runs directly on the calling thread.
+ */
+void jobs_parallel_for(JobPool *pool, int count, int min_batch, JobFunc func, void *data);
+
+#endif // JOBS_H
@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+/*
+ * A whole file mapped read-only into memory.
+ *
+ * data  - first byte of the file, NULL when nothing is mapped
+ * size  - file size in bytes
+ */
+typedef struct MappedFile
+{
+    void *data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} MappedFile;
+
+/*
+ * Map a file. Returns false if it is missing, empty or cannot be mapped.
+ */
+bool mapped_file_open(MappedFile *out_file, const char *path);
+
+/*
+ * Unmap a file and reset the structure. Safe on an unmapped structure.
+ */
+void mapped_file_close(MappedFile *file);
+
+#endif // MAPPED_FILE_H
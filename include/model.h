@@ -2,7 +2,6 @@
 #define MODEL_H
 
 #include <stdbool.h>
-#include <GL/gl.h>
 
 #include "geom.h"
 #include "texture.h"
@@ -34,7 +33,10 @@ typedef struct ModelVertex
  * radius_xy     - approximate radius in the X-Y plane
  *
  * texture       - main texture of the model
- * ao_texture    - optional ambient occlusion texture
+ * ao_texture    - optional ambient occlusion texture, applied on a second
+ *                 texture unit with the same UVs
+ * vertex_ao     - ambient occlusion baked into RGBA8 vertex colors by
+ *                 model_bake_ao, NULL if not baked
  */
 typedef struct Model
 {
@@ -49,8 +51,21 @@ typedef struct Model
 
     Texture2D texture;
     Texture2D ao_texture;
+    unsigned char *vertex_ao;
 } Model;
 
+/*
+ * Load only the vertices and bounds of an OBJ model, without textures.
+ * Needs no OpenGL context, so the simulation can run headless.
+ * Returns true if loading was successful.
+ */
+bool model_load_obj_geometry(Model *out_model, const char *obj_path);
+
+/*
+ * Free the vertices of a model loaded with model_load_obj_geometry.
+ */
+void model_free_geometry(Model *model);
+
 /*
  * Load an OBJ model and its main texture.
  * Returns true if loading was successful.
@@ -63,6 +78,22 @@ bool model_load_obj(Model *out_model, const char *obj_path, const char *tex_path
  */
 bool model_load_obj_with_ao(Model *out_model, const char *obj_path, const char *tex_path, const char *ao_path);
 
+/*
+ * Print the video memory of a model's textures next to what a single
+ * uncompressed level of each would take. Streamed textures that are not
+ * complete yet report the levels uploaded so far.
+ */
+void model_report_texture_memory(Model *model, const char *obj_path);
+
+/*
+ * Sample the AO texture at every vertex and keep the result as vertex
+ * colors, then free the texture. Cheaper to draw than a second texture
+ * fetch, at the cost of detail between vertices. Must be called on the
+ * thread that owns the OpenGL context, once the texture is uploaded.
+ * Returns true if the model was baked.
+ */
+bool model_bake_ao(Model *model);
+
 /*
  * Free all memory and textures used by the model.
  */
@@ -73,4 +104,10 @@ void model_free(Model *model);
  */
 void model_draw(const Model *model);
 
+/*
+ * Render only the model's positions, for depth-only passes such as shadow
+ * maps. Leaves every other GL state alone.
+ */
+void model_draw_depth(const Model *model);
+
 #endif // MODEL_H
\ No newline at end of file
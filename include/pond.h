@@ -0,0 +1,142 @@
+#ifndef POND_H
+#define POND_H
+
+#include <stdbool.h>
+
+#include "water.h"
+#include "jobs.h"
+
+/*
+ * Simulation rate by distance from the focus point (usually the camera)
+ * to the pond shore. Ponds closer than POND_NEAR_DISTANCE are stepped
+ * every frame, ponds up to POND_FAR_DISTANCE every POND_MID_TICK seconds
+ * and anything further every POND_FAR_TICK seconds. A reduced rate step
+ * never advances by more than POND_MAX_STEP_DT, so distant ponds run
+ * slower instead of becoming unstable.
+ */
+#define POND_NEAR_DISTANCE 40.0f
+#define POND_FAR_DISTANCE 120.0f
+#define POND_MID_TICK (1.0f / 30.0f)
+#define POND_FAR_TICK (1.0f / 10.0f)
+#define POND_MAX_STEP_DT (1.0f / 30.0f)
+
+/*
+ * Spatial lookup grid.
+ * Cells are POND_GRID_CELL world units wide; the cell size grows when the
+ * ponds are spread so far apart that a side would exceed
+ * POND_GRID_MAX_SIDE cells.
+ */
+#define POND_GRID_CELL 16.0f
+#define POND_GRID_MAX_SIDE 256
+
+/*
+ * One elliptical water body with its own height field.
+ *
+ * x, y, z        - centre of the water surface
+ * rx, ry         - ellipse radii
+ * water          - height-field simulation covering the ellipse bounds
+ * emit_timer     - accumulator for ambient particle emission
+ * tick_interval  - current simulation interval, 0 = every frame
+ * tick_timer     - time accumulated since the last simulation step
+ */
+typedef struct Pond
+{
+    float x, y, z;
+    float rx, ry;
+
+    WaterSim water;
+
+    float emit_timer;
+    float tick_interval;
+    float tick_timer;
+} Pond;
+
+/*
+ * Collection of ponds with a uniform grid for position lookups.
+ *
+ * The grid covers the bounding box of all ponds. Each cell lists the ponds
+ * whose bounds overlap it: cell c owns cell_ponds[cell_start[c]] up to
+ * cell_ponds[cell_start[c + 1]]. The grid is rebuilt when a pond is added.
+ *
+ * ponds          - pond array, count used out of capacity
+ * grid_x0/y0     - world position of the grid corner
+ * grid_cell      - cell side length
+ * grid_w/h       - cell count along x and y
+ */
+typedef struct PondSystem
+{
+    Pond *ponds;
+    int count;
+    int capacity;
+
+    float grid_x0, grid_y0;
+    float grid_cell;
+    int grid_w, grid_h;
+    int *cell_start;
+    int *cell_ponds;
+} PondSystem;
+
+/*
+ * Initialize an empty pond system.
+ */
+void pond_system_init(PondSystem *system);
+
+/*
+ * Free every pond grid and the lookup structure.
+ */
+void pond_system_free(PondSystem *system);
+
+/*
+ * Make dst a copy of src for drawing: the ponds, their latest water
+ * heights and the lookup grid. Buffers of dst are reused where the sizes
+ * match. Returns false if an allocation failed; dst then holds a prefix
+ * of the ponds.
+ */
+bool pond_system_copy(PondSystem *dst, const PondSystem *src);
+
+/*
+ * Add a pond with a size x size simulation grid.
+ * Returns the pond index, or -1 on invalid arguments or allocation failure.
+ */
+int pond_system_add(PondSystem *system, float x, float y, float z, float rx, float ry, int size);
+
+/*
+ * Replace the grid of one pond with a calm one of the given resolution.
+ * Returns false if the allocation failed; the old grid is kept then.
+ */
+bool pond_system_set_size(PondSystem *system, int index, int size);
+
+/*
+ * Return the index of the pond containing world position (x, y), or -1.
+ */
+int pond_system_find(const PondSystem *system, float x, float y);
+
+/*
+ * Return the index of the pond whose centre is closest to (x, y), or -1
+ * if there are no ponds. The centre distance is stored in distance.
+ */
+int pond_system_nearest(const PondSystem *system, float x, float y, float *distance);
+
+/*
+ * Add a splash impulse at world position (x, y).
+ * Returns false if the position is not on any pond.
+ */
+bool pond_system_splash(PondSystem *system, float x, float y);
+
+/*
+ * Advance the ponds by delta_time. Each pond's rate is chosen from its
+ * distance to (focus_x, focus_y).
+ */
+void pond_system_step(PondSystem *system, float delta_time, float focus_x, float focus_y, JobPool *jobs);
+
+/*
+ * Return true if world position (x, y) is inside the pond ellipse.
+ */
+static inline bool pond_contains(const Pond *pond, float x, float y)
+{
+    float lx = (x - pond->x) / pond->rx;
+    float ly = (y - pond->y) / pond->ry;
+    return lx * lx + ly * ly <= 1.0f;
+}
+
+#endif // POND_H
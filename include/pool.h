@@ -0,0 +1,78 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdbool.h>
+
+/*
+ * Fixed-capacity slot allocator.
+ *
+ * Slots are indices into an array owned by the caller. Free slots are kept
+ * on a stack, so acquire and release are O(1). Live slots are additionally
+ * kept in a dense list, so iteration only visits live entries.
+ *
+ * capacity    - number of slots
+ * free_slots  - stack of currently free slots
+ * free_count  - number of entries on the free stack
+ * live        - dense list of live slots
+ * live_count  - number of live slots
+ * live_pos    - position of each slot in the live list, or -1 if free
+ */
+typedef struct SlotPool
+{
+    int capacity;
+
+    int *free_slots;
+    int free_count;
+
+    int *live;
+    int live_count;
+
+    int *live_pos;
+} SlotPool;
+
+/*
+ * Allocate the bookkeeping for capacity slots, all of them free.
+ * Returns false if the allocation failed.
+ */
+bool pool_init(SlotPool *pool, int capacity);
+
+/*
+ * Release the bookkeeping memory.
+ */
+void pool_free(SlotPool *pool);
+
+/*
+ * Mark every slot as free again.
+ */
+void pool_clear(SlotPool *pool);
+
+/*
+ * Make dst an exact copy of src, reallocating it if the capacities differ.
+ * Returns false if the allocation failed; dst is then empty.
+ */
+bool pool_copy(SlotPool *dst, const SlotPool *src);
+
+/*
+ * Take a free slot and add it to the live list.
+ * Returns the slot index, or -1 if the pool is full.
+ */
+int pool_acquire(SlotPool *pool);
+
+/*
+ * Return a live slot to the free stack.
+ * The last live slot is moved into the released position of the live list,
+ * so a loop that releases while iterating should walk the list backwards.
+ */
+void pool_release(SlotPool *pool, int slot);
+
+/*
+ * Return the number of live slots.
+ */
+static inline int pool_live_count(const SlotPool *pool) { return pool->live_count; }
+
+/*
+ * Return the slot stored at position i of the live list.
+ */
+static inline int pool_live_slot(const SlotPool *pool, int i) { return pool->live[i]; }
+
+#endif // POOL_H
@@ -0,0 +1,103 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Zones recorded per frame, frames kept in the history ring, and the
+ * deepest nesting tracked. Zones beyond the limits are dropped.
+ */
+#define PROFILER_MAX_ZONES 256
+#define PROFILER_HISTORY 128
+#define PROFILER_MAX_DEPTH 16
+
+/*
+ * One timed zone.
+ *
+ * name   - static string passed to profiler_begin
+ * start  - performance counter at profiler_begin
+ * end    - performance counter at profiler_end
+ * depth  - nesting level, 0 for zones directly inside the frame
+ */
+typedef struct ProfileZone
+{
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+    int depth;
+} ProfileZone;
+
+/*
+ * All zones of one frame, in the order they were opened.
+ */
+typedef struct ProfileFrame
+{
+    uint64_t start;
+    uint64_t end;
+    ProfileZone zones[PROFILER_MAX_ZONES];
+    int zone_count;
+} ProfileFrame;
+
+/*
+ * Scoped-zone CPU profiler.
+ *
+ * Zones are opened with profiler_begin and closed with profiler_end and
+ * may nest. They are collected per frame into a ring of the last
+ * PROFILER_HISTORY frames. The profiler is a single global instance that
+ * only records on the thread that called profiler_init; calls from other
+ * threads, and all calls while disabled, return immediately.
+ */
+
+/*
+ * Reset the history and make the calling thread the recording thread.
+ */
+void profiler_init(void);
+
+/*
+ * Turn recording on or off. Off by default.
+ */
+void profiler_set_enabled(bool enabled);
+
+/*
+ * Return true while the profiler records.
+ */
+bool profiler_is_enabled(void);
+
+/*
+ * Start a new frame in the ring, overwriting the oldest one.
+ */
+void profiler_begin_frame(void);
+
+/*
+ * Close the current frame; it becomes the one profiler_last_frame returns.
+ */
+void profiler_end_frame(void);
+
+/*
+ * Open a zone. name must stay valid for the lifetime of the profiler.
+ */
+void profiler_begin(const char *name);
+
+/*
+ * Close the innermost open zone.
+ */
+void profiler_end(void);
+
+/*
+ * Return the last completed frame, or NULL if there is none.
+ */
+const ProfileFrame *profiler_last_frame(void);
+
+/*
+ * Convert a performance counter interval to milliseconds.
+ */
+double profiler_ms(uint64_t ticks);
+
+/*
+ * Write every completed frame in the ring as a Chrome trace event file,
+ * viewable in chrome://tracing or Perfetto. Returns true on success.
+ */
+bool profiler_write_chrome_trace(const char *path);
+
+#endif // PROFILER_H
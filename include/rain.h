@@ -0,0 +1,119 @@
+#ifndef RAIN_H
+#define RAIN_H
+
+#include <stdbool.h>
+
+#include "pond.h"
+#include "jobs.h"
+
+/*
+ * Default number of drops and size of the rain area.
+ * Drops fall inside a square of 2 * RAIN_HALF_EXTENT around the centre.
+ */
+#define RAIN_DEFAULT_DROPS 800
+#define RAIN_HALF_EXTENT 55.0f
+
+/*
+ * Percentage of drops landing on a pond that create a splash.
+ */
+#define RAIN_SPLASH_PERCENT 20
+
+/*
+ * Analytic rain.
+ *
+ * Drop i falls from height top[i] to the ground with a fixed speed and
+ * then restarts, so its motion is periodic. Its position at time t follows
+ * from cycles = t * inv_period[i] + phase[i]: the fractional part gives the
+ * height, the integer part numbers the fall, and the horizontal position
+ * of each fall is hashed from the drop seed and that number. The hashed
+ * position is cached in offset_x/y and only rewritten when the drop lands.
+ *
+ * Horizontal positions are wrapped into the square around the centre
+ * (usually the camera), so the rain follows the viewer while the drops
+ * themselves stay fixed in the world.
+ *
+ * count            - number of drops
+ * seed             - base seed for the per-drop hashes
+ * time             - rain clock in seconds
+ * center_x/y       - centre of the rain area
+ * top, len         - start height and streak length per drop
+ * inv_period       - falls per second per drop, a multiple of 1/64
+ * phase            - cycle offset per drop in [0, 1)
+ * offset_x/y       - hashed position of the current fall, before wrapping
+ * landed           - drops that reached the ground in the last update
+ * landed_cycle     - fall number of each landing
+ * landed_count     - length of the landed lists
+ * vertices         - scratch line vertices for drawing, 6 floats per drop
+ */
+typedef struct RainSystem
+{
+    int count;
+    unsigned int seed;
+
+    double time;
+    float center_x, center_y;
+
+    float *top;
+    float *len;
+    float *inv_period;
+    float *phase;
+    float *offset_x;
+    float *offset_y;
+
+    int *landed;
+    unsigned int *landed_cycle;
+    int landed_count;
+
+    float *vertices;
+} RainSystem;
+
+/*
+ * Allocate count drops with properties derived from seed.
+ * Returns false if the allocation failed.
+ */
+bool rain_init(RainSystem *rain, int count, unsigned int seed);
+
+/*
+ * Release the per-drop arrays.
+ */
+void rain_free(RainSystem *rain);
+
+/*
+ * Replace the drops with count new ones. The rain clock is kept.
+ * Returns false if the allocation failed; the old drops are kept then.
+ */
+bool rain_set_drop_count(RainSystem *rain, int count);
+
+/*
+ * Make dst draw the same rain as src: the drops, the clock and the area.
+ * Drop properties are only rebuilt when the count or seed differs; the
+ * landings are not copied. Returns false if the allocation failed; dst
+ * keeps its old drops then.
+ */
+bool rain_copy(RainSystem *dst, const RainSystem *src);
+
+/*
+ * Advance the rain clock, move the rain area to (center_x, center_y) and
+ * collect every drop that reached the ground during delta_time.
+ */
+void rain_update(RainSystem *rain, float delta_time, float center_x, float center_y);
+
+/*
+ * Return the world position where a collected landing hit the ground.
+ */
+void rain_landing_position(const RainSystem *rain, int landing, float *x, float *y);
+
+/*
+ * Turn a share of the collected landings into pond splashes.
+ * Returns the number of splashes.
+ */
+int rain_splash_ponds(const RainSystem *rain, PondSystem *ponds);
+
+/*
+ * Fill rain->vertices with one line segment per drop at the current time,
+ * split across the job pool when there are enough drops.
+ * Returns the number of vertices written.
+ */
+int rain_build_vertices(const RainSystem *rain, JobPool *jobs);
+
+#endif // RAIN_H
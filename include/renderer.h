@@ -1,10 +1,60 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include <stdbool.h>
+
+struct ShadowCascades;
+
+/*
+ * Vertical field of view in degrees and depth range of the projection.
+ */
+#define RENDERER_FOV_Y 70.0f
+#define RENDERER_Z_NEAR 0.1f
+#define RENDERER_Z_FAR 500.0f
+
 /*
  * Initialize OpenGL render state and set up the initial viewport/projection.
+ * With use_shaders the scene is lit and fogged by a GLSL 1.20 program,
+ * falling back to the fixed-function pipeline if it is not available.
+ * Returns true if the program is in use.
+ */
+bool renderer_init(int width, int height, bool use_shaders);
+
+/*
+ * Release the scene program.
+ */
+void renderer_shutdown(void);
+
+/*
+ * Bind the scene program, if there is one, and start with lighting on and
+ * texturing off. Call after the view is set up and before the light and
+ * fog are applied.
+ */
+void renderer_begin_scene(void);
+
+/*
+ * Unbind the scene program before fixed-function drawing such as the UI.
+ */
+void renderer_end_scene(void);
+
+/*
+ * Turn lighting or texturing of a texture unit on or off for scene
+ * drawing. Only changes are sent to GL; returns true if one was.
+ */
+bool renderer_set_lighting(bool enabled);
+bool renderer_set_texturing(int unit, bool enabled);
+
+/*
+ * Cached switches for the rest of the state the scene changes: alpha
+ * blending, depth and color writes, line width and point size. Like the
+ * ones above they only send and count changes; the UI leaves blending off
+ * as it found it.
  */
-void renderer_init(int width, int height);
+bool renderer_set_blending(bool enabled);
+bool renderer_set_depth_write(bool enabled);
+bool renderer_set_color_write(bool enabled);
+bool renderer_set_line_width(float width);
+bool renderer_set_point_size(float size);
 
 /*
  * Update the viewport and projection matrix after a window resize.
@@ -17,25 +67,52 @@ void renderer_resize(int width, int height);
  */
 void renderer_begin_frame(float r, float g, float b);
 
+/*
+ * Start a new frame by clearing only the depth buffer, for frames where
+ * the sky covers every pixel the scene does not.
+ */
+void renderer_begin_frame_depth(void);
+
 /*
  * Finish the current frame and present it on the SDL window.
  */
 void renderer_end_frame(void *sdl_window);
 
+/*
+ * Block until the GPU has finished all submitted work.
+ * Used to attribute render time to passes when profiling.
+ */
+void renderer_finish(void);
+
 /*
  * Apply scene lighting with the given intensity value.
  */
 void renderer_apply_light(float intensity);
 
 /*
- * Draw a fullscreen sky background with a vertical color gradient.
+ * Write the unit vector pointing from the scene towards the light.
+ */
+void renderer_light_direction(float *out_dir);
+
+/*
+ * Shadow the scene program's diffuse light with the given maps, or turn
+ * shadows off with NULL. Call with the same view as shadow_render, after
+ * renderer_begin_scene. The fixed-function path has no shadows.
+ */
+void renderer_apply_shadows(const struct ShadowCascades *shadows);
+
+/*
+ * Draw a fullscreen sky background with a vertical color gradient at the
+ * far plane, without writing depth. Drawn after the opaque scene it only
+ * fills the pixels left empty. The colors are rebuilt only when the
+ * intensity changes.
  */
 void renderer_draw_sky_gradient(float intensity);
 
 /*
- * Apply animated fog parameters based on time, camera position,
- * and whether the camera is close to the pond area.
+ * Apply animated fog parameters based on time and the distance from the
+ * camera to the nearest pond. A negative distance means there is no water.
  */
-void renderer_apply_dynamic_fog(float global_time, float cam_x, float cam_y, int pond_enabled, float pond_x, float pond_y);
+void renderer_apply_dynamic_fog(float global_time, float water_distance);
 
 #endif // RENDERER_H
\ No newline at end of file
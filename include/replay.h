@@ -0,0 +1,89 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "input.h"
+
+/*
+ * Input recording file.
+ *
+ * A header with the seed and the simulation rate of the recorded session
+ * is followed by one record per frame: the frame time fed to the
+ * simulation and the parts of InputState that changed. A frame without
+ * mouse or keyboard activity takes 5 bytes. Window events are not stored;
+ * the replaying window keeps its own size.
+ *
+ * Replaying the records with the same seed and simulation rate through
+ * the fixed-step loop reproduces the session step for step.
+ */
+
+/*
+ * Writes a recording.
+ *
+ * file    - output file
+ * frames  - frames written so far
+ * failed  - set after a write error
+ */
+typedef struct ReplayWriter
+{
+    FILE *file;
+    int frames;
+    bool failed;
+} ReplayWriter;
+
+/*
+ * Reads a recording.
+ *
+ * file      - input file
+ * seed      - seed of the recorded session
+ * sim_rate  - simulation steps per second of the recorded session
+ * frames    - frames read so far
+ * failed    - set when the file is truncated or corrupt
+ */
+typedef struct ReplayReader
+{
+    FILE *file;
+    uint64_t seed;
+    int sim_rate;
+    int frames;
+    bool failed;
+} ReplayReader;
+
+/*
+ * Create a recording and write its header. Returns false if the file
+ * cannot be created.
+ */
+bool replay_writer_open(ReplayWriter *writer, const char *path, uint64_t seed, int sim_rate);
+
+/*
+ * Append the input of one frame and the frame time that went with it.
+ */
+void replay_writer_frame(ReplayWriter *writer, const InputState *in, float delta_time);
+
+/*
+ * Close the recording. Returns false if any write failed.
+ */
+bool replay_writer_close(ReplayWriter *writer);
+
+/*
+ * Open a recording and read its header. Returns false if the file is
+ * missing or is not a recording of this version.
+ */
+bool replay_reader_open(ReplayReader *reader, const char *path);
+
+/*
+ * Apply the next recorded frame to in, which must have gone through
+ * input_begin_frame, and return its frame time in delta_time.
+ * Returns false at the end of the recording.
+ */
+bool replay_reader_frame(ReplayReader *reader, InputState *in, float *delta_time);
+
+/*
+ * Close the recording.
+ */
+void replay_reader_close(ReplayReader *reader);
+
+#endif // REPLAY_H
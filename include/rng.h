@@ -0,0 +1,103 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/*
+ * Number of independent generators advanced side by side by RngBatch.
+ */
+#define RNG_BATCH_LANES 8
+
+/*
+ * xoshiro128** pseudo random number generator.
+ *
+ * The state is owned by the caller, so every system can keep its own
+ * generator and a run is reproducible from its seed. Work split across
+ * threads should not share one generator: derive a stream per batch with
+ * rng_seed_stream from a seed and the batch index instead, so the result
+ * does not depend on which thread ran which batch.
+ */
+typedef struct Rng
+{
+    uint32_t s[4];
+} Rng;
+
+/*
+ * RNG_BATCH_LANES xoshiro128** generators in structure-of-arrays layout.
+ * Stepping all lanes together compiles to SIMD code, which makes bulk
+ * generation several times faster than calling rng_next in a loop.
+ */
+typedef struct RngBatch
+{
+    uint32_t s0[RNG_BATCH_LANES];
+    uint32_t s1[RNG_BATCH_LANES];
+    uint32_t s2[RNG_BATCH_LANES];
+    uint32_t s3[RNG_BATCH_LANES];
+} RngBatch;
+
+/*
+ * Seed a generator. Any 64-bit value, including 0, is a valid seed.
+ */
+void rng_seed(Rng *rng, uint64_t seed);
+
+/*
+ * Seed a generator for one of many independent streams of the same seed.
+ */
+void rng_seed_stream(Rng *rng, uint64_t seed, uint64_t stream);
+
+/*
+ * Seed every lane of a batch generator from values drawn from source,
+ * two per lane, the first one becoming the high word of the lane seed.
+ */
+void rng_batch_seed(RngBatch *batch, Rng *source);
+
+/*
+ * Write count uniform floats in [minv, maxv) to out.
+ */
+void rng_batch_fill(RngBatch *batch, float *out, int count, float minv, float maxv);
+
+/*
+ * Return the next 32 random bits.
+ */
+static inline uint32_t rng_next(Rng *rng)
+{
+    uint32_t *s = rng->s;
+    uint32_t x = s[1] * 5u;
+    uint32_t result = ((x << 7) | (x >> 25)) * 9u;
+    uint32_t t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 11) | (s[3] >> 21);
+
+    return result;
+}
+
+/*
+ * Return a uniform float in [0, 1).
+ */
+static inline float rng_float(Rng *rng)
+{
+    return (float)(rng_next(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+/*
+ * Return a uniform float in [minv, maxv).
+ */
+static inline float rng_range(Rng *rng, float minv, float maxv)
+{
+    return minv + (maxv - minv) * rng_float(rng);
+}
+
+/*
+ * Return a uniform integer in [0, n) for n > 0.
+ */
+static inline int rng_below(Rng *rng, int n)
+{
+    return (int)(((uint64_t)rng_next(rng) * (uint64_t)n) >> 32);
+}
+
+#endif // RNG_H
@@ -2,8 +2,16 @@
 #define SCENE_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "model.h"
 #include "geom.h"
+#include "pool.h"
+#include "water.h"
+#include "pond.h"
+#include "rain.h"
+#include "rng.h"
+#include "jobs.h"
+#include "draw_sort.h"
 
 struct Model;
 
@@ -16,12 +24,22 @@ struct Model;
 #define SCENE_MAX_FENCES 64
 #define SCENE_MAX_ROCKS 256
 #define SCENE_MAX_MONKEYS 64
-#define SCENE_MAX_BANANAS 128
 #define SCENE_MAX_TREES 256
 #define SCENE_MAX_GATES 8
 #define MAX_WATER_PARTICLES 128
-#define WATER_SIZE 64
-#define MAX_RAIN_DROPS 800
+
+/*
+ * Initial banana capacity.
+ * Banana storage is heap allocated and can be resized at runtime
+ * with scene_set_banana_capacity().
+ */
+#define SCENE_DEFAULT_BANANA_CAPACITY 128
+
+/*
+ * Seed used by scene_init. Runs with the same seed and the same inputs
+ * produce the same scene.
+ */
+#define SCENE_DEFAULT_SEED 0x6d6f6e6b65797a6full
 
 /*
  * Possible animation/behavior states of a monkey.
@@ -33,15 +51,77 @@ typedef enum
 } MonkeyState;
 
 /*
- * Simple water simulation grid.
- * h = water height field
- * v = water velocity field
+ * Parts of scene_update timed separately.
  */
-typedef struct
+typedef enum
+{
+    SCENE_SUBSYSTEM_OBSTACLES,
+    SCENE_SUBSYSTEM_ANIMATION,
+    SCENE_SUBSYSTEM_PARTICLES,
+    SCENE_SUBSYSTEM_WATER,
+    SCENE_SUBSYSTEM_RAIN,
+    SCENE_SUBSYSTEM_BANANAS,
+    SCENE_SUBSYSTEM_COUNT
+} SceneSubsystem;
+
+/*
+ * Shadow casters: the static ones only change with the scene layout, the
+ * dynamic ones move every step.
+ */
+typedef enum
+{
+    SCENE_CASTERS_STATIC,
+    SCENE_CASTERS_DYNAMIC
+} SceneCasters;
+
+/*
+ * Area a shadow map cascade covers, for culling its casters.
+ *
+ * light_view - column-major world to light space matrix
+ * min_x/max_x - light-space x extent of the cascade
+ * min_y/max_y - light-space y extent of the cascade; the cascade covers
+ *               the whole scene along the light direction
+ */
+typedef struct SceneCasterBox
+{
+    const float *light_view;
+    float min_x, max_x;
+    float min_y, max_y;
+} SceneCasterBox;
+
+/*
+ * Render passes of scene_render, in drawing order: opaque first, blended
+ * last.
+ */
+typedef enum
+{
+    SCENE_PASS_GROUND,
+    SCENE_PASS_OBJECTS,
+    SCENE_PASS_WATER,
+    SCENE_PASS_RAIN,
+    SCENE_PASS_COUNT
+} ScenePass;
+
+/*
+ * Per-frame state of the render passes, kept apart from the scene so
+ * that drawing never writes to it.
+ *
+ * view          - column-major world to eye matrix of the frame, as
+ *                 camera_apply_view builds it
+ * items         - draw list the passes sort into, grown on demand
+ * scratch       - scratch space of the sort, as large as items
+ * capacity      - entries items and scratch can hold
+ * object_count  - objects the depth pre-pass left sorted in items for
+ *                 the objects pass, -1 if none
+ */
+typedef struct SceneRenderContext
 {
-    float h[WATER_SIZE][WATER_SIZE];
-    float v[WATER_SIZE][WATER_SIZE];
-} WaterSim;
+    float view[16];
+    DrawItem *items;
+    DrawItem *scratch;
+    int capacity;
+    int object_count;
+} SceneRenderContext;
 
 /*
  * One rock instance placed in the scene.
@@ -77,7 +157,8 @@ typedef struct
 } SceneMonkey;
 
 /*
- * Small particle used above the pond for splash/ambient water effects.
+ * Small particle used above the ponds for splash/ambient water effects.
+ * Live particles are tracked by Scene.water_particle_pool.
  */
 typedef struct
 {
@@ -85,47 +166,47 @@ typedef struct
     float vx, vy, vz;
     float life;
     float max_life;
-    bool active;
 } WaterParticle;
 
 /*
- * One rain drop in the rain effect system.
- */
-typedef struct
-{
-    float x, y, z;
-    float speed;
-    float len;
-    bool active;
-} RainDrop;
-
-/*
- * One banana object in the scene.
+ * Banana storage in structure-of-arrays layout.
  *
- * vx, vy, vz       - linear velocity
- * yaw/pitch/roll   - current orientation
+ * Live bananas are kept dense in [0, count); removing one moves the last
+ * banana into its slot. Airborne bananas occupy [0, airborne_count) and
+ * bananas resting on the ground follow them, so the physics loops can run
+ * over contiguous ranges without per-banana active/on_ground checks.
+ *
+ * x, y, z          - positions
+ * vx, vy, vz       - linear velocities
+ * yaw/pitch/roll   - current orientations
  * ang_vel_*        - angular velocities for spinning motion
- * active           - whether the banana currently exists in the scene
- * on_ground        - whether the banana has landed
+ * prev_*           - pose before the last scene_update, for interpolation
+ * capacity         - allocated length of every array
  */
 typedef struct
 {
-    float x, y, z;
-    float vx, vy, vz;
+    int count;
+    int airborne_count;
+    int capacity;
 
-    float scale;
+    float *x, *y, *z;
+    float *vx, *vy, *vz;
 
-    float yaw_deg;
-    float pitch_deg;
-    float roll_deg;
+    float *scale;
 
-    float ang_vel_pitch;
-    float ang_vel_roll;
+    float *yaw_deg;
+    float *pitch_deg;
+    float *roll_deg;
 
-    bool collidable;
-    bool active;
-    bool on_ground;
-} SceneBanana;
+    float *ang_vel_pitch;
+    float *ang_vel_roll;
+
+    float *prev_x, *prev_y, *prev_z;
+    float *prev_pitch_deg;
+    float *prev_roll_deg;
+
+    bool *collidable;
+} SceneBananas;
 
 /*
  * One tree instance placed in the scene.
@@ -170,6 +251,7 @@ typedef struct
  * hx, hy, hz          - hinge position
  * w, t, h             - width, thickness and height
  * angle_deg           - current gate rotation
+ * prev_angle_deg      - rotation before the last scene_update
  * target_deg          - target gate rotation
  * closed_deg/open_deg - angles for closed/open states
  * speed_deg_per_s     - opening/closing speed
@@ -182,6 +264,7 @@ typedef struct
     float w, t, h;
 
     float angle_deg;
+    float prev_angle_deg;
     float target_deg;
     float closed_deg;
     float open_deg;
@@ -214,42 +297,100 @@ typedef struct
     int monkey_count;
 
     const struct Model *banana_model;
-    SceneBanana bananas[SCENE_MAX_BANANAS];
-    int banana_count;
+    SceneBananas bananas;
 
     const struct Model *tree_model;
     SceneTree trees[SCENE_MAX_TREES];
     int tree_count;
 
     WaterParticle water_particles[MAX_WATER_PARTICLES];
-    int water_particle_count;
+    SlotPool water_particle_pool;
 
-    RainDrop rain_drops[MAX_RAIN_DROPS];
+    RainSystem rain;
     bool rain_enabled;
 
-    float pond_x;
-    float pond_y;
-    float pond_z;
-    float pond_rx;
-    float pond_ry;
-    bool pond_enabled;
-    float pond_emit_timer;
+    PondSystem ponds;
 
-    WaterSim water;
+    float focus_x;
+    float focus_y;
+
+    JobPool *jobs;
+
+    Rng rng;
+    RngBatch particle_rng;
 
     int eaten_banana_count;
     float global_time;
 
     float ground_half_size;
 
+    /* Bumped whenever boxes, fences, rocks or trees change; cached shadows compare it */
+    uint32_t static_revision;
+
     SceneGate gates[SCENE_MAX_GATES];
     int gate_count;
+
+    /* Performance counter ticks spent per subsystem since the last reset */
+    uint64_t subsystem_ticks[SCENE_SUBSYSTEM_COUNT];
 } Scene;
 
 /*
  * Initialize the whole scene with default values.
+ * Returns false if any storage could not be allocated; the scene must
+ * still be released with scene_free.
  */
-void scene_init(Scene *scene);
+bool scene_init(Scene *scene);
+
+/*
+ * Release heap storage owned by the scene.
+ */
+void scene_free(Scene *scene);
+
+/*
+ * Copy everything needed to draw src into dst, so src can keep changing
+ * while dst is drawn. dst must be zeroed or a previous copy, and keeps
+ * its buffers where the sizes match. Pond water holds only its heights,
+ * and the copy has no job pool. Returns false if an allocation failed;
+ * dst is then incomplete but still safe to draw.
+ */
+bool scene_copy(Scene *dst, const Scene *src);
+
+/*
+ * Set the thread pool used to parallelise heavy simulation steps.
+ * NULL runs everything on the calling thread.
+ */
+void scene_set_job_pool(Scene *scene, JobPool *jobs);
+
+/*
+ * Set the point the level of detail is measured from, usually the camera.
+ * Ponds near it are simulated every frame, distant ones less often, and
+ * the rain falls around it.
+ */
+void scene_set_focus(Scene *scene, float x, float y);
+
+/*
+ * Reseed all scene randomness, including the rain drops.
+ * Returns false if the rain could not be rebuilt.
+ */
+bool scene_set_seed(Scene *scene, uint64_t seed);
+
+/*
+ * Replace the rain with count drops falling around the focus point.
+ * Returns false if the allocation failed.
+ */
+bool scene_set_rain_drops(Scene *scene, int count);
+
+/*
+ * Add an elliptical pond with a size x size simulation grid.
+ * Returns false if the allocation failed.
+ */
+bool scene_add_pond(Scene *scene, float x, float y, float z, float rx, float ry, int size);
+
+/*
+ * Reallocate every pond simulation grid with size x size cells.
+ * The ponds become calm. Returns false if an allocation failed.
+ */
+bool scene_set_water_size(Scene *scene, int size);
 
 /*
  * Add a simple colored box object to the scene.
@@ -307,6 +448,13 @@ void scene_set_banana_model(Scene *scene, const struct Model *banana_model);
  */
 void scene_add_banana(Scene *scene, float x, float y, float z, float scale, float yaw_deg, bool collidable);
 
+/*
+ * Resize banana storage to hold up to capacity bananas.
+ * Bananas beyond the new capacity are dropped.
+ * Returns false if the allocation failed.
+ */
+bool scene_set_banana_capacity(Scene *scene, int capacity);
+
 /*
  * Spawn a thrown banana with the given initial position and velocity.
  */
@@ -337,15 +485,64 @@ void scene_add_tree(Scene *scene, float x, float y, float z, float scale, float
  */
 void scene_update(Scene *scene, float delta_time);
 
+/*
+ * Return the display name of a subsystem timed by scene_update.
+ */
+const char *scene_subsystem_name(SceneSubsystem subsystem);
+
+/*
+ * Clear the per-subsystem time accumulated by scene_update.
+ */
+void scene_reset_subsystem_times(Scene *scene);
+
 /*
  * Rebuild the obstacle list used for collision handling.
  */
 void scene_collect_obstacles(Scene *scene);
 
 /*
- * Render the full scene.
+ * Initialize an empty render context.
+ */
+void scene_render_context_init(SceneRenderContext *context);
+
+/*
+ * Free the draw lists of a render context.
+ */
+void scene_render_context_free(SceneRenderContext *context);
+
+/*
+ * Start a frame drawn with the given column-major view matrix, as
+ * camera_apply_view returns it.
+ */
+void scene_render_context_begin(SceneRenderContext *context, const float *view);
+
+/*
+ * Render the full scene, interpolating moving objects by alpha in [0, 1]
+ * between the last two scene_update calls.
+ */
+void scene_render(const Scene *scene, SceneRenderContext *context, float alpha);
+
+/*
+ * Render a single pass of scene_render, so passes can be timed separately.
+ */
+void scene_render_pass(const Scene *scene, SceneRenderContext *context, ScenePass pass, float alpha);
+
+/*
+ * Write the depth of the heavy model instances, nearest first, without
+ * touching color, so the passes after it shade only visible fragments of
+ * them. Call before the ground pass, after the depth buffer is cleared.
+ * The objects are sorted once for both this and the objects pass.
+ */
+void scene_render_depth_prepass(const Scene *scene, SceneRenderContext *context, float alpha);
+
+/*
+ * Draw the geometry of one group of shadow casters from the same instance
+ * lists as the scene passes, without touching lighting, texturing or
+ * color state. Static casters are fences, boxes, rocks and trees; dynamic
+ * ones are gates, monkeys and bananas. Casters whose bounding sphere lies
+ * outside box are skipped; box may be NULL.
  */
-void scene_render(const Scene *scene);
+void scene_render_casters(const Scene *scene, SceneCasters casters, float alpha, const SceneCasterBox *box);
 
 /*
  * Test whether a 2D circle collides with any current obstacle.
@@ -0,0 +1,50 @@
+#ifndef SHADER_H
+#define SHADER_H
+
+#include <stdbool.h>
+
+/*
+ * True if GLSL 1.20 programs can be built: the OpenGL 2.0 entry points
+ * are there and the shading language is at least version 1.20. Needs the
+ * OpenGL context; checked once.
+ */
+bool shader_available(void);
+
+/*
+ * Compile and link a program from vertex and fragment shader source.
+ * Compile and link errors are printed under the given name.
+ * Returns the program, or 0 on failure.
+ */
+unsigned int shader_build(const char *name, const char *vertex_source, const char *fragment_source);
+
+/*
+ * Make a program current, or return to fixed function with 0. Skips the
+ * call if the program is already current.
+ */
+void shader_use(unsigned int program);
+
+/*
+ * Location of a uniform in a program, -1 if it has none by that name.
+ */
+int shader_uniform(unsigned int program, const char *name);
+
+/*
+ * Set a uniform of the current program. A location of -1 is ignored.
+ */
+void shader_set_int(int location, int value);
+void shader_set_float(int location, float value);
+void shader_set_vec2(int location, float x, float y);
+void shader_set_vec3(int location, float x, float y, float z);
+
+/*
+ * Set count consecutive mat4 uniforms, 16 column-major floats each, as
+ * glLoadMatrixf takes them.
+ */
+void shader_set_mat4(int location, int count, const float *matrices);
+
+/*
+ * Delete a program. The current program is reset to fixed function first.
+ */
+void shader_delete(unsigned int program);
+
+#endif // SHADER_H
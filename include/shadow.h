@@ -0,0 +1,60 @@
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include <stdbool.h>
+
+#include "scene.h"
+
+/*
+ * Cascades the view is split into, the resolution of each, and how far
+ * from the camera shadows reach. The scene shader in renderer.c samples
+ * exactly three cascades.
+ */
+#define SHADOW_CASCADES 3
+#define SHADOW_MAP_SIZE 1024
+#define SHADOW_DISTANCE 100.0f
+
+/*
+ * Shadow maps of the current frame, ready for the scene shader.
+ *
+ * eye_to_map  - per cascade, column-major matrix taking eye-space
+ *               positions of the current view to shadow map coordinates
+ *               and depth, each cascade in its own third of the maps
+ * static_fit  - per cascade, scale and x/y offset taking the cascade's
+ *               map coordinates to the static map, which covers a
+ *               larger square around it
+ * split_far   - view depth where each cascade ends
+ * static_map  - depth of the static casters, re-rendered only when a
+ *               cascade leaves its square or the light or the scene
+ *               layout changes
+ * dynamic_map - depth of the moving casters, rendered every frame
+ */
+typedef struct ShadowCascades
+{
+    float eye_to_map[SHADOW_CASCADES][16];
+    float static_fit[SHADOW_CASCADES][3];
+    float split_far[SHADOW_CASCADES];
+    unsigned int static_map;
+    unsigned int dynamic_map;
+} ShadowCascades;
+
+/*
+ * Create the shadow maps. Needs GLSL 1.20, framebuffer objects and depth
+ * textures; returns false, printing why, if any is missing.
+ */
+bool shadow_init(void);
+
+/*
+ * Delete the shadow maps.
+ */
+void shadow_shutdown(void);
+
+/*
+ * Fit the cascades to the view frustum of the given column-major view
+ * matrix and the current viewport, then render the casters into them.
+ * Call after the camera view is applied; viewport, matrices and
+ * framebuffer are restored. Returns NULL if shadows are not initialized.
+ */
+const ShadowCascades *shadow_render(const Scene *scene, const float *view, float alpha);
+
+#endif // SHADOW_H
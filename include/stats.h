@@ -0,0 +1,96 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Frames kept for the frame time graph and percentiles.
+ */
+#define STATS_HISTORY 240
+
+/*
+ * Per-frame counters incremented by the renderer and the scene.
+ *
+ * STAT_DRAW_CALLS        - glBegin/glEnd blocks and glDrawArrays calls
+ * STAT_VERTICES          - vertices submitted by those draws
+ * STAT_STATE_CHANGES     - changes made through the cached state switches:
+ *                          renderer_set_*, texture binds and units, programs
+ *                          and shadow map targets
+ * STAT_COLLISION_QUERIES - shape tests against the obstacle list
+ * STAT_STATIC_SHADOW_PASSES - cascades whose static shadow map was drawn
+ *                          again
+ */
+typedef enum
+{
+    STAT_DRAW_CALLS,
+    STAT_VERTICES,
+    STAT_STATE_CHANGES,
+    STAT_COLLISION_QUERIES,
+    STAT_STATIC_SHADOW_PASSES,
+    STAT_COUNT
+} StatCounter;
+
+/*
+ * Counter storage. Only touched through the functions below; exposed so
+ * stats_add can be inlined down to a single test of stats_enabled when
+ * the overlay is off.
+ */
+extern bool stats_enabled;
+extern uint32_t stats_counters[STAT_COUNT];
+
+/*
+ * Add n to a counter of the current frame.
+ */
+static inline void stats_add(StatCounter counter, uint32_t n)
+{
+    if (stats_enabled)
+        stats_counters[counter] += n;
+}
+
+/*
+ * Count one draw call submitting the given number of vertices.
+ */
+static inline void stats_draw(uint32_t vertices)
+{
+    if (stats_enabled)
+    {
+        stats_counters[STAT_DRAW_CALLS]++;
+        stats_counters[STAT_VERTICES] += vertices;
+    }
+}
+
+/*
+ * Turn counting on or off. Turning it on clears the history.
+ */
+void stats_set_enabled(bool enabled);
+
+/*
+ * Close the current frame: keep its counters for stats_last, add its
+ * duration to the history and start counting from zero.
+ */
+void stats_end_frame(float frame_ms);
+
+/*
+ * Return a counter of the last completed frame.
+ */
+uint32_t stats_last(StatCounter counter);
+
+/*
+ * Return the name of a counter for display.
+ */
+const char *stats_counter_name(StatCounter counter);
+
+/*
+ * Copy the frame time history, oldest first, into out (STATS_HISTORY
+ * entries). Returns the number of frames copied.
+ */
+int stats_frame_history(float *out);
+
+/*
+ * Return the frame time at percentile p (0..100) over the history,
+ * or 0 if there is no history.
+ */
+float stats_frame_percentile(float p);
+
+#endif // STATS_H
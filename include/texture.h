@@ -2,38 +2,260 @@
 #define TEXTURE_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-#ifdef _WIN32
-#include <Windows.h>
-#endif
+#include "mapped_file.h"
 
-#include <GL/gl.h>
+/*
+ * Most mip levels an image can have, enough for 32768 pixel textures.
+ */
+#define TEXTURE_MAX_LEVELS 16
+
+/*
+ * Texture units used: the base texture and one modulating it, which fixed
+ * function can apply too, then the static and dynamic shadow maps, which
+ * only shaders sample.
+ */
+#define TEXTURE_COLOR_UNITS 2
+#define TEXTURE_UNIT_SHADOW_STATIC 2
+#define TEXTURE_UNIT_SHADOW_DYNAMIC 3
+#define TEXTURE_UNITS 4
 
 /*
  * Represents a 2D OpenGL texture.
  *
- * id     - OpenGL texture identifier
- * width  - texture width in pixels
- * height - texture height in pixels
- * valid  - indicates whether the texture was successfully loaded
+ * id         - OpenGL texture identifier
+ * width      - texture width in pixels
+ * height     - texture height in pixels
+ * levels     - number of mip levels
+ * compressed - true if the driver stores the texture in a block format
+ * bytes      - video memory used by all levels
+ * valid      - indicates whether the texture was successfully loaded
  */
 typedef struct Texture2D
 {
-    GLuint id;
+    unsigned int id;
     int width;
     int height;
+    int levels;
+    bool compressed;
+    size_t bytes;
     bool valid;
 } Texture2D;
 
+/*
+ * A decoded RGBA8 image with its full mip chain, down to 1x1.
+ *
+ * pixels        - all levels, largest first, in one allocation or in
+ *                 the mapped converted file (then read-only)
+ * level_offset  - byte offset of each level in pixels
+ * level_width   - width of each level
+ * level_height  - height of each level
+ * level_count   - number of levels
+ * opaque        - true if every pixel has full alpha
+ * hash          - FNV-1a hash of the encoded file contents
+ * mapping       - converted file the pixels were mapped from, if any
+ */
+typedef struct TextureImage
+{
+    unsigned char *pixels;
+    size_t level_offset[TEXTURE_MAX_LEVELS];
+    int level_width[TEXTURE_MAX_LEVELS];
+    int level_height[TEXTURE_MAX_LEVELS];
+    int level_count;
+    bool opaque;
+    uint64_t hash;
+    MappedFile mapping;
+} TextureImage;
+
+/*
+ * Texture cache counters.
+ *
+ * entries      - distinct textures currently shared through the cache
+ * references   - handles currently held on them
+ * hits         - loads answered from the cache instead of a new upload
+ * bytes        - video memory of the cached textures
+ * bytes_saved  - video memory the hits would have used as separate copies
+ */
+typedef struct TextureCacheStats
+{
+    int entries;
+    int references;
+    int hits;
+    size_t bytes;
+    size_t bytes_saved;
+} TextureCacheStats;
+
+/*
+ * Decode an image file and build its mip chain with a box filter.
+ * With the disk cache on, the result is kept in "<file_path>.mzt" and
+ * later loads map that file instead, as long as the source keeps its
+ * size and modification time.
+ * Uses no OpenGL, so it can run on any thread.
+ * Returns true on success.
+ */
+bool texture_image_load(TextureImage *out_image, const char *file_path);
+
+/*
+ * Build an image with up to max_levels mip levels from RGBA8 pixels,
+ * pitch bytes per row. Returns false if out of memory.
+ */
+bool texture_image_from_pixels(TextureImage *out_image, const void *pixels, int width, int height, int pitch, int max_levels);
+
+/*
+ * Free the pixels of a decoded image.
+ */
+void texture_image_free(TextureImage *image);
+
+/*
+ * Upload a decoded image with all its levels, trilinear filtering and
+ * anisotropic filtering where available. Must be called on the thread
+ * that owns the OpenGL context.
+ * Returns true on success.
+ */
+bool texture_create(Texture2D *out_tex, const TextureImage *image);
+
 /*
  * Load an image file and create an OpenGL texture from it.
+ * Textures are shared through the cache: loading a file that is already
+ * loaded, under the same canonical path or with the same contents,
+ * returns another handle to the same texture.
  * Returns true on success.
  */
 bool texture_load(Texture2D *out_tex, const char *file_path);
 
 /*
- * Free the OpenGL texture and reset the structure.
+ * Take another handle to a cached texture loaded from file_path, if
+ * there is one. Returns false without touching out_tex otherwise.
+ */
+bool texture_cache_acquire(Texture2D *out_tex, const char *file_path);
+
+/*
+ * Like texture_create, but first looks for a cached texture with the
+ * same contents, size and format, and caches the new texture under
+ * file_path otherwise. On a hit file_path becomes another name of the
+ * cached texture for texture_cache_acquire.
+ */
+bool texture_create_cached(Texture2D *out_tex, const TextureImage *image, const char *file_path);
+
+/*
+ * Add a reference to a cached texture, for a copy of its handle that
+ * will be freed separately. Returns false if the texture is not cached.
+ */
+bool texture_retain(const Texture2D *tex);
+
+/*
+ * Bytes uploaded per frame by texture_stream_update in the game.
+ */
+#define TEXTURE_STREAM_FRAME_BYTES (2 * 1024 * 1024)
+
+/*
+ * Start loading an image file in the background. out_tex immediately
+ * gets a usable placeholder texture that texture_stream_update fills in
+ * with the real image, level by level. Shares the cache with texture_load.
+ * Returns false without touching out_tex when streaming is off; the
+ * caller then loads the file itself.
+ */
+bool texture_stream_load(Texture2D *out_tex, const char *file_path);
+
+/*
+ * Upload about byte_budget bytes of the textures being streamed. Call
+ * once per frame on the thread that owns the OpenGL context.
+ * Returns the number of textures still streaming.
+ */
+int texture_stream_update(size_t byte_budget);
+
+/*
+ * Number of textures still streaming.
+ */
+int texture_stream_pending(void);
+
+/*
+ * Release the buffer used for streaming. Call before the OpenGL context
+ * is destroyed.
+ */
+void texture_stream_shutdown(void);
+
+/*
+ * Bring a handle's size, level count and memory up to date. While its
+ * texture is still streaming, the handle describes the levels uploaded so
+ * far and false is returned.
+ */
+bool texture_refresh(Texture2D *tex);
+
+/*
+ * Read the cache counters.
+ */
+void texture_cache_stats(TextureCacheStats *out_stats);
+
+/*
+ * Bind a texture to GL_TEXTURE_2D of the selected unit, or unbind with 0.
+ * Returns false without a GL call if it is already bound.
+ */
+bool texture_bind(unsigned int id);
+
+/*
+ * True if TEXTURE_COLOR_UNITS textures can be applied in one pass. Needs
+ * the OpenGL context.
+ */
+bool texture_multitexture_available(void);
+
+/*
+ * True if shaders can use all TEXTURE_UNITS units, including the shadow
+ * map units. Needs the OpenGL context.
+ */
+bool texture_shader_units_available(void);
+
+/*
+ * Make a texture unit the target of texture_bind, glEnable(GL_TEXTURE_2D),
+ * glTexEnv and texture coordinate arrays. Returns false, leaving unit 0
+ * selected, if the unit is not available.
+ */
+bool texture_select_unit(int unit);
+
+/*
+ * Read the first level of a texture back as RGBA8, width * height * 4
+ * bytes. Returns true on success.
+ */
+bool texture_read_pixels(const Texture2D *tex, unsigned char *out_rgba);
+
+/*
+ * Load the decoded RGBA8 image of a cached texture again from the file it
+ * was loaded from, usually by mapping its converted file. Unlike
+ * texture_read_pixels it never sees the compressed copy in video memory.
+ * Returns false for textures not loaded from a file, and if the file no
+ * longer holds the same image.
+ */
+bool texture_cache_image(const Texture2D *tex, TextureImage *out_image);
+
+/*
+ * Let the driver store textures created from now on in a compressed
+ * block format (S3TC) when it supports one. On by default.
+ */
+void texture_set_compression(bool enabled);
+
+/*
+ * Let texture_stream_load stream textures. Off by default.
+ */
+void texture_set_streaming(bool enabled);
+
+/*
+ * Keep converted images next to their source files and load them from
+ * there instead of decoding the source again. On by default.
+ */
+void texture_set_disk_cache(bool enabled);
+
+/*
+ * Video memory a single uncompressed RGBA8 level of the texture would use,
+ * the way textures were stored before mipmapping and compression.
+ */
+size_t texture_base_bytes(const Texture2D *tex);
+
+/*
+ * Free the OpenGL texture and reset the structure. A cached texture is
+ * only deleted when its last handle is freed.
  */
 void texture_free(Texture2D *tex);
 
-#endif // TEXTURE_H
\ No newline at end of file
+#endif // TEXTURE_H
@@ -1,6 +1,9 @@
 #ifndef UI_H
 #define UI_H
 
+#include "profiler.h"
+#include "stats.h"
+
 /*
  * Draw the on-screen help overlay.
  *
@@ -11,4 +14,35 @@
  */
 void ui_draw_help_overlay(int screen_w, int screen_h, float light_intensity, int active_bananas, int eaten_bananas);
 
+/*
+ * Draw a flame graph of one profiled frame with the time of every zone.
+ * frame may be NULL before the first frame has been recorded.
+ */
+void ui_draw_profiler_overlay(int screen_w, int screen_h, const ProfileFrame *frame);
+
+/*
+ * Scene object counts shown by the statistics overlay.
+ *
+ * obstacles         - collision boxes collected this frame
+ * particles         - live water particles
+ * rain_drops        - drawn rain drops, 0 while rain is off
+ * bananas           - live bananas
+ * airborne_bananas  - bananas still in flight
+ */
+typedef struct UiStatsCounts
+{
+    int obstacles;
+    int particles;
+    int rain_drops;
+    int bananas;
+    int airborne_bananas;
+} UiStatsCounts;
+
+/*
+ * Draw the frame statistics panel: frame time, FPS, percentiles and a
+ * history graph, the renderer counters of the last frame and the scene
+ * object counts.
+ */
+void ui_draw_stats_overlay(int screen_w, int screen_h, const UiStatsCounts *counts);
+
 #endif // UI_H
\ No newline at end of file
@@ -0,0 +1,144 @@
+#ifndef WATER_H
+#define WATER_H
+
+#include <stdbool.h>
+
+#include "jobs.h"
+
+/*
+ * Default resolution of the pond height field.
+ */
+#define WATER_DEFAULT_SIZE 64
+
+/*
+ * Grids at least this large split their tiles across the job pool.
+ */
+#define WATER_PARALLEL_MIN_SIZE 128
+
+/*
+ * Sleep tracking.
+ * The grid is divided into square tiles of WATER_TILE_SIZE cells. Only
+ * awake tiles are simulated. A tile falls asleep after its heights and
+ * velocities stayed below WATER_SLEEP_EPSILON for WATER_SLEEP_STEPS
+ * steps; it is woken by a splash, or by a neighbour whose border cells
+ * rise above WATER_WAKE_THRESHOLD.
+ */
+#define WATER_TILE_SIZE 16
+#define WATER_SLEEP_EPSILON 2e-4f
+#define WATER_WAKE_THRESHOLD 1e-5f
+#define WATER_SLEEP_STEPS 30
+
+/*
+ * Row kernels for the wave stencil.
+ * The SIMD variants are only available on x86 and are selected at
+ * runtime from the CPU features reported by SDL.
+ */
+typedef enum
+{
+    WATER_KERNEL_SCALAR,
+    WATER_KERNEL_SSE2,
+    WATER_KERNEL_AVX2,
+    WATER_KERNEL_COUNT
+} WaterKernel;
+
+/*
+ * Height-field water simulation on a size x size grid.
+ *
+ * The grid is stored row-major: cell (x, y) is at index x * size + y.
+ * Two buffers are kept for both fields; each step reads the current pair
+ * and writes the other one, then flips current. Border cells are never
+ * written, so they stay zero in both buffers. Cells of a sleeping tile
+ * are zero in both buffers as well.
+ *
+ * h              - water height field buffers
+ * v              - water velocity field buffers
+ * current        - index of the buffer pair holding the latest state
+ * kernel         - stencil implementation used by water_sim_step
+ *
+ * tiles_per_side - number of tiles along one grid side
+ * tile_awake     - per tile: simulated in the next step
+ * tile_calm      - per tile: consecutive steps below the sleep epsilon
+ * tile_report    - per tile: result flags of the last step
+ * active_tiles   - tiles simulated in the last step
+ * active_count   - length of active_tiles
+ * sleep_enabled  - when false every tile is simulated every step
+ */
+typedef struct WaterSim
+{
+    int size;
+
+    float *h[2];
+    float *v[2];
+    int current;
+
+    WaterKernel kernel;
+
+    int tiles_per_side;
+    unsigned char *tile_awake;
+    unsigned char *tile_calm;
+    unsigned char *tile_report;
+    int *active_tiles;
+    int active_count;
+    bool sleep_enabled;
+} WaterSim;
+
+/*
+ * Return true if the kernel was compiled in and the CPU supports it.
+ */
+bool water_kernel_available(WaterKernel kernel);
+
+/*
+ * Return the fastest kernel available on this CPU.
+ */
+WaterKernel water_kernel_best(void);
+
+/*
+ * Return a short printable kernel name.
+ */
+const char *water_kernel_name(WaterKernel kernel);
+
+/*
+ * Allocate a calm size x size water grid using the best kernel,
+ * with sleep tracking enabled and every tile asleep.
+ * Returns false if size is below 4 or the allocation failed.
+ */
+bool water_sim_init(WaterSim *water, int size);
+
+/*
+ * Free the grid buffers.
+ */
+void water_sim_free(WaterSim *water);
+
+/*
+ * Give dst the grid size of src and copy the latest heights of src into
+ * it. Velocities and tile state are not copied, so dst is a still image
+ * of the surface, for drawing. Returns false if the allocation failed;
+ * dst is then empty.
+ */
+bool water_sim_copy_heights(WaterSim *dst, const WaterSim *src);
+
+/*
+ * Advance the simulation by delta_time seconds.
+ * Only awake tiles are updated. Large grids are split by tiles across
+ * jobs; jobs may be NULL.
+ */
+void water_sim_step(WaterSim *water, float delta_time, JobPool *jobs);
+
+/*
+ * Add a splash impulse at normalized grid position (u, v) in [0, 1].
+ * The splash radius scales with the grid resolution. Tiles touched by
+ * the splash are woken.
+ */
+void water_sim_splash(WaterSim *water, float u, float v);
+
+/*
+ * Return the number of tiles simulated in the last step.
+ */
+static inline int water_sim_active_tiles(const WaterSim *water) { return water->active_count; }
+
+/*
+ * Return the latest height field.
+ */
+static inline const float *water_sim_height(const WaterSim *water) { return water->h[water->current]; }
+
+#endif // WATER_H
@@ -0,0 +1,17 @@
+#ifndef ZOO_H
+#define ZOO_H
+
+#include "scene.h"
+#include "rng.h"
+
+/*
+ * Fill a freshly initialised scene with the zoo layout.
+ *
+ * Rocks, monkeys and trees are only added when the matching model was
+ * set on the scene, since their obstacles come from the model bounds.
+ * The models only need geometry, so the same layout can be built
+ * without a window. Tree placement draws from rng.
+ */
+void zoo_build(Scene *scene, Rng *rng);
+
+#endif // ZOO_H
@@ -0,0 +1,364 @@
+#include "atlas.h"
+
+#include <GL/gl.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Most distinct textures and most models handled in one call.
+ */
+#define ATLAS_MAX_ITEMS 64
+#define ATLAS_MAX_MODELS 64
+
+/*
+ * UVs this far outside [0, 1] still count as inside, to allow for
+ * rounding in exported models.
+ */
+#define ATLAS_UV_EPSILON 0.001f
+
+/*
+ * One texture placed in the atlas.
+ *
+ * texture  - the original texture
+ * image    - its decoded image, reloaded from the source file
+ * x, y     - position of its first pixel on the page
+ * page     - page it was placed on, -1 if it did not fit
+ */
+typedef struct AtlasItem
+{
+    Texture2D texture;
+    TextureImage image;
+    int x;
+    int y;
+    int page;
+} AtlasItem;
+
+/*
+ * True if every texture coordinate of the model lies within [0, 1].
+ */
+static bool atlas_uvs_in_unit_square(const Model *m)
+{
+    const float lo = -ATLAS_UV_EPSILON;
+    const float hi = 1.0f + ATLAS_UV_EPSILON;
+
+    for (int i = 0; i < m->vert_count; i++)
+    {
+        const ModelVertex *v = &m->verts[i];
+        if (v->u < lo || v->u > hi || v->v < lo || v->v > hi)
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Round up to a multiple of the gutter.
+ */
+static int atlas_align(int value)
+{
+    return (value + ATLAS_GUTTER - 1) / ATLAS_GUTTER * ATLAS_GUTTER;
+}
+
+/*
+ * qsort comparison: taller textures first, which keeps shelves tight.
+ */
+static int atlas_compare_height(const void *a, const void *b)
+{
+    const AtlasItem *x = (const AtlasItem *)a;
+    const AtlasItem *y = (const AtlasItem *)b;
+    return y->texture.height - x->texture.height;
+}
+
+/*
+ * Find the item holding a texture, or -1.
+ */
+static int atlas_find_item(const AtlasItem *items, int count, unsigned int id)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (items[i].texture.id == id)
+            return i;
+    }
+    return -1;
+}
+
+/*
+ * Shelf packing. Every texture takes a cell of its size plus a gutter on
+ * each side, rounded up to the gutter; shelves fill left to right and a
+ * page is closed when the next shelf would not fit. Returns the page
+ * count and stores the used height of each page.
+ */
+static int atlas_place(AtlasItem *items, int count, int page_width, int max_height, int *page_heights)
+{
+    int page = 0;
+    int shelf_x = 0;
+    int shelf_y = 0;
+    int shelf_h = 0;
+
+    page_heights[0] = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        AtlasItem *item = &items[i];
+        int cell_w = atlas_align(item->texture.width + 2 * ATLAS_GUTTER);
+        int cell_h = atlas_align(item->texture.height + 2 * ATLAS_GUTTER);
+
+        item->page = -1;
+
+        if (cell_w > page_width || cell_h > max_height)
+            continue;
+
+        if (shelf_x + cell_w > page_width)
+        {
+            shelf_y += shelf_h;
+            shelf_x = 0;
+            shelf_h = 0;
+        }
+
+        if (shelf_y + cell_h > max_height)
+        {
+            if (page + 1 == ATLAS_MAX_PAGES)
+                continue;
+
+            page++;
+            page_heights[page] = 0;
+            shelf_x = 0;
+            shelf_y = 0;
+            shelf_h = 0;
+        }
+
+        item->page = page;
+        item->x = shelf_x + ATLAS_GUTTER;
+        item->y = shelf_y + ATLAS_GUTTER;
+
+        shelf_x += cell_w;
+        if (cell_h > shelf_h)
+            shelf_h = cell_h;
+        if (shelf_y + shelf_h > page_heights[page])
+            page_heights[page] = shelf_y + shelf_h;
+    }
+
+    return page_heights[0] > 0 ? page + 1 : 0;
+}
+
+/*
+ * Copy the first level of a texture's image into its cell. The gutter
+ * repeats the nearest edge pixel, so filtering at the border sees the
+ * texture's own colors.
+ */
+static void atlas_blit(unsigned char *page, int page_width, const AtlasItem *item)
+{
+    const unsigned char *src = item->image.pixels + item->image.level_offset[0];
+    int w = item->texture.width;
+    int h = item->texture.height;
+
+    for (int y = -ATLAS_GUTTER; y < h + ATLAS_GUTTER; y++)
+    {
+        int sy = y < 0 ? 0 : (y >= h ? h - 1 : y);
+        unsigned char *row = page + ((size_t)(item->y + y) * page_width + item->x) * 4;
+
+        for (int x = -ATLAS_GUTTER; x < w + ATLAS_GUTTER; x++)
+        {
+            int sx = x < 0 ? 0 : (x >= w ? w - 1 : x);
+            memcpy(row + (ptrdiff_t)x * 4, src + ((size_t)sy * w + sx) * 4, 4);
+        }
+    }
+}
+
+/*
+ * Assemble one page from the decoded images of the original textures and
+ * upload it with a mip chain limited to what the gutter protects. The
+ * page is encoded once, from the source pixels, rather than from a copy
+ * the driver may already have compressed.
+ */
+static bool atlas_build_page(const AtlasItem *items, int count, int page, int width, int height, Texture2D *out)
+{
+    unsigned char *pixels = calloc((size_t)width * height, 4);
+    if (!pixels)
+        return false;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (items[i].page == page)
+            atlas_blit(pixels, width, &items[i]);
+    }
+
+    int levels = 1;
+    while ((1 << (levels - 1)) < ATLAS_GUTTER)
+        levels++;
+
+    TextureImage image;
+    bool ok = texture_image_from_pixels(&image, pixels, width, height, width * 4, levels);
+    free(pixels);
+
+    if (!ok)
+        return false;
+
+    char name[32];
+    snprintf(name, sizeof(name), "<atlas page %d>", page);
+
+    ok = texture_create_cached(out, &image, name);
+    texture_image_free(&image);
+    return ok;
+}
+
+/*
+ * Release the decoded images of the items.
+ */
+static void atlas_free_images(AtlasItem *items, int count)
+{
+    for (int i = 0; i < count; i++)
+        texture_image_free(&items[i].image);
+}
+
+/*
+ * Collect the distinct textures of the eligible models with their decoded
+ * images, pack them, build the pages, then point every packed model at
+ * its page with UVs scaled into its cell. Each model keeps a reference on
+ * its page and drops the one on its old texture.
+ */
+void atlas_pack_models(Model *const *models, int count, AtlasResult *out_result)
+{
+    AtlasItem items[ATLAS_MAX_ITEMS];
+    bool eligible[ATLAS_MAX_MODELS];
+    int eligible_count = 0;
+    int item_count = 0;
+
+    memset(out_result, 0, sizeof(*out_result));
+
+    if (count > ATLAS_MAX_MODELS)
+        count = ATLAS_MAX_MODELS;
+
+    for (int i = 0; i < count; i++)
+    {
+        const Model *m = models[i];
+        eligible[i] = false;
+
+        if (!m || !m->texture.valid || !m->has_uvs)
+            continue;
+
+        /* The AO texture shares the UVs, so they cannot be remapped */
+        if (m->ao_texture.valid || !atlas_uvs_in_unit_square(m))
+        {
+            out_result->skipped++;
+            continue;
+        }
+
+        if (atlas_find_item(items, item_count, m->texture.id) < 0 && item_count < ATLAS_MAX_ITEMS)
+        {
+            /* Without its source image the texture stays where it is */
+            if (!texture_cache_image(&m->texture, &items[item_count].image))
+            {
+                out_result->skipped++;
+                continue;
+            }
+
+            items[item_count].texture = m->texture;
+            item_count++;
+        }
+
+        eligible[i] = true;
+        eligible_count++;
+    }
+
+    if (item_count == 0)
+        return;
+
+    qsort(items, (size_t)item_count, sizeof(items[0]), atlas_compare_height);
+
+    /*
+     * A power of two wide page about as wide as it is tall: start from
+     * the widest cell and double while the cells' area does not fit a
+     * square.
+     */
+    GLint max_texture_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    int max_size = max_texture_size > 0 && max_texture_size < ATLAS_MAX_SIZE ? max_texture_size : ATLAS_MAX_SIZE;
+
+    size_t area = 0;
+    int widest = 0;
+    for (int i = 0; i < item_count; i++)
+    {
+        int cell_w = atlas_align(items[i].texture.width + 2 * ATLAS_GUTTER);
+        int cell_h = atlas_align(items[i].texture.height + 2 * ATLAS_GUTTER);
+        area += (size_t)cell_w * cell_h;
+        if (cell_w > widest)
+            widest = cell_w;
+    }
+
+    int page_width = ATLAS_GUTTER;
+    while (page_width < max_size && (page_width < widest || (size_t)page_width * page_width < area))
+        page_width *= 2;
+
+    int page_heights[ATLAS_MAX_PAGES];
+    int page_count = atlas_place(items, item_count, page_width, max_size, page_heights);
+
+    Texture2D pages[ATLAS_MAX_PAGES];
+    for (int p = 0; p < page_count; p++)
+    {
+        if (!atlas_build_page(items, item_count, p, page_width, page_heights[p], &pages[p]))
+        {
+            fprintf(stderr, "Texture atlas page %d not built, keeping the separate textures.\n", p);
+            for (int q = 0; q < p; q++)
+                texture_free(&pages[q]);
+            atlas_free_images(items, item_count);
+            out_result->skipped += eligible_count;
+            return;
+        }
+
+        out_result->page_width[p] = page_width;
+        out_result->page_height[p] = page_heights[p];
+    }
+
+    atlas_free_images(items, item_count);
+
+    out_result->pages = page_count;
+
+    for (int i = 0; i < item_count; i++)
+    {
+        if (items[i].page >= 0)
+            out_result->textures++;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!eligible[i])
+            continue;
+
+        Model *m = models[i];
+        int index = atlas_find_item(items, item_count, m->texture.id);
+
+        if (index < 0 || items[index].page < 0)
+        {
+            out_result->skipped++;
+            continue;
+        }
+
+        const AtlasItem *item = &items[index];
+        const Texture2D *page = &pages[item->page];
+
+        float u_scale = (float)item->texture.width / (float)page->width;
+        float v_scale = (float)item->texture.height / (float)page->height;
+        float u_offset = (float)item->x / (float)page->width;
+        float v_offset = (float)item->y / (float)page->height;
+
+        for (int v = 0; v < m->vert_count; v++)
+        {
+            ModelVertex *vert = &m->verts[v];
+            vert->u = u_offset + vert->u * u_scale;
+            vert->v = v_offset + vert->v * v_scale;
+        }
+
+        Texture2D old = m->texture;
+        m->texture = *page;
+        texture_retain(page);
+        texture_free(&old);
+
+        out_result->models++;
+    }
+
+    /* The models hold their own references now */
+    for (int p = 0; p < page_count; p++)
+        texture_free(&pages[p]);
+}
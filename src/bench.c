@@ -0,0 +1,958 @@
+#include "bench.h"
+#include "game.h"
+#include "scene.h"
+#include "pool.h"
+#include "water.h"
+#include "jobs.h"
+#include "pond.h"
+#include "rain.h"
+#include "rng.h"
+
+#include <SDL2/SDL.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Convert a performance counter interval to nanoseconds.
+ */
+static double counter_to_ns(uint64_t ticks)
+{
+    return (double)ticks * 1e9 / (double)SDL_GetPerformanceFrequency();
+}
+
+/*
+ * Throw bananas from random spots above the ground, spread over the whole
+ * zoo, with the same velocity ranges the player throw uses.
+ */
+static void bench_throw_bananas(Scene *scene, Rng *rng, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        float angle = rng_range(rng, 0.0f, 6.28318f);
+        float speed = rng_range(rng, 8.5f, 11.5f);
+
+        scene_throw_banana(
+            scene,
+            rng_range(rng, -90.0f, 90.0f),
+            rng_range(rng, -90.0f, 90.0f),
+            rng_range(rng, 1.0f, 12.0f),
+            cosf(angle) * speed,
+            sinf(angle) * speed,
+            rng_range(rng, 3.2f, 4.6f));
+    }
+}
+
+/*
+ * Banana physics stress test.
+ * The fences and the main pond of the regular zoo are added so that
+ * obstacle tests and pond lookups are part of the measured cost, but no
+ * monkeys, so no banana gets eaten.
+ */
+int bench_bananas(int banana_count, int frames)
+{
+    const float delta_time = 1.0f / 60.0f;
+
+    if (banana_count < 1 || frames < 1)
+    {
+        fprintf(stderr, "bench_bananas: invalid arguments\n");
+        return 1;
+    }
+
+    Scene *scene = malloc(sizeof(Scene));
+    if (!scene)
+    {
+        fprintf(stderr, "bench_bananas: out of memory\n");
+        return 1;
+    }
+
+    Rng rng;
+    rng_seed(&rng, 1234u);
+
+    if (!scene_init(scene))
+    {
+        fprintf(stderr, "bench_bananas: out of memory\n");
+        scene_free(scene);
+        free(scene);
+        return 1;
+    }
+    scene->rain_enabled = false;
+
+    scene_add_fence(scene, 0.0f, 0.0f, 25.0f, 2.0f, true);
+    scene_add_fence(scene, 40.0f, 10.0f, 12.0f, 2.0f, true);
+    scene_add_fence(scene, -45.0f, -20.0f, 15.0f, 2.0f, true);
+    scene_add_pond(scene, 18.0f, -55.0f, 0.06f, 8.0f, 5.0f, WATER_DEFAULT_SIZE);
+
+    if (!scene_set_banana_capacity(scene, banana_count))
+    {
+        fprintf(stderr, "bench_bananas: could not allocate %d bananas\n", banana_count);
+        scene_free(scene);
+        free(scene);
+        return 1;
+    }
+
+    bench_throw_bananas(scene, &rng, banana_count);
+
+    uint64_t total = 0;
+    double banana_frames = 0.0;
+
+    for (int f = 0; f < frames; f++)
+    {
+        int live = scene_get_active_banana_count(scene);
+
+        uint64_t t0 = SDL_GetPerformanceCounter();
+        scene_update(scene, delta_time);
+        uint64_t t1 = SDL_GetPerformanceCounter();
+
+        total += t1 - t0;
+        banana_frames += (double)live;
+    }
+
+    double total_ns = counter_to_ns(total);
+
+    printf("bananas: %d thrown, %d frames\n", banana_count, frames);
+    printf("  live at end     : %d (%d airborne)\n",
+           scene->bananas.count, scene->bananas.airborne_count);
+    printf("  avg frame       : %.3f ms\n", total_ns / (double)frames * 1e-6);
+    printf("  ns per banana   : %.2f\n", banana_frames > 0.0 ? total_ns / banana_frames : 0.0);
+
+    scene_free(scene);
+    free(scene);
+    return 0;
+}
+
+/*
+ * Check that every slot is either free or live exactly once and that
+ * live_pos matches the live list.
+ */
+static bool pool_is_consistent(const SlotPool *pool, const unsigned char *live_flags)
+{
+    if (pool->live_count + pool->free_count != pool->capacity)
+        return false;
+
+    for (int i = 0; i < pool->live_count; i++)
+    {
+        int slot = pool->live[i];
+        if (pool->live_pos[slot] != i || !live_flags[slot])
+            return false;
+    }
+
+    for (int i = 0; i < pool->free_count; i++)
+    {
+        int slot = pool->free_slots[i];
+        if (pool->live_pos[slot] != -1 || live_flags[slot])
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * Slot pool churn test.
+ * Spawn and despawn are mixed with a bias that keeps the pool around
+ * half full, which is the worst case for free list reuse. Every fourth
+ * batch releases a burst of slots to mimic mass despawns.
+ */
+int bench_pool_churn(int slots, int operations)
+{
+    if (slots < 1 || operations < 1)
+    {
+        fprintf(stderr, "bench_pool_churn: invalid arguments\n");
+        return 1;
+    }
+
+    SlotPool pool;
+    unsigned char *live_flags = calloc((size_t)slots, 1);
+
+    if (!live_flags || !pool_init(&pool, slots))
+    {
+        fprintf(stderr, "bench_pool_churn: out of memory\n");
+        free(live_flags);
+        return 1;
+    }
+
+    Rng rng;
+    rng_seed(&rng, 1234u);
+
+    int acquired = 0;
+    int released = 0;
+    int failed = 0;
+
+    uint64_t t0 = SDL_GetPerformanceCounter();
+
+    for (int op = 0; op < operations; op++)
+    {
+        bool spawn = pool_live_count(&pool) < slots / 2 ? (rng_below(&rng, 4) != 0) : (rng_below(&rng, 4) == 0);
+
+        if (spawn)
+        {
+            int slot = pool_acquire(&pool);
+            if (slot < 0)
+            {
+                failed++;
+                continue;
+            }
+            live_flags[slot] = 1;
+            acquired++;
+        }
+        else if (pool_live_count(&pool) > 0)
+        {
+            int burst = (op & 0x3ff) == 0 ? pool_live_count(&pool) / 4 + 1 : 1;
+            for (int k = 0; k < burst; k++)
+            {
+                int slot = pool_live_slot(&pool, rng_below(&rng, pool_live_count(&pool)));
+                pool_release(&pool, slot);
+                live_flags[slot] = 0;
+                released++;
+            }
+        }
+    }
+
+    uint64_t t1 = SDL_GetPerformanceCounter();
+
+    bool ok = pool_is_consistent(&pool, live_flags);
+
+    printf("pool churn: %d slots, %d operations\n", slots, operations);
+    printf("  acquired        : %d (%d failed, pool full)\n", acquired, failed);
+    printf("  released        : %d\n", released);
+    printf("  live at end     : %d\n", pool_live_count(&pool));
+    printf("  ns per op       : %.2f\n", counter_to_ns(t1 - t0) / (double)(acquired + released + failed));
+    printf("  bookkeeping     : %s\n", ok ? "ok" : "CORRUPT");
+
+    pool_free(&pool);
+    free(live_flags);
+    return ok ? 0 : 1;
+}
+
+/*
+ * Stir a pond with a fixed set of splashes so every run and every kernel
+ * works on the same non-trivial data.
+ */
+static void bench_water_stir(WaterSim *water)
+{
+    Rng rng;
+    rng_seed(&rng, 1234u);
+
+    for (int i = 0; i < 16; i++)
+        water_sim_splash(water, rng_range(&rng, 0.1f, 0.9f), rng_range(&rng, 0.1f, 0.9f));
+}
+
+/*
+ * Run one timed water simulation with the given kernel and pool.
+ * With sleep tracking off every cell is simulated, which is what the
+ * kernel and thread comparisons need. If awake_tiles is given it receives
+ * the average number of simulated tiles per step. Returns the elapsed
+ * time in nanoseconds, or a negative value on allocation failure.
+ */
+static double bench_water_run(int size, int steps, WaterKernel kernel, JobPool *jobs,
+                              bool stir, bool sleep, double *awake_tiles)
+{
+    WaterSim water;
+    if (!water_sim_init(&water, size))
+        return -1.0;
+
+    water.kernel = kernel;
+    water.sleep_enabled = sleep;
+
+    if (stir)
+        bench_water_stir(&water);
+
+    double awake = 0.0;
+
+    uint64_t t0 = SDL_GetPerformanceCounter();
+    for (int s = 0; s < steps; s++)
+    {
+        water_sim_step(&water, 1.0f / 60.0f, jobs);
+        awake += (double)water_sim_active_tiles(&water);
+    }
+    uint64_t t1 = SDL_GetPerformanceCounter();
+
+    if (awake_tiles)
+        *awake_tiles = awake / (double)steps;
+
+    water_sim_free(&water);
+    return counter_to_ns(t1 - t0);
+}
+
+/*
+ * Run the given kernel and the scalar reference side by side and return
+ * the largest height or velocity difference after the given steps.
+ * The reference always simulates every cell, so with sleep enabled this
+ * also measures the error introduced by sleeping tiles.
+ * The step length alternates so the delta_time scaling is exercised too.
+ */
+static float bench_water_max_error(int size, int steps, WaterKernel kernel, bool sleep)
+{
+    WaterSim ref;
+    WaterSim test;
+
+    if (!water_sim_init(&ref, size))
+        return -1.0f;
+    if (!water_sim_init(&test, size))
+    {
+        water_sim_free(&ref);
+        return -1.0f;
+    }
+
+    ref.kernel = WATER_KERNEL_SCALAR;
+    ref.sleep_enabled = false;
+    test.kernel = kernel;
+    test.sleep_enabled = sleep;
+
+    bench_water_stir(&ref);
+    bench_water_stir(&test);
+
+    for (int s = 0; s < steps; s++)
+    {
+        float dt = (s & 1) ? 1.0f / 60.0f : 1.0f / 144.0f;
+        water_sim_step(&ref, dt, NULL);
+        water_sim_step(&test, dt, NULL);
+    }
+
+    float max_err = 0.0f;
+    size_t cells = (size_t)size * (size_t)size;
+
+    for (size_t i = 0; i < cells; i++)
+    {
+        float dh = fabsf(ref.h[ref.current][i] - test.h[test.current][i]);
+        float dv = fabsf(ref.v[ref.current][i] - test.v[test.current][i]);
+        if (dh > max_err)
+            max_err = dh;
+        if (dv > max_err)
+            max_err = dv;
+    }
+
+    water_sim_free(&ref);
+    water_sim_free(&test);
+    return max_err;
+}
+
+/*
+ * Benchmark one grid size: every available kernel on one thread with a
+ * correctness check against the scalar kernel, then thread scaling with
+ * the best kernel.
+ */
+static bool bench_water_size(int size, int steps)
+{
+    const float tolerance = 1e-5f;
+    int cpu_count = SDL_GetCPUCount();
+    double cells = (double)(size - 2) * (double)(size - 2) * (double)steps;
+    bool ok = true;
+
+    printf("water: %dx%d grid, %d steps\n", size, size, steps);
+
+    for (int k = 0; k < WATER_KERNEL_COUNT; k++)
+    {
+        if (!water_kernel_available((WaterKernel)k))
+            continue;
+
+        double ns = bench_water_run(size, steps, (WaterKernel)k, NULL, true, false, NULL);
+        float err = bench_water_max_error(size, 64, (WaterKernel)k, false);
+
+        if (ns < 0.0 || err < 0.0f)
+        {
+            fprintf(stderr, "bench_water: out of memory\n");
+            return false;
+        }
+
+        bool match = err <= tolerance;
+        ok = ok && match;
+
+        printf("  %-6s 1 thread : %8.1f Mcells/s  max err %.2g %s\n",
+               water_kernel_name((WaterKernel)k), cells / ns * 1e3, err, match ? "ok" : "MISMATCH");
+    }
+
+    WaterKernel best = water_kernel_best();
+    int tiles = (size + WATER_TILE_SIZE - 1) / WATER_TILE_SIZE;
+    tiles *= tiles;
+
+    double awake = 0.0;
+    double stirred_ns = bench_water_run(size, steps, best, NULL, true, true, &awake);
+    double calm_ns = bench_water_run(size, steps, best, NULL, false, true, NULL);
+    float sleep_err = bench_water_max_error(size, 600, best, true);
+
+    if (stirred_ns < 0.0 || calm_ns < 0.0 || sleep_err < 0.0f)
+    {
+        fprintf(stderr, "bench_water: out of memory\n");
+        return false;
+    }
+
+    printf("  sleep, stirred  : %8.4f ms/step  %.1f%% tiles awake  max err %.2g\n",
+           stirred_ns / (double)steps * 1e-6, awake * 100.0 / (double)tiles, sleep_err);
+    printf("  sleep, calm     : %8.4f ms/step\n", calm_ns / (double)steps * 1e-6);
+
+    if (size < WATER_PARALLEL_MIN_SIZE)
+    {
+        printf("  (grids below %d run single-threaded)\n", WATER_PARALLEL_MIN_SIZE);
+        return ok;
+    }
+
+    for (int threads = 2; threads <= cpu_count; threads *= 2)
+    {
+        JobPool pool;
+        if (!jobs_init(&pool, threads - 1))
+            break;
+
+        double ns = bench_water_run(size, steps, best, &pool, true, false, NULL);
+        jobs_shutdown(&pool);
+
+        if (ns < 0.0)
+        {
+            fprintf(stderr, "bench_water: out of memory\n");
+            return false;
+        }
+
+        printf("  %-6s %d threads: %8.1f Mcells/s\n",
+               water_kernel_name(best), threads, cells / ns * 1e3);
+    }
+
+    return ok;
+}
+
+/*
+ * Water height-field throughput test.
+ * A size of 0 runs a sweep over several grid sizes; the step count is
+ * scaled so every size simulates about the same number of cells.
+ */
+int bench_water(int size, int steps)
+{
+    static const int sweep[] = {64, 128, 256, 512, 1024};
+
+    if (size != 0 && size < 4)
+    {
+        fprintf(stderr, "bench_water: invalid arguments\n");
+        return 1;
+    }
+
+    if (steps < 1)
+        steps = 600;
+
+    printf("water: %d CPUs, best kernel %s\n", SDL_GetCPUCount(), water_kernel_name(water_kernel_best()));
+
+    bool ok = true;
+
+    if (size != 0)
+        return bench_water_size(size, steps) ? 0 : 1;
+
+    for (int i = 0; i < (int)(sizeof(sweep) / sizeof(sweep[0])); i++)
+    {
+        int n = sweep[i];
+        int scaled = (int)((double)steps * 256.0 * 256.0 / ((double)n * (double)n));
+        if (scaled < 10)
+            scaled = 10;
+
+        ok = bench_water_size(n, scaled) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
+
+/*
+ * Rain throughput test.
+ * The ponds of the regular zoo are added and the centre circles around the
+ * main pond, so landings are tested against water every frame. The number
+ * of collected landings is checked against the number of completed falls
+ * derived from the drop clocks, and every drawn drop must lie inside the
+ * rain area.
+ */
+int bench_rain(int drop_count, int frames)
+{
+    const float delta_time = 1.0f / 60.0f;
+
+    if (drop_count < 1 || frames < 1)
+    {
+        fprintf(stderr, "bench_rain: invalid arguments\n");
+        return 1;
+    }
+
+    RainSystem rain;
+    PondSystem ponds;
+    pond_system_init(&ponds);
+
+    if (!rain_init(&rain, drop_count, 1234u) ||
+        pond_system_add(&ponds, 18.0f, -55.0f, 0.06f, 8.0f, 5.0f, WATER_DEFAULT_SIZE) < 0 ||
+        pond_system_add(&ponds, -22.0f, 52.0f, 0.06f, 6.0f, 4.0f, 32) < 0 ||
+        pond_system_add(&ponds, 140.0f, -120.0f, 0.06f, 14.0f, 9.0f, 96) < 0)
+    {
+        fprintf(stderr, "bench_rain: out of memory\n");
+        rain_free(&rain);
+        pond_system_free(&ponds);
+        return 1;
+    }
+
+    uint64_t update_ticks = 0;
+    uint64_t build_ticks = 0;
+    long long landings = 0;
+    long long splashes = 0;
+    bool inside = true;
+
+    for (int f = 0; f < frames; f++)
+    {
+        float angle = (float)f * 0.01f;
+        float cx = 18.0f + cosf(angle) * 30.0f;
+        float cy = -55.0f + sinf(angle) * 30.0f;
+
+        uint64_t t0 = SDL_GetPerformanceCounter();
+        rain_update(&rain, delta_time, cx, cy);
+        splashes += rain_splash_ponds(&rain, &ponds);
+        uint64_t t1 = SDL_GetPerformanceCounter();
+        int vertex_count = rain_build_vertices(&rain, NULL);
+        uint64_t t2 = SDL_GetPerformanceCounter();
+
+        update_ticks += t1 - t0;
+        build_ticks += t2 - t1;
+        landings += rain.landed_count;
+
+        for (int v = 0; v < vertex_count; v++)
+        {
+            const float *p = &rain.vertices[v * 3];
+            if (fabsf(p[0] - cx) > RAIN_HALF_EXTENT + 0.01f || fabsf(p[1] - cy) > RAIN_HALF_EXTENT + 0.01f)
+                inside = false;
+        }
+    }
+
+    /* Every drop falls for longer than a frame, so each fall lands exactly once */
+    long long expected = 0;
+    for (int i = 0; i < rain.count; i++)
+    {
+        double end = rain.time * (double)rain.inv_period[i] + (double)rain.phase[i];
+        expected += (long long)floor(end) - (long long)floor((double)rain.phase[i]);
+    }
+
+    bool ok = landings == expected && inside;
+
+    double update_ms = counter_to_ns(update_ticks) / (double)frames * 1e-6;
+    double build_ms = counter_to_ns(build_ticks) / (double)frames * 1e-6;
+
+    printf("rain: %d drops, %d frames\n", drop_count, frames);
+    printf("  update + splash : %.4f ms/frame (target 0.5 ms)\n", update_ms);
+    printf("  vertex build    : %.4f ms/frame (target 0.5 ms)\n", build_ms);
+    printf("  landings        : %.1f per frame, %.2f splashes per frame\n",
+           (double)landings / (double)frames, (double)splashes / (double)frames);
+    printf("  landing count   : %lld of %lld %s\n", landings, expected, landings == expected ? "ok" : "MISMATCH");
+    printf("  drops in area   : %s\n", inside ? "ok" : "FAILED");
+
+    rain_free(&rain);
+    pond_system_free(&ponds);
+    return ok ? 0 : 1;
+}
+
+/*
+ * Values generated per pass in the random number test.
+ */
+#define BENCH_RNG_CHUNK 4096
+
+/*
+ * Simulate a short banana throw in a fresh scene with the given seed and
+ * return a checksum of the final banana state, or NaN if the scene could
+ * not be allocated.
+ */
+static double bench_rng_scene_checksum(Scene *scene, uint64_t seed)
+{
+    if (!scene_init(scene))
+    {
+        scene_free(scene);
+        return NAN;
+    }
+    scene_set_seed(scene, seed);
+    scene_add_pond(scene, 18.0f, -55.0f, 0.06f, 8.0f, 5.0f, WATER_DEFAULT_SIZE);
+
+    for (int f = 0; f < 120; f++)
+    {
+        if (f < 60)
+            scene_throw_banana(scene, 18.0f, -45.0f, 1.5f, 0.0f, -8.0f, 3.5f);
+        scene_update(scene, 1.0f / 60.0f);
+    }
+
+    double sum = 0.0;
+    const SceneBananas *b = &scene->bananas;
+    for (int i = 0; i < b->count; i++)
+        sum += (double)b->x[i] + (double)b->y[i] * 3.0 + (double)b->pitch_deg[i] * 7.0;
+
+    const float *h = water_sim_height(&scene->ponds.ponds[0].water);
+    for (int i = 0; i < WATER_DEFAULT_SIZE * WATER_DEFAULT_SIZE; i++)
+        sum += (double)h[i] * (double)(i + 1);
+
+    scene_free(scene);
+    return sum;
+}
+
+/*
+ * Random number generator test.
+ * Compares rand() with the scene generator and the batch generator, checks
+ * that a seed reproduces its sequence, that streams and seeds differ, that
+ * batch output stays in range with a plausible mean, and that two scenes
+ * with the same seed end up identical.
+ */
+int bench_rng(int count)
+{
+    if (count < 1)
+    {
+        fprintf(stderr, "bench_rng: invalid arguments\n");
+        return 1;
+    }
+
+    float *out = malloc(BENCH_RNG_CHUNK * sizeof(float));
+    Scene *scene = malloc(sizeof(Scene));
+    if (!out || !scene)
+    {
+        fprintf(stderr, "bench_rng: out of memory\n");
+        free(out);
+        free(scene);
+        return 1;
+    }
+
+    volatile float sink = 0.0f;
+    Rng rng;
+    RngBatch batch;
+
+    /* Values go through a cache sized buffer so memory bandwidth is not measured */
+    uint64_t t0 = SDL_GetPerformanceCounter();
+    srand(1234u);
+    for (int done = 0; done < count; done += BENCH_RNG_CHUNK)
+    {
+        int n = count - done < BENCH_RNG_CHUNK ? count - done : BENCH_RNG_CHUNK;
+        for (int i = 0; i < n; i++)
+            out[i] = (float)rand() / (float)RAND_MAX;
+        sink += out[n - 1];
+    }
+
+    uint64_t t1 = SDL_GetPerformanceCounter();
+    rng_seed(&rng, 1234u);
+    for (int done = 0; done < count; done += BENCH_RNG_CHUNK)
+    {
+        int n = count - done < BENCH_RNG_CHUNK ? count - done : BENCH_RNG_CHUNK;
+        for (int i = 0; i < n; i++)
+            out[i] = rng_float(&rng);
+        sink += out[n - 1];
+    }
+
+    uint64_t t2 = SDL_GetPerformanceCounter();
+    rng_seed(&rng, 1234u);
+    rng_batch_seed(&batch, &rng);
+    for (int done = 0; done < count; done += BENCH_RNG_CHUNK)
+    {
+        int n = count - done < BENCH_RNG_CHUNK ? count - done : BENCH_RNG_CHUNK;
+        rng_batch_fill(&batch, out, n, 0.0f, 1.0f);
+        sink += out[n - 1];
+    }
+
+    uint64_t t3 = SDL_GetPerformanceCounter();
+    (void)sink;
+
+    /* Untimed pass over fresh batch output for range and mean */
+    double mean = 0.0;
+    bool in_range = true;
+    rng_batch_seed(&batch, &rng);
+    for (int done = 0; done < count; done += BENCH_RNG_CHUNK)
+    {
+        int n = count - done < BENCH_RNG_CHUNK ? count - done : BENCH_RNG_CHUNK;
+        rng_batch_fill(&batch, out, n, 0.0f, 1.0f);
+
+        for (int i = 0; i < n; i++)
+        {
+            mean += (double)out[i];
+            if (out[i] < 0.0f || out[i] >= 1.0f)
+                in_range = false;
+        }
+    }
+    mean /= (double)count;
+
+    Rng a;
+    Rng b;
+    Rng c;
+    Rng d;
+    rng_seed(&a, 42u);
+    rng_seed(&b, 42u);
+    rng_seed_stream(&c, 42u, 1u);
+    rng_seed_stream(&d, 42u, 2u);
+
+    bool repeat = true;
+    int stream_same = 0;
+    for (int i = 0; i < 1000; i++)
+    {
+        if (rng_next(&a) != rng_next(&b))
+            repeat = false;
+        if (rng_next(&c) == rng_next(&d))
+            stream_same++;
+    }
+
+    double scene_a = bench_rng_scene_checksum(scene, 7u);
+    double scene_b = bench_rng_scene_checksum(scene, 7u);
+    double scene_c = bench_rng_scene_checksum(scene, 8u);
+
+    bool mean_ok = fabs(mean - 0.5) < 0.01;
+    bool scene_ok = scene_a == scene_b && scene_a != scene_c;
+    bool ok = in_range && mean_ok && repeat && stream_same < 2 && scene_ok;
+
+    printf("rng: %d floats\n", count);
+    printf("  rand()          : %.2f ns/value\n", counter_to_ns(t1 - t0) / (double)count);
+    printf("  rng_float       : %.2f ns/value\n", counter_to_ns(t2 - t1) / (double)count);
+    printf("  rng_batch_fill  : %.2f ns/value\n", counter_to_ns(t3 - t2) / (double)count);
+    printf("  batch range     : %s, mean %.4f %s\n", in_range ? "ok" : "FAILED", mean, mean_ok ? "ok" : "FAILED");
+    printf("  same seed       : %s\n", repeat ? "ok" : "FAILED");
+    printf("  streams differ  : %s\n", stream_same < 2 ? "ok" : "FAILED");
+    printf("  scene replay    : %s\n", scene_ok ? "ok" : "FAILED");
+
+    free(out);
+    free(scene);
+    return ok ? 0 : 1;
+}
+
+/*
+ * qsort comparison for ascending doubles.
+ */
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Frame times of one render benchmark run.
+ *
+ * min_ms, avg_ms, p99_ms, max_ms  - frame time distribution
+ * pass_ms                         - average time per frame of each pass
+ */
+typedef struct BenchRenderStats
+{
+    double min_ms;
+    double avg_ms;
+    double p99_ms;
+    double max_ms;
+    double pass_ms[GAME_PASS_COUNT];
+} BenchRenderStats;
+
+/*
+ * Change the shared render benchmark options into variant number variant.
+ */
+typedef void (*BenchRenderVariant)(GameOptions *options, int variant);
+
+/*
+ * Write the render benchmark results as one JSON object.
+ */
+static void bench_render_write_json(FILE *out, int frames, int width, int height, const BenchRenderStats *stats)
+{
+    fprintf(out, "{\"benchmark\":\"render\",\"frames\":%d,\"width\":%d,\"height\":%d,", frames, width, height);
+    fprintf(out, "\"frame_ms\":{\"min\":%.4f,\"avg\":%.4f,\"p99\":%.4f,\"max\":%.4f},",
+            stats->min_ms, stats->avg_ms, stats->p99_ms, stats->max_ms);
+    fprintf(out, "\"pass_ms_per_frame\":{");
+
+    for (int p = 0; p < GAME_PASS_COUNT; p++)
+    {
+        fprintf(out, "%s\"%s\":%.4f", p > 0 ? "," : "", game_pass_name((GamePass)p), stats->pass_ms[p]);
+    }
+
+    fprintf(out, "}}\n");
+}
+
+/*
+ * Options shared by the render benchmarks: a hidden window, vsync off, a
+ * fixed seed and every texture uploaded before the first frame.
+ */
+static void bench_render_options(GameOptions *options, int width, int height)
+{
+    game_default_options(options);
+    options->seed = 1;
+    options->vsync = false;
+    options->window_width = width;
+    options->window_height = height;
+    options->hidden_window = true;
+    options->texture_streaming = false;
+}
+
+/*
+ * Start the game, fly the benchmark spline and shut it down again.
+ * Returns false if the game did not start or the window was closed.
+ */
+static bool bench_render_run(const char *name, const GameOptions *options, int frames, double *frame_ms, double *pass_ms)
+{
+    Game *game = malloc(sizeof(Game));
+    if (!game)
+    {
+        fprintf(stderr, "%s: out of memory\n", name);
+        return false;
+    }
+
+    if (!game_init(game, options))
+    {
+        free(game);
+        return false;
+    }
+
+    bool completed = game_run_render_benchmark(game, frames, frame_ms, pass_ms);
+
+    game_shutdown(game);
+    free(game);
+
+    if (!completed)
+        fprintf(stderr, "%s: window closed before the run finished\n", name);
+
+    return completed;
+}
+
+/*
+ * Run the render benchmark once per variant, each in a freshly started
+ * game, and fill one entry of out_stats per run. configure may be NULL
+ * for a single run with the shared options.
+ * Returns false if an argument is invalid or a run did not complete.
+ */
+static bool bench_render_variants(const char *name, int frames, int width, int height,
+                                  BenchRenderVariant configure, int variant_count, BenchRenderStats *out_stats)
+{
+    if (frames < 1 || width < 1 || height < 1)
+    {
+        fprintf(stderr, "%s: invalid arguments\n", name);
+        return false;
+    }
+
+    double *frame_ms = malloc((size_t)frames * sizeof(double));
+    if (!frame_ms)
+    {
+        fprintf(stderr, "%s: out of memory\n", name);
+        return false;
+    }
+
+    for (int v = 0; v < variant_count; v++)
+    {
+        GameOptions options;
+        bench_render_options(&options, width, height);
+        if (configure)
+            configure(&options, v);
+
+        double pass_ms[GAME_PASS_COUNT];
+        if (!bench_render_run(name, &options, frames, frame_ms, pass_ms))
+        {
+            free(frame_ms);
+            return false;
+        }
+
+        double total_ms = 0.0;
+        for (int f = 0; f < frames; f++)
+            total_ms += frame_ms[f];
+
+        qsort(frame_ms, (size_t)frames, sizeof(double), compare_double);
+
+        int p99_index = (int)ceil(0.99 * (double)frames) - 1;
+        BenchRenderStats *stats = &out_stats[v];
+        stats->min_ms = frame_ms[0];
+        stats->avg_ms = total_ms / (double)frames;
+        stats->p99_ms = frame_ms[p99_index < 0 ? 0 : p99_index];
+        stats->max_ms = frame_ms[frames - 1];
+
+        for (int p = 0; p < GAME_PASS_COUNT; p++)
+            stats->pass_ms[p] = pass_ms[p] / (double)frames;
+    }
+
+    free(frame_ms);
+    return true;
+}
+
+/*
+ * Offscreen render benchmark.
+ * The game is started with a hidden window, vsync off and a fixed seed,
+ * and the camera flies the benchmark spline. Every pass is finished before
+ * the next starts, so pass times add up to the frame time.
+ */
+int bench_render(int frames, int width, int height, const char *json_path)
+{
+    BenchRenderStats stats;
+    if (!bench_render_variants("bench_render", frames, width, height, NULL, 1, &stats))
+        return 1;
+
+    printf("render: %d frames at %dx%d\n", frames, width, height);
+    printf("  frame min       : %.3f ms\n", stats.min_ms);
+    printf("  frame avg       : %.3f ms\n", stats.avg_ms);
+    printf("  frame p99       : %.3f ms\n", stats.p99_ms);
+    printf("  frame max       : %.3f ms\n", stats.max_ms);
+
+    for (int p = 0; p < GAME_PASS_COUNT; p++)
+    {
+        printf("  %-16s: %.3f ms/frame\n", game_pass_name((GamePass)p), stats.pass_ms[p]);
+    }
+
+    /* stdout also carries the game's own messages, so JSON only goes to a file */
+    if (json_path)
+    {
+        FILE *json = fopen(json_path, "w");
+        if (!json)
+        {
+            fprintf(stderr, "bench_render: cannot write %s\n", json_path);
+            return 1;
+        }
+
+        bench_render_write_json(json, frames, width, height, &stats);
+        fclose(json);
+    }
+
+    return 0;
+}
+
+/*
+ * Variant 0 applies the AO maps on a second texture unit, variant 1 bakes
+ * them into vertex colors.
+ */
+static void bench_ao_variant(GameOptions *options, int variant)
+{
+    options->ao_bake = variant == 1;
+}
+
+/*
+ * Ambient occlusion benchmark: the render benchmark once with the AO maps
+ * applied on a second texture unit and once baked into vertex colors.
+ * Only models that have an "_ao" map next to their texture take part.
+ */
+int bench_ao(int frames, int width, int height)
+{
+    static const char *const modes[2] = {"multitexture", "vertex colors"};
+
+    BenchRenderStats stats[2];
+    if (!bench_render_variants("bench_ao", frames, width, height, bench_ao_variant, 2, stats))
+        return 1;
+
+    printf("ao: %d frames at %dx%d\n", frames, width, height);
+    for (int mode = 0; mode < 2; mode++)
+    {
+        printf("  %-14s: frame avg %.3f ms, p99 %.3f ms, objects %.3f ms/frame\n",
+               modes[mode], stats[mode].avg_ms, stats[mode].p99_ms, stats[mode].pass_ms[GAME_PASS_OBJECTS]);
+    }
+
+    return 0;
+}
+
+/*
+ * Variant 0 draws the sky first over a full clear, variant 1 draws it
+ * last behind the opaque scene.
+ */
+static void bench_sky_variant(GameOptions *options, int variant)
+{
+    options->sky_first = variant == 0;
+}
+
+/*
+ * Sky fill benchmark: the render benchmark once with the sky drawn first
+ * over a full clear and once drawn last behind the opaque scene. The
+ * clear moves between the two passes, so both are reported together.
+ */
+int bench_sky(int frames, int width, int height)
+{
+    static const char *const modes[2] = {"sky first", "sky last"};
+
+    BenchRenderStats stats[2];
+    if (!bench_render_variants("bench_sky", frames, width, height, bench_sky_variant, 2, stats))
+        return 1;
+
+    printf("sky: %d frames at %dx%d\n", frames, width, height);
+    for (int mode = 0; mode < 2; mode++)
+    {
+        /* The clear moves from the sky pass to the ground pass, count both */
+        double fill_ms = stats[mode].pass_ms[GAME_PASS_SKY] + stats[mode].pass_ms[GAME_PASS_GROUND];
+
+        printf("  %-9s: frame avg %.3f ms, p99 %.3f ms, sky + ground %.3f ms/frame\n",
+               modes[mode], stats[mode].avg_ms, stats[mode].p99_ms, fill_ms);
+    }
+
+    return 0;
+}
@@ -127,18 +127,38 @@ void camera_update_z(Camera *camera, float delta_time)
 /*
  * Apply the camera transformation to the OpenGL view matrix.
  * This defines how the scene is rendered from the camera's perspective.
+ * The matrix is built on the CPU, so the renderer can use it without
+ * reading it back from OpenGL.
  */
-void camera_apply_view(const Camera *camera)
+void camera_apply_view(const Camera *camera, float *out_view)
 {
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+    // Rotations are inverse, because we move the world instead of the camera
+    float p = deg2rad(-camera->pitch);
+    float y = deg2rad(-(camera->yaw - 90.0f));
+    float cp = cosf(p), sp = sinf(p);
+    float cy = cosf(y), sy = sinf(y);
+
+    // Rows of the pitch rotation times the yaw rotation
+    float r[3][3] = {
+        {cy, -sy, 0.0f},
+        {cp * sy, cp * cy, -sp},
+        {sp * sy, sp * cy, cp}};
 
-    // Apply rotations (inverse, because we move the world instead of the camera)
-    glRotatef(-camera->pitch, 1.0f, 0.0f, 0.0f);
-    glRotatef(-(camera->yaw - 90.0f), 0.0f, 0.0f, 1.0f);
+    const Vec3 *pos = &camera->position;
+
+    for (int row = 0; row < 3; row++)
+    {
+        for (int col = 0; col < 3; col++)
+            out_view[col * 4 + row] = r[row][col];
 
-    // Translate the world opposite to camera position
-    glTranslatef(-camera->position.x, -camera->position.y, -camera->position.z);
+        // Translate the world opposite to camera position
+        out_view[12 + row] = -(r[row][0] * pos->x + r[row][1] * pos->y + r[row][2] * pos->z);
+        out_view[row * 4 + 3] = 0.0f;
+    }
+    out_view[15] = 1.0f;
+
+    glMatrixMode(GL_MODELVIEW);
+    glLoadMatrixf(out_view);
 }
 
 /*
@@ -149,4 +169,58 @@ void camera_get_forward(const Camera *camera, float *fx, float *fy)
     float yaw = deg2rad(camera->yaw);
     *fx = cosf(yaw);
     *fy = sinf(yaw);
-}
\ No newline at end of file
+}
+
+/*
+ * Uniform Catmull-Rom interpolation of one coordinate.
+ */
+static float catmull_rom(float p0, float p1, float p2, float p3, float t)
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+
+    return 0.5f * ((2.0f * p1) +
+                   (-p0 + p2) * t +
+                   (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                   (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+}
+
+/*
+ * Derivative of catmull_rom with respect to t.
+ */
+static float catmull_rom_tangent(float p0, float p1, float p2, float p3, float t)
+{
+    float t2 = t * t;
+
+    return 0.5f * ((-p0 + p2) +
+                   2.0f * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t +
+                   3.0f * (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t2);
+}
+
+/*
+ * Each control point owns an equal share of t; the segment from point i
+ * to point i + 1 uses its neighbours i - 1 and i + 2, wrapping around.
+ */
+void camera_path_sample(const Vec3 *points, int count, float t, Vec3 *position, Vec3 *tangent)
+{
+    t -= floorf(t);
+
+    float s = t * (float)count;
+    int i = (int)s;
+    if (i >= count)
+        i = count - 1;
+    float f = s - (float)i;
+
+    const Vec3 *p0 = &points[(i + count - 1) % count];
+    const Vec3 *p1 = &points[i];
+    const Vec3 *p2 = &points[(i + 1) % count];
+    const Vec3 *p3 = &points[(i + 2) % count];
+
+    position->x = catmull_rom(p0->x, p1->x, p2->x, p3->x, f);
+    position->y = catmull_rom(p0->y, p1->y, p2->y, p3->y, f);
+    position->z = catmull_rom(p0->z, p1->z, p2->z, p3->z, f);
+
+    tangent->x = catmull_rom_tangent(p0->x, p1->x, p2->x, p3->x, f);
+    tangent->y = catmull_rom_tangent(p0->y, p1->y, p2->y, p3->y, f);
+    tangent->z = catmull_rom_tangent(p0->z, p1->z, p2->z, p3->z, f);
+}
@@ -0,0 +1,54 @@
+#include "draw_sort.h"
+
+#include <string.h>
+
+/*
+ * Depth is linear in eye space, which keeps the buckets evenly sized
+ * across the range; 65536 of them are far finer than any two instances.
+ */
+uint32_t draw_depth_key(float depth, float max_depth, bool back_to_front)
+{
+    float t = max_depth > 0.0f ? depth / max_depth : 0.0f;
+    if (t < 0.0f)
+        t = 0.0f;
+    if (t > 1.0f)
+        t = 1.0f;
+
+    uint32_t key = (uint32_t)(t * 65535.0f + 0.5f);
+    return back_to_front ? 65535u - key : key;
+}
+
+/*
+ * One counting pass over 8 bits of the key, from src into dst.
+ */
+static void draw_sort_pass(const DrawItem *src, DrawItem *dst, int count, int shift)
+{
+    int offsets[256];
+    memset(offsets, 0, sizeof(offsets));
+
+    for (int i = 0; i < count; i++)
+        offsets[(src[i].key >> shift) & 0xff]++;
+
+    int sum = 0;
+    for (int d = 0; d < 256; d++)
+    {
+        int n = offsets[d];
+        offsets[d] = sum;
+        sum += n;
+    }
+
+    for (int i = 0; i < count; i++)
+        dst[offsets[(src[i].key >> shift) & 0xff]++] = src[i];
+}
+
+/*
+ * Low byte into scratch, high byte back into items.
+ */
+void draw_sort(DrawItem *items, DrawItem *scratch, int count)
+{
+    if (count < 2)
+        return;
+
+    draw_sort_pass(items, scratch, count, 0);
+    draw_sort_pass(scratch, items, count, 8);
+}
@@ -1,3 +1,4 @@
+#define _USE_MATH_DEFINES
 #include "game.h"
 
 #include <SDL2/SDL.h>
@@ -7,15 +8,21 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <math.h>
 
 #include "camera.h"
 #include "scene.h"
 #include "renderer.h"
+#include "shadow.h"
 #include "input.h"
 #include "model.h"
 #include "ui.h"
+#include "zoo.h"
+#include "profiler.h"
+#include "atlas.h"
+#include "stats.h"
 
 #define WINDOW_WIDTH 1280
 #define WINDOW_HEIGHT 720
@@ -24,22 +31,29 @@
 #define RUN_SPEED 9.0f
 #define CROUCH_MULTIPLIER 0.4f
 
-#define MAX_DELTA_TIME 0.05f
+/*
+ * Longest real frame time fed into the simulation accumulator, and the
+ * most fixed steps run to catch up in one frame. Beyond either the
+ * simulation falls behind real time instead of spiralling.
+ */
+#define MAX_FRAME_TIME 0.25f
+#define MAX_SIM_STEPS_PER_FRAME 8
 #define CAMERA_RADIUS 0.35f
 #define MAX_COLLISION_STEPS 12
 
-static float randf_range(float minv, float maxv)
-{
-    return minv + (maxv - minv) * ((float)rand() / (float)RAND_MAX);
-}
+/*
+ * File written when the profiler trace is dumped with F4.
+ */
+#define PROFILER_TRACE_PATH "profile_trace.json"
 
-static void game_load_assets(Game *game);
-static void game_build_scene(Game *game);
+static void game_load_assets(Game *game, const GameOptions *options);
+static void game_update_streaming(Game *game);
 
 static void game_handle_light_input(Game *game);
 static void game_handle_camera_input(Game *game);
 static void game_handle_gameplay_input(Game *game);
 static void game_update_camera(Game *game, float delta_time);
+static void game_throw_banana(Game *game);
 
 static void print_help(void)
 {
@@ -53,13 +67,79 @@ static void print_help(void)
     printf("Q             : banan eldobasa\n");
     printf("+ / -         : fenyero novelese / csokkentese\n");
     printf("F1            : utmutato ki/be\n");
+    printf("F2            : statisztika ki/be\n");
+    printf("F3            : profiler ki/be\n");
+    printf("F4            : profiler trace mentese (profile_trace.json)\n");
     printf("ESC           : kilepes\n");
     printf("=======================================\n\n");
 }
 
-bool game_init(Game *game)
+void game_default_options(GameOptions *options)
+{
+    options->water_size = 0;
+    options->worker_threads = 0;
+    options->rain_drops = RAIN_DEFAULT_DROPS;
+    options->seed = 0;
+    options->sim_rate = GAME_DEFAULT_SIM_RATE;
+    options->sim_thread = false;
+    options->vsync = true;
+    options->window_width = WINDOW_WIDTH;
+    options->window_height = WINDOW_HEIGHT;
+    options->hidden_window = false;
+    options->record_path = NULL;
+    options->replay_path = NULL;
+    options->texture_compression = true;
+    options->texture_atlas = true;
+    options->texture_disk_cache = true;
+    options->texture_streaming = true;
+    options->ao_bake = false;
+    options->shaders = true;
+    options->shadows = true;
+    options->sky_first = false;
+    options->depth_prepass = false;
+}
+
+bool game_init(Game *game, const GameOptions *options)
 {
-    srand((unsigned int)time(NULL));
+    int sim_rate = options->sim_rate > 0 ? options->sim_rate : GAME_DEFAULT_SIM_RATE;
+
+    game->seed = options->seed != 0 ? options->seed : (uint64_t)time(NULL);
+    scene_render_context_init(&game->render_context);
+    memset(&game->render_scene, 0, sizeof(game->render_scene));
+    game->recording = false;
+    game->replaying = false;
+
+    /*
+     * A replay runs with the seed and simulation rate of the recording,
+     * whatever the command line says.
+     */
+    if (options->replay_path)
+    {
+        if (!replay_reader_open(&game->replay, options->replay_path))
+        {
+            fprintf(stderr, "Could not read replay %s\n", options->replay_path);
+            return false;
+        }
+
+        game->replaying = true;
+        game->seed = game->replay.seed;
+        sim_rate = game->replay.sim_rate > 0 ? game->replay.sim_rate : GAME_DEFAULT_SIM_RATE;
+        printf("Replaying %s\n", options->replay_path);
+    }
+    else if (options->record_path)
+    {
+        if (!replay_writer_open(&game->recorder, options->record_path, game->seed, sim_rate))
+        {
+            fprintf(stderr, "Could not create recording %s\n", options->record_path);
+            return false;
+        }
+
+        game->recording = true;
+        printf("Recording input to %s\n", options->record_path);
+    }
+
+    rng_seed(&game->rng, game->seed);
+    printf("Seed: %llu\n", (unsigned long long)game->seed);
 
     game->window = NULL;
     game->gl_context = NULL;
@@ -72,6 +152,13 @@ bool game_init(Game *game)
     game->running = true;
     game->show_help = false;
     game->light_intensity = 1.0f;
+    game->jobs_ready = false;
+    game->time_passes = false;
+    game->show_profiler = false;
+    game->show_stats = false;
+
+    profiler_init();
+    profiler_set_enabled(true);
 
     if (SDL_Init(SDL_INIT_VIDEO) != 0)
     {
@@ -94,9 +181,9 @@ bool game_init(Game *game)
         "Monkey Zoo",
         SDL_WINDOWPOS_CENTERED,
         SDL_WINDOWPOS_CENTERED,
-        WINDOW_WIDTH,
-        WINDOW_HEIGHT,
-        SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+        options->window_width,
+        options->window_height,
+        SDL_WINDOW_OPENGL | (options->hidden_window ? SDL_WINDOW_HIDDEN : SDL_WINDOW_RESIZABLE));
 
     if (!game->window)
     {
@@ -114,25 +201,85 @@ bool game_init(Game *game)
         return false;
     }
 
-    SDL_GL_SetSwapInterval(1);
+    SDL_GL_SetSwapInterval(options->vsync ? 1 : 0);
+
+    game->sim_step = 1.0f / (float)sim_rate;
+    game->sim_ticks = 0;
+    SDL_AtomicSet(&game->sim_ticks_atomic, 0);
+    SDL_AtomicSet(&game->sim_running, 0);
+    game->sim_lock = NULL;
+
+    if (options->sim_thread && (game->recording || game->replaying))
+    {
+        fprintf(stderr, "Recording and replay run the simulation on the main thread.\n");
+    }
+    else if (options->sim_thread)
+    {
+        game->sim_lock = SDL_CreateMutex();
+        if (!game->sim_lock)
+            fprintf(stderr, "Simulation lock not created, running the simulation on the main thread.\n");
+    }
 
     int width;
     int height;
     SDL_GetWindowSize(game->window, &width, &height);
 
-    renderer_init(width, height);
+    bool shaders = renderer_init(width, height, options->shaders);
+    if (shaders && options->shadows)
+        shadow_init();
     camera_init(&game->camera);
-    scene_init(&game->scene);
+    game->prev_camera_position = game->camera.position;
+    if (!scene_init(&game->scene))
+    {
+        fprintf(stderr, "Scene storage could not be allocated\n");
+        game_shutdown(game);
+        return false;
+    }
+    scene_set_seed(&game->scene, game->seed);
     input_init(&game->input);
 
-    game_load_assets(game);
-    game_build_scene(game);
+    game->jobs_ready = jobs_init(&game->jobs, options->worker_threads);
+    if (game->jobs_ready)
+        scene_set_job_pool(&game->scene, &game->jobs);
+    else
+        fprintf(stderr, "Worker threads not started. Simulation runs single-threaded.\n");
+
+    texture_set_compression(options->texture_compression);
+    texture_set_disk_cache(options->texture_disk_cache);
+    texture_set_streaming(options->texture_streaming);
+    game_load_assets(game, options);
+    zoo_build(&game->scene, &game->rng);
+
+    if (options->water_size > 0 &&
+        !scene_set_water_size(&game->scene, options->water_size))
+    {
+        fprintf(stderr, "Invalid water size %d, keeping the default pond sizes.\n", options->water_size);
+    }
+
+    if (options->rain_drops != RAIN_DEFAULT_DROPS &&
+        !scene_set_rain_drops(&game->scene, options->rain_drops))
+    {
+        fprintf(stderr, "Invalid rain drop count %d, keeping %d.\n", options->rain_drops, RAIN_DEFAULT_DROPS);
+    }
 
     return true;
 }
 
 void game_shutdown(Game *game)
 {
+    if (game->recording)
+    {
+        int frames = game->recorder.frames;
+
+        if (replay_writer_close(&game->recorder))
+            printf("Recorded %d frames\n", frames);
+        else
+            fprintf(stderr, "Recording is incomplete: write error\n");
+    }
+
+    if (game->replaying)
+        replay_reader_close(&game->replay);
+
     if (game->banana_loaded)
         model_free(&game->banana_model);
 
@@ -145,6 +292,19 @@ void game_shutdown(Game *game)
     if (game->tree_loaded)
         model_free(&game->tree_model);
 
+    texture_stream_shutdown();
+    shadow_shutdown();
+    renderer_shutdown();
+    scene_free(&game->scene);
+    scene_free(&game->render_scene);
+    scene_render_context_free(&game->render_context);
+
+    if (game->jobs_ready)
+        jobs_shutdown(&game->jobs);
+
+    if (game->sim_lock)
+        SDL_DestroyMutex(game->sim_lock);
+
     IMG_Quit();
 
     if (game->gl_context)
@@ -156,148 +316,815 @@ void game_shutdown(Game *game)
     SDL_Quit();
 }
 
-void game_run(Game *game)
+/*
+ * Advance the camera and the scene by one fixed simulation step.
+ * In threaded mode the caller holds sim_lock.
+ */
+static void game_sim_tick(Game *game)
+{
+    profiler_begin("sim tick");
+
+    game->prev_camera_position = game->camera.position;
+
+    profiler_begin("camera");
+    game_update_camera(game, game->sim_step);
+    profiler_end();
+
+    scene_set_focus(&game->scene, game->camera.position.x, game->camera.position.y);
+
+    profiler_begin("scene_update");
+    scene_update(&game->scene, game->sim_step);
+    profiler_end();
+
+    profiler_begin("collect obstacles");
+    scene_collect_obstacles(&game->scene);
+    profiler_end();
+
+    game->sim_ticks++;
+
+    profiler_end();
+}
+
+/*
+ * Take the next frame of a replay in place of the SDL events, with its
+ * recorded frame time. The event queue is still drained so the window can
+ * be closed or the replay stopped with ESC. The run ends with the
+ * recording.
+ */
+static void game_replay_frame(Game *game, float *frame_time)
+{
+    SDL_Event event;
+    while (SDL_PollEvent(&event))
+    {
+        if (event.type == SDL_QUIT ||
+            (event.type == SDL_KEYDOWN && event.key.keysym.scancode == SDL_SCANCODE_ESCAPE))
+        {
+            game->running = false;
+        }
+    }
+
+    if (!replay_reader_frame(&game->replay, &game->input, frame_time))
+    {
+        game->running = false;
+        *frame_time = 0.0f;
+        return;
+    }
+
+    uint64_t now = SDL_GetPerformanceCounter();
+    if (game->replay.frames > 1)
+    {
+        double ms = profiler_ms(now - game->replay_mark);
+        if (ms > game->replay_worst_ms)
+            game->replay_worst_ms = ms;
+    }
+    game->replay_mark = now;
+}
+
+/*
+ * Poll events and apply per-frame input: window events, help toggle,
+ * light, movement intent, mouse look and gameplay actions.
+ *
+ * frame_time is the time the frame feeds to the simulation. A replay
+ * replaces it with the recorded one and a recording stores it with the
+ * input. It may be NULL when neither is active.
+ */
+static void game_handle_frame_input(Game *game, float *frame_time)
+{
+    profiler_begin("input");
+
+    input_begin_frame(&game->input);
+
+    profiler_begin("poll events");
+    if (game->replaying)
+        game_replay_frame(game, frame_time);
+    else
+        input_poll_events(&game->input);
+    profiler_end();
+
+    if (game->recording)
+        replay_writer_frame(&game->recorder, &game->input, *frame_time);
+
+    if (game->input.quit)
+        game->running = false;
+
+    if (game->input.resized)
+        renderer_resize(game->input.win_w, game->input.win_h);
+
+    if (input_pressed(&game->input, SDL_SCANCODE_ESCAPE))
+        game->running = false;
+
+    if (input_pressed(&game->input, SDL_SCANCODE_F1))
+    {
+        game->show_help = !game->show_help;
+
+        if (game->show_help)
+            print_help();
+    }
+
+    if (input_pressed(&game->input, SDL_SCANCODE_F2))
+    {
+        game->show_stats = !game->show_stats;
+        game->stats_mark = SDL_GetPerformanceCounter();
+        stats_set_enabled(game->show_stats);
+    }
+
+    if (input_pressed(&game->input, SDL_SCANCODE_F3))
+        game->show_profiler = !game->show_profiler;
+
+    if (input_pressed(&game->input, SDL_SCANCODE_F4))
+    {
+        if (profiler_write_chrome_trace(PROFILER_TRACE_PATH))
+            printf("Profiler trace written to %s\n", PROFILER_TRACE_PATH);
+        else
+            fprintf(stderr, "Could not write %s\n", PROFILER_TRACE_PATH);
+    }
+
+    game_handle_light_input(game);
+    game_handle_camera_input(game);
+    game_handle_gameplay_input(game);
+
+    profiler_end();
+}
+
+/*
+ * Open the profiler zone of a render pass.
+ */
+static void game_begin_pass(Game *game, GamePass pass)
+{
+    (void)game;
+    profiler_begin(game_pass_name(pass));
+}
+
+/*
+ * Close the zone of a render pass. While time_passes is set, wait for the
+ * GPU first, so the time lands on the pass that queued the work.
+ */
+static void game_end_pass(Game *game, GamePass pass)
+{
+    if (game->time_passes)
+    {
+        renderer_finish();
+
+        uint64_t now = SDL_GetPerformanceCounter();
+        game->pass_ticks[pass] += now - game->pass_mark;
+        game->pass_mark = now;
+    }
+
+    profiler_end();
+}
+
+/*
+ * Return the camera between the last two steps at alpha, the fraction of
+ * a simulation step elapsed since the last tick.
+ */
+static Camera game_view_camera(const Game *game, float alpha)
+{
+    Camera view = game->camera;
+    const Vec3 *prev = &game->prev_camera_position;
+
+    view.position.x = prev->x + (game->camera.position.x - prev->x) * alpha;
+    view.position.y = prev->y + (game->camera.position.y - prev->y) * alpha;
+    view.position.z = prev->z + (game->camera.position.z - prev->z) * alpha;
+    return view;
+}
+
+/*
+ * Draw one frame of scene seen from view. alpha is the fraction of a
+ * simulation step elapsed since the last tick; moving objects are
+ * interpolated by it. Only scene and view are read from the simulation,
+ * so in threaded mode both can be copies taken under sim_lock.
+ */
+static void game_render(Game *game, const Scene *scene, const Camera *view, float alpha)
+{
+    if (game->show_stats)
+    {
+        uint64_t now = SDL_GetPerformanceCounter();
+        stats_end_frame((float)profiler_ms(now - game->stats_mark));
+        game->stats_mark = now;
+    }
+
+    profiler_begin("render");
+
+    if (game->time_passes)
+        game->pass_mark = SDL_GetPerformanceCounter();
+
+    /*
+     * The sky normally goes behind the opaque passes, filling only the
+     * pixels they left empty, and covers the rest of the screen, so only
+     * depth needs clearing. Drawing it first is kept for comparison.
+     */
+    if (game->sky_first)
+    {
+        game_begin_pass(game, GAME_PASS_SKY);
+        renderer_begin_frame(0.78f, 0.88f, 0.98f);
+        renderer_draw_sky_gradient(game->light_intensity);
+        game_end_pass(game, GAME_PASS_SKY);
+    }
+
+    float view_matrix[16];
+    camera_apply_view(view, view_matrix);
+    scene_render_context_begin(&game->render_context, view_matrix);
+
+    game_begin_pass(game, GAME_PASS_SHADOW);
+    const ShadowCascades *shadows = shadow_render(scene, view_matrix, alpha);
+    game_end_pass(game, GAME_PASS_SHADOW);
+
+    renderer_begin_scene();
+    renderer_apply_light(game->light_intensity);
+    renderer_apply_shadows(shadows);
+
+    float water_distance = -1.0f;
+    pond_system_nearest(&scene->ponds, view->position.x, view->position.y, &water_distance);
+
+    renderer_apply_dynamic_fog(scene->global_time, water_distance);
+
+    /* Without the sky first, the first pass that draws clears depth */
+    bool depth_cleared = game->sky_first;
+
+    if (game->depth_prepass)
+    {
+        game_begin_pass(game, GAME_PASS_PREPASS);
+        if (!depth_cleared)
+            renderer_begin_frame_depth();
+        depth_cleared = true;
+        scene_render_depth_prepass(scene, &game->render_context, alpha);
+        game_end_pass(game, GAME_PASS_PREPASS);
+    }
+
+    game_begin_pass(game, GAME_PASS_GROUND);
+    if (!depth_cleared)
+        renderer_begin_frame_depth();
+    scene_render_pass(scene, &game->render_context, SCENE_PASS_GROUND, alpha);
+    game_end_pass(game, GAME_PASS_GROUND);
+
+    game_begin_pass(game, GAME_PASS_OBJECTS);
+    scene_render_pass(scene, &game->render_context, SCENE_PASS_OBJECTS, alpha);
+    game_end_pass(game, GAME_PASS_OBJECTS);
+
+    /* Before the blended passes, which need the sky behind them */
+    if (!game->sky_first)
+    {
+        game_begin_pass(game, GAME_PASS_SKY);
+        renderer_draw_sky_gradient(game->light_intensity);
+        game_end_pass(game, GAME_PASS_SKY);
+    }
+
+    game_begin_pass(game, GAME_PASS_WATER);
+    scene_render_pass(scene, &game->render_context, SCENE_PASS_WATER, alpha);
+    game_end_pass(game, GAME_PASS_WATER);
+
+    game_begin_pass(game, GAME_PASS_RAIN);
+    scene_render_pass(scene, &game->render_context, SCENE_PASS_RAIN, alpha);
+    game_end_pass(game, GAME_PASS_RAIN);
+
+    renderer_end_scene();
+
+    game_begin_pass(game, GAME_PASS_UI);
+
+    int w;
+    int h;
+    SDL_GetWindowSize(game->window, &w, &h);
+
+    if (game->show_profiler)
+        ui_draw_profiler_overlay(w, h, profiler_last_frame());
+
+    if (game->show_stats)
+    {
+        UiStatsCounts counts = {
+            .obstacles = scene->obstacle_count,
+            .particles = pool_live_count(&scene->water_particle_pool),
+            .rain_drops = scene->rain_enabled ? scene->rain.count : 0,
+            .bananas = scene->bananas.count,
+            .airborne_bananas = scene->bananas.airborne_count};
+
+        ui_draw_stats_overlay(w, h, &counts);
+    }
+
+    if (game->show_help)
+    {
+        ui_draw_help_overlay(
+            w,
+            h,
+            game->light_intensity,
+            scene_get_active_banana_count(scene),
+            scene_get_eaten_banana_count(scene));
+    }
+
+    game_end_pass(game, GAME_PASS_UI);
+
+    profiler_end();
+}
+
+/*
+ * Present the frame, timed as its own pass.
+ */
+static void game_present(Game *game)
+{
+    game_begin_pass(game, GAME_PASS_PRESENT);
+    renderer_end_frame(game->window);
+    game_end_pass(game, GAME_PASS_PRESENT);
+}
+
+/*
+ * Once per second, show the measured frame and simulation rates in the
+ * window title.
+ */
+static void game_update_title(Game *game, uint64_t now)
+{
+    const uint64_t freq = SDL_GetPerformanceFrequency();
+
+    game->stat_frames++;
+
+    if (now - game->stat_start < freq)
+        return;
+
+    double seconds = (double)(now - game->stat_start) / (double)freq;
+    int ticks = SDL_AtomicGet(&game->sim_ticks_atomic);
+
+    char title[128];
+    snprintf(title, sizeof(title), "Monkey Zoo - %.0f fps, %.0f Hz sim%s",
+             (double)game->stat_frames / seconds,
+             (double)(ticks - game->stat_ticks) / seconds,
+             game->show_help ? " - F1: help aktiv" : "");
+    SDL_SetWindowTitle(game->window, title);
+
+    game->stat_start = now;
+    game->stat_frames = 0;
+    game->stat_ticks = ticks;
+}
+
+/*
+ * Single-threaded loop: the real frame time fills an accumulator that is
+ * drained in fixed steps, then the frame is drawn with the remainder as
+ * interpolation factor.
+ */
+static void game_run_fixed_step(Game *game)
 {
-    uint64_t prev = SDL_GetPerformanceCounter();
     const double freq = (double)SDL_GetPerformanceFrequency();
+    uint64_t prev = SDL_GetPerformanceCounter();
+    float accumulator = 0.0f;
 
     while (game->running)
     {
         uint64_t now = SDL_GetPerformanceCounter();
-        float delta_time = (float)((double)(now - prev) / freq);
+        float frame_time = (float)((double)(now - prev) / freq);
         prev = now;
 
-        if (delta_time > MAX_DELTA_TIME)
-            delta_time = MAX_DELTA_TIME;
-
-        input_begin_frame(&game->input);
-        input_poll_events(&game->input);
+        if (frame_time > MAX_FRAME_TIME)
+            frame_time = MAX_FRAME_TIME;
 
-        if (game->input.quit)
-            game->running = false;
+        profiler_begin_frame();
 
-        if (game->input.resized)
-            renderer_resize(game->input.win_w, game->input.win_h);
+        game_handle_frame_input(game, &frame_time);
 
-        if (input_pressed(&game->input, SDL_SCANCODE_ESCAPE))
-            game->running = false;
+        accumulator += frame_time;
 
-        if (input_pressed(&game->input, SDL_SCANCODE_F1))
+        int steps = 0;
+        while (accumulator >= game->sim_step)
         {
-            game->show_help = !game->show_help;
-
-            if (game->show_help)
-            {
-                print_help();
-                SDL_SetWindowTitle(game->window, "Monkey Zoo - F1: help aktiv");
-            }
-            else
+            if (steps == MAX_SIM_STEPS_PER_FRAME)
             {
-                SDL_SetWindowTitle(game->window, "Monkey Zoo");
+                accumulator = fmodf(accumulator, game->sim_step);
+                break;
             }
+
+            game_sim_tick(game);
+            accumulator -= game->sim_step;
+            steps++;
         }
 
-        game_handle_light_input(game);
-        game_handle_camera_input(game);
-        game_handle_gameplay_input(game);
+        SDL_AtomicSet(&game->sim_ticks_atomic, game->sim_ticks);
 
-        scene_update(&game->scene, delta_time);
-        scene_collect_obstacles(&game->scene);
+        game_update_streaming(game);
 
-        game_update_camera(game, delta_time);
+        float alpha = accumulator / game->sim_step;
+        Camera view = game_view_camera(game, alpha);
+        game_render(game, &game->scene, &view, alpha);
+        game_present(game);
 
-        renderer_begin_frame(0.78f, 0.88f, 0.98f);
+        game_update_title(game, now);
 
-        renderer_draw_sky_gradient(game->light_intensity);
+        profiler_end_frame();
+    }
+}
+
+/*
+ * Simulation thread: runs fixed steps against real time at its own rate
+ * and sleeps in between. Each step holds sim_lock and records when it
+ * finished, so the render thread can interpolate.
+ */
+static int game_sim_thread_main(void *arg)
+{
+    Game *game = (Game *)arg;
+
+    const double freq = (double)SDL_GetPerformanceFrequency();
+    uint64_t prev = SDL_GetPerformanceCounter();
+    float accumulator = 0.0f;
 
-        camera_apply_view(&game->camera);
-        renderer_apply_light(game->light_intensity);
+    while (SDL_AtomicGet(&game->sim_running))
+    {
+        uint64_t now = SDL_GetPerformanceCounter();
+        float frame_time = (float)((double)(now - prev) / freq);
+        prev = now;
 
-        renderer_apply_dynamic_fog(
-            game->scene.global_time,
-            game->camera.position.x,
-            game->camera.position.y,
-            game->scene.pond_enabled ? 1 : 0,
-            game->scene.pond_x,
-            game->scene.pond_y);
+        if (frame_time > MAX_FRAME_TIME)
+            frame_time = MAX_FRAME_TIME;
 
-        scene_render(&game->scene);
+        accumulator += frame_time;
 
-        if (game->show_help)
+        int steps = 0;
+        while (accumulator >= game->sim_step && steps < MAX_SIM_STEPS_PER_FRAME)
         {
-            int w;
-            int h;
-            SDL_GetWindowSize(game->window, &w, &h);
-
-            ui_draw_help_overlay(
-                w,
-                h,
-                game->light_intensity,
-                scene_get_active_banana_count(&game->scene),
-                scene_get_eaten_banana_count(&game->scene));
+            SDL_LockMutex(game->sim_lock);
+            game_sim_tick(game);
+            game->last_tick_counter = SDL_GetPerformanceCounter();
+            SDL_UnlockMutex(game->sim_lock);
+
+            SDL_AtomicSet(&game->sim_ticks_atomic, game->sim_ticks);
+
+            accumulator -= game->sim_step;
+            steps++;
         }
 
-        renderer_end_frame(game->window);
+        if (steps == MAX_SIM_STEPS_PER_FRAME)
+            accumulator = fmodf(accumulator, game->sim_step);
+
+        Uint32 sleep_ms = (Uint32)((game->sim_step - accumulator) * 1000.0f);
+        SDL_Delay(sleep_ms > 0 ? sleep_ms : 1);
     }
+
+    return 0;
 }
 
-static void generate_trees(Scene *scene, int count)
+/*
+ * Threaded loop: input and rendering stay on the main thread, which owns
+ * the GL context and the SDL event queue. Input, texture streaming, the
+ * interpolated camera and a copy of the scene are taken under sim_lock;
+ * the frame is then drawn from the copies with the lock released, so the
+ * simulation thread keeps stepping while the main thread draws. If the
+ * copy cannot be allocated the frame is drawn under the lock instead.
+ */
+static void game_run_threaded(Game *game)
 {
-    for (int i = 0; i < count; i++)
+    const double freq = (double)SDL_GetPerformanceFrequency();
+
+    game->last_tick_counter = SDL_GetPerformanceCounter();
+    SDL_AtomicSet(&game->sim_running, 1);
+
+    SDL_Thread *thread = SDL_CreateThread(game_sim_thread_main, "simulation", game);
+    if (!thread)
     {
-        float x;
-        float y;
-        int tries = 0;
+        fprintf(stderr, "Simulation thread not started: %s\n", SDL_GetError());
+        game_run_fixed_step(game);
+        return;
+    }
 
-        do
+    while (game->running)
+    {
+        profiler_begin_frame();
+
+        SDL_LockMutex(game->sim_lock);
+
+        game_handle_frame_input(game, NULL);
+        game_update_streaming(game);
+
+        uint64_t now = SDL_GetPerformanceCounter();
+        float alpha = (float)((double)(now - game->last_tick_counter) / freq) / game->sim_step;
+        if (alpha > 1.0f)
+            alpha = 1.0f;
+
+        Camera view = game_view_camera(game, alpha);
+
+        profiler_begin("copy scene");
+        bool copied = scene_copy(&game->render_scene, &game->scene);
+        profiler_end();
+
+        if (copied)
         {
-            x = randf_range(-90.0f, 90.0f);
-            y = randf_range(-90.0f, 90.0f);
-            tries++;
-        } while (
-            tries < 100 &&
-            ((fabsf(x) < 32.0f && fabsf(y) < 32.0f) ||
-             (fabsf(x - 40.0f) < 18.0f && fabsf(y - 10.0f) < 18.0f) ||
-             (fabsf(x + 45.0f) < 20.0f && fabsf(y + 20.0f) < 20.0f)));
-
-        scene_add_tree(
-            scene,
-            x,
-            y,
-            0.0f,
-            randf_range(5.0f, 8.0f),
-            randf_range(0.0f, 360.0f),
-            true);
+            SDL_UnlockMutex(game->sim_lock);
+            game_render(game, &game->render_scene, &view, alpha);
+        }
+        else
+        {
+            game_render(game, &game->scene, &view, alpha);
+            SDL_UnlockMutex(game->sim_lock);
+        }
+
+        game_present(game);
+
+        game_update_title(game, now);
+
+        profiler_end_frame();
+    }
+
+    SDL_AtomicSet(&game->sim_running, 0);
+    SDL_WaitThread(thread, NULL);
+}
+
+/*
+ * Print the timing of a finished replay and the state it ended in. Two
+ * runs of the same recording end in the same state, which confirms that
+ * a before/after comparison replayed the same session.
+ */
+static void game_report_replay(Game *game)
+{
+    double seconds = profiler_ms(SDL_GetPerformanceCounter() - game->replay_start) / 1e3;
+    int frames = game->replay.frames;
+
+    if (game->replay.failed)
+        fprintf(stderr, "Replay file is truncated after frame %d\n", frames);
+
+    if (frames == 0 || seconds <= 0.0)
+        return;
+
+    printf("Replay: %d frames, %d simulation steps in %.2f s\n", frames, game->sim_ticks, seconds);
+    printf("  frame time: %.3f ms average, %.3f ms worst, %.1f fps\n",
+           seconds * 1e3 / (double)frames,
+           game->replay_worst_ms,
+           (double)frames / seconds);
+    printf("  end state: camera (%.3f, %.3f, %.3f), %d bananas active, %d eaten\n",
+           game->camera.position.x,
+           game->camera.position.y,
+           game->camera.position.z,
+           scene_get_active_banana_count(&game->scene),
+           scene_get_eaten_banana_count(&game->scene));
+}
+
+void game_run(Game *game)
+{
+    game->stat_start = SDL_GetPerformanceCounter();
+    game->stat_frames = 0;
+    game->stat_ticks = 0;
+
+    game->replay_start = game->stat_start;
+    game->replay_mark = game->stat_start;
+    game->replay_worst_ms = 0.0;
+
+    if (game->sim_lock)
+        game_run_threaded(game);
+    else
+        game_run_fixed_step(game);
+
+    if (game->replaying)
+        game_report_replay(game);
+}
+
+/*
+ * Control points of the benchmark flight: a loop around the enclosures
+ * that passes over the ponds and through the tree line.
+ */
+static const Vec3 BENCH_CAMERA_PATH[] = {
+    {0.0f, -80.0f, 2.5f},
+    {18.0f, -62.0f, 3.0f},
+    {48.0f, -30.0f, 4.0f},
+    {58.0f, 12.0f, 5.0f},
+    {30.0f, 40.0f, 3.5f},
+    {-22.0f, 60.0f, 2.5f},
+    {-62.0f, 28.0f, 6.0f},
+    {-70.0f, -20.0f, 4.0f},
+    {-40.0f, -52.0f, 3.0f},
+    {-12.0f, -70.0f, 2.0f}};
+
+/*
+ * Frames between two banana throws during the benchmark flight.
+ */
+#define BENCH_THROW_INTERVAL 15
+
+/*
+ * The camera is placed on the spline directly instead of moving through
+ * game_update_camera, so the flight is the same on every run.
+ */
+bool game_run_render_benchmark(Game *game, int frames, double *frame_ms, double *pass_ms)
+{
+    const int path_count = (int)(sizeof(BENCH_CAMERA_PATH) / sizeof(BENCH_CAMERA_PATH[0]));
+    const double freq = (double)SDL_GetPerformanceFrequency();
+
+    for (int p = 0; p < GAME_PASS_COUNT; p++)
+        game->pass_ticks[p] = 0;
+
+    game->time_passes = true;
+
+    for (int f = 0; f < frames; f++)
+    {
+        SDL_Event event;
+        while (SDL_PollEvent(&event))
+        {
+            if (event.type == SDL_QUIT)
+            {
+                game->time_passes = false;
+                return false;
+            }
+        }
+
+        Vec3 position;
+        Vec3 tangent;
+        camera_path_sample(BENCH_CAMERA_PATH, path_count, (float)f / (float)frames, &position, &tangent);
+
+        game->camera.position = position;
+        game->camera.yaw = atan2f(tangent.y, tangent.x) * 180.0f / (float)M_PI;
+        game->camera.pitch = 84.0f;
+        game->prev_camera_position = position;
+
+        if (f % BENCH_THROW_INTERVAL == 0)
+            game_throw_banana(game);
+
+        scene_set_focus(&game->scene, position.x, position.y);
+        scene_update(&game->scene, game->sim_step);
+        scene_collect_obstacles(&game->scene);
+
+        uint64_t start = SDL_GetPerformanceCounter();
+
+        profiler_begin_frame();
+        game_update_streaming(game);
+        Camera view = game_view_camera(game, 1.0f);
+        game_render(game, &game->scene, &view, 1.0f);
+        game_present(game);
+        profiler_end_frame();
+
+        frame_ms[f] = (double)(SDL_GetPerformanceCounter() - start) * 1e3 / freq;
     }
+
+    for (int p = 0; p < GAME_PASS_COUNT; p++)
+        pass_ms[p] = (double)game->pass_ticks[p] * 1e3 / freq;
+
+    game->time_passes = false;
+    return true;
+}
+
+/*
+ * Names in GamePass order.
+ */
+const char *game_pass_name(GamePass pass)
+{
+    static const char *names[GAME_PASS_COUNT] = {
+        "shadow",
+        "prepass",
+        "ground",
+        "objects",
+        "sky",
+        "water",
+        "rain",
+        "ui",
+        "present"};
+
+    if (pass < 0 || pass >= GAME_PASS_COUNT)
+        return "?";
+
+    return names[pass];
 }
 
-static void generate_border_trees(Scene *scene)
+/*
+ * Collect the models that loaded, and the OBJ files they came from if
+ * paths is not NULL. Returns their count, at most 4.
+ */
+static int game_loaded_models(Game *game, Model **models, const char **paths)
 {
-    const float min_x = -95.0f;
-    const float max_x = 95.0f;
-    const float min_y = -95.0f;
-    const float max_y = 95.0f;
-    const float step = 7.0f;
+    static const char *const obj_paths[4] = {
+        "assets/rock.obj",
+        "assets/monkey.obj",
+        "assets/banana.obj",
+        "assets/tree.obj"};
 
-    for (float x = min_x; x <= max_x; x += step)
+    bool loaded[4] = {game->rock_loaded, game->monkey_loaded, game->banana_loaded, game->tree_loaded};
+    Model *all[4] = {&game->rock_model, &game->monkey_model, &game->banana_model, &game->tree_model};
+
+    int count = 0;
+    for (int i = 0; i < 4; i++)
     {
-        scene_add_tree(scene, x + randf_range(-1.5f, 1.5f), max_y + randf_range(-1.0f, 1.0f), 0.0f, randf_range(5.0f, 7.5f), randf_range(0.0f, 360.0f), true);
-        scene_add_tree(scene, x + randf_range(-1.5f, 1.5f), min_y + randf_range(-1.0f, 1.0f), 0.0f, randf_range(5.0f, 7.5f), randf_range(0.0f, 360.0f), true);
+        if (!loaded[i])
+            continue;
+
+        if (paths)
+            paths[count] = obj_paths[i];
+        models[count++] = all[i];
     }
 
-    for (float y = min_y + step; y <= max_y - step; y += step)
+    return count;
+}
+
+/*
+ * Move the loaded models' textures onto shared atlas pages, so drawing
+ * rocks, trees, monkeys and bananas needs no texture switches.
+ */
+static void game_pack_atlas(Game *game)
+{
+    Model *models[4];
+    int count = game_loaded_models(game, models, NULL);
+
+    AtlasResult atlas;
+    atlas_pack_models(models, count, &atlas);
+
+    if (atlas.pages == 0)
+        return;
+
+    printf("Texture atlas: %d textures of %d models on %d page(s), first page %dx%d",
+           atlas.textures, atlas.models, atlas.pages, atlas.page_width[0], atlas.page_height[0]);
+    if (atlas.skipped > 0)
+        printf(", %d models kept their own texture", atlas.skipped);
+    printf("\n");
+}
+
+/*
+ * Once every texture is uploaded: bring the models' texture handles up to
+ * date, bake their AO if requested, pack the atlas if requested and report
+ * the cache. Baking comes first, as it frees the AO textures that would
+ * keep a model out of the atlas. Streamed models only reported their
+ * resident levels when they loaded, so their final memory is reported
+ * here.
+ */
+static void game_finish_textures(Game *game, bool streamed)
+{
+    Model *models[4];
+    const char *paths[4];
+    int count = game_loaded_models(game, models, paths);
+
+    int multitextured = 0;
+    int baked = 0;
+
+    for (int i = 0; i < count; i++)
     {
-        scene_add_tree(scene, min_x + randf_range(-1.0f, 1.0f), y + randf_range(-1.5f, 1.5f), 0.0f, randf_range(5.0f, 7.5f), randf_range(0.0f, 360.0f), true);
-        scene_add_tree(scene, max_x + randf_range(-1.0f, 1.0f), y + randf_range(-1.5f, 1.5f), 0.0f, randf_range(5.0f, 7.5f), randf_range(0.0f, 360.0f), true);
+        if (streamed)
+        {
+            model_report_texture_memory(models[i], paths[i]);
+        }
+        else
+        {
+            texture_refresh(&models[i]->texture);
+            texture_refresh(&models[i]->ao_texture);
+        }
+
+        if (game->ao_bake)
+            model_bake_ao(models[i]);
+
+        if (models[i]->vertex_ao)
+            baked++;
+        else if (models[i]->ao_texture.valid)
+            multitextured++;
+    }
+
+    if (multitextured > 0 || baked > 0)
+        printf("Ambient occlusion: %d model(s) multitextured, %d baked into vertex colors\n", multitextured, baked);
+
+    if (game->atlas_pending)
+    {
+        game->atlas_pending = false;
+        game_pack_atlas(game);
     }
+
+    TextureCacheStats cache;
+    texture_cache_stats(&cache);
+    printf("Texture cache: %d textures, %.2f MB, %d hits, %.2f MB saved\n",
+           cache.entries,
+           (double)cache.bytes / (1024.0 * 1024.0),
+           cache.hits,
+           (double)cache.bytes_saved / (1024.0 * 1024.0));
 }
 
-static void game_load_assets(Game *game)
+/*
+ * Upload the next part of the textures being streamed, within the frame's
+ * byte budget. Models draw with a placeholder until theirs is complete.
+ */
+static void game_update_streaming(Game *game)
 {
-    game->rock_loaded = model_load_obj(
+    if (texture_stream_pending() == 0)
+        return;
+
+    profiler_begin("texture_stream");
+    int pending = texture_stream_update(TEXTURE_STREAM_FRAME_BYTES);
+    profiler_end();
+
+    if (pending > 0)
+        return;
+
+    double elapsed = (double)(SDL_GetPerformanceCounter() - game->stream_start) / (double)SDL_GetPerformanceFrequency();
+    printf("Textures streamed in %.1f ms\n", elapsed * 1000.0);
+
+    game_finish_textures(game, true);
+}
+
+/*
+ * Return path if the file can be opened, else NULL. Used for assets that
+ * may be missing without an error message.
+ */
+static const char *game_optional_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+
+    fclose(f);
+    return path;
+}
+
+static void game_load_assets(Game *game, const GameOptions *options)
+{
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    game->rock_loaded = model_load_obj_with_ao(
         &game->rock_model,
         "assets/rock.obj",
-        "assets/rock.png");
+        "assets/rock.png",
+        game_optional_file("assets/rock_ao.png"));
 
     if (game->rock_loaded)
     {
@@ -308,10 +1135,11 @@ static void game_load_assets(Game *game)
         fprintf(stderr, "Rock model not loaded. Falling back to colored boxes.\n");
     }
 
-    game->monkey_loaded = model_load_obj(
+    game->monkey_loaded = model_load_obj_with_ao(
         &game->monkey_model,
         "assets/monkey.obj",
-        "assets/monkey.png");
+        "assets/monkey.png",
+        game_optional_file("assets/monkey_ao.png"));
 
     if (game->monkey_loaded)
     {
@@ -322,10 +1150,11 @@ static void game_load_assets(Game *game)
         fprintf(stderr, "Monkey model not loaded.\n");
     }
 
-    game->banana_loaded = model_load_obj(
+    game->banana_loaded = model_load_obj_with_ao(
         &game->banana_model,
         "assets/banana.obj",
-        "assets/banana.png");
+        "assets/banana.png",
+        game_optional_file("assets/banana_ao.png"));
 
     if (game->banana_loaded)
     {
@@ -336,10 +1165,11 @@ static void game_load_assets(Game *game)
         fprintf(stderr, "Banana model not loaded.\n");
     }
 
-    game->tree_loaded = model_load_obj(
+    game->tree_loaded = model_load_obj_with_ao(
         &game->tree_model,
         "assets/tree.obj",
-        "assets/tree.png");
+        "assets/tree.png",
+        game_optional_file("assets/tree_ao.png"));
 
     if (game->tree_loaded)
     {
@@ -349,53 +1179,23 @@ static void game_load_assets(Game *game)
     {
         fprintf(stderr, "Tree model not loaded.\n");
     }
-}
-
-static void game_build_scene(Game *game)
-{
-    Scene *scene = &game->scene;
-
-    if (game->rock_loaded)
-    {
-        scene_add_rock(scene, 5.0f, 6.0f, 2.0f, 8.0f, 25.0f, true);
-        scene_add_rock(scene, -8.0f, 4.0f, 0.5f, 0.7f, -10.0f, true);
-        scene_add_rock(scene, 12.0f, -3.0f, 0.7f, 1.1f, 70.0f, true);
-        scene_add_rock(scene, -10.0f, 10.0f, 0.6f, 1.0f, 15.0f, true);
-        scene_add_rock(scene, 8.0f, 11.0f, 0.5f, 0.9f, 120.0f, true);
-        scene_add_rock(scene, 42.0f, 6.0f, 0.4f, 0.8f, 45.0f, true);
-        scene_add_rock(scene, 36.0f, 14.0f, 0.5f, 1.0f, -20.0f, true);
-        scene_add_rock(scene, -48.0f, -16.0f, 0.4f, 0.8f, 80.0f, true);
-        scene_add_rock(scene, -39.0f, -24.0f, 0.5f, 1.1f, 150.0f, true);
-    }
-
-    scene_add_fence(scene, 0.0f, 0.0f, 25.0f, 2.0f, true);
-    scene_add_fence(scene, 40.0f, 10.0f, 12.0f, 2.0f, true);
-    scene_add_fence(scene, -45.0f, -20.0f, 15.0f, 2.0f, true);
-
-    if (game->monkey_loaded)
-    {
-        scene_add_monkey(scene, 6.0f, 2.0f, 0.0f, 3.5f, 180.0f, 1.8f, true);
-        scene_add_monkey(scene, -5.0f, 5.0f, 0.0f, 3.2f, 45.0f, 1.8f, true);
-
-        scene_add_monkey(scene, 10.0f, -8.0f, 0.0f, 3.1f, 230.0f, 1.8f, true);
-        scene_add_monkey(scene, -12.0f, -6.0f, 0.0f, 3.4f, 300.0f, 1.8f, true);
-
-        scene_add_monkey(scene, 39.0f, 8.0f, 0.0f, 2.8f, 90.0f, 1.6f, true);
-        scene_add_monkey(scene, 44.0f, 13.0f, 0.0f, 2.9f, 210.0f, 1.6f, true);
-
-        scene_add_monkey(scene, -46.0f, -18.0f, 0.0f, 3.0f, 120.0f, 1.7f, true);
-        scene_add_monkey(scene, -40.0f, -24.0f, 0.0f, 2.7f, 20.0f, 1.6f, true);
-    }
-
-    if (game->tree_loaded)
-    {
-        generate_border_trees(scene);
-        generate_trees(scene, 64);
-    }
 
-    scene_add_gate(scene, -1.5f, -25.0f, 0.0f, 3.0f, 0.12f, 2.0f, (Color3){0.40f, 0.30f, 0.15f}, 0.0f, 90.0f);
-    scene_add_gate(scene, 38.5f, -2.0f, 0.0f, 3.0f, 0.12f, 2.0f, (Color3){0.40f, 0.30f, 0.15f}, 0.0f, 90.0f);
-    scene_add_gate(scene, -46.5f, -35.0f, 0.0f, 3.0f, 0.12f, 2.0f, (Color3){0.40f, 0.30f, 0.15f}, 0.0f, 90.0f);
+    /*
+     * The atlas is built from the source images of the cached textures,
+     * which streamed entries only know once they are complete, so with
+     * streaming it waits until they are all in.
+     */
+    game->atlas_pending = options->texture_atlas;
+    game->ao_bake = options->ao_bake;
+    game->sky_first = options->sky_first;
+    game->depth_prepass = options->depth_prepass;
+    game->stream_start = start;
+
+    if (texture_stream_pending() == 0)
+        game_finish_textures(game, false);
+
+    double elapsed = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+    printf("Assets loaded in %.1f ms\n", elapsed * 1000.0);
 }
 
 static void game_handle_light_input(Game *game)
@@ -486,9 +1286,9 @@ static void game_throw_banana(Game *game)
     float side_x = -fy;
     float side_y = fx;
 
-    float forward_speed = randf_range(8.5f, 11.5f);
-    float side_offset = randf_range(-1.4f, 1.4f);
-    float up_speed = randf_range(3.2f, 4.6f);
+    float forward_speed = rng_range(&game->rng, 8.5f, 11.5f);
+    float side_offset = rng_range(&game->rng, -1.4f, 1.4f);
+    float up_speed = rng_range(&game->rng, 3.2f, 4.6f);
 
     float throw_vx = fx * forward_speed + side_x * side_offset;
     float throw_vy = fy * forward_speed + side_y * side_offset;
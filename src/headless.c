@@ -0,0 +1,303 @@
+/*
+ * Headless simulation runner.
+ *
+ * Builds the zoo scene and runs scene_update for a fixed number of ticks
+ * without a window or an OpenGL context, then reports the tick rate and
+ * the time spent per subsystem. Models are loaded as geometry only, so
+ * obstacles match the game; missing asset files are skipped.
+ *
+ *   monkey_zoo_headless [--ticks N] [--seed N] [--threads N]
+ *                       [--rain-drops N] [--water-size N]
+ *                       [--bananas N] [--throw-rate N] [--trace FILE]
+ */
+#define SDL_MAIN_HANDLED
+
+#include "scene.h"
+#include "model.h"
+#include "zoo.h"
+#include "jobs.h"
+#include "rng.h"
+#include "profiler.h"
+
+#include <SDL2/SDL.h>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Simulation step, matching the default game rate.
+ */
+#define HEADLESS_STEP (1.0f / 60.0f)
+
+/*
+ * Radius and period of the circle the simulated viewer walks along.
+ * It passes near the ponds, so their level of detail changes as in play.
+ */
+#define HEADLESS_PATH_RADIUS 60.0f
+#define HEADLESS_PATH_PERIOD 40.0f
+
+/*
+ * Startup options.
+ *
+ * ticks        - simulation steps to run
+ * seed         - scene and layout seed
+ * threads      - worker threads, 0 = one per extra CPU core, -1 = none
+ * rain_drops   - number of rain drops
+ * water_size   - resolution of every pond grid, 0 = per-pond default
+ * bananas      - banana capacity
+ * throw_rate   - bananas thrown per second
+ * trace_path   - Chrome trace of the last ticks, NULL for none
+ */
+typedef struct HeadlessOptions
+{
+    int ticks;
+    uint64_t seed;
+    int threads;
+    int rain_drops;
+    int water_size;
+    int bananas;
+    float throw_rate;
+    const char *trace_path;
+} HeadlessOptions;
+
+/*
+ * One model file and the scene setter it belongs to.
+ */
+typedef struct HeadlessModel
+{
+    const char *path;
+    void (*set)(Scene *scene, const Model *model);
+    Model model;
+    bool loaded;
+} HeadlessModel;
+
+/*
+ * Convert performance counter ticks to milliseconds.
+ */
+static double counter_to_ms(uint64_t ticks)
+{
+    return (double)ticks * 1e3 / (double)SDL_GetPerformanceFrequency();
+}
+
+/*
+ * Parse the command line. Returns false on an unknown option.
+ */
+static bool headless_parse_options(HeadlessOptions *options, int argc, char **argv)
+{
+    options->ticks = 3600;
+    options->seed = 1;
+    options->threads = 0;
+    options->rain_drops = RAIN_DEFAULT_DROPS;
+    options->water_size = 0;
+    options->bananas = 1024;
+    options->throw_rate = 8.0f;
+    options->trace_path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+        {
+            options->ticks = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            options->seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            options->threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--rain-drops") == 0 && i + 1 < argc)
+        {
+            options->rain_drops = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--water-size") == 0 && i + 1 < argc)
+        {
+            options->water_size = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--bananas") == 0 && i + 1 < argc)
+        {
+            options->bananas = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--throw-rate") == 0 && i + 1 < argc)
+        {
+            options->throw_rate = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            options->trace_path = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Throw one banana from the viewer position in its walking direction,
+ * with some spread, the way the player throws them.
+ */
+static void headless_throw_banana(Scene *scene, Rng *rng, float x, float y, float heading)
+{
+    float a = heading + rng_range(rng, -0.4f, 0.4f);
+    float speed = rng_range(rng, 7.0f, 12.0f);
+
+    scene_throw_banana(
+        scene,
+        x, y, 1.6f,
+        cosf(a) * speed,
+        sinf(a) * speed,
+        rng_range(rng, 2.0f, 5.0f));
+}
+
+int main(int argc, char **argv)
+{
+    HeadlessOptions options;
+    if (!headless_parse_options(&options, argc, argv))
+        return 1;
+
+    if (options.ticks < 1)
+    {
+        fprintf(stderr, "headless: invalid tick count %d\n", options.ticks);
+        return 1;
+    }
+
+    Scene *scene = malloc(sizeof(Scene));
+    if (!scene)
+    {
+        fprintf(stderr, "headless: out of memory\n");
+        return 1;
+    }
+
+    JobPool jobs;
+    bool jobs_ready = options.threads >= 0 && jobs_init(&jobs, options.threads);
+
+    if (!scene_init(scene))
+    {
+        fprintf(stderr, "headless: out of memory\n");
+        scene_free(scene);
+        free(scene);
+        if (jobs_ready)
+            jobs_shutdown(&jobs);
+        return 1;
+    }
+    scene_set_seed(scene, options.seed);
+    if (jobs_ready)
+        scene_set_job_pool(scene, &jobs);
+
+    HeadlessModel models[] = {
+        {.path = "assets/rock.obj", .set = scene_set_rock_model},
+        {.path = "assets/monkey.obj", .set = scene_set_monkey_model},
+        {.path = "assets/banana.obj", .set = scene_set_banana_model},
+        {.path = "assets/tree.obj", .set = scene_set_tree_model}};
+    const int model_count = (int)(sizeof(models) / sizeof(models[0]));
+
+    for (int i = 0; i < model_count; i++)
+    {
+        models[i].loaded = model_load_obj_geometry(&models[i].model, models[i].path);
+        if (models[i].loaded)
+            models[i].set(scene, &models[i].model);
+    }
+
+    Rng rng;
+    rng_seed(&rng, options.seed);
+    zoo_build(scene, &rng);
+
+    if (options.water_size > 0 && !scene_set_water_size(scene, options.water_size))
+        fprintf(stderr, "Invalid water size %d, keeping the default pond sizes.\n", options.water_size);
+
+    if (options.rain_drops != RAIN_DEFAULT_DROPS && !scene_set_rain_drops(scene, options.rain_drops))
+        fprintf(stderr, "Invalid rain drop count %d, keeping %d.\n", options.rain_drops, RAIN_DEFAULT_DROPS);
+
+    if (options.bananas > 0 && !scene_set_banana_capacity(scene, options.bananas))
+        fprintf(stderr, "Could not allocate %d bananas, keeping the default capacity.\n", options.bananas);
+
+    scene_collect_obstacles(scene);
+    scene_reset_subsystem_times(scene);
+
+    profiler_init();
+    profiler_set_enabled(options.trace_path != NULL);
+
+    float throw_timer = 0.0f;
+    uint64_t total = 0;
+
+    for (int t = 0; t < options.ticks; t++)
+    {
+        float time = (float)t * HEADLESS_STEP;
+        float phase = 2.0f * (float)M_PI * time / HEADLESS_PATH_PERIOD;
+        float x = cosf(phase) * HEADLESS_PATH_RADIUS;
+        float y = sinf(phase) * HEADLESS_PATH_RADIUS;
+
+        throw_timer += HEADLESS_STEP * options.throw_rate;
+        while (throw_timer >= 1.0f)
+        {
+            throw_timer -= 1.0f;
+            headless_throw_banana(scene, &rng, x, y, phase + 0.5f * (float)M_PI);
+        }
+
+        profiler_begin_frame();
+
+        uint64_t t0 = SDL_GetPerformanceCounter();
+        scene_set_focus(scene, x, y);
+        scene_update(scene, HEADLESS_STEP);
+
+        profiler_begin("collect obstacles");
+        scene_collect_obstacles(scene);
+        profiler_end();
+        total += SDL_GetPerformanceCounter() - t0;
+
+        profiler_end_frame();
+    }
+
+    double total_ms = counter_to_ms(total);
+    double subsystem_ms = 0.0;
+
+    printf("headless: %d ticks, seed %llu, %d worker threads\n",
+           options.ticks,
+           (unsigned long long)options.seed,
+           jobs_ready ? jobs_thread_count(&jobs) : 0);
+    printf("  models          :");
+    for (int i = 0; i < model_count; i++)
+        printf(" %s%s", models[i].path, models[i].loaded ? "" : " (missing)");
+    printf("\n");
+    printf("  scene           : %d ponds, %d monkeys, %d trees, %d obstacles\n",
+           scene->ponds.count, scene->monkey_count, scene->tree_count, scene->obstacle_count);
+    printf("  total           : %.1f ms\n", total_ms);
+    printf("  ticks per second: %.1f\n", total_ms > 0.0 ? (double)options.ticks * 1e3 / total_ms : 0.0);
+    printf("  avg tick        : %.4f ms\n", total_ms / (double)options.ticks);
+
+    for (int i = 0; i < SCENE_SUBSYSTEM_COUNT; i++)
+    {
+        double ms = counter_to_ms(scene->subsystem_ticks[i]);
+        subsystem_ms += ms;
+        printf("  %-16s: %.4f ms/tick\n", scene_subsystem_name((SceneSubsystem)i), ms / (double)options.ticks);
+    }
+
+    printf("  %-16s: %.4f ms/tick\n", "other", (total_ms - subsystem_ms) / (double)options.ticks);
+    printf("  banana result   : %d live, %d eaten\n",
+           scene_get_active_banana_count(scene), scene_get_eaten_banana_count(scene));
+
+    if (options.trace_path && !profiler_write_chrome_trace(options.trace_path))
+        fprintf(stderr, "headless: cannot write %s\n", options.trace_path);
+
+    scene_free(scene);
+    free(scene);
+
+    for (int i = 0; i < model_count; i++)
+    {
+        if (models[i].loaded)
+            model_free_geometry(&models[i].model);
+    }
+
+    if (jobs_ready)
+        jobs_shutdown(&jobs);
+
+    return 0;
+}
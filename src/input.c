@@ -36,11 +36,43 @@ void input_begin_frame(InputState *in)
     in->mouse_dx = 0;
     in->mouse_dy = 0;
 
-    memset(in->key_pressed, 0, sizeof(in->key_pressed));
-    memset(in->key_released, 0, sizeof(in->key_released));
+    in->key_event_count = 0;
 
-    memset(in->mouse_pressed, 0, sizeof(in->mouse_pressed));
-    memset(in->mouse_released, 0, sizeof(in->mouse_released));
+    in->mouse_pressed = 0;
+    in->mouse_released = 0;
+}
+
+/*
+ * Update the held bit and the key's entry in this frame's change list,
+ * adding the entry on its first change of the frame.
+ */
+void input_key_event(InputState *in, SDL_Scancode sc, bool down)
+{
+    if ((int)sc < 0 || sc >= SDL_NUM_SCANCODES)
+        return;
+
+    uint32_t bit = 1u << (sc & 31);
+    if (down)
+        in->key_down[sc >> 5] |= bit;
+    else
+        in->key_down[sc >> 5] &= ~bit;
+
+    InputKeyEvent *e = (InputKeyEvent *)input_find_key_event(in, sc);
+    if (!e)
+    {
+        if (in->key_event_count == INPUT_MAX_KEY_EVENTS)
+            return;
+
+        e = &in->key_events[in->key_event_count++];
+        e->scancode = (uint16_t)sc;
+        e->pressed = false;
+        e->released = false;
+    }
+
+    if (down)
+        e->pressed = true;
+    else
+        e->released = true;
 }
 
 /*
@@ -84,25 +116,19 @@ void input_poll_events(InputState *in)
              */
             if (e.key.repeat == 0)
             {
-                SDL_Scancode sc = e.key.keysym.scancode;
-                in->key_down[sc] = true;
-                in->key_pressed[sc] = true;
+                input_key_event(in, e.key.keysym.scancode, true);
             }
             break;
 
         case SDL_KEYUP:
-        {
-            SDL_Scancode sc = e.key.keysym.scancode;
-            in->key_down[sc] = false;
-            in->key_released[sc] = true;
-        }
-        break;
+            input_key_event(in, e.key.keysym.scancode, false);
+            break;
 
         case SDL_MOUSEBUTTONDOWN:
         {
             int b = clamp_mouse_button(e.button.button);
-            in->mouse_down[b] = true;
-            in->mouse_pressed[b] = true;
+            in->mouse_down |= (uint8_t)(1u << b);
+            in->mouse_pressed |= (uint8_t)(1u << b);
 
             /*
              * Right mouse button enables mouse capture,
@@ -118,8 +144,8 @@ void input_poll_events(InputState *in)
         case SDL_MOUSEBUTTONUP:
         {
             int b = clamp_mouse_button(e.button.button);
-            in->mouse_down[b] = false;
-            in->mouse_released[b] = true;
+            in->mouse_down &= (uint8_t)~(1u << b);
+            in->mouse_released |= (uint8_t)(1u << b);
 
             /*
              * Releasing the right mouse button disables mouse capture.
@@ -0,0 +1,159 @@
+#include "jobs.h"
+
+#include <stdio.h>
+
+/*
+ * Claim and run batches of the current job until none are left.
+ */
+static void jobs_run_batches(JobPool *pool)
+{
+    for (;;)
+    {
+        int batch = SDL_AtomicAdd(&pool->next_batch, 1);
+        if (batch >= pool->batch_count)
+            break;
+
+        int begin = batch * pool->batch_size;
+        int end = begin + pool->batch_size;
+        if (end > pool->count)
+            end = pool->count;
+
+        pool->func(pool->data, begin, end);
+    }
+}
+
+/*
+ * Worker thread main loop: wait for a job, help finish it, report back.
+ */
+static int jobs_worker_main(void *arg)
+{
+    JobPool *pool = (JobPool *)arg;
+
+    for (;;)
+    {
+        SDL_SemWait(pool->start);
+
+        if (SDL_AtomicGet(&pool->quit))
+            break;
+
+        jobs_run_batches(pool);
+        SDL_SemPost(pool->done);
+    }
+
+    return 0;
+}
+
+/*
+ * Create the semaphores and worker threads.
+ */
+bool jobs_init(JobPool *pool, int worker_count)
+{
+    pool->worker_count = 0;
+    pool->func = NULL;
+    pool->data = NULL;
+    pool->count = 0;
+    pool->batch_size = 0;
+    pool->batch_count = 0;
+    SDL_AtomicSet(&pool->next_batch, 0);
+    SDL_AtomicSet(&pool->quit, 0);
+
+    if (worker_count < 1)
+        worker_count = SDL_GetCPUCount() - 1;
+    if (worker_count > JOBS_MAX_WORKERS)
+        worker_count = JOBS_MAX_WORKERS;
+
+    pool->start = SDL_CreateSemaphore(0);
+    pool->done = SDL_CreateSemaphore(0);
+    if (!pool->start || !pool->done)
+    {
+        fprintf(stderr, "jobs_init: SDL_CreateSemaphore failed: %s\n", SDL_GetError());
+        jobs_shutdown(pool);
+        return false;
+    }
+
+    for (int i = 0; i < worker_count; i++)
+    {
+        SDL_Thread *t = SDL_CreateThread(jobs_worker_main, "jobs", pool);
+        if (!t)
+        {
+            fprintf(stderr, "jobs_init: SDL_CreateThread failed: %s\n", SDL_GetError());
+            jobs_shutdown(pool);
+            return false;
+        }
+        pool->workers[pool->worker_count++] = t;
+    }
+
+    return true;
+}
+
+/*
+ * Wake every worker with the quit flag set and wait for it to exit.
+ */
+void jobs_shutdown(JobPool *pool)
+{
+    SDL_AtomicSet(&pool->quit, 1);
+
+    for (int i = 0; i < pool->worker_count; i++)
+        SDL_SemPost(pool->start);
+
+    for (int i = 0; i < pool->worker_count; i++)
+        SDL_WaitThread(pool->workers[i], NULL);
+
+    pool->worker_count = 0;
+
+    if (pool->start)
+        SDL_DestroySemaphore(pool->start);
+    if (pool->done)
+        SDL_DestroySemaphore(pool->done);
+
+    pool->start = NULL;
+    pool->done = NULL;
+}
+
+/*
+ * Return the worker count plus the calling thread.
+ */
+int jobs_thread_count(const JobPool *pool)
+{
+    return pool ? pool->worker_count + 1 : 1;
+}
+
+/*
+ * Publish a job, take part in it and wait for all workers to finish.
+ */
+void jobs_parallel_for(JobPool *pool, int count, int min_batch, JobFunc func, void *data)
+{
+    if (count <= 0)
+        return;
+
+    if (min_batch < 1)
+        min_batch = 1;
+
+    int threads = jobs_thread_count(pool);
+
+    if (threads == 1 || count < min_batch * 2)
+    {
+        func(data, 0, count);
+        return;
+    }
+
+    /* A few batches per thread keep the load balanced */
+    int batch_size = count / (threads * 4);
+    if (batch_size < min_batch)
+        batch_size = min_batch;
+
+    pool->func = func;
+    pool->data = data;
+    pool->count = count;
+    pool->batch_size = batch_size;
+    pool->batch_count = (count + batch_size - 1) / batch_size;
+    SDL_AtomicSet(&pool->next_batch, 0);
+
+    for (int i = 0; i < pool->worker_count; i++)
+        SDL_SemPost(pool->start);
+
+    jobs_run_batches(pool);
+
+    for (int i = 0; i < pool->worker_count; i++)
+        SDL_SemWait(pool->done);
+}
@@ -1,13 +1,186 @@
 #include "game.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 int main(int argc, char **argv)
 {
-    (void)argc;
-    (void)argv;
+    /*
+     * Benchmark modes; all but --bench-render, --bench-ao and --bench-sky
+     * run without a window:
+     *   monkey_zoo --bench-bananas [count] [frames]
+     *   monkey_zoo --bench-pool [slots] [operations]
+     *   monkey_zoo --bench-water [size] [steps]
+     *   monkey_zoo --bench-rain [drops] [frames]
+     *   monkey_zoo --bench-rng [count]
+     *   monkey_zoo --bench-render [frames] [width] [height] [json file]
+     *   monkey_zoo --bench-ao [frames] [width] [height]
+     *   monkey_zoo --bench-sky [frames] [width] [height]
+     */
+    if (argc >= 2 && strcmp(argv[1], "--bench-bananas") == 0)
+    {
+        int count = argc > 2 ? atoi(argv[2]) : 100000;
+        int frames = argc > 3 ? atoi(argv[3]) : 600;
+        return bench_bananas(count, frames);
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "--bench-pool") == 0)
+    {
+        int slots = argc > 2 ? atoi(argv[2]) : 4096;
+        int operations = argc > 3 ? atoi(argv[3]) : 10000000;
+        return bench_pool_churn(slots, operations);
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "--bench-water") == 0)
+    {
+        int size = argc > 2 ? atoi(argv[2]) : 0;
+        int steps = argc > 3 ? atoi(argv[3]) : 600;
+        return bench_water(size, steps);
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "--bench-rain") == 0)
+    {
+        int drops = argc > 2 ? atoi(argv[2]) : 100000;
+        int frames = argc > 3 ? atoi(argv[3]) : 600;
+        return bench_rain(drops, frames);
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "--bench-rng") == 0)
+    {
+        int count = argc > 2 ? atoi(argv[2]) : 10000000;
+        return bench_rng(count);
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "--bench-render") == 0)
+    {
+        int frames = argc > 2 ? atoi(argv[2]) : 600;
+        int width = argc > 3 ? atoi(argv[3]) : 1280;
+        int height = argc > 4 ? atoi(argv[4]) : 720;
+        const char *json_path = argc > 5 ? argv[5] : NULL;
+        return bench_render(frames, width, height, json_path);
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "--bench-ao") == 0)
+    {
+        int frames = argc > 2 ? atoi(argv[2]) : 600;
+        int width = argc > 3 ? atoi(argv[3]) : 1280;
+        int height = argc > 4 ? atoi(argv[4]) : 720;
+        return bench_ao(frames, width, height);
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "--bench-sky") == 0)
+    {
+        int frames = argc > 2 ? atoi(argv[2]) : 600;
+        int width = argc > 3 ? atoi(argv[3]) : 1280;
+        int height = argc > 4 ? atoi(argv[4]) : 720;
+        return bench_sky(frames, width, height);
+    }
+
+    /*
+     * Game options:
+     *   --water-size N   resolution of every pond grid (default: per pond)
+     *   --threads N      simulation worker threads (default: one per extra core)
+     *   --rain-drops N   number of rain drops (default 800)
+     *   --seed N         random seed (default: current time)
+     *   --sim-rate N     simulation steps per second (default 60)
+     *   --sim-thread     run the simulation on its own thread
+     *   --no-vsync       present frames without waiting for vsync
+     *   --record FILE    record the input of the session to FILE
+     *   --replay FILE    replay a recorded session from FILE
+     *   --no-texture-compression  keep textures uncompressed RGBA8
+     *   --no-atlas       keep a separate texture per model
+     *   --no-texture-cache  decode every texture from its image file
+     *   --no-texture-streaming  upload every texture before the first frame
+     *   --bake-ao        bake AO maps into vertex colors
+     *   --no-shaders     light and fog with the fixed-function pipeline
+     *   --no-shadows     draw without shadow maps
+     *   --depth-prepass  write the depth of heavy meshes before shading
+     */
+    GameOptions options;
+    game_default_options(&options);
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--water-size") == 0 && i + 1 < argc)
+        {
+            options.water_size = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            options.worker_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--rain-drops") == 0 && i + 1 < argc)
+        {
+            options.rain_drops = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            options.seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--sim-rate") == 0 && i + 1 < argc)
+        {
+            options.sim_rate = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--sim-thread") == 0)
+        {
+            options.sim_thread = true;
+        }
+        else if (strcmp(argv[i], "--no-vsync") == 0)
+        {
+            options.vsync = false;
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            options.record_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            options.replay_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--no-texture-compression") == 0)
+        {
+            options.texture_compression = false;
+        }
+        else if (strcmp(argv[i], "--no-atlas") == 0)
+        {
+            options.texture_atlas = false;
+        }
+        else if (strcmp(argv[i], "--no-texture-cache") == 0)
+        {
+            options.texture_disk_cache = false;
+        }
+        else if (strcmp(argv[i], "--no-texture-streaming") == 0)
+        {
+            options.texture_streaming = false;
+        }
+        else if (strcmp(argv[i], "--bake-ao") == 0)
+        {
+            options.ao_bake = true;
+        }
+        else if (strcmp(argv[i], "--no-shaders") == 0)
+        {
+            options.shaders = false;
+        }
+        else if (strcmp(argv[i], "--no-shadows") == 0)
+        {
+            options.shadows = false;
+        }
+        else if (strcmp(argv[i], "--depth-prepass") == 0)
+        {
+            options.depth_prepass = true;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
 
     Game game;
 
-    if (!game_init(&game))
+    if (!game_init(&game, &options))
     {
         return 1;
     }
@@ -16,4 +189,4 @@ int main(int argc, char **argv)
     game_shutdown(&game);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,111 @@
+#include "mapped_file.h"
+
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+/*
+ * CreateFileMapping keeps the file open until the view is unmapped.
+ */
+bool mapped_file_open(MappedFile *out_file, const char *path)
+{
+    memset(out_file, 0, sizeof(*out_file));
+
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    out_file->data = data;
+    out_file->size = (size_t)size.QuadPart;
+    out_file->file = file;
+    out_file->mapping = mapping;
+    return true;
+}
+
+/*
+ * Unmap the view, then close the mapping and the file.
+ */
+void mapped_file_close(MappedFile *file)
+{
+    if (file->data)
+    {
+        UnmapViewOfFile(file->data);
+        CloseHandle(file->mapping);
+        CloseHandle(file->file);
+    }
+
+    memset(file, 0, sizeof(*file));
+}
+
+#else
+
+/*
+ * The descriptor can be closed right away; the mapping keeps the file.
+ */
+bool mapped_file_open(MappedFile *out_file, const char *path)
+{
+    memset(out_file, 0, sizeof(*out_file));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    out_file->data = data;
+    out_file->size = (size_t)st.st_size;
+    return true;
+}
+
+/*
+ * Unmap the file.
+ */
+void mapped_file_close(MappedFile *file)
+{
+    if (file->data)
+        munmap(file->data, file->size);
+
+    memset(file, 0, sizeof(*file));
+}
+
+#endif
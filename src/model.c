@@ -146,7 +146,7 @@ static V3 v3_norm(V3 a)
 }
 
 /*
- * Load an OBJ model, optionally with a main texture and an AO texture.
+ * Load the geometry of an OBJ model without touching OpenGL.
  *
  * The loader:
  * - parses vertex positions, normals and UVs
@@ -156,7 +156,7 @@ static V3 v3_norm(V3 a)
  * - normalizes it to a consistent size
  * - computes bounds and an approximate XY radius
  */
-bool model_load_obj_with_ao(Model *out, const char *obj_path, const char *tex_path, const char *ao_path)
+bool model_load_obj_geometry(Model *out, const char *obj_path)
 {
     memset(out, 0, sizeof(*out));
 
@@ -472,83 +472,18 @@ bool model_load_obj_with_ao(Model *out, const char *obj_path, const char *tex_pa
     out->verts = verts;
     out->vert_count = vert_count;
 
-    /*
-     * Load textures if file paths were provided.
-     */
-    if (tex_path)
-        texture_load(&out->texture, tex_path);
-
-    if (ao_path)
-        texture_load(&out->ao_texture, ao_path);
-
     return true;
 }
 
 /*
- * Load an OBJ model with only the main texture.
+ * Free the vertex array of a model.
  */
-bool model_load_obj(Model *out, const char *obj, const char *tex)
-{
-    return model_load_obj_with_ao(out, obj, tex, NULL);
-}
-
-/*
- * Free all dynamic memory and textures belonging to a model.
- */
-void model_free(Model *m)
+void model_free_geometry(Model *m)
 {
     if (!m)
         return;
 
     free(m->verts);
     m->verts = NULL;
-
-    texture_free(&m->texture);
-    texture_free(&m->ao_texture);
+    m->vert_count = 0;
 }
-
-/*
- * Draw the model using immediate-mode OpenGL.
- * If a valid texture and UVs are available, the model is textured.
- * Otherwise, it is drawn with a flat fallback color.
- */
-void model_draw(const Model *m)
-{
-    if (!m || !m->verts)
-        return;
-
-    bool use_tex = m->texture.valid && m->has_uvs;
-
-    glEnable(GL_LIGHTING);
-    glDisable(GL_CULL_FACE);
-
-    glColor3f(1.0f, 1.0f, 1.0f);
-
-    if (use_tex)
-    {
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, m->texture.id);
-        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-    }
-    else
-    {
-        glDisable(GL_TEXTURE_2D);
-        glColor3f(0.7f, 0.7f, 0.7f);
-    }
-
-    glBegin(GL_TRIANGLES);
-    for (int i = 0; i < m->vert_count; i++)
-    {
-        const ModelVertex *v = &m->verts[i];
-        glNormal3f(v->nx, v->ny, v->nz);
-        if (use_tex)
-        {
-            glTexCoord2f(v->u, v->v);
-        }
-        glVertex3f(v->x, v->y, v->z);
-    }
-    glEnd();
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glDisable(GL_TEXTURE_2D);
-}
\ No newline at end of file
@@ -0,0 +1,348 @@
+#include "model.h"
+#include "renderer.h"
+#include "stats.h"
+
+#include <GL/gl.h>
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * One texture decoded on a helper thread.
+ *
+ * path    - image file, NULL for no texture
+ * image   - decoded image with its mip chain
+ * ok      - true if decoding succeeded
+ * cached  - true if the texture came from the cache or is being streamed,
+ *           so there is nothing to decode here
+ * thread  - helper thread, NULL if decoding ran inline
+ */
+typedef struct TextureDecode
+{
+    const char *path;
+    TextureImage image;
+    bool ok;
+    bool cached;
+    SDL_Thread *thread;
+} TextureDecode;
+
+/*
+ * Thread entry: decode the image and build its mip chain.
+ */
+static int texture_decode_main(void *arg)
+{
+    TextureDecode *job = (TextureDecode *)arg;
+    job->ok = texture_image_load(&job->image, job->path);
+    return 0;
+}
+
+/*
+ * Take the texture from the cache if its file is already loaded, hand it
+ * to the streamer if streaming is on, else start decoding it on a helper
+ * thread. Decodes inline if no thread can be started.
+ */
+static void texture_decode_start(TextureDecode *job, const char *path, Texture2D *out)
+{
+    job->path = path;
+    job->ok = false;
+    job->cached = false;
+    job->thread = NULL;
+
+    if (!path)
+        return;
+
+    if (texture_cache_acquire(out, path) || texture_stream_load(out, path))
+    {
+        job->cached = true;
+        return;
+    }
+
+    job->thread = SDL_CreateThread(texture_decode_main, "texture", job);
+    if (!job->thread)
+        texture_decode_main(job);
+}
+
+/*
+ * Wait for a decode and upload its result through the cache, if there is
+ * one and upload is requested. Otherwise a handle taken from the cache is
+ * given back. The decoded pixels are released either way.
+ */
+static void texture_decode_finish(TextureDecode *job, Texture2D *out, bool upload)
+{
+    if (job->thread)
+        SDL_WaitThread(job->thread, NULL);
+
+    if (job->cached && !upload)
+        texture_free(out);
+
+    if (job->ok && upload)
+        texture_create_cached(out, &job->image, job->path);
+
+    if (job->ok)
+        texture_image_free(&job->image);
+}
+
+/*
+ * Both handles are refreshed even if the first is still streaming.
+ */
+void model_report_texture_memory(Model *m, const char *obj_path)
+{
+    bool texture_done = texture_refresh(&m->texture);
+    bool ao_done = texture_refresh(&m->ao_texture);
+
+    size_t bytes = m->texture.bytes + m->ao_texture.bytes;
+    size_t base = texture_base_bytes(&m->texture) + texture_base_bytes(&m->ao_texture);
+
+    if (base == 0)
+        return;
+
+    printf("%s: textures %.2f MB (%d levels%s%s), %.2f MB as a single RGBA8 level\n",
+           obj_path,
+           (double)bytes / (1024.0 * 1024.0),
+           m->texture.valid ? m->texture.levels : m->ao_texture.levels,
+           m->texture.compressed ? ", S3TC" : "",
+           texture_done && ao_done ? "" : ", still streaming",
+           (double)base / (1024.0 * 1024.0));
+}
+
+/*
+ * Decode the textures on helper threads while the OBJ file is parsed,
+ * then upload them here, on the thread that owns the GL context.
+ */
+bool model_load_obj_with_ao(Model *out, const char *obj_path, const char *tex_path, const char *ao_path)
+{
+    TextureDecode tex_job;
+    TextureDecode ao_job;
+
+    Texture2D texture = {0};
+    Texture2D ao_texture = {0};
+
+    texture_decode_start(&tex_job, tex_path, &texture);
+    texture_decode_start(&ao_job, ao_path, &ao_texture);
+
+    bool loaded = model_load_obj_geometry(out, obj_path);
+
+    texture_decode_finish(&tex_job, &texture, loaded);
+    texture_decode_finish(&ao_job, &ao_texture, loaded);
+
+    if (!loaded)
+        return false;
+
+    out->texture = texture;
+    out->ao_texture = ao_texture;
+
+    model_report_texture_memory(out, obj_path);
+    return true;
+}
+
+/*
+ * Load an OBJ model with only the main texture.
+ */
+bool model_load_obj(Model *out, const char *obj, const char *tex)
+{
+    return model_load_obj_with_ao(out, obj, tex, NULL);
+}
+
+/*
+ * Free all dynamic memory and textures belonging to a model.
+ */
+void model_free(Model *m)
+{
+    if (!m)
+        return;
+
+    model_free_geometry(m);
+
+    texture_free(&m->texture);
+    texture_free(&m->ao_texture);
+
+    free(m->vertex_ao);
+    m->vertex_ao = NULL;
+}
+
+/*
+ * Wrap a texel index into [0, size), like GL_REPEAT.
+ */
+static int model_wrap(int i, int size)
+{
+    i %= size;
+    return i < 0 ? i + size : i;
+}
+
+/*
+ * Bilinear sample of the red channel at (u, v), with the same texel
+ * centers and wrapping as the GPU would use.
+ */
+static float model_sample_ao(const unsigned char *pixels, int w, int h, float u, float v)
+{
+    float x = u * (float)w - 0.5f;
+    float y = v * (float)h - 0.5f;
+    float fx = floorf(x);
+    float fy = floorf(y);
+    float tx = x - fx;
+    float ty = y - fy;
+
+    int x0 = model_wrap((int)fx, w);
+    int y0 = model_wrap((int)fy, h);
+    int x1 = model_wrap(x0 + 1, w);
+    int y1 = model_wrap(y0 + 1, h);
+
+    float a = pixels[((size_t)y0 * w + x0) * 4];
+    float b = pixels[((size_t)y0 * w + x1) * 4];
+    float c = pixels[((size_t)y1 * w + x0) * 4];
+    float d = pixels[((size_t)y1 * w + x1) * 4];
+
+    float top = a + (b - a) * tx;
+    float bottom = c + (d - c) * tx;
+    return (top + (bottom - top) * ty) / 255.0f;
+}
+
+/*
+ * Read the AO texture back from the GPU, which also covers textures that
+ * were streamed or compressed. An untextured model is drawn in grey, so
+ * the grey is baked in with the occlusion.
+ */
+bool model_bake_ao(Model *m)
+{
+    if (!m || !m->verts || !m->has_uvs || !m->ao_texture.valid)
+        return false;
+
+    if (!texture_refresh(&m->ao_texture))
+        return false;
+
+    int w = m->ao_texture.width;
+    int h = m->ao_texture.height;
+
+    unsigned char *pixels = malloc((size_t)w * h * 4);
+    unsigned char *colors = malloc((size_t)m->vert_count * 4);
+
+    if (!pixels || !colors || !texture_read_pixels(&m->ao_texture, pixels))
+    {
+        free(pixels);
+        free(colors);
+        return false;
+    }
+
+    float base = m->texture.valid ? 255.0f : 0.7f * 255.0f;
+
+    for (int i = 0; i < m->vert_count; i++)
+    {
+        float ao = model_sample_ao(pixels, w, h, m->verts[i].u, m->verts[i].v);
+        unsigned char shade = (unsigned char)(base * ao + 0.5f);
+
+        colors[i * 4 + 0] = shade;
+        colors[i * 4 + 1] = shade;
+        colors[i * 4 + 2] = shade;
+        colors[i * 4 + 3] = 255;
+    }
+
+    free(pixels);
+
+    free(m->vertex_ao);
+    m->vertex_ao = colors;
+    texture_free(&m->ao_texture);
+    return true;
+}
+
+/*
+ * Draw the model from client-side vertex arrays, straight out of the
+ * interleaved vertices.
+ * If a valid texture and UVs are available, the model is textured.
+ * Otherwise, it is drawn with a flat fallback color.
+ * Ambient occlusion is applied in the same pass: an AO texture modulates
+ * the result on the second texture unit, baked AO comes in as vertex
+ * colors.
+ * Textures stay bound and enabled afterwards, so models sharing an atlas
+ * page are drawn one after another without touching GL state; the caller
+ * turns the AO unit off with renderer_set_texturing once it is done.
+ */
+void model_draw(const Model *m)
+{
+    if (!m || !m->verts)
+        return;
+
+    bool use_tex = m->texture.valid && m->has_uvs;
+    bool use_ao = m->ao_texture.valid && m->has_uvs && texture_multitexture_available();
+    bool use_vertex_ao = m->vertex_ao != NULL;
+
+    renderer_set_lighting(true);
+    renderer_set_texturing(0, use_tex);
+    renderer_set_texturing(1, use_ao);
+
+    glColor3f(1.0f, 1.0f, 1.0f);
+
+    if (use_tex)
+    {
+        texture_bind(m->texture.id);
+    }
+    else
+    {
+        glColor3f(0.7f, 0.7f, 0.7f);
+    }
+
+    const ModelVertex *first = m->verts;
+    const GLsizei stride = (GLsizei)sizeof(ModelVertex);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, stride, &first->x);
+    glNormalPointer(GL_FLOAT, stride, &first->nx);
+
+    if (use_tex)
+    {
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, stride, &first->u);
+    }
+
+    if (use_ao)
+    {
+        texture_select_unit(1);
+        texture_bind(m->ao_texture.id);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, stride, &first->u);
+        texture_select_unit(0);
+    }
+
+    if (use_vertex_ao)
+    {
+        glEnableClientState(GL_COLOR_ARRAY);
+        glColorPointer(4, GL_UNSIGNED_BYTE, 0, m->vertex_ao);
+    }
+
+    glDrawArrays(GL_TRIANGLES, 0, m->vert_count);
+    stats_draw((uint32_t)m->vert_count);
+
+    if (use_ao)
+    {
+        texture_select_unit(1);
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        texture_select_unit(0);
+    }
+
+    /* The color array leaves the current color undefined */
+    if (use_vertex_ao)
+    {
+        glDisableClientState(GL_COLOR_ARRAY);
+        glColor3f(1.0f, 1.0f, 1.0f);
+    }
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+/*
+ * Positions only, from the same interleaved vertices.
+ */
+void model_draw_depth(const Model *m)
+{
+    if (!m || !m->verts)
+        return;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, (GLsizei)sizeof(ModelVertex), &m->verts->x);
+    glDrawArrays(GL_TRIANGLES, 0, m->vert_count);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    stats_draw((uint32_t)m->vert_count);
+}
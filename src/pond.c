@@ -0,0 +1,394 @@
+#include "pond.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Reset the system to an empty state without freeing anything.
+ */
+void pond_system_init(PondSystem *system)
+{
+    system->ponds = NULL;
+    system->count = 0;
+    system->capacity = 0;
+
+    system->grid_x0 = 0.0f;
+    system->grid_y0 = 0.0f;
+    system->grid_cell = POND_GRID_CELL;
+    system->grid_w = 0;
+    system->grid_h = 0;
+    system->cell_start = NULL;
+    system->cell_ponds = NULL;
+}
+
+/*
+ * Free the pond grids, the pond array and the lookup grid.
+ */
+void pond_system_free(PondSystem *system)
+{
+    for (int i = 0; i < system->count; i++)
+        water_sim_free(&system->ponds[i].water);
+
+    free(system->ponds);
+    free(system->cell_start);
+    free(system->cell_ponds);
+
+    pond_system_init(system);
+}
+
+/*
+ * Return the range of grid cells overlapped by the bounds of a pond.
+ */
+static void pond_cell_range(const PondSystem *system, const Pond *pond,
+                            int *x0, int *y0, int *x1, int *y1)
+{
+    *x0 = (int)((pond->x - pond->rx - system->grid_x0) / system->grid_cell);
+    *y0 = (int)((pond->y - pond->ry - system->grid_y0) / system->grid_cell);
+    *x1 = (int)((pond->x + pond->rx - system->grid_x0) / system->grid_cell);
+    *y1 = (int)((pond->y + pond->ry - system->grid_y0) / system->grid_cell);
+
+    if (*x1 >= system->grid_w)
+        *x1 = system->grid_w - 1;
+    if (*y1 >= system->grid_h)
+        *y1 = system->grid_h - 1;
+}
+
+/*
+ * Rebuild the lookup grid over the bounds of all ponds.
+ * Ponds are bucketed with a counting pass, a prefix sum and a fill pass.
+ * Returns false if the allocation failed; the old grid is kept then.
+ */
+static bool pond_grid_build(PondSystem *system)
+{
+    float min_x = INFINITY;
+    float min_y = INFINITY;
+    float max_x = -INFINITY;
+    float max_y = -INFINITY;
+
+    for (int i = 0; i < system->count; i++)
+    {
+        const Pond *p = &system->ponds[i];
+        min_x = fminf(min_x, p->x - p->rx);
+        min_y = fminf(min_y, p->y - p->ry);
+        max_x = fmaxf(max_x, p->x + p->rx);
+        max_y = fmaxf(max_y, p->y + p->ry);
+    }
+
+    float cell = POND_GRID_CELL;
+    cell = fmaxf(cell, (max_x - min_x) / (float)POND_GRID_MAX_SIDE);
+    cell = fmaxf(cell, (max_y - min_y) / (float)POND_GRID_MAX_SIDE);
+
+    int w = (int)((max_x - min_x) / cell) + 1;
+    int h = (int)((max_y - min_y) / cell) + 1;
+    if (w > POND_GRID_MAX_SIDE)
+        w = POND_GRID_MAX_SIDE;
+    if (h > POND_GRID_MAX_SIDE)
+        h = POND_GRID_MAX_SIDE;
+
+    PondSystem grid = *system;
+    grid.grid_x0 = min_x;
+    grid.grid_y0 = min_y;
+    grid.grid_cell = cell;
+    grid.grid_w = w;
+    grid.grid_h = h;
+
+    int *cell_start = calloc((size_t)w * (size_t)h + 1, sizeof(int));
+    if (!cell_start)
+        return false;
+
+    /* Count ponds per cell, shifted by one for the prefix sum */
+    for (int i = 0; i < system->count; i++)
+    {
+        int x0, y0, x1, y1;
+        pond_cell_range(&grid, &system->ponds[i], &x0, &y0, &x1, &y1);
+
+        for (int cy = y0; cy <= y1; cy++)
+            for (int cx = x0; cx <= x1; cx++)
+                cell_start[cy * w + cx + 1]++;
+    }
+
+    for (int c = 0; c < w * h; c++)
+        cell_start[c + 1] += cell_start[c];
+
+    int *cell_ponds = malloc((size_t)cell_start[w * h] * sizeof(int));
+    if (!cell_ponds)
+    {
+        free(cell_start);
+        return false;
+    }
+
+    /* Fill using cell_start as a cursor, then shift it back */
+    for (int i = 0; i < system->count; i++)
+    {
+        int x0, y0, x1, y1;
+        pond_cell_range(&grid, &system->ponds[i], &x0, &y0, &x1, &y1);
+
+        for (int cy = y0; cy <= y1; cy++)
+            for (int cx = x0; cx <= x1; cx++)
+                cell_ponds[cell_start[cy * w + cx]++] = i;
+    }
+
+    for (int c = w * h; c > 0; c--)
+        cell_start[c] = cell_start[c - 1];
+    cell_start[0] = 0;
+
+    free(system->cell_start);
+    free(system->cell_ponds);
+
+    grid.cell_start = cell_start;
+    grid.cell_ponds = cell_ponds;
+    *system = grid;
+    return true;
+}
+
+/*
+ * Copy the lookup grid of src into dst, reallocating its lists.
+ */
+static bool pond_grid_copy(PondSystem *dst, const PondSystem *src)
+{
+    dst->grid_x0 = src->grid_x0;
+    dst->grid_y0 = src->grid_y0;
+    dst->grid_cell = src->grid_cell;
+    dst->grid_w = 0;
+    dst->grid_h = 0;
+
+    if (!src->cell_start)
+        return true;
+
+    size_t cells = (size_t)src->grid_w * (size_t)src->grid_h;
+    size_t entries = (size_t)src->cell_start[cells];
+
+    int *cell_start = realloc(dst->cell_start, (cells + 1) * sizeof(int));
+    if (!cell_start)
+        return false;
+    dst->cell_start = cell_start;
+
+    int *cell_ponds = realloc(dst->cell_ponds, (entries > 0 ? entries : 1) * sizeof(int));
+    if (!cell_ponds)
+        return false;
+    dst->cell_ponds = cell_ponds;
+
+    memcpy(cell_start, src->cell_start, (cells + 1) * sizeof(int));
+    if (entries > 0)
+        memcpy(cell_ponds, src->cell_ponds, entries * sizeof(int));
+
+    dst->grid_w = src->grid_w;
+    dst->grid_h = src->grid_h;
+    return true;
+}
+
+/*
+ * Ponds beyond the source count are freed; new array slots start zeroed
+ * so their water grids count as empty.
+ */
+bool pond_system_copy(PondSystem *dst, const PondSystem *src)
+{
+    for (int i = src->count; i < dst->count; i++)
+        water_sim_free(&dst->ponds[i].water);
+    if (dst->count > src->count)
+        dst->count = src->count;
+
+    if (dst->capacity < src->count)
+    {
+        Pond *ponds = realloc(dst->ponds, (size_t)src->count * sizeof(Pond));
+        if (!ponds)
+            return false;
+
+        memset(ponds + dst->capacity, 0, (size_t)(src->count - dst->capacity) * sizeof(Pond));
+        dst->ponds = ponds;
+        dst->capacity = src->count;
+    }
+
+    for (int i = 0; i < src->count; i++)
+    {
+        Pond *pond = &dst->ponds[i];
+        WaterSim water = pond->water;
+
+        *pond = src->ponds[i];
+        pond->water = water;
+
+        if (!water_sim_copy_heights(&pond->water, &src->ponds[i].water))
+        {
+            dst->count = i;
+            return false;
+        }
+
+        if (dst->count <= i)
+            dst->count = i + 1;
+    }
+
+    return pond_grid_copy(dst, src);
+}
+
+/*
+ * Append a pond, grow the array when needed and rebuild the lookup grid.
+ */
+int pond_system_add(PondSystem *system, float x, float y, float z, float rx, float ry, int size)
+{
+    if (rx <= 0.0f || ry <= 0.0f)
+        return -1;
+
+    if (system->count == system->capacity)
+    {
+        int capacity = system->capacity > 0 ? system->capacity * 2 : 4;
+        Pond *ponds = realloc(system->ponds, (size_t)capacity * sizeof(Pond));
+        if (!ponds)
+            return -1;
+
+        system->ponds = ponds;
+        system->capacity = capacity;
+    }
+
+    Pond *pond = &system->ponds[system->count];
+    if (!water_sim_init(&pond->water, size))
+        return -1;
+
+    pond->x = x;
+    pond->y = y;
+    pond->z = z;
+    pond->rx = rx;
+    pond->ry = ry;
+    pond->emit_timer = 0.0f;
+    pond->tick_interval = 0.0f;
+    pond->tick_timer = 0.0f;
+
+    system->count++;
+
+    if (!pond_grid_build(system))
+    {
+        system->count--;
+        water_sim_free(&pond->water);
+        return -1;
+    }
+
+    return system->count - 1;
+}
+
+/*
+ * Swap in a calm grid of the new resolution.
+ */
+bool pond_system_set_size(PondSystem *system, int index, int size)
+{
+    if (index < 0 || index >= system->count)
+        return false;
+
+    WaterSim resized;
+    if (!water_sim_init(&resized, size))
+        return false;
+
+    WaterSim *water = &system->ponds[index].water;
+    resized.kernel = water->kernel;
+    resized.sleep_enabled = water->sleep_enabled;
+
+    water_sim_free(water);
+    *water = resized;
+    return true;
+}
+
+/*
+ * Look up the grid cell of (x, y) and test the ponds listed there.
+ */
+int pond_system_find(const PondSystem *system, float x, float y)
+{
+    if (system->count == 0)
+        return -1;
+
+    float fx = (x - system->grid_x0) / system->grid_cell;
+    float fy = (y - system->grid_y0) / system->grid_cell;
+    if (fx < 0.0f || fy < 0.0f)
+        return -1;
+
+    int cx = (int)fx;
+    int cy = (int)fy;
+    if (cx >= system->grid_w || cy >= system->grid_h)
+        return -1;
+
+    int c = cy * system->grid_w + cx;
+    for (int k = system->cell_start[c]; k < system->cell_start[c + 1]; k++)
+    {
+        int i = system->cell_ponds[k];
+        if (pond_contains(&system->ponds[i], x, y))
+            return i;
+    }
+
+    return -1;
+}
+
+/*
+ * Linear scan; only used once per frame for fog.
+ */
+int pond_system_nearest(const PondSystem *system, float x, float y, float *distance)
+{
+    int best = -1;
+    float best_d2 = 0.0f;
+
+    for (int i = 0; i < system->count; i++)
+    {
+        float dx = x - system->ponds[i].x;
+        float dy = y - system->ponds[i].y;
+        float d2 = dx * dx + dy * dy;
+
+        if (best < 0 || d2 < best_d2)
+        {
+            best = i;
+            best_d2 = d2;
+        }
+    }
+
+    if (distance)
+        *distance = sqrtf(best_d2);
+
+    return best;
+}
+
+/*
+ * Map the world position into the unit square of the pond grid.
+ */
+bool pond_system_splash(PondSystem *system, float x, float y)
+{
+    int i = pond_system_find(system, x, y);
+    if (i < 0)
+        return false;
+
+    Pond *pond = &system->ponds[i];
+    float lx = (x - pond->x) / pond->rx;
+    float ly = (y - pond->y) / pond->ry;
+
+    water_sim_splash(&pond->water, lx * 0.5f + 0.5f, ly * 0.5f + 0.5f);
+    return true;
+}
+
+/*
+ * Pick the tick interval of each pond from the distance between the focus
+ * point and the pond shore, then step the ponds whose interval elapsed.
+ */
+void pond_system_step(PondSystem *system, float delta_time, float focus_x, float focus_y, JobPool *jobs)
+{
+    for (int i = 0; i < system->count; i++)
+    {
+        Pond *pond = &system->ponds[i];
+
+        float dx = focus_x - pond->x;
+        float dy = focus_y - pond->y;
+        float shore = sqrtf(dx * dx + dy * dy) - fmaxf(pond->rx, pond->ry);
+
+        if (shore < POND_NEAR_DISTANCE)
+            pond->tick_interval = 0.0f;
+        else if (shore < POND_FAR_DISTANCE)
+            pond->tick_interval = POND_MID_TICK;
+        else
+            pond->tick_interval = POND_FAR_TICK;
+
+        pond->tick_timer += delta_time;
+        if (pond->tick_timer < pond->tick_interval)
+            continue;
+
+        float step_dt = pond->tick_timer;
+        if (pond->tick_interval > 0.0f && step_dt > POND_MAX_STEP_DT)
+            step_dt = POND_MAX_STEP_DT;
+
+        pond->tick_timer = 0.0f;
+        water_sim_step(&pond->water, step_dt, jobs);
+    }
+}
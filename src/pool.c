@@ -0,0 +1,119 @@
+#include "pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Allocate the three index arrays in one block and mark all slots free.
+ */
+bool pool_init(SlotPool *pool, int capacity)
+{
+    pool->capacity = 0;
+    pool->free_slots = NULL;
+    pool->free_count = 0;
+    pool->live = NULL;
+    pool->live_count = 0;
+    pool->live_pos = NULL;
+
+    if (capacity <= 0)
+        return true;
+
+    int *block = malloc((size_t)capacity * 3 * sizeof(int));
+    if (!block)
+        return false;
+
+    pool->capacity = capacity;
+    pool->free_slots = block;
+    pool->live = block + capacity;
+    pool->live_pos = block + capacity * 2;
+
+    pool_clear(pool);
+    return true;
+}
+
+/*
+ * Free the index block and reset the pool to an empty state.
+ */
+void pool_free(SlotPool *pool)
+{
+    free(pool->free_slots);
+
+    pool->capacity = 0;
+    pool->free_slots = NULL;
+    pool->free_count = 0;
+    pool->live = NULL;
+    pool->live_count = 0;
+    pool->live_pos = NULL;
+}
+
+/*
+ * The three lists share one block, so a single copy covers them.
+ */
+bool pool_copy(SlotPool *dst, const SlotPool *src)
+{
+    if (dst->capacity != src->capacity)
+    {
+        pool_free(dst);
+        if (!pool_init(dst, src->capacity))
+            return false;
+    }
+
+    if (src->capacity > 0)
+        memcpy(dst->free_slots, src->free_slots, (size_t)src->capacity * 3 * sizeof(int));
+
+    dst->free_count = src->free_count;
+    dst->live_count = src->live_count;
+    return true;
+}
+
+/*
+ * Put every slot back on the free stack.
+ * Slots are pushed in reverse so that acquiring hands out 0, 1, 2, ...
+ */
+void pool_clear(SlotPool *pool)
+{
+    pool->live_count = 0;
+    pool->free_count = pool->capacity;
+
+    for (int i = 0; i < pool->capacity; i++)
+    {
+        pool->free_slots[i] = pool->capacity - 1 - i;
+        pool->live_pos[i] = -1;
+    }
+}
+
+/*
+ * Pop a free slot and append it to the live list.
+ */
+int pool_acquire(SlotPool *pool)
+{
+    if (pool->free_count == 0)
+        return -1;
+
+    int slot = pool->free_slots[--pool->free_count];
+
+    pool->live_pos[slot] = pool->live_count;
+    pool->live[pool->live_count++] = slot;
+
+    return slot;
+}
+
+/*
+ * Swap-remove the slot from the live list and push it on the free stack.
+ */
+void pool_release(SlotPool *pool, int slot)
+{
+    if (slot < 0 || slot >= pool->capacity)
+        return;
+
+    int pos = pool->live_pos[slot];
+    if (pos < 0)
+        return;
+
+    int last = pool->live[--pool->live_count];
+    pool->live[pos] = last;
+    pool->live_pos[last] = pos;
+
+    pool->live_pos[slot] = -1;
+    pool->free_slots[pool->free_count++] = slot;
+}
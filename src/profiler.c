@@ -0,0 +1,255 @@
+#include "profiler.h"
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+
+/*
+ * Global profiler state.
+ *
+ * frames     - ring of recorded frames
+ * current    - index of the frame being recorded
+ * completed  - number of completed frames in the ring
+ * in_frame   - true between profiler_begin_frame and profiler_end_frame
+ * stack      - zone index per open nesting level, -1 for dropped zones
+ * depth      - number of open zones
+ * overflow   - zones opened beyond PROFILER_MAX_DEPTH, not recorded
+ * owner      - thread that records
+ * origin     - counter value that trace timestamps are relative to
+ */
+typedef struct Profiler
+{
+    bool enabled;
+
+    ProfileFrame frames[PROFILER_HISTORY];
+    int current;
+    int completed;
+    bool in_frame;
+
+    int stack[PROFILER_MAX_DEPTH];
+    int depth;
+    int overflow;
+
+    SDL_threadID owner;
+    uint64_t origin;
+} Profiler;
+
+static Profiler profiler;
+
+/*
+ * True if calls from the current thread should be recorded. The owner is
+ * checked first: it is only written by profiler_init, before any other
+ * thread starts, so other threads return here without reading the flags
+ * the owner changes.
+ */
+static bool profiler_recording(void)
+{
+    return SDL_ThreadID() == profiler.owner && profiler.enabled && profiler.in_frame;
+}
+
+/*
+ * Forget all frames and take ownership for the calling thread.
+ */
+void profiler_init(void)
+{
+    profiler.current = 0;
+    profiler.completed = 0;
+    profiler.in_frame = false;
+    profiler.depth = 0;
+    profiler.overflow = 0;
+    profiler.owner = SDL_ThreadID();
+    profiler.origin = SDL_GetPerformanceCounter();
+}
+
+/*
+ * Enable or disable recording. A frame in progress is abandoned.
+ */
+void profiler_set_enabled(bool enabled)
+{
+    profiler.enabled = enabled;
+    profiler.in_frame = false;
+    profiler.depth = 0;
+    profiler.overflow = 0;
+}
+
+/*
+ * Report whether recording is on.
+ */
+bool profiler_is_enabled(void)
+{
+    return profiler.enabled;
+}
+
+/*
+ * Move to the next slot of the ring and clear it.
+ */
+void profiler_begin_frame(void)
+{
+    if (SDL_ThreadID() != profiler.owner || !profiler.enabled)
+        return;
+
+    if (profiler.in_frame)
+        profiler_end_frame();
+
+    ProfileFrame *frame = &profiler.frames[profiler.current];
+    frame->start = SDL_GetPerformanceCounter();
+    frame->end = frame->start;
+    frame->zone_count = 0;
+
+    profiler.depth = 0;
+    profiler.overflow = 0;
+    profiler.in_frame = true;
+}
+
+/*
+ * Close zones left open, stamp the frame and advance the ring.
+ */
+void profiler_end_frame(void)
+{
+    if (!profiler_recording())
+        return;
+
+    profiler.overflow = 0;
+    while (profiler.depth > 0)
+        profiler_end();
+
+    ProfileFrame *frame = &profiler.frames[profiler.current];
+    frame->end = SDL_GetPerformanceCounter();
+
+    profiler.current = (profiler.current + 1) % PROFILER_HISTORY;
+    if (profiler.completed < PROFILER_HISTORY)
+        profiler.completed++;
+
+    profiler.in_frame = false;
+}
+
+/*
+ * Append a zone to the current frame and push it on the nesting stack.
+ * A full frame still pushes a marker and a full stack is counted in
+ * overflow, so begin and end stay paired.
+ */
+void profiler_begin(const char *name)
+{
+    if (!profiler_recording())
+        return;
+
+    if (profiler.depth >= PROFILER_MAX_DEPTH)
+    {
+        profiler.overflow++;
+        return;
+    }
+
+    ProfileFrame *frame = &profiler.frames[profiler.current];
+
+    int index = -1;
+    if (frame->zone_count < PROFILER_MAX_ZONES)
+    {
+        index = frame->zone_count++;
+
+        ProfileZone *zone = &frame->zones[index];
+        zone->name = name;
+        zone->depth = profiler.depth;
+        zone->start = SDL_GetPerformanceCounter();
+        zone->end = zone->start;
+    }
+
+    profiler.stack[profiler.depth++] = index;
+}
+
+/*
+ * Pop the innermost zone and stamp its end time. Zones dropped for depth
+ * are closed first, leaving their parents open.
+ */
+void profiler_end(void)
+{
+    if (!profiler_recording())
+        return;
+
+    if (profiler.overflow > 0)
+    {
+        profiler.overflow--;
+        return;
+    }
+
+    if (profiler.depth == 0)
+        return;
+
+    int index = profiler.stack[--profiler.depth];
+    if (index >= 0)
+        profiler.frames[profiler.current].zones[index].end = SDL_GetPerformanceCounter();
+}
+
+/*
+ * The last completed frame sits just before the current slot.
+ */
+const ProfileFrame *profiler_last_frame(void)
+{
+    if (profiler.completed == 0)
+        return NULL;
+
+    return &profiler.frames[(profiler.current + PROFILER_HISTORY - 1) % PROFILER_HISTORY];
+}
+
+/*
+ * Counter ticks to milliseconds.
+ */
+double profiler_ms(uint64_t ticks)
+{
+    return (double)ticks * 1e3 / (double)SDL_GetPerformanceFrequency();
+}
+
+/*
+ * Counter value to trace microseconds since profiler_init.
+ */
+static double profiler_trace_us(uint64_t counter)
+{
+    return profiler_ms(counter - profiler.origin) * 1e3;
+}
+
+/*
+ * Write one complete ("X") trace event.
+ */
+static void profiler_write_event(FILE *f, bool *first, const char *name, uint64_t start, uint64_t end)
+{
+    fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+            *first ? "" : ",",
+            name,
+            profiler_trace_us(start),
+            profiler_ms(end - start) * 1e3);
+    *first = false;
+}
+
+/*
+ * Frames are written oldest first, each as a "frame" event with its
+ * zones nested inside by time, which is how the trace viewer nests them.
+ */
+bool profiler_write_chrome_trace(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return false;
+
+    fprintf(f, "{\"traceEvents\":[");
+
+    bool first = true;
+    int oldest = (profiler.current + PROFILER_HISTORY - profiler.completed) % PROFILER_HISTORY;
+
+    for (int n = 0; n < profiler.completed; n++)
+    {
+        const ProfileFrame *frame = &profiler.frames[(oldest + n) % PROFILER_HISTORY];
+
+        profiler_write_event(f, &first, "frame", frame->start, frame->end);
+
+        for (int i = 0; i < frame->zone_count; i++)
+        {
+            const ProfileZone *zone = &frame->zones[i];
+            profiler_write_event(f, &first, zone->name, zone->start, zone->end);
+        }
+    }
+
+    fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
@@ -0,0 +1,380 @@
+#include "rain.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RAIN_FLOAT_FIELDS 6
+
+/*
+ * Every drop's falls per second are a multiple of 1 / RAIN_CLOCK_PERIOD,
+ * so each drop completes a whole number of falls per RAIN_CLOCK_PERIOD
+ * seconds and its height only depends on the clock modulo that period.
+ */
+#define RAIN_CLOCK_PERIOD 64.0
+
+/*
+ * Integer hash with good avalanche behaviour (lowbias32).
+ */
+static unsigned int rain_hash(unsigned int x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+/*
+ * Map a hash to a float in [minv, maxv).
+ */
+static float rain_hash_range(unsigned int h, float minv, float maxv)
+{
+    return minv + (maxv - minv) * ((float)(h >> 8) * (1.0f / 16777216.0f));
+}
+
+/*
+ * Seed of drop i; every other per-drop value is hashed from it.
+ */
+static unsigned int rain_drop_seed(const RainSystem *rain, int i)
+{
+    return rain_hash(rain->seed ^ ((unsigned int)i * 0x9e3779b9u));
+}
+
+/*
+ * Seed of one fall of drop i.
+ */
+static unsigned int rain_cycle_seed(const RainSystem *rain, int i, unsigned int cycle)
+{
+    return rain_hash(rain_drop_seed(rain, i) + cycle * 0x85ebca6bu);
+}
+
+/*
+ * Return the shift that wraps offsets into the square around center:
+ * an offset o in [0, 2 * RAIN_HALF_EXTENT) lies at world position
+ * center - RAIN_HALF_EXTENT + ((o + shift) mod 2 * RAIN_HALF_EXTENT).
+ * It is computed once per frame so the per-drop wrap is a single compare.
+ */
+static float rain_wrap_shift(float center)
+{
+    const float size = 2.0f * RAIN_HALF_EXTENT;
+    float a = RAIN_HALF_EXTENT - center;
+    return a - size * floorf(a / size);
+}
+
+/*
+ * Wrap one offset with a shift from rain_wrap_shift.
+ */
+static float rain_wrap(float offset, float shift, float center)
+{
+    const float size = 2.0f * RAIN_HALF_EXTENT;
+    float v = offset + shift;
+    v = v >= size ? v - size : v;
+    return center - RAIN_HALF_EXTENT + v;
+}
+
+/*
+ * Horizontal offsets of one fall of drop i in [0, 2 * RAIN_HALF_EXTENT).
+ */
+static void rain_fall_offset(const RainSystem *rain, int i, unsigned int cycle, float *x, float *y)
+{
+    unsigned int h = rain_cycle_seed(rain, i, cycle);
+
+    *x = rain_hash_range(h, 0.0f, 2.0f * RAIN_HALF_EXTENT);
+    *y = rain_hash_range(rain_hash(h), 0.0f, 2.0f * RAIN_HALF_EXTENT);
+}
+
+/*
+ * Return the number of completed falls of drop i at time t.
+ * Cycle counters are never negative, so truncation is floor.
+ */
+static unsigned int rain_cycle(const RainSystem *rain, int i, double t)
+{
+    return (unsigned int)(t * (double)rain->inv_period[i] + (double)rain->phase[i]);
+}
+
+/*
+ * Allocate all per-drop arrays into a new system and fill the drop
+ * properties. The value ranges match the old per-drop rain.
+ */
+static bool rain_alloc(RainSystem *rain, int count, unsigned int seed)
+{
+    rain->count = 0;
+    rain->seed = seed;
+    rain->time = 0.0;
+    rain->center_x = 0.0f;
+    rain->center_y = 0.0f;
+    rain->top = NULL;
+    rain->len = NULL;
+    rain->inv_period = NULL;
+    rain->phase = NULL;
+    rain->offset_x = NULL;
+    rain->offset_y = NULL;
+    rain->landed = NULL;
+    rain->landed_cycle = NULL;
+    rain->landed_count = 0;
+    rain->vertices = NULL;
+
+    if (count < 0)
+        return false;
+    if (count == 0)
+        return true;
+
+    float *block = malloc((size_t)count * RAIN_FLOAT_FIELDS * sizeof(float));
+    int *landed = malloc((size_t)count * sizeof(int));
+    unsigned int *landed_cycle = malloc((size_t)count * sizeof(unsigned int));
+    float *vertices = malloc((size_t)count * 6 * sizeof(float));
+
+    if (!block || !landed || !landed_cycle || !vertices)
+    {
+        free(block);
+        free(landed);
+        free(landed_cycle);
+        free(vertices);
+        return false;
+    }
+
+    rain->count = count;
+    rain->top = block;
+    rain->len = block + count;
+    rain->inv_period = block + (size_t)count * 2;
+    rain->phase = block + (size_t)count * 3;
+    rain->offset_x = block + (size_t)count * 4;
+    rain->offset_y = block + (size_t)count * 5;
+    rain->landed = landed;
+    rain->landed_cycle = landed_cycle;
+    rain->vertices = vertices;
+
+    for (int i = 0; i < count; i++)
+    {
+        unsigned int h0 = rain_drop_seed(rain, i);
+        unsigned int h1 = rain_hash(h0);
+        unsigned int h2 = rain_hash(h1);
+        unsigned int h3 = rain_hash(h2);
+
+        float top = rain_hash_range(h0, 12.0f, 28.0f);
+        float speed = rain_hash_range(h1, 16.0f, 26.0f);
+
+        rain->top[i] = top;
+        rain->len[i] = rain_hash_range(h2, 0.35f, 0.80f);
+        rain->inv_period[i] = roundf(speed / top * (float)RAIN_CLOCK_PERIOD) / (float)RAIN_CLOCK_PERIOD;
+        rain->phase[i] = rain_hash_range(h3, 0.0f, 1.0f);
+
+        rain_fall_offset(rain, i, rain_cycle(rain, i, 0.0), &rain->offset_x[i], &rain->offset_y[i]);
+    }
+
+    return true;
+}
+
+/*
+ * Create the drops with a clock at zero.
+ */
+bool rain_init(RainSystem *rain, int count, unsigned int seed)
+{
+    return rain_alloc(rain, count, seed);
+}
+
+/*
+ * Free the arrays and reset to an empty system.
+ */
+void rain_free(RainSystem *rain)
+{
+    free(rain->top);
+    free(rain->landed);
+    free(rain->landed_cycle);
+    free(rain->vertices);
+
+    rain_alloc(rain, 0, rain->seed);
+}
+
+/*
+ * Build the new drops aside so a failed allocation keeps the old ones.
+ */
+bool rain_set_drop_count(RainSystem *rain, int count)
+{
+    RainSystem resized;
+    if (!rain_alloc(&resized, count, rain->seed))
+        return false;
+
+    resized.time = rain->time;
+    resized.center_x = rain->center_x;
+    resized.center_y = rain->center_y;
+
+    for (int i = 0; i < resized.count; i++)
+        rain_fall_offset(&resized, i, rain_cycle(&resized, i, resized.time), &resized.offset_x[i], &resized.offset_y[i]);
+
+    rain_free(rain);
+    *rain = resized;
+    return true;
+}
+
+/*
+ * Everything but the fall offsets follows from the seed and the count,
+ * so a copy of the same rain only moves the offsets.
+ */
+bool rain_copy(RainSystem *dst, const RainSystem *src)
+{
+    if (dst->count != src->count || dst->seed != src->seed)
+    {
+        RainSystem rebuilt;
+        if (!rain_alloc(&rebuilt, src->count, src->seed))
+            return false;
+
+        rain_free(dst);
+        *dst = rebuilt;
+    }
+
+    if (src->count > 0)
+    {
+        memcpy(dst->offset_x, src->offset_x, (size_t)src->count * sizeof(float));
+        memcpy(dst->offset_y, src->offset_y, (size_t)src->count * sizeof(float));
+    }
+
+    dst->time = src->time;
+    dst->center_x = src->center_x;
+    dst->center_y = src->center_y;
+    dst->landed_count = 0;
+    return true;
+}
+
+/*
+ * A drop landed when the integer part of its cycle counter changed during
+ * the step. The counters are evaluated in double precision, so the rain
+ * clock can run for days without the fall phase losing resolution.
+ * Every drop's index and fall number are stored into landed and
+ * landed_cycle without a branch, and the count only advances past the
+ * drops that landed. The offsets of the next fall are then rewritten
+ * for the landing batch alone.
+ */
+void rain_update(RainSystem *rain, float delta_time, float center_x, float center_y)
+{
+    const double t0 = rain->time;
+    const double t1 = t0 + (double)delta_time;
+
+    const float *restrict inv_period = rain->inv_period;
+    const float *restrict phase = rain->phase;
+    int *restrict landed = rain->landed;
+    unsigned int *restrict landed_cycle = rain->landed_cycle;
+
+    int n = 0;
+
+    for (int i = 0; i < rain->count; i++)
+    {
+        long long k0 = (long long)(t0 * (double)inv_period[i] + (double)phase[i]);
+        long long k1 = (long long)(t1 * (double)inv_period[i] + (double)phase[i]);
+
+        landed[n] = i;
+        landed_cycle[n] = (unsigned int)k1 - 1u;
+        n += k0 != k1;
+    }
+
+    for (int j = 0; j < n; j++)
+    {
+        int i = landed[j];
+        rain_fall_offset(rain, i, landed_cycle[j] + 1u, &rain->offset_x[i], &rain->offset_y[i]);
+    }
+
+    rain->landed_count = n;
+    rain->time = t1;
+    rain->center_x = center_x;
+    rain->center_y = center_y;
+}
+
+/*
+ * Position of the fall that ended in landing number landing.
+ */
+void rain_landing_position(const RainSystem *rain, int landing, float *x, float *y)
+{
+    float ox;
+    float oy;
+    rain_fall_offset(rain, rain->landed[landing], rain->landed_cycle[landing], &ox, &oy);
+
+    *x = rain_wrap(ox, rain_wrap_shift(rain->center_x), rain->center_x);
+    *y = rain_wrap(oy, rain_wrap_shift(rain->center_y), rain->center_y);
+}
+
+/*
+ * The splash decision is hashed from the fall as well, so it does not
+ * touch any shared random state.
+ */
+int rain_splash_ponds(const RainSystem *rain, PondSystem *ponds)
+{
+    if (ponds->count == 0)
+        return 0;
+
+    int splashes = 0;
+
+    for (int j = 0; j < rain->landed_count; j++)
+    {
+        unsigned int h = rain_hash(rain_cycle_seed(rain, rain->landed[j], rain->landed_cycle[j]) ^ 0x5bd1e995u);
+        if (h % 100u >= RAIN_SPLASH_PERCENT)
+            continue;
+
+        float x;
+        float y;
+        rain_landing_position(rain, j, &x, &y);
+
+        if (pond_system_splash(ponds, x, y))
+            splashes++;
+    }
+
+    return splashes;
+}
+
+/*
+ * Drops per batch when building vertices on the job pool.
+ */
+#define RAIN_MIN_DROPS_PER_BATCH 8192
+
+/*
+ * Job callback: evaluate drops [begin, end) at the current clock. The
+ * streak hangs below the drop head, like the old per-drop rain.
+ * The clock is reduced modulo RAIN_CLOCK_PERIOD once in double, so the
+ * per-drop fall phase fits in float and the loop has no double math.
+ */
+static void rain_build_range(void *data, int begin, int end)
+{
+    const RainSystem *rain = data;
+
+    const float shift_x = rain_wrap_shift(rain->center_x);
+    const float shift_y = rain_wrap_shift(rain->center_y);
+    const float center_x = rain->center_x;
+    const float center_y = rain->center_y;
+    const float t = (float)fmod(rain->time, RAIN_CLOCK_PERIOD);
+
+    const float *restrict top = rain->top;
+    const float *restrict len = rain->len;
+    const float *restrict inv_period = rain->inv_period;
+    const float *restrict phase = rain->phase;
+    const float *restrict offset_x = rain->offset_x;
+    const float *restrict offset_y = rain->offset_y;
+    float *restrict out = rain->vertices + (size_t)begin * 6;
+
+    for (int i = begin; i < end; i++)
+    {
+        float c = t * inv_period[i] + phase[i];
+        float frac = c - (float)(int)c;
+
+        float x = rain_wrap(offset_x[i], shift_x, center_x);
+        float y = rain_wrap(offset_y[i], shift_y, center_y);
+        float z = top[i] * (1.0f - frac);
+
+        out[0] = x;
+        out[1] = y;
+        out[2] = z;
+        out[3] = x;
+        out[4] = y;
+        out[5] = z - len[i];
+        out += 6;
+    }
+}
+
+/*
+ * Split the drops across the pool; every batch writes its own vertices.
+ */
+int rain_build_vertices(const RainSystem *rain, JobPool *jobs)
+{
+    jobs_parallel_for(jobs, rain->count, RAIN_MIN_DROPS_PER_BATCH, rain_build_range, (void *)rain);
+    return rain->count * 2;
+}
@@ -1,9 +1,261 @@
 #include "renderer.h"
+#include "shader.h"
+#include "shadow.h"
+#include "stats.h"
+#include "texture.h"
 
 #include <GL/gl.h>
 #include <GL/glu.h>
 #include <SDL2/SDL.h>
 #include <math.h>
+#include <stdio.h>
+
+/*
+ * Scene lighting and fog in GLSL 1.20, matching the fixed-function setup
+ * below: one directional light evaluated per vertex with the vertex color
+ * as ambient and diffuse material, textures modulating the result, and
+ * linear fog per fragment over the eye-space depth, as fixed-function fog
+ * uses. There is no specular term: the material specular is black in the
+ * fixed-function setup, so its light specular never shows either. The fog
+ * gets denser and bluer as the camera approaches a pond; the constants are
+ * the ones the fixed-function path uses in renderer_apply_dynamic_fog.
+ *
+ * With shadows, the diffuse term is kept apart and scaled per fragment by
+ * the light visibility from the cascade the fragment's view depth falls
+ * in: the product of the static and dynamic caster maps, each compared
+ * with bilinear filtering. The cascades sit side by side in the maps, so
+ * lookups are clamped half a texel inside their own third; the filter
+ * never reaches into the neighbouring cascade.
+ */
+static const char *const renderer_vertex_source =
+    "#version 120\n"
+    "uniform vec3 u_light_dir;\n"
+    "uniform vec3 u_light_ambient;\n"
+    "uniform vec3 u_light_diffuse;\n"
+    "uniform bool u_lit;\n"
+    "uniform bool u_shadows;\n"
+    "uniform mat4 u_shadow_matrix[3];\n"
+    "varying float v_depth;\n"
+    "varying vec3 v_diffuse;\n"
+    "varying vec4 v_shadow[3];\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 eye = gl_ModelViewMatrix * gl_Vertex;\n"
+    "    vec4 color = gl_Color;\n"
+    "    v_diffuse = vec3(0.0);\n"
+    "    if (u_lit)\n"
+    "    {\n"
+    "        vec3 n = normalize(gl_NormalMatrix * gl_Normal);\n"
+    "        float d = max(dot(n, u_light_dir), 0.0);\n"
+    "        v_diffuse = color.rgb * u_light_diffuse * d;\n"
+    "        color.rgb *= u_light_ambient;\n"
+    "    }\n"
+    "    if (u_shadows)\n"
+    "    {\n"
+    "        v_shadow[0] = u_shadow_matrix[0] * eye;\n"
+    "        v_shadow[1] = u_shadow_matrix[1] * eye;\n"
+    "        v_shadow[2] = u_shadow_matrix[2] * eye;\n"
+    "    }\n"
+    "    gl_FrontColor = color;\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_TexCoord[1] = gl_MultiTexCoord1;\n"
+    "    v_depth = -eye.z;\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+static const char *const renderer_fragment_source =
+    "#version 120\n"
+    "uniform sampler2D u_texture0;\n"
+    "uniform sampler2D u_texture1;\n"
+    "uniform bool u_textured0;\n"
+    "uniform bool u_textured1;\n"
+    "uniform vec3 u_fog_color;\n"
+    "uniform vec2 u_fog_range;\n"
+    "uniform float u_pond_proximity;\n"
+    "uniform sampler2DShadow u_shadow_static;\n"
+    "uniform sampler2DShadow u_shadow_dynamic;\n"
+    "uniform bool u_shadows;\n"
+    "uniform vec3 u_shadow_splits;\n"
+    "uniform float u_shadow_texel;\n"
+    "uniform vec3 u_static_fit[3];\n"
+    "varying float v_depth;\n"
+    "varying vec3 v_diffuse;\n"
+    "varying vec4 v_shadow[3];\n"
+    "float light_visibility()\n"
+    "{\n"
+    "    vec3 c;\n"
+    "    vec3 fit;\n"
+    "    float cascade;\n"
+    "    if (!u_shadows)\n"
+    "        return 1.0;\n"
+    "    if (v_depth < u_shadow_splits.x)\n"
+    "    {\n"
+    "        c = v_shadow[0].xyz;\n"
+    "        fit = u_static_fit[0];\n"
+    "        cascade = 0.0;\n"
+    "    }\n"
+    "    else if (v_depth < u_shadow_splits.y)\n"
+    "    {\n"
+    "        c = v_shadow[1].xyz;\n"
+    "        fit = u_static_fit[1];\n"
+    "        cascade = 1.0;\n"
+    "    }\n"
+    "    else if (v_depth < u_shadow_splits.z)\n"
+    "    {\n"
+    "        c = v_shadow[2].xyz;\n"
+    "        fit = u_static_fit[2];\n"
+    "        cascade = 2.0;\n"
+    "    }\n"
+    "    else\n"
+    "        return 1.0;\n"
+    "    float lo = cascade / 3.0 + 0.5 * u_shadow_texel;\n"
+    "    c.x = clamp(c.x, lo, lo + 1.0 / 3.0 - u_shadow_texel);\n"
+    "    vec3 s = vec3(c.xy * fit.x + fit.yz, c.z);\n"
+    "    return shadow2D(u_shadow_static, s).r * shadow2D(u_shadow_dynamic, c).r;\n"
+    "}\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 color = vec4(min(gl_Color.rgb + v_diffuse * light_visibility(), 1.0), gl_Color.a);\n"
+    "    if (u_textured0)\n"
+    "        color *= texture2D(u_texture0, gl_TexCoord[0].st);\n"
+    "    if (u_textured1)\n"
+    "        color *= texture2D(u_texture1, gl_TexCoord[1].st);\n"
+    "    float start = max(u_fog_range.x - u_pond_proximity * 7.0, 6.0);\n"
+    "    float end = max(u_fog_range.y - u_pond_proximity * 18.0, start + 8.0);\n"
+    "    vec3 fog = u_fog_color - u_pond_proximity * vec3(0.08, 0.05, 0.02);\n"
+    "    float f = clamp((end - v_depth) / (end - start), 0.0, 1.0);\n"
+    "    gl_FragColor = vec4(mix(fog, color.rgb, f), color.a);\n"
+    "}\n";
+
+/*
+ * The sky: vertex colors straight through, no lighting or fog. The quad
+ * is given in normalized device coordinates next to the far plane, so no
+ * matrices are involved and it only fills pixels the scene left empty.
+ */
+static const char *const renderer_sky_vertex_source =
+    "#version 120\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "    gl_Position = gl_Vertex;\n"
+    "}\n";
+
+static const char *const renderer_sky_fragment_source =
+    "#version 120\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = gl_Color;\n"
+    "}\n";
+
+/*
+ * Full-screen sky quad just inside the far plane. At exactly 1.0 it
+ * would sit on the clip boundary, where drivers may clip it away or
+ * round its depth past the cleared value. RENDERER_SKY_DEPTH maps to
+ * about eight steps below 1.0 in a 24-bit depth buffer. That still
+ * passes GL_LEQUAL against the cleared depth and fails against any
+ * geometry drawn in front.
+ */
+#define RENDERER_SKY_DEPTH (1.0f - 1e-6f)
+
+static const GLfloat renderer_sky_vertices[4 * 3] = {
+    -1.0f, -1.0f, RENDERER_SKY_DEPTH,
+    1.0f, -1.0f, RENDERER_SKY_DEPTH,
+    1.0f, 1.0f, RENDERER_SKY_DEPTH,
+    -1.0f, 1.0f, RENDERER_SKY_DEPTH};
+
+/*
+ * Per-vertex sky colors for renderer_sky_intensity; rebuilt only when the
+ * intensity changes.
+ */
+static GLfloat renderer_sky_colors[4 * 3];
+static float renderer_sky_intensity = -1.0f;
+
+/*
+ * Light and fog values last sent to GL, so unchanged ones are skipped.
+ */
+typedef struct RendererLightCache
+{
+    bool valid;
+    float intensity;
+} RendererLightCache;
+
+typedef struct RendererFogCache
+{
+    bool valid;
+    float start;
+    float end;
+    float r;
+    float g;
+    float b;
+    float proximity;
+} RendererFogCache;
+
+static RendererLightCache renderer_light_cache;
+static RendererFogCache renderer_fog_cache;
+
+/*
+ * Uniform locations of the scene program.
+ */
+typedef struct RendererUniforms
+{
+    int light_dir;
+    int light_ambient;
+    int light_diffuse;
+    int lit;
+    int textured[TEXTURE_COLOR_UNITS];
+    int fog_color;
+    int fog_range;
+    int pond_proximity;
+    int shadows;
+    int shadow_matrix;
+    int shadow_splits;
+    int static_fit[SHADOW_CASCADES];
+} RendererUniforms;
+
+/*
+ * Scene program, 0 when the fixed-function pipeline is used, and the
+ * lighting and texturing switches as last set, so repeated calls cost
+ * nothing.
+ */
+static unsigned int renderer_program;
+static unsigned int renderer_sky_program;
+static bool renderer_in_scene;
+static RendererUniforms renderer_uniforms;
+static bool renderer_lit;
+static bool renderer_textured[TEXTURE_COLOR_UNITS];
+
+/*
+ * Blending, depth and color writes, line width and point size as last
+ * set through their switches. They start at the GL defaults.
+ */
+static bool renderer_blending;
+static bool renderer_depth_write = true;
+static bool renderer_color_write = true;
+static float renderer_line_width = 1.0f;
+static float renderer_point_size = 1.0f;
+
+/*
+ * Direction towards the light in world space. The last value is 0.0, so
+ * GL treats it as a direction, not a position.
+ */
+static const GLfloat renderer_light_position[4] = {0.2f, -0.6f, 1.0f, 0.0f};
+
+/*
+ * Fixed-function light model ambient, added to the light's own ambient.
+ */
+#define RENDERER_GLOBAL_AMBIENT 0.20f
+
+/*
+ * Fog is densest this close to a pond, fading out at this distance.
+ */
+#define RENDERER_POND_FOG_DISTANCE 18.0f
+
+/*
+ * Fog range and pond proximity are rounded to these steps before they are
+ * sent, so the slowly animated values are not re-sent every frame.
+ */
+#define RENDERER_FOG_RANGE_STEP 0.125f
+#define RENDERER_FOG_PROXIMITY_STEP (1.0f / 64.0f)
 
 /*
  * Configure the OpenGL viewport and perspective projection
@@ -18,7 +270,7 @@ static void apply_viewport_projection(int width, int height)
 
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
-    gluPerspective(70.0, (double)width / (double)height, 0.1, 500.0);
+    gluPerspective(RENDERER_FOV_Y, (double)width / (double)height, RENDERER_Z_NEAR, RENDERER_Z_FAR);
 
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
@@ -30,97 +282,339 @@ static void apply_viewport_projection(int width, int height)
 }
 
 /*
- * Draw a fullscreen background quad with a vertical sky gradient.
- * The gradient brightness depends on the current light intensity.
+ * Build the scene program and look up its uniforms. Returns false if
+ * shaders are not available or the program does not build.
  */
-void renderer_draw_sky_gradient(float intensity)
+static bool renderer_init_program(void)
 {
-    float bottom_r, bottom_g, bottom_b;
-    float top_r, top_g, top_b;
-    float t;
+    renderer_program = shader_build("scene", renderer_vertex_source, renderer_fragment_source);
+    if (!renderer_program)
+        return false;
+
+    RendererUniforms *u = &renderer_uniforms;
+    u->light_dir = shader_uniform(renderer_program, "u_light_dir");
+    u->light_ambient = shader_uniform(renderer_program, "u_light_ambient");
+    u->light_diffuse = shader_uniform(renderer_program, "u_light_diffuse");
+    u->lit = shader_uniform(renderer_program, "u_lit");
+    u->textured[0] = shader_uniform(renderer_program, "u_textured0");
+    u->textured[1] = shader_uniform(renderer_program, "u_textured1");
+    u->fog_color = shader_uniform(renderer_program, "u_fog_color");
+    u->fog_range = shader_uniform(renderer_program, "u_fog_range");
+    u->pond_proximity = shader_uniform(renderer_program, "u_pond_proximity");
+    u->shadows = shader_uniform(renderer_program, "u_shadows");
+    u->shadow_matrix = shader_uniform(renderer_program, "u_shadow_matrix");
+    u->shadow_splits = shader_uniform(renderer_program, "u_shadow_splits");
+    u->static_fit[0] = shader_uniform(renderer_program, "u_static_fit[0]");
+    u->static_fit[1] = shader_uniform(renderer_program, "u_static_fit[1]");
+    u->static_fit[2] = shader_uniform(renderer_program, "u_static_fit[2]");
+
+    /* Optional: without it the sky goes through the matrix stacks */
+    renderer_sky_program = shader_build("sky", renderer_sky_vertex_source, renderer_sky_fragment_source);
+
+    shader_use(renderer_program);
+    shader_set_int(shader_uniform(renderer_program, "u_texture0"), 0);
+    shader_set_int(shader_uniform(renderer_program, "u_texture1"), 1);
+    shader_set_int(shader_uniform(renderer_program, "u_shadow_static"), TEXTURE_UNIT_SHADOW_STATIC);
+    shader_set_int(shader_uniform(renderer_program, "u_shadow_dynamic"), TEXTURE_UNIT_SHADOW_DYNAMIC);
+    shader_set_float(shader_uniform(renderer_program, "u_shadow_texel"),
+                     1.0f / (float)(SHADOW_CASCADES * SHADOW_MAP_SIZE));
+    shader_use(0);
+
+    return true;
+}
 
-    if (intensity < 0.2f)
-        intensity = 0.2f;
-    if (intensity > 2.0f)
-        intensity = 2.0f;
+/*
+ * Initialize the renderer and set up default OpenGL states. With the
+ * scene program, lighting and fog live in its uniforms; otherwise fog,
+ * lighting and color material are set up for the fixed-function path.
+ */
+bool renderer_init(int width, int height, bool use_shaders)
+{
+    apply_viewport_projection(width, height);
 
-    t = intensity;
-    if (t > 1.0f)
-        t = 1.0f;
+    /* The only blend function the scene uses; renderer_set_blending toggles it */
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    bottom_r = 0.78f * t;
-    bottom_g = 0.88f * t;
-    bottom_b = 0.98f * t;
+    if (use_shaders && renderer_init_program())
+    {
+        printf("Renderer: GLSL 1.20 lighting and fog\n");
+        return true;
+    }
 
-    top_r = 0.44f * t;
-    top_g = 0.66f * t;
-    top_b = 0.90f * t;
+    if (use_shaders)
+        fprintf(stderr, "GLSL 1.20 is not available, using fixed-function lighting and fog.\n");
 
-    /*
-     * Temporarily disable lighting and depth testing,
-     * then draw the sky in normalized screen space.
-     */
-    glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT | GL_CURRENT_BIT);
+    glEnable(GL_FOG);
+    glFogi(GL_FOG_MODE, GL_LINEAR);
+    glHint(GL_FOG_HINT, GL_NICEST);
 
-    glDisable(GL_LIGHTING);
-    glDisable(GL_TEXTURE_2D);
-    glDisable(GL_DEPTH_TEST);
-    glDepthMask(GL_FALSE);
+    glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
 
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-    glOrtho(-1, 1, -1, 1, -1, 1);
+    const GLfloat ambient[4] = {0.20f, 0.20f, 0.20f, 1.0f};
+    const GLfloat diffuse[4] = {0.85f, 0.85f, 0.85f, 1.0f};
+    const GLfloat specular[4] = {0.10f, 0.10f, 0.10f, 1.0f};
+    glLightfv(GL_LIGHT0, GL_AMBIENT, ambient);
+    glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuse);
+    glLightfv(GL_LIGHT0, GL_SPECULAR, specular);
 
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
+    glEnable(GL_COLOR_MATERIAL);
+    glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+    return false;
+}
 
-    glBegin(GL_QUADS);
-    glColor3f(bottom_r, bottom_g, bottom_b);
-    glVertex2f(-1.0f, -1.0f);
-    glVertex2f(1.0f, -1.0f);
+/*
+ * Delete the scene program.
+ */
+void renderer_shutdown(void)
+{
+    shader_delete(renderer_sky_program);
+    shader_delete(renderer_program);
+    renderer_sky_program = 0;
+    renderer_program = 0;
+}
 
-    glColor3f(top_r, top_g, top_b);
-    glVertex2f(1.0f, 1.0f);
-    glVertex2f(-1.0f, 1.0f);
-    glEnd();
+/*
+ * Start from lit, untextured drawing. The fixed-function state is set
+ * outright, as the UI changes it behind the cached switches.
+ */
+void renderer_begin_scene(void)
+{
+    if (renderer_program)
+        shader_use(renderer_program);
 
-    glPopMatrix();
+    /* Invert the cached values so the switches below always send */
+    renderer_lit = false;
+    renderer_set_lighting(true);
 
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
+    for (int unit = 0; unit < TEXTURE_COLOR_UNITS; unit++)
+    {
+        renderer_textured[unit] = true;
+        renderer_set_texturing(unit, false);
+    }
 
-    glMatrixMode(GL_MODELVIEW);
+    renderer_in_scene = true;
+}
 
-    glDepthMask(GL_TRUE);
-    glEnable(GL_DEPTH_TEST);
+/*
+ * Back to fixed function for the UI.
+ */
+void renderer_end_scene(void)
+{
+    shader_use(0);
+    renderer_in_scene = false;
+}
 
-    glPopAttrib();
+/*
+ * A uniform with the program, GL_LIGHTING without.
+ */
+bool renderer_set_lighting(bool enabled)
+{
+    if (enabled == renderer_lit)
+        return false;
+
+    if (renderer_program)
+        shader_set_int(renderer_uniforms.lit, enabled);
+    else if (enabled)
+        glEnable(GL_LIGHTING);
+    else
+        glDisable(GL_LIGHTING);
+
+    renderer_lit = enabled;
+    stats_add(STAT_STATE_CHANGES, 1);
+    return true;
 }
 
 /*
- * Initialize the renderer and set up default OpenGL states,
- * including fog, lighting and color material.
+ * A uniform with the program; without it GL_TEXTURE_2D on the unit, with
+ * the modulate mode the scene always uses.
  */
-void renderer_init(int width, int height)
+bool renderer_set_texturing(int unit, bool enabled)
 {
-    apply_viewport_projection(width, height);
+    if (unit < 0 || unit >= TEXTURE_COLOR_UNITS || enabled == renderer_textured[unit])
+        return false;
 
-    glEnable(GL_FOG);
+    if (renderer_program)
+    {
+        shader_set_int(renderer_uniforms.textured[unit], enabled);
+    }
+    else
+    {
+        if (!texture_select_unit(unit))
+            return false;
 
-    glEnable(GL_LIGHTING);
-    glEnable(GL_LIGHT0);
+        if (enabled)
+        {
+            glEnable(GL_TEXTURE_2D);
+            glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+        }
+        else
+        {
+            glDisable(GL_TEXTURE_2D);
+        }
 
-    const GLfloat ambient[4] = {0.20f, 0.20f, 0.20f, 1.0f};
-    const GLfloat diffuse[4] = {0.85f, 0.85f, 0.85f, 1.0f};
-    const GLfloat specular[4] = {0.10f, 0.10f, 0.10f, 1.0f};
-    glLightfv(GL_LIGHT0, GL_AMBIENT, ambient);
-    glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuse);
-    glLightfv(GL_LIGHT0, GL_SPECULAR, specular);
+        texture_select_unit(0);
+    }
 
-    glEnable(GL_COLOR_MATERIAL);
-    glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+    renderer_textured[unit] = enabled;
+    stats_add(STAT_STATE_CHANGES, 1);
+    return true;
+}
+
+/*
+ * Alpha blending with the function set by renderer_init.
+ */
+bool renderer_set_blending(bool enabled)
+{
+    if (enabled == renderer_blending)
+        return false;
+
+    if (enabled)
+        glEnable(GL_BLEND);
+    else
+        glDisable(GL_BLEND);
+
+    renderer_blending = enabled;
+    stats_add(STAT_STATE_CHANGES, 1);
+    return true;
+}
+
+/*
+ * glDepthMask.
+ */
+bool renderer_set_depth_write(bool enabled)
+{
+    if (enabled == renderer_depth_write)
+        return false;
+
+    glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    renderer_depth_write = enabled;
+    stats_add(STAT_STATE_CHANGES, 1);
+    return true;
+}
+
+/*
+ * glColorMask on all four channels.
+ */
+bool renderer_set_color_write(bool enabled)
+{
+    if (enabled == renderer_color_write)
+        return false;
+
+    GLboolean mask = enabled ? GL_TRUE : GL_FALSE;
+    glColorMask(mask, mask, mask, mask);
+    renderer_color_write = enabled;
+    stats_add(STAT_STATE_CHANGES, 1);
+    return true;
+}
+
+/*
+ * glLineWidth.
+ */
+bool renderer_set_line_width(float width)
+{
+    if (width == renderer_line_width)
+        return false;
+
+    glLineWidth(width);
+    renderer_line_width = width;
+    stats_add(STAT_STATE_CHANGES, 1);
+    return true;
+}
+
+/*
+ * glPointSize.
+ */
+bool renderer_set_point_size(float size)
+{
+    if (size == renderer_point_size)
+        return false;
+
+    glPointSize(size);
+    renderer_point_size = size;
+    stats_add(STAT_STATE_CHANGES, 1);
+    return true;
+}
+
+/*
+ * Rebuild the sky colors for a new light intensity.
+ */
+static void renderer_update_sky_colors(float intensity)
+{
+    if (intensity < 0.2f)
+        intensity = 0.2f;
+    if (intensity > 2.0f)
+        intensity = 2.0f;
+
+    if (intensity == renderer_sky_intensity)
+        return;
+
+    renderer_sky_intensity = intensity;
+
+    float t = intensity;
+    if (t > 1.0f)
+        t = 1.0f;
+
+    const float bottom[3] = {0.78f * t, 0.88f * t, 0.98f * t};
+    const float top[3] = {0.44f * t, 0.66f * t, 0.90f * t};
+
+    for (int i = 0; i < 3; i++)
+    {
+        renderer_sky_colors[0 * 3 + i] = bottom[i];
+        renderer_sky_colors[1 * 3 + i] = bottom[i];
+        renderer_sky_colors[2 * 3 + i] = top[i];
+        renderer_sky_colors[3 * 3 + i] = top[i];
+    }
+}
+
+/*
+ * Draw the sky gradient from the prebuilt quad. With the sky program the
+ * vertices need no matrices at all; the fixed-function path loads
+ * identity matrices, where the quad's eye distance of 1 also keeps it out
+ * of the fog. Depth writes are off, so it can be drawn before or after
+ * the opaque scene.
+ */
+void renderer_draw_sky_gradient(float intensity)
+{
+    renderer_update_sky_colors(intensity);
+
+    renderer_set_depth_write(false);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, renderer_sky_vertices);
+    glColorPointer(3, GL_FLOAT, 0, renderer_sky_colors);
+
+    if (renderer_sky_program)
+    {
+        shader_use(renderer_sky_program);
+        glDrawArrays(GL_QUADS, 0, 4);
+        shader_use(renderer_in_scene ? renderer_program : 0);
+    }
+    else
+    {
+        renderer_set_lighting(false);
+        renderer_set_texturing(0, false);
+
+        glMatrixMode(GL_PROJECTION);
+        glPushMatrix();
+        glLoadIdentity();
+        glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+        glLoadIdentity();
+
+        glDrawArrays(GL_QUADS, 0, 4);
+
+        glMatrixMode(GL_PROJECTION);
+        glPopMatrix();
+        glMatrixMode(GL_MODELVIEW);
+        glPopMatrix();
+    }
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    renderer_set_depth_write(true);
+
+    stats_draw(4);
 }
 
 /*
@@ -140,6 +634,14 @@ void renderer_begin_frame(float r, float g, float b)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
+/*
+ * Begin a frame whose every pixel the sky or the scene will cover.
+ */
+void renderer_begin_frame_depth(void)
+{
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
 /*
  * Present the rendered frame on the SDL window.
  */
@@ -148,6 +650,14 @@ void renderer_end_frame(void *sdl_window)
     SDL_GL_SwapWindow((SDL_Window *)sdl_window);
 }
 
+/*
+ * Wait until every issued GL command has completed.
+ */
+void renderer_finish(void)
+{
+    glFinish();
+}
+
 /*
  * Update the main light source based on the given intensity value.
  * This affects ambient, diffuse and specular light components.
@@ -177,27 +687,115 @@ void renderer_apply_light(float intensity)
         0.10f * intensity,
         1.0f};
 
-    glEnable(GL_LIGHTING);
-    glEnable(GL_LIGHT0);
+    /*
+     * Directional light source above the scene.
+     */
+    const GLfloat *pos = renderer_light_position;
+
+    if (renderer_program)
+    {
+        /*
+         * GL transforms the light direction by the modelview matrix when
+         * it is set; do the same. Material specular is black in the
+         * fixed-function path, so only ambient and diffuse matter.
+         */
+        GLfloat m[16];
+        glGetFloatv(GL_MODELVIEW_MATRIX, m);
+
+        float x = m[0] * pos[0] + m[4] * pos[1] + m[8] * pos[2];
+        float y = m[1] * pos[0] + m[5] * pos[1] + m[9] * pos[2];
+        float z = m[2] * pos[0] + m[6] * pos[1] + m[10] * pos[2];
+        float len = sqrtf(x * x + y * y + z * z);
+        if (len > 0.0f)
+        {
+            x /= len;
+            y /= len;
+            z /= len;
+        }
+
+        shader_set_vec3(renderer_uniforms.light_dir, x, y, z);
+    }
+    else
+    {
+        /* Lighting and GL_LIGHT0 are enabled by renderer_init and renderer_begin_scene */
+        glLightfv(GL_LIGHT0, GL_POSITION, pos);
+    }
+
+    /* The colors only depend on the intensity, which rarely changes */
+    RendererLightCache *cache = &renderer_light_cache;
+    if (cache->valid && cache->intensity == intensity)
+        return;
+
+    cache->valid = true;
+    cache->intensity = intensity;
+
+    if (renderer_program)
+    {
+        float a = RENDERER_GLOBAL_AMBIENT + ambient[0];
+        shader_set_vec3(renderer_uniforms.light_ambient, a, a, a);
+        shader_set_vec3(renderer_uniforms.light_diffuse, diffuse[0], diffuse[1], diffuse[2]);
+        return;
+    }
 
     glLightfv(GL_LIGHT0, GL_AMBIENT, ambient);
     glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuse);
     glLightfv(GL_LIGHT0, GL_SPECULAR, specular);
+}
 
-    /*
-     * Directional light source above the scene.
-     * The last value is 0.0, so this is treated as a direction, not a position.
-     */
-    const GLfloat pos[4] = {0.2f, -0.6f, 1.0f, 0.0f};
-    glLightfv(GL_LIGHT0, GL_POSITION, pos);
+/*
+ * Normalized renderer_light_position.
+ */
+void renderer_light_direction(float *out_dir)
+{
+    const GLfloat *pos = renderer_light_position;
+    float len = sqrtf(pos[0] * pos[0] + pos[1] * pos[1] + pos[2] * pos[2]);
+
+    out_dir[0] = pos[0] / len;
+    out_dir[1] = pos[1] / len;
+    out_dir[2] = pos[2] / len;
+}
+
+/*
+ * Bind the maps on their own units and hand the cascade matrices, which
+ * already start from eye space, and the static map fits to the scene
+ * program.
+ */
+void renderer_apply_shadows(const ShadowCascades *shadows)
+{
+    if (!renderer_program)
+        return;
+
+    if (!shadows)
+    {
+        shader_set_int(renderer_uniforms.shadows, 0);
+        return;
+    }
+
+    if (texture_select_unit(TEXTURE_UNIT_SHADOW_STATIC))
+        texture_bind(shadows->static_map);
+    if (texture_select_unit(TEXTURE_UNIT_SHADOW_DYNAMIC))
+        texture_bind(shadows->dynamic_map);
+    texture_select_unit(0);
+
+    shader_set_mat4(renderer_uniforms.shadow_matrix, SHADOW_CASCADES, &shadows->eye_to_map[0][0]);
+    shader_set_vec3(renderer_uniforms.shadow_splits,
+                    shadows->split_far[0], shadows->split_far[1], shadows->split_far[2]);
+
+    for (int i = 0; i < SHADOW_CASCADES; i++)
+    {
+        const float *fit = shadows->static_fit[i];
+        shader_set_vec3(renderer_uniforms.static_fit[i], fit[0], fit[1], fit[2]);
+    }
+    shader_set_int(renderer_uniforms.shadows, 1);
 }
 
 /*
  * Configure animated fog for the scene.
- * Fog density changes over time and becomes stronger near the pond.
+ * Fog density changes over time and becomes stronger near water. The
+ * scene program takes the pond proximity as is and adjusts the fog per
+ * fragment; the fixed-function path adjusts it here.
  */
-void renderer_apply_dynamic_fog(float global_time, float cam_x, float cam_y,
-                                int pond_enabled, float pond_x, float pond_y)
+void renderer_apply_dynamic_fog(float global_time, float water_distance)
 {
     /*
      * Base fog animation using a smooth sine wave pulse.
@@ -210,26 +808,47 @@ void renderer_apply_dynamic_fog(float global_time, float cam_x, float cam_y,
     float fog_g = 0.82f;
     float fog_b = 0.90f;
 
+    float proximity = 0.0f;
+    if (water_distance >= 0.0f && water_distance < RENDERER_POND_FOG_DISTANCE)
+        proximity = 1.0f - water_distance / RENDERER_POND_FOG_DISTANCE;
+
+    RendererFogCache *cache = &renderer_fog_cache;
+
+    proximity = roundf(proximity / RENDERER_FOG_PROXIMITY_STEP) * RENDERER_FOG_PROXIMITY_STEP;
+
+    if (renderer_program)
+    {
+        start = roundf(start / RENDERER_FOG_RANGE_STEP) * RENDERER_FOG_RANGE_STEP;
+        end = roundf(end / RENDERER_FOG_RANGE_STEP) * RENDERER_FOG_RANGE_STEP;
+
+        if (cache->valid && cache->start == start && cache->end == end && cache->proximity == proximity)
+            return;
+
+        cache->valid = true;
+        cache->start = start;
+        cache->end = end;
+        cache->proximity = proximity;
+
+        /* The base color is constant; the shader shifts it near ponds */
+        shader_set_vec3(renderer_uniforms.fog_color, fog_r, fog_g, fog_b);
+        shader_set_vec2(renderer_uniforms.fog_range, start, end);
+        shader_set_float(renderer_uniforms.pond_proximity, proximity);
+        return;
+    }
+
     /*
      * Increase fog strength and slightly shift its color
-     * when the camera is close to the pond.
+     * when the camera is close to a pond.
      */
-    if (pond_enabled)
+    if (proximity > 0.0f)
     {
-        float dx = cam_x - pond_x;
-        float dy = cam_y - pond_y;
-        float dist = sqrtf(dx * dx + dy * dy);
-
-        if (dist < 18.0f)
-        {
-            float t = 1.0f - dist / 18.0f;
-            start -= t * 7.0f;
-            end -= t * 18.0f;
+        float t = proximity;
+        start -= t * 7.0f;
+        end -= t * 18.0f;
 
-            fog_r -= t * 0.08f;
-            fog_g -= t * 0.05f;
-            fog_b -= t * 0.02f;
-        }
+        fog_r -= t * 0.08f;
+        fog_g -= t * 0.05f;
+        fog_b -= t * 0.02f;
     }
 
     /*
@@ -241,13 +860,25 @@ void renderer_apply_dynamic_fog(float global_time, float cam_x, float cam_y,
     if (end < start + 8.0f)
         end = start + 8.0f;
 
+    start = roundf(start / RENDERER_FOG_RANGE_STEP) * RENDERER_FOG_RANGE_STEP;
+    end = roundf(end / RENDERER_FOG_RANGE_STEP) * RENDERER_FOG_RANGE_STEP;
+
+    /* Fog, its mode and hint are set once by renderer_init */
+    if (!cache->valid || cache->r != fog_r || cache->g != fog_g || cache->b != fog_b)
     {
         GLfloat fog_color[4] = {fog_r, fog_g, fog_b, 1.0f};
-        glEnable(GL_FOG);
-        glFogi(GL_FOG_MODE, GL_LINEAR);
         glFogfv(GL_FOG_COLOR, fog_color);
+        cache->r = fog_r;
+        cache->g = fog_g;
+        cache->b = fog_b;
+    }
+
+    if (!cache->valid || cache->start != start)
         glFogf(GL_FOG_START, start);
+    if (!cache->valid || cache->end != end)
         glFogf(GL_FOG_END, end);
-        glHint(GL_FOG_HINT, GL_NICEST);
-    }
+
+    cache->valid = true;
+    cache->start = start;
+    cache->end = end;
 }
\ No newline at end of file
@@ -0,0 +1,367 @@
+#include "replay.h"
+
+#include <string.h>
+
+/*
+ * File signature and format version.
+ */
+#define REPLAY_MAGIC "MZRP"
+#define REPLAY_VERSION 1u
+
+/*
+ * Bits of the per-frame flag byte. The optional sections follow the frame
+ * time in the order of their bits.
+ */
+#define REPLAY_QUIT 0x01
+#define REPLAY_MOUSE_CAPTURED 0x02
+#define REPLAY_MOUSE_MOTION 0x04
+#define REPLAY_MOUSE_BUTTONS 0x08
+#define REPLAY_KEYS 0x10
+
+/*
+ * Bits of a recorded key state.
+ */
+#define REPLAY_KEY_DOWN 0x01
+#define REPLAY_KEY_PRESSED 0x02
+#define REPLAY_KEY_RELEASED 0x04
+
+/*
+ * Little-endian writers. Errors are collected by ferror at close.
+ */
+static void write_u8(FILE *f, uint8_t v)
+{
+    fputc(v, f);
+}
+
+static void write_u16(FILE *f, uint16_t v)
+{
+    write_u8(f, (uint8_t)v);
+    write_u8(f, (uint8_t)(v >> 8));
+}
+
+static void write_u32(FILE *f, uint32_t v)
+{
+    write_u16(f, (uint16_t)v);
+    write_u16(f, (uint16_t)(v >> 16));
+}
+
+static void write_u64(FILE *f, uint64_t v)
+{
+    write_u32(f, (uint32_t)v);
+    write_u32(f, (uint32_t)(v >> 32));
+}
+
+/*
+ * Little-endian readers. They return false at the end of the file.
+ */
+static bool read_u8(FILE *f, uint8_t *v)
+{
+    int c = fgetc(f);
+    if (c == EOF)
+        return false;
+
+    *v = (uint8_t)c;
+    return true;
+}
+
+static bool read_u16(FILE *f, uint16_t *v)
+{
+    uint8_t lo;
+    uint8_t hi;
+    if (!read_u8(f, &lo) || !read_u8(f, &hi))
+        return false;
+
+    *v = (uint16_t)(lo | (hi << 8));
+    return true;
+}
+
+static bool read_u32(FILE *f, uint32_t *v)
+{
+    uint16_t lo;
+    uint16_t hi;
+    if (!read_u16(f, &lo) || !read_u16(f, &hi))
+        return false;
+
+    *v = (uint32_t)lo | ((uint32_t)hi << 16);
+    return true;
+}
+
+static bool read_u64(FILE *f, uint64_t *v)
+{
+    uint32_t lo;
+    uint32_t hi;
+    if (!read_u32(f, &lo) || !read_u32(f, &hi))
+        return false;
+
+    *v = (uint64_t)lo | ((uint64_t)hi << 32);
+    return true;
+}
+
+/*
+ * Floats are stored as their IEEE-754 bit pattern, so a replay feeds the
+ * simulation exactly the frame times that were recorded.
+ */
+static void write_f32(FILE *f, float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    write_u32(f, bits);
+}
+
+static bool read_f32(FILE *f, float *v)
+{
+    uint32_t bits;
+    if (!read_u32(f, &bits))
+        return false;
+
+    memcpy(v, &bits, sizeof(bits));
+    return true;
+}
+
+/*
+ * Header: magic, version, seed and simulation rate.
+ */
+bool replay_writer_open(ReplayWriter *writer, const char *path, uint64_t seed, int sim_rate)
+{
+    writer->file = fopen(path, "wb");
+    writer->frames = 0;
+    writer->failed = false;
+
+    if (!writer->file)
+        return false;
+
+    fwrite(REPLAY_MAGIC, 1, 4, writer->file);
+    write_u32(writer->file, REPLAY_VERSION);
+    write_u64(writer->file, seed);
+    write_u32(writer->file, (uint32_t)sim_rate);
+    return true;
+}
+
+/*
+ * Only the keys in the frame's change list and the mouse buttons that
+ * were pressed or released are written. Held state cannot change
+ * otherwise, so the reader rebuilds key_down and mouse_down from these
+ * changes alone.
+ */
+void replay_writer_frame(ReplayWriter *writer, const InputState *in, float delta_time)
+{
+    if (!writer->file)
+        return;
+
+    FILE *f = writer->file;
+
+    uint8_t flags = 0;
+    if (in->quit)
+        flags |= REPLAY_QUIT;
+    if (in->mouse_captured)
+        flags |= REPLAY_MOUSE_CAPTURED;
+    if (in->mouse_dx != 0 || in->mouse_dy != 0)
+        flags |= REPLAY_MOUSE_MOTION;
+    if (in->mouse_pressed != 0 || in->mouse_released != 0)
+        flags |= REPLAY_MOUSE_BUTTONS;
+    if (in->key_event_count > 0)
+        flags |= REPLAY_KEYS;
+
+    write_u8(f, flags);
+    write_f32(f, delta_time);
+
+    if (flags & REPLAY_MOUSE_MOTION)
+    {
+        write_u32(f, (uint32_t)in->mouse_dx);
+        write_u32(f, (uint32_t)in->mouse_dy);
+    }
+
+    if (flags & REPLAY_MOUSE_BUTTONS)
+    {
+        write_u8(f, in->mouse_down);
+        write_u8(f, in->mouse_pressed);
+        write_u8(f, in->mouse_released);
+    }
+
+    if (flags & REPLAY_KEYS)
+    {
+        write_u16(f, (uint16_t)in->key_event_count);
+
+        for (int i = 0; i < in->key_event_count; i++)
+        {
+            const InputKeyEvent *e = &in->key_events[i];
+
+            uint8_t state = 0;
+            if (input_down(in, (SDL_Scancode)e->scancode))
+                state |= REPLAY_KEY_DOWN;
+            if (e->pressed)
+                state |= REPLAY_KEY_PRESSED;
+            if (e->released)
+                state |= REPLAY_KEY_RELEASED;
+
+            write_u16(f, e->scancode);
+            write_u8(f, state);
+        }
+    }
+
+    writer->frames++;
+}
+
+/*
+ * Close the file and report whether everything reached it.
+ */
+bool replay_writer_close(ReplayWriter *writer)
+{
+    if (!writer->file)
+        return !writer->failed;
+
+    if (ferror(writer->file))
+        writer->failed = true;
+    if (fclose(writer->file) != 0)
+        writer->failed = true;
+
+    writer->file = NULL;
+    return !writer->failed;
+}
+
+/*
+ * Check the magic and version, then read the session parameters.
+ */
+bool replay_reader_open(ReplayReader *reader, const char *path)
+{
+    reader->file = fopen(path, "rb");
+    reader->seed = 0;
+    reader->sim_rate = 0;
+    reader->frames = 0;
+    reader->failed = false;
+
+    if (!reader->file)
+        return false;
+
+    char magic[4];
+    uint32_t version;
+    uint32_t sim_rate;
+
+    if (fread(magic, 1, 4, reader->file) != 4 ||
+        memcmp(magic, REPLAY_MAGIC, 4) != 0 ||
+        !read_u32(reader->file, &version) ||
+        version != REPLAY_VERSION ||
+        !read_u64(reader->file, &reader->seed) ||
+        !read_u32(reader->file, &sim_rate))
+    {
+        replay_reader_close(reader);
+        return false;
+    }
+
+    reader->sim_rate = (int)sim_rate;
+    return true;
+}
+
+/*
+ * Turn a recorded key state back into key events. A key that was both
+ * pressed and released in one frame is replayed in the order that leaves
+ * it in its recorded held state.
+ */
+static void replay_apply_key(InputState *in, SDL_Scancode sc, uint8_t state)
+{
+    bool down = (state & REPLAY_KEY_DOWN) != 0;
+    bool pressed = (state & REPLAY_KEY_PRESSED) != 0;
+    bool released = (state & REPLAY_KEY_RELEASED) != 0;
+
+    if (pressed && released)
+    {
+        input_key_event(in, sc, !down);
+        input_key_event(in, sc, down);
+    }
+    else if (pressed || released)
+    {
+        input_key_event(in, sc, pressed);
+    }
+}
+
+/*
+ * A clean end of file before a frame's flag byte ends the replay; running
+ * out of data anywhere else marks the recording as truncated.
+ */
+bool replay_reader_frame(ReplayReader *reader, InputState *in, float *delta_time)
+{
+    if (!reader->file || reader->failed)
+        return false;
+
+    FILE *f = reader->file;
+
+    uint8_t flags;
+    if (!read_u8(f, &flags))
+        return false;
+
+    if (!read_f32(f, delta_time))
+    {
+        reader->failed = true;
+        return false;
+    }
+
+    in->quit = (flags & REPLAY_QUIT) != 0;
+    in->mouse_captured = (flags & REPLAY_MOUSE_CAPTURED) != 0;
+
+    if (flags & REPLAY_MOUSE_MOTION)
+    {
+        uint32_t dx;
+        uint32_t dy;
+        if (!read_u32(f, &dx) || !read_u32(f, &dy))
+        {
+            reader->failed = true;
+            return false;
+        }
+
+        in->mouse_dx = (int32_t)dx;
+        in->mouse_dy = (int32_t)dy;
+    }
+
+    if (flags & REPLAY_MOUSE_BUTTONS)
+    {
+        uint8_t down;
+        uint8_t pressed;
+        uint8_t released;
+        if (!read_u8(f, &down) || !read_u8(f, &pressed) || !read_u8(f, &released))
+        {
+            reader->failed = true;
+            return false;
+        }
+
+        in->mouse_down = down;
+        in->mouse_pressed = pressed;
+        in->mouse_released = released;
+    }
+
+    if (flags & REPLAY_KEYS)
+    {
+        uint16_t count;
+        if (!read_u16(f, &count))
+        {
+            reader->failed = true;
+            return false;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            uint16_t sc;
+            uint8_t state;
+            if (!read_u16(f, &sc) || !read_u8(f, &state) || sc >= SDL_NUM_SCANCODES)
+            {
+                reader->failed = true;
+                return false;
+            }
+
+            replay_apply_key(in, (SDL_Scancode)sc, state);
+        }
+    }
+
+    reader->frames++;
+    return true;
+}
+
+/*
+ * Close the file.
+ */
+void replay_reader_close(ReplayReader *reader)
+{
+    if (reader->file)
+        fclose(reader->file);
+
+    reader->file = NULL;
+}
@@ -0,0 +1,111 @@
+#include "rng.h"
+
+/*
+ * splitmix64 step, used to expand seeds into generator state.
+ */
+static uint64_t rng_splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/*
+ * Expand the seed with splitmix64; it never yields the all-zero state
+ * for the four words together, which xoshiro cannot leave.
+ */
+void rng_seed(Rng *rng, uint64_t seed)
+{
+    uint64_t a = rng_splitmix64(&seed);
+    uint64_t b = rng_splitmix64(&seed);
+
+    rng->s[0] = (uint32_t)a;
+    rng->s[1] = (uint32_t)(a >> 32);
+    rng->s[2] = (uint32_t)b;
+    rng->s[3] = (uint32_t)(b >> 32);
+}
+
+/*
+ * Mix the stream number into the seed before expanding it.
+ */
+void rng_seed_stream(Rng *rng, uint64_t seed, uint64_t stream)
+{
+    uint64_t mixed = stream;
+    rng_seed(rng, seed ^ rng_splitmix64(&mixed));
+}
+
+/*
+ * Give every lane its own seed drawn from the source generator.
+ */
+void rng_batch_seed(RngBatch *batch, Rng *source)
+{
+    for (int lane = 0; lane < RNG_BATCH_LANES; lane++)
+    {
+        Rng lane_rng;
+
+        /* Two statements: the draw order must not be left to the compiler */
+        uint64_t hi = rng_next(source);
+        uint64_t lo = rng_next(source);
+        rng_seed(&lane_rng, (hi << 32) | lo);
+
+        batch->s0[lane] = lane_rng.s[0];
+        batch->s1[lane] = lane_rng.s[1];
+        batch->s2[lane] = lane_rng.s[2];
+        batch->s3[lane] = lane_rng.s[3];
+    }
+}
+
+/*
+ * Step every lane once and store one float per lane.
+ * The lane loop has no dependencies between iterations and vectorises.
+ */
+static void rng_batch_step(RngBatch *restrict batch, float *restrict out, float minv, float scale)
+{
+    for (int lane = 0; lane < RNG_BATCH_LANES; lane++)
+    {
+        uint32_t s0 = batch->s0[lane];
+        uint32_t s1 = batch->s1[lane];
+        uint32_t s2 = batch->s2[lane];
+        uint32_t s3 = batch->s3[lane];
+
+        uint32_t x = s1 * 5u;
+        uint32_t result = ((x << 7) | (x >> 25)) * 9u;
+        uint32_t t = s1 << 9;
+
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        s3 = (s3 << 11) | (s3 >> 21);
+
+        batch->s0[lane] = s0;
+        batch->s1[lane] = s1;
+        batch->s2[lane] = s2;
+        batch->s3[lane] = s3;
+
+        out[lane] = minv + scale * (float)(int32_t)(result >> 8);
+    }
+}
+
+/*
+ * Fill whole lane groups directly and the tail through a small buffer.
+ */
+void rng_batch_fill(RngBatch *batch, float *out, int count, float minv, float maxv)
+{
+    const float scale = (maxv - minv) * (1.0f / 16777216.0f);
+
+    int i = 0;
+    for (; i + RNG_BATCH_LANES <= count; i += RNG_BATCH_LANES)
+        rng_batch_step(batch, out + i, minv, scale);
+
+    if (i < count)
+    {
+        float tail[RNG_BATCH_LANES];
+        rng_batch_step(batch, tail, minv, scale);
+
+        for (int k = 0; i < count; i++, k++)
+            out[i] = tail[k];
+    }
+}
@@ -1,20 +1,15 @@
 #include "scene.h"
 #include "model.h"
+#include "profiler.h"
+#include "stats.h"
 
-#include <GL/gl.h>
+#include <SDL2/SDL.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
 
-/*
- * Return a random floating-point number in the [minv, maxv] interval.
- */
-static float randf_range(float minv, float maxv)
-{
-    return minv + (maxv - minv) * ((float)rand() / (float)RAND_MAX);
-}
-
 /*
  * Clear the current obstacle list.
  */
@@ -64,6 +59,8 @@ static bool sphere_aabb_hit(float cx, float cy, float cz, float r, const AABB *b
  */
 static bool banana_hits_any_obstacle(const Scene *scene, float x, float y, float z, float r)
 {
+    stats_add(STAT_COLLISION_QUERIES, 1);
+
     for (int i = 0; i < scene->obstacle_count; i++)
     {
         if (sphere_aabb_hit(x, y, z, r, &scene->obstacles[i]))
@@ -141,6 +138,8 @@ static bool circle_aabb_2d(float cx, float cy, float r, AABB b)
  */
 bool scene_collides_circle_2d(const Scene *scene, float cx, float cy, float r)
 {
+    stats_add(STAT_COLLISION_QUERIES, 1);
+
     for (int i = 0; i < scene->obstacle_count; i++)
     {
         if (circle_aabb_2d(cx, cy, r, scene->obstacles[i]))
@@ -189,586 +188,474 @@ static void add_fence_obstacles(Scene *scene, float cx, float cy, float half_siz
 }
 
 /*
- * Draw a simple box primitive centered at (cx, cy, cz).
- * This is used for fences, gates, debug geometry and simple scene objects.
+ * Random values drawn per water particle, and particles spawned per batch.
  */
-static void draw_box(float cx, float cy, float cz, float sx, float sy, float sz)
-{
-    float x0 = cx - sx * 0.5f, x1 = cx + sx * 0.5f;
-    float y0 = cy - sy * 0.5f, y1 = cy + sy * 0.5f;
-    float z0 = cz - sz * 0.5f, z1 = cz + sz * 0.5f;
-
-    glBegin(GL_QUADS);
-
-    /* top */
-    glNormal3f(0.0f, 0.0f, 1.0f);
-    glVertex3f(x0, y0, z1);
-    glVertex3f(x1, y0, z1);
-    glVertex3f(x1, y1, z1);
-    glVertex3f(x0, y1, z1);
-
-    /* bottom */
-    glNormal3f(0.0f, 0.0f, -1.0f);
-    glVertex3f(x0, y1, z0);
-    glVertex3f(x1, y1, z0);
-    glVertex3f(x1, y0, z0);
-    glVertex3f(x0, y0, z0);
-
-    /* front (+Y) */
-    glNormal3f(0.0f, 1.0f, 0.0f);
-    glVertex3f(x0, y1, z0);
-    glVertex3f(x0, y1, z1);
-    glVertex3f(x1, y1, z1);
-    glVertex3f(x1, y1, z0);
-
-    /* back (-Y) */
-    glNormal3f(0.0f, -1.0f, 0.0f);
-    glVertex3f(x0, y0, z0);
-    glVertex3f(x1, y0, z0);
-    glVertex3f(x1, y0, z1);
-    glVertex3f(x0, y0, z1);
-
-    /* left (-X) */
-    glNormal3f(-1.0f, 0.0f, 0.0f);
-    glVertex3f(x0, y0, z0);
-    glVertex3f(x0, y0, z1);
-    glVertex3f(x0, y1, z1);
-    glVertex3f(x0, y1, z0);
-
-    /* right (+X) */
-    glNormal3f(1.0f, 0.0f, 0.0f);
-    glVertex3f(x1, y0, z0);
-    glVertex3f(x1, y1, z0);
-    glVertex3f(x1, y1, z1);
-    glVertex3f(x1, y0, z1);
-
-    glEnd();
-}
+#define WATER_PARTICLE_RANDOMS 6
+#define WATER_PARTICLE_BATCH 16
 
 /*
- * Random float helper used by particle, rain and water effects.
+ * Spawn count small water particles above the surface of a pond.
+ * The random values of up to WATER_PARTICLE_BATCH particles are generated
+ * in one batch and then mapped to their ranges.
  */
-static float frand_range(float a, float b)
+static void spawn_water_particles(Scene *scene, const Pond *pond, int count)
 {
-    return a + (b - a) * ((float)rand() / (float)RAND_MAX);
-}
+    float r[WATER_PARTICLE_RANDOMS * WATER_PARTICLE_BATCH];
 
-/*
- * Spawn one small water particle above the pond surface.
- */
-static void spawn_water_particle(Scene *scene)
-{
-    for (int i = 0; i < MAX_WATER_PARTICLES; i++)
+    while (count > 0)
     {
-        WaterParticle *p = &scene->water_particles[i];
-        if (!p->active)
+        int n = count < WATER_PARTICLE_BATCH ? count : WATER_PARTICLE_BATCH;
+        count -= n;
+
+        rng_batch_fill(&scene->particle_rng, r, n * WATER_PARTICLE_RANDOMS, 0.0f, 1.0f);
+
+        for (int k = 0; k < n; k++)
         {
-            float angle = frand_range(0.0f, 6.28318f);
+            int slot = pool_acquire(&scene->water_particle_pool);
+            if (slot < 0)
+                return;
+
+            const float *u = &r[k * WATER_PARTICLE_RANDOMS];
+            WaterParticle *p = &scene->water_particles[slot];
 
-            float rr = sqrtf(frand_range(0.0f, 1.0f));
-            float ex = scene->pond_rx * 0.75f * rr;
-            float ey = scene->pond_ry * 0.75f * rr;
+            float angle = u[0] * 6.28318f;
 
-            p->x = scene->pond_x + cosf(angle) * ex;
-            p->y = scene->pond_y + sinf(angle) * ey;
-            p->z = scene->pond_z + 0.04f;
+            float rr = sqrtf(u[1]);
+            float ex = pond->rx * 0.75f * rr;
+            float ey = pond->ry * 0.75f * rr;
 
-            p->vx = frand_range(-0.04f, 0.04f);
-            p->vy = frand_range(-0.04f, 0.04f);
-            p->vz = frand_range(0.12f, 0.28f);
+            p->x = pond->x + cosf(angle) * ex;
+            p->y = pond->y + sinf(angle) * ey;
+            p->z = pond->z + 0.04f;
 
-            p->life = frand_range(0.7f, 1.4f);
+            p->vx = -0.04f + 0.08f * u[2];
+            p->vy = -0.04f + 0.08f * u[3];
+            p->vz = 0.12f + 0.16f * u[4];
+
+            p->life = 0.7f + 0.7f * u[5];
             p->max_life = p->life;
-            p->active = true;
-            return;
         }
     }
 }
 
+#define BANANA_FLOAT_FIELDS 17
+
 /*
- * Draw the animated pond water mesh based on the height field simulation.
+ * Collect pointers to every float array of the banana storage,
+ * so resizing and element moves can treat all fields uniformly.
  */
-static void draw_water_mesh(const Scene *scene)
+static void bananas_float_fields(SceneBananas *b, float **fields[BANANA_FLOAT_FIELDS])
 {
-    float cx = scene->pond_x;
-    float cy = scene->pond_y;
-    float z = scene->pond_z;
-    float rx = scene->pond_rx;
-    float ry = scene->pond_ry;
-
-    glDisable(GL_TEXTURE_2D);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    for (int x = 0; x < WATER_SIZE - 1; x++)
-    {
-        glBegin(GL_TRIANGLE_STRIP);
-
-        for (int y = 0; y < WATER_SIZE; y++)
-        {
-            for (int k = 0; k < 2; k++)
-            {
-                int xx = x + k;
-                int yy = y;
-
-                float fx = (float)xx / (float)(WATER_SIZE - 1);
-                float fy = (float)yy / (float)(WATER_SIZE - 1);
-
-                float nx = (fx - 0.5f) * 2.0f;
-                float ny = (fy - 0.5f) * 2.0f;
-
-                float inside = nx * nx + ny * ny;
-                if (inside > 1.0f)
-                {
-                    continue;
-                }
-
-                float wx = cx + nx * rx;
-                float wy = cy + ny * ry;
-                float h = scene->water.h[xx][yy];
-
-                /* Slight color variation based on edge distance and wave height */
-                float edge = inside;
-                float r = 0.10f + 0.05f * (1.0f - edge) + h * 0.10f;
-                float g = 0.28f + 0.10f * (1.0f - edge) + h * 0.12f;
-                float b = 0.52f + 0.18f * (1.0f - edge) + h * 0.08f;
-
-                glColor4f(r, g, b, 0.88f);
-                glNormal3f(0.0f, 0.0f, 1.0f);
-                glVertex3f(wx, wy, z + h * 0.28f);
-            }
-        }
-
-        glEnd();
-    }
-
-    glDisable(GL_BLEND);
+    fields[0] = &b->x;
+    fields[1] = &b->y;
+    fields[2] = &b->z;
+    fields[3] = &b->vx;
+    fields[4] = &b->vy;
+    fields[5] = &b->vz;
+    fields[6] = &b->scale;
+    fields[7] = &b->yaw_deg;
+    fields[8] = &b->pitch_deg;
+    fields[9] = &b->roll_deg;
+    fields[10] = &b->ang_vel_pitch;
+    fields[11] = &b->ang_vel_roll;
+    fields[12] = &b->prev_x;
+    fields[13] = &b->prev_y;
+    fields[14] = &b->prev_z;
+    fields[15] = &b->prev_pitch_deg;
+    fields[16] = &b->prev_roll_deg;
 }
 
 /*
- * Draw a line loop around the pond border.
+ * Copy the current pose of every banana into the prev_* arrays.
+ * Called at the start of each simulation step for render interpolation.
  */
-static void draw_pond_border(const Scene *scene)
+static void bananas_store_previous(SceneBananas *b)
 {
-    const int segments = 64;
+    size_t bytes = (size_t)b->count * sizeof(float);
 
-    glDisable(GL_LIGHTING);
-    glDisable(GL_TEXTURE_2D);
-
-    glColor3f(0.08f, 0.16f, 0.22f);
-    glLineWidth(2.0f);
-
-    glBegin(GL_LINE_LOOP);
-    for (int i = 0; i < segments; i++)
-    {
-        float a = (2.0f * (float)M_PI * (float)i) / (float)segments;
-        float x = scene->pond_x + cosf(a) * scene->pond_rx;
-        float y = scene->pond_y + sinf(a) * scene->pond_ry;
-        glVertex3f(x, y, scene->pond_z + 0.01f);
-    }
-    glEnd();
+    memcpy(b->prev_x, b->x, bytes);
+    memcpy(b->prev_y, b->y, bytes);
+    memcpy(b->prev_z, b->z, bytes);
+    memcpy(b->prev_pitch_deg, b->pitch_deg, bytes);
+    memcpy(b->prev_roll_deg, b->roll_deg, bytes);
+}
 
-    glEnable(GL_LIGHTING);
+/*
+ * Make a new banana start without interpolation.
+ */
+static void bananas_store_previous_one(SceneBananas *b, int i)
+{
+    b->prev_x[i] = b->x[i];
+    b->prev_y[i] = b->y[i];
+    b->prev_z[i] = b->z[i];
+    b->prev_pitch_deg[i] = b->pitch_deg[i];
+    b->prev_roll_deg[i] = b->roll_deg[i];
 }
 
 /*
- * Draw small particles above the water.
+ * Reallocate every banana array to the given capacity.
+ * On failure the capacity is reduced to what all arrays can still hold.
  */
-static void draw_water_particles(const Scene *scene)
+static bool bananas_reserve(SceneBananas *b, int capacity)
 {
-    glDisable(GL_LIGHTING);
-    glDisable(GL_TEXTURE_2D);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    float **fields[BANANA_FLOAT_FIELDS];
+    bananas_float_fields(b, fields);
 
-    glPointSize(4.0f);
+    size_t n = (size_t)(capacity > 0 ? capacity : 1);
+    int safe_capacity = capacity < b->capacity ? capacity : b->capacity;
 
-    glBegin(GL_POINTS);
-    for (int i = 0; i < MAX_WATER_PARTICLES; i++)
+    for (int f = 0; f < BANANA_FLOAT_FIELDS; f++)
     {
-        const WaterParticle *p = &scene->water_particles[i];
-        if (!p->active)
+        float *p = realloc(*fields[f], n * sizeof(float));
+        if (!p)
         {
-            continue;
+            b->capacity = safe_capacity;
+            return false;
         }
+        *fields[f] = p;
+    }
 
-        float a = p->life / p->max_life;
-        glColor4f(0.75f, 0.88f, 1.0f, a);
-        glVertex3f(p->x, p->y, p->z);
+    bool *c = realloc(b->collidable, n * sizeof(bool));
+    if (!c)
+    {
+        b->capacity = safe_capacity;
+        return false;
     }
-    glEnd();
+    b->collidable = c;
 
-    glDisable(GL_BLEND);
-    glEnable(GL_LIGHTING);
+    b->capacity = capacity;
+    return true;
 }
 
 /*
- * Add an impulse into the water simulation at world position (wx, wy).
- * This creates a splash / wave effect.
+ * Copy banana src into slot dst.
  */
-void water_splash(Scene *scene, float wx, float wy)
+static void bananas_move(SceneBananas *b, int dst, int src)
 {
-    float lx = (wx - scene->pond_x) / scene->pond_rx;
-    float ly = (wy - scene->pond_y) / scene->pond_ry;
-
-    if (lx * lx + ly * ly > 1.0f)
-        return;
-
-    int ix = (int)(((lx * 0.5f) + 0.5f) * (WATER_SIZE - 1));
-    int iy = (int)(((ly * 0.5f) + 0.5f) * (WATER_SIZE - 1));
+    float **fields[BANANA_FLOAT_FIELDS];
+    bananas_float_fields(b, fields);
 
-    for (int dx = -2; dx <= 2; dx++)
-    {
-        for (int dy = -2; dy <= 2; dy++)
-        {
-            int x = ix + dx;
-            int y = iy + dy;
+    for (int f = 0; f < BANANA_FLOAT_FIELDS; f++)
+        (*fields[f])[dst] = (*fields[f])[src];
 
-            if (x <= 1 || x >= WATER_SIZE - 1 || y <= 1 || y >= WATER_SIZE - 1)
-                continue;
-
-            float d2 = (float)(dx * dx + dy * dy);
-            float impulse = 0.28f - 0.04f * d2;
+    b->collidable[dst] = b->collidable[src];
+}
 
-            if (impulse > 0.0f)
-            {
-                scene->water.v[x][y] += impulse;
+/*
+ * Exchange two banana slots.
+ */
+static void bananas_swap(SceneBananas *b, int i, int j)
+{
+    float **fields[BANANA_FLOAT_FIELDS];
+    bananas_float_fields(b, fields);
 
-                if (scene->water.v[x][y] > 0.08f)
-                    scene->water.v[x][y] = 0.08f;
-                if (scene->water.v[x][y] < -0.08f)
-                    scene->water.v[x][y] = -0.08f;
-            }
-        }
+    for (int f = 0; f < BANANA_FLOAT_FIELDS; f++)
+    {
+        float *a = *fields[f];
+        float t = a[i];
+        a[i] = a[j];
+        a[j] = t;
     }
+
+    bool c = b->collidable[i];
+    b->collidable[i] = b->collidable[j];
+    b->collidable[j] = c;
 }
 
 /*
- * Return true if the given world position is inside the pond ellipse.
+ * Remove an airborne banana by swapping in the last airborne banana,
+ * then filling the freed airborne slot with the last grounded one.
  */
-static bool point_in_pond(const Scene *scene, float x, float y)
+static void bananas_remove_airborne(SceneBananas *b, int i)
 {
-    float lx = (x - scene->pond_x) / scene->pond_rx;
-    float ly = (y - scene->pond_y) / scene->pond_ry;
-    return (lx * lx + ly * ly) <= 1.0f;
+    int last_air = b->airborne_count - 1;
+    int last = b->count - 1;
+
+    if (i != last_air)
+        bananas_move(b, i, last_air);
+    if (last_air != last)
+        bananas_move(b, last_air, last);
+
+    b->airborne_count--;
+    b->count--;
 }
 
 /*
- * Reset one raindrop to a new random position above the scene.
+ * Move an airborne banana into the grounded range.
  */
-static void reset_raindrop(RainDrop *d, float center_x, float center_y)
+static void bananas_land(SceneBananas *b, int i)
 {
-    d->x = center_x + frand_range(-55.0f, 55.0f);
-    d->y = center_y + frand_range(-55.0f, 55.0f);
-    d->z = frand_range(12.0f, 28.0f);
-    d->speed = frand_range(16.0f, 26.0f);
-    d->len = frand_range(0.35f, 0.80f);
-    d->active = true;
+    int last_air = b->airborne_count - 1;
+
+    if (i != last_air)
+        bananas_swap(b, i, last_air);
+
+    b->airborne_count--;
 }
 
 /*
- * Draw the rain effect as simple line segments.
+ * Airborne integration step: gravity, spin and horizontal damping.
+ * The loop is branch-free over contiguous arrays so the compiler can
+ * vectorise it; the damping factor is computed once per frame.
  */
-static void draw_rain(const Scene *scene)
+static void bananas_integrate_airborne(SceneBananas *b, float delta_time)
 {
-    glDisable(GL_LIGHTING);
-    glDisable(GL_TEXTURE_2D);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    glLineWidth(1.2f);
-
-    glBegin(GL_LINES);
-    for (int i = 0; i < MAX_RAIN_DROPS; i++)
+    const int n = b->airborne_count;
+    const float damping = powf(0.995f, delta_time * 60.0f);
+    const float dvz = 9.81f * delta_time;
+
+    float *restrict vx = b->vx;
+    float *restrict vy = b->vy;
+    float *restrict vz = b->vz;
+    float *restrict pitch = b->pitch_deg;
+    float *restrict roll = b->roll_deg;
+    const float *restrict avp = b->ang_vel_pitch;
+    const float *restrict avr = b->ang_vel_roll;
+
+    for (int i = 0; i < n; i++)
     {
-        const RainDrop *d = &scene->rain_drops[i];
-        if (!d->active)
-            continue;
+        vz[i] -= dvz;
 
-        glColor4f(0.75f, 0.82f, 0.95f, 0.75f);
-        glVertex3f(d->x, d->y, d->z);
-        glVertex3f(d->x, d->y, d->z - d->len);
-    }
-    glEnd();
+        pitch[i] += avp[i] * delta_time;
+        roll[i] += avr[i] * delta_time;
 
-    glDisable(GL_BLEND);
-    glEnable(GL_LIGHTING);
+        vx[i] *= damping;
+        vy[i] *= damping;
+    }
 }
 
 /*
- * Draw the ground of the pond below the water surface.
+ * Bananas resting on the ground with small residual sliding/spinning.
  */
-static void draw_pond_bed(const Scene *scene)
+static void bananas_update_grounded(SceneBananas *b, float delta_time)
 {
-    const int segments = 64;
+    const float friction = powf(0.08f, delta_time * 60.0f);
 
-    float cx = scene->pond_x;
-    float cy = scene->pond_y;
-    float z = scene->pond_z - 0.35f;
-    float rx = scene->pond_rx * 1.02f;
-    float ry = scene->pond_ry * 1.02f;
+    for (int i = b->airborne_count; i < b->count; i++)
+    {
+        b->z[i] = 0.0f;
 
-    glEnable(GL_LIGHTING);
-    glDisable(GL_TEXTURE_2D);
+        b->vx[i] *= friction;
+        b->vy[i] *= friction;
 
-    glBegin(GL_TRIANGLE_FAN);
-    glColor3f(0.18f, 0.16f, 0.10f);
-    glNormal3f(0.0f, 0.0f, 1.0f);
-    glVertex3f(cx, cy, z);
+        if (fabsf(b->vx[i]) < 0.03f)
+            b->vx[i] = 0.0f;
+        if (fabsf(b->vy[i]) < 0.03f)
+            b->vy[i] = 0.0f;
 
-    for (int i = 0; i <= segments; i++)
-    {
-        float a = (2.0f * (float)M_PI * (float)i) / (float)segments;
-        float x = cx + cosf(a) * rx;
-        float y = cy + sinf(a) * ry;
+        b->x[i] += b->vx[i] * delta_time;
+        b->y[i] += b->vy[i] * delta_time;
+
+        b->ang_vel_pitch[i] *= 0.85f;
+        b->ang_vel_roll[i] *= 0.85f;
+
+        if (fabsf(b->ang_vel_pitch[i]) < 8.0f)
+            b->ang_vel_pitch[i] = 0.0f;
+        if (fabsf(b->ang_vel_roll[i]) < 8.0f)
+            b->ang_vel_roll[i] = 0.0f;
 
-        glColor3f(0.28f, 0.24f, 0.14f);
-        glVertex3f(x, y, z + 0.10f);
+        b->pitch_deg[i] += b->ang_vel_pitch[i] * delta_time;
+        b->roll_deg[i] += b->ang_vel_roll[i] * delta_time;
     }
-    glEnd();
 }
 
 /*
- * Fill the transition area between water and surrounding ground.
+ * Initialize the scene and all simulation systems.
  */
-static void draw_pond_edge_fill(const Scene *scene)
+bool scene_init(Scene *scene)
 {
-    const int segments = 96;
+    bool ok = true;
+
+    scene->ground_half_size = 200.0f;
+    scene->static_revision = 0;
+    scene->box_count = 0;
+    scene->fence_count = 0;
+    scene->obstacle_count = 0;
+    scene->gate_count = 0;
+
+    scene->rock_model = NULL;
+    scene->rock_count = 0;
+
+    scene->monkey_model = NULL;
+    scene->monkey_count = 0;
+
+    scene->banana_model = NULL;
+    memset(&scene->bananas, 0, sizeof(scene->bananas));
+    ok = bananas_reserve(&scene->bananas, SCENE_DEFAULT_BANANA_CAPACITY) && ok;
 
-    float cx = scene->pond_x;
-    float cy = scene->pond_y;
-    float z = scene->pond_z;
+    scene->tree_model = NULL;
+    scene->tree_count = 0;
 
-    float inner_rx = scene->pond_rx * 0.96f;
-    float inner_ry = scene->pond_ry * 0.96f;
+    scene->global_time = 0.0f;
+    scene->eaten_banana_count = 0;
+    scene_reset_subsystem_times(scene);
 
-    float outer_rx = scene->pond_rx * 1.02f;
-    float outer_ry = scene->pond_ry * 1.02f;
+    /* Ponds are added by the caller */
+    pond_system_init(&scene->ponds);
+    scene->focus_x = 0.0f;
+    scene->focus_y = 0.0f;
 
-    glDisable(GL_TEXTURE_2D);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    ok = pool_init(&scene->water_particle_pool, MAX_WATER_PARTICLES) && ok;
 
-    glBegin(GL_TRIANGLE_STRIP);
-    for (int i = 0; i <= segments; i++)
-    {
-        float a = (2.0f * (float)M_PI * (float)i) / (float)segments;
-        float c = cosf(a);
-        float s = sinf(a);
-
-        glColor4f(0.10f, 0.30f, 0.52f, 0.92f);
-        glVertex3f(
-            cx + c * inner_rx,
-            cy + s * inner_ry,
-            z + 0.003f);
-
-        glColor4f(0.24f, 0.22f, 0.14f, 0.98f);
-        glVertex3f(
-            cx + c * outer_rx,
-            cy + s * outer_ry,
-            z - 0.02f);
-    }
-    glEnd();
+    scene->jobs = NULL;
 
-    glDisable(GL_BLEND);
+    /* Random streams, reseeded by scene_set_seed */
+    rng_seed(&scene->rng, SCENE_DEFAULT_SEED);
+    rng_batch_seed(&scene->particle_rng, &scene->rng);
+
+    /* Rain setup */
+    scene->rain_enabled = true;
+    ok = rain_init(&scene->rain, RAIN_DEFAULT_DROPS, rng_next(&scene->rng)) && ok;
+
+    return ok;
 }
 
 /*
- * Draw one rectangular ground patch with a fixed color.
+ * Set the thread pool used by the simulation.
  */
-static void draw_ground_patch(float x0, float y0, float x1, float y1, float z, float r, float g, float b)
+void scene_set_job_pool(Scene *scene, JobPool *jobs)
 {
-    glColor3f(r, g, b);
-    glBegin(GL_QUADS);
-    glNormal3f(0.0f, 0.0f, 1.0f);
-    glVertex3f(x0, y0, z);
-    glVertex3f(x1, y0, z);
-    glVertex3f(x1, y1, z);
-    glVertex3f(x0, y1, z);
-    glEnd();
+    scene->jobs = jobs;
 }
 
 /*
- * Draw one simple road segment made from two layered rectangular patches.
+ * Set the level of detail focus point.
  */
-static void draw_road_segment(float x0, float y0, float x1, float y1, float z)
+void scene_set_focus(Scene *scene, float x, float y)
 {
-    draw_ground_patch(
-        x0 - 1.5f, y0 - 1.5f,
-        x1 + 1.5f, y1 + 1.5f,
-        z,
-        0.48f, 0.50f, 0.30f);
-
-    draw_ground_patch(
-        x0, y0,
-        x1, y1,
-        z + 0.001f,
-        0.58f, 0.48f, 0.30f);
+    scene->focus_x = x;
+    scene->focus_y = y;
 }
 
 /*
- * Draw the full ground with multiple colored areas and simple roads.
+ * Reseed the scene generators and rebuild the rain drops from the new seed.
  */
-static void draw_ground(float half_size, float z)
+bool scene_set_seed(Scene *scene, uint64_t seed)
 {
-    glEnable(GL_LIGHTING);
-
-    /* base ground */
-    draw_ground_patch(-half_size, -half_size, half_size, half_size, z, 0.34f, 0.50f, 0.24f);
-
-    /* larger terrain variations */
-    draw_ground_patch(-half_size, -half_size, 0.0f, 0.0f, z + 0.001f, 0.30f, 0.46f, 0.22f);
-    draw_ground_patch(0.0f, -half_size, half_size, 0.0f, z + 0.001f, 0.32f, 0.48f, 0.23f);
-    draw_ground_patch(-half_size, 0.0f, 0.0f, half_size, z + 0.001f, 0.36f, 0.53f, 0.25f);
-    draw_ground_patch(0.0f, 0.0f, half_size, half_size, z + 0.001f, 0.33f, 0.49f, 0.24f);
-
-    /* lighter ground around enclosures */
-    draw_ground_patch(-30.0f, -30.0f, 30.0f, 30.0f, z + 0.002f, 0.38f, 0.47f, 0.24f);
-    draw_ground_patch(25.0f, -5.0f, 55.0f, 25.0f, z + 0.002f, 0.39f, 0.48f, 0.25f);
-    draw_ground_patch(-63.0f, -38.0f, -27.0f, -2.0f, z + 0.002f, 0.39f, 0.48f, 0.25f);
-
-    /* main road */
-    draw_road_segment(-3.0f, -95.0f, 3.0f, -25.0f, z + 0.004f);
-
-    /* road to right enclosure */
-    draw_road_segment(0.0f, -31.0f, 44.0f, -25.0f, z + 0.004f);
-    draw_road_segment(38.0f, -25.0f, 44.0f, -6.0f, z + 0.0045f);
-    draw_road_segment(36.0f, -6.0f, 44.0f, 0.0f, z + 0.005f);
-
-    /* road to left enclosure */
-    draw_road_segment(-46.0f, -36.0f, 0.0f, -30.0f, z + 0.004f);
-    draw_road_segment(-49.0f, -38.0f, -43.0f, -32.0f, z + 0.005f);
-
-    /* dry terrain patches */
-    draw_ground_patch(10.0f, 20.0f, 28.0f, 32.0f, z + 0.003f, 0.46f, 0.50f, 0.26f);
-    draw_ground_patch(-80.0f, 18.0f, -55.0f, 35.0f, z + 0.003f, 0.44f, 0.49f, 0.25f);
-    draw_ground_patch(60.0f, -50.0f, 88.0f, -30.0f, z + 0.003f, 0.45f, 0.50f, 0.26f);
+    rng_seed(&scene->rng, seed);
+    rng_batch_seed(&scene->particle_rng, &scene->rng);
+
+    scene->rain.seed = rng_next(&scene->rng);
+    return rain_set_drop_count(&scene->rain, scene->rain.count);
 }
 
 /*
- * Draw one fence enclosure visually.
- * This includes walls, posts and the gate posts.
+ * Rebuild the analytic rain with a new drop count.
  */
-static void draw_fence_visual(float half_size, float wall_height)
+bool scene_set_rain_drops(Scene *scene, int count)
 {
-    glEnable(GL_LIGHTING);
-
-    const float t = 0.25f;
-    const float post = 0.35f;
-    const float step = 4.0f;
-    const float gate_w = 3.0f;
-
-    /* fence walls */
-    glColor3f(0.35f, 0.25f, 0.12f);
-
-    /* +Y wall */
-    draw_box(0.0f, half_size, wall_height * 0.5f, half_size * 2.0f, t, wall_height);
-
-    /* -Y wall split for gate */
-    float gap = gate_w + post;
-    float total = half_size * 2.0f;
-    float side_len = (total - gap) * 0.5f;
-    if (side_len < 0.5f)
-        side_len = 0.5f;
-
-    float left_cx = -(gap * 0.5f + side_len * 0.5f);
-    float right_cx = +(gap * 0.5f + side_len * 0.5f);
+    return rain_set_drop_count(&scene->rain, count);
+}
 
-    draw_box(left_cx, -half_size, wall_height * 0.5f, side_len, t, wall_height);
-    draw_box(right_cx, -half_size, wall_height * 0.5f, side_len, t, wall_height);
+/*
+ * Add a pond to the water system.
+ */
+bool scene_add_pond(Scene *scene, float x, float y, float z, float rx, float ry, int size)
+{
+    return pond_system_add(&scene->ponds, x, y, z, rx, ry, size) >= 0;
+}
 
-    /* +X wall */
-    draw_box(half_size, 0.0f, wall_height * 0.5f, t, half_size * 2.0f, wall_height);
+/*
+ * Replace every pond grid with a calm one of the requested resolution.
+ */
+bool scene_set_water_size(Scene *scene, int size)
+{
+    bool ok = true;
 
-    /* -X wall */
-    draw_box(-half_size, 0.0f, wall_height * 0.5f, t, half_size * 2.0f, wall_height);
+    for (int i = 0; i < scene->ponds.count; i++)
+    {
+        if (!pond_system_set_size(&scene->ponds, i, size))
+            ok = false;
+    }
 
-    /* posts */
-    glColor3f(0.25f, 0.18f, 0.08f);
-    float gate_clear = gate_w * 0.5f + post * 0.6f;
+    return ok;
+}
 
-    for (float x = -half_size; x <= half_size; x += step)
+/*
+ * Copy the live bananas of src into dst, growing dst when needed.
+ */
+static bool bananas_copy(SceneBananas *dst, const SceneBananas *src)
+{
+    if (dst->capacity < src->count && !bananas_reserve(dst, src->count))
     {
-        draw_box(x, half_size, wall_height * 0.5f, post, post, wall_height);
-        if (fabsf(x) > gate_clear)
-        {
-            draw_box(x, -half_size, wall_height * 0.5f, post, post, wall_height);
-        }
+        dst->count = 0;
+        dst->airborne_count = 0;
+        return false;
     }
 
-    for (float y = -half_size; y <= half_size; y += step)
+    if (src->count > 0)
     {
-        draw_box(half_size, y, wall_height * 0.5f, post, post, wall_height);
-        draw_box(-half_size, y, wall_height * 0.5f, post, post, wall_height);
-    }
+        float **to[BANANA_FLOAT_FIELDS];
+        float **from[BANANA_FLOAT_FIELDS];
+        bananas_float_fields(dst, to);
+        bananas_float_fields((SceneBananas *)src, from);
+
+        size_t bytes = (size_t)src->count * sizeof(float);
+        for (int f = 0; f < BANANA_FLOAT_FIELDS; f++)
+            memcpy(*to[f], *from[f], bytes);
 
-    /* gate posts */
-    glColor3f(0.40f, 0.30f, 0.15f);
-    float gate_y = -half_size - t * 0.6f;
-    float gate_x0 = -gate_w * 0.5f;
-    float gate_x1 = gate_w * 0.5f;
+        memcpy(dst->collidable, src->collidable, (size_t)src->count * sizeof(bool));
+    }
 
-    draw_box(gate_x0, gate_y, wall_height * 0.5f, post, post, wall_height);
-    draw_box(gate_x1, gate_y, wall_height * 0.5f, post, post, wall_height);
+    dst->count = src->count;
+    dst->airborne_count = src->airborne_count;
+    return true;
 }
 
 /*
- * Initialize the scene and all simulation systems.
+ * The fixed arrays come along with the struct; the heap parts are copied
+ * into the buffers dst already owns. A failed part leaves that part
+ * empty or as it was, so the rest of dst is still consistent.
  */
-void scene_init(Scene *scene)
+bool scene_copy(Scene *dst, const Scene *src)
 {
-    scene->ground_half_size = 200.0f;
-    scene->box_count = 0;
-    scene->fence_count = 0;
-    scene->obstacle_count = 0;
-    scene->gate_count = 0;
-
-    scene->rock_model = NULL;
-    scene->rock_count = 0;
-
-    scene->monkey_model = NULL;
-    scene->monkey_count = 0;
-
-    scene->banana_model = NULL;
-    scene->banana_count = 0;
+    SceneBananas bananas = dst->bananas;
+    SlotPool pool = dst->water_particle_pool;
+    RainSystem rain = dst->rain;
+    PondSystem ponds = dst->ponds;
+
+    *dst = *src;
+
+    dst->bananas = bananas;
+    dst->water_particle_pool = pool;
+    dst->rain = rain;
+    dst->ponds = ponds;
+    dst->jobs = NULL;
+
+    bool ok = bananas_copy(&dst->bananas, &src->bananas);
+    ok = pool_copy(&dst->water_particle_pool, &src->water_particle_pool) && ok;
+    ok = rain_copy(&dst->rain, &src->rain) && ok;
+    ok = pond_system_copy(&dst->ponds, &src->ponds) && ok;
+    return ok;
+}
 
-    scene->tree_model = NULL;
-    scene->tree_count = 0;
+/*
+ * Free the heap allocated banana storage, particle pool, rain
+ * and ponds.
+ */
+void scene_free(Scene *scene)
+{
+    pool_free(&scene->water_particle_pool);
+    rain_free(&scene->rain);
+    pond_system_free(&scene->ponds);
 
-    scene->global_time = 0.0f;
-    scene->eaten_banana_count = 0;
+    SceneBananas *b = &scene->bananas;
 
-    /* Pond setup */
-    scene->pond_enabled = true;
-    scene->pond_x = 18.0f;
-    scene->pond_y = -55.0f;
-    scene->pond_z = 0.06f;
-    scene->pond_rx = 8.0f;
-    scene->pond_ry = 5.0f;
-    scene->pond_emit_timer = 0.0f;
-    scene->water_particle_count = MAX_WATER_PARTICLES;
-
-    for (int i = 0; i < MAX_WATER_PARTICLES; i++)
-    {
-        scene->water_particles[i].active = false;
-    }
+    float **fields[BANANA_FLOAT_FIELDS];
+    bananas_float_fields(b, fields);
 
-    for (int i = 0; i < WATER_SIZE; i++)
+    for (int f = 0; f < BANANA_FLOAT_FIELDS; f++)
     {
-        for (int j = 0; j < WATER_SIZE; j++)
-        {
-            scene->water.h[i][j] = 0.0f;
-            scene->water.v[i][j] = 0.0f;
-        }
+        free(*fields[f]);
+        *fields[f] = NULL;
     }
 
-    /* Rain setup */
-    scene->rain_enabled = true;
+    free(b->collidable);
+    b->collidable = NULL;
 
-    for (int i = 0; i < MAX_RAIN_DROPS; i++)
-    {
-        reset_raindrop(&scene->rain_drops[i], 0.0f, 0.0f);
-    }
+    b->count = 0;
+    b->airborne_count = 0;
+    b->capacity = 0;
 }
 
 /*
@@ -788,6 +675,7 @@ void scene_add_box(Scene *scene, float cx, float cy, float cz, float sx, float s
     b->sz = sz;
     b->color = color;
     b->collidable = collidable;
+    scene->static_revision++;
 }
 
 /*
@@ -804,6 +692,7 @@ void scene_add_fence(Scene *scene, float cx, float cy, float half_size, float wa
     f->half_size = half_size;
     f->wall_height = wall_height;
     f->collidable = collidable;
+    scene->static_revision++;
 }
 
 /*
@@ -831,6 +720,7 @@ void scene_add_gate(Scene *scene, float hinge_x, float hinge_y, float hinge_z,
     g->open_deg = open_deg;
 
     g->angle_deg = closed_deg;
+    g->prev_angle_deg = closed_deg;
     g->target_deg = closed_deg;
     g->speed_deg_per_s = 120.0f;
 }
@@ -909,6 +799,7 @@ int scene_find_interactable_gate(const Scene *scene, float cam_x, float cam_y, f
 void scene_set_rock_model(Scene *scene, const Model *rock_model)
 {
     scene->rock_model = rock_model;
+    scene->static_revision++;
 }
 
 /*
@@ -925,6 +816,7 @@ void scene_add_rock(Scene *scene, float x, float y, float z, float scale, float
     r->scale = scale;
     r->yaw_deg = yaw_deg;
     r->collidable = collidable;
+    scene->static_revision++;
 }
 
 /*
@@ -1082,27 +974,45 @@ void scene_collect_obstacles(Scene *scene)
     /* bananas */
     if (scene->banana_model)
     {
-        for (int i = 0; i < scene->banana_count; i++)
+        const SceneBananas *b = &scene->bananas;
+        for (int i = 0; i < b->count; i++)
         {
-            const SceneBanana *b = &scene->bananas[i];
-            if (!b->active || !b->collidable)
+            if (!b->collidable[i])
                 continue;
 
-            float rad = 0.16f * b->scale;
+            float rad = 0.16f * b->scale[i];
 
-            float bottom_offset = 0.60f * b->scale;
-            float height = 1.35f * b->scale;
+            float bottom_offset = 0.60f * b->scale[i];
+            float height = 1.35f * b->scale[i];
 
-            float minz = b->z - bottom_offset;
+            float minz = b->z[i] - bottom_offset;
             float maxz = minz + height;
 
-            obs_add(scene, (AABB){b->x - rad, b->y - rad, minz, b->x + rad, b->y + rad, maxz});
+            obs_add(scene, (AABB){b->x[i] - rad, b->y[i] - rad, minz, b->x[i] + rad, b->y[i] + rad, maxz});
         }
     }
 
     add_gate_obstacles(scene);
 }
 
+/*
+ * Open the profiler zone of a subsystem and note when it started.
+ */
+static void scene_begin_subsystem(SceneSubsystem subsystem, uint64_t *mark)
+{
+    profiler_begin(scene_subsystem_name(subsystem));
+    *mark = SDL_GetPerformanceCounter();
+}
+
+/*
+ * Charge the time since mark to the subsystem and close its zone.
+ */
+static void scene_end_subsystem(Scene *scene, SceneSubsystem subsystem, uint64_t mark)
+{
+    scene->subsystem_ticks[subsystem] += SDL_GetPerformanceCounter() - mark;
+    profiler_end();
+}
+
 /*
  * Update the whole scene for one frame:
  * - global time
@@ -1114,8 +1024,21 @@ void scene_collect_obstacles(Scene *scene)
  */
 void scene_update(Scene *scene, float delta_time)
 {
+    uint64_t mark;
+
     scene->global_time += delta_time;
+
+    scene_begin_subsystem(SCENE_SUBSYSTEM_OBSTACLES, &mark);
     scene_collect_obstacles(scene);
+    scene_end_subsystem(scene, SCENE_SUBSYSTEM_OBSTACLES, mark);
+
+    scene_begin_subsystem(SCENE_SUBSYSTEM_ANIMATION, &mark);
+
+    /* Remember the pose before this step for render interpolation */
+    bananas_store_previous(&scene->bananas);
+
+    for (int gi = 0; gi < scene->gate_count; gi++)
+        scene->gates[gi].prev_angle_deg = scene->gates[gi].angle_deg;
 
     /* Animate gates toward their target angle */
     for (int gi = 0; gi < scene->gate_count; gi++)
@@ -1151,7 +1074,7 @@ void scene_update(Scene *scene, float delta_time)
 
         if (m->state == MONKEY_IDLE)
         {
-            if ((rand() % 1000) < 2)
+            if (rng_below(&scene->rng, 1000) < 2)
             {
                 m->state = MONKEY_EATING;
                 m->eat_timer = 0.0f;
@@ -1168,29 +1091,41 @@ void scene_update(Scene *scene, float delta_time)
         }
     }
 
-    /* Update water particles emitted above the pond */
-    if (scene->pond_enabled)
+    scene_end_subsystem(scene, SCENE_SUBSYSTEM_ANIMATION, mark);
+
+    /* Update water particles; only ponds simulated every frame emit new ones */
+    scene_begin_subsystem(SCENE_SUBSYSTEM_PARTICLES, &mark);
+
+    for (int pi = 0; pi < scene->ponds.count; pi++)
     {
-        scene->pond_emit_timer += delta_time;
+        Pond *pond = &scene->ponds.ponds[pi];
+        if (pond->tick_interval > 0.0f)
+            continue;
+
+        pond->emit_timer += delta_time;
 
-        while (scene->pond_emit_timer >= 0.04f)
+        int emit = 0;
+        while (pond->emit_timer >= 0.04f)
         {
-            scene->pond_emit_timer -= 0.04f;
-            spawn_water_particle(scene);
+            pond->emit_timer -= 0.04f;
+            emit++;
         }
 
-        for (int i = 0; i < MAX_WATER_PARTICLES; i++)
+        spawn_water_particles(scene, pond, emit);
+    }
+
+    {
+        /* Walk the live list backwards so releases do not skip particles */
+        SlotPool *pool = &scene->water_particle_pool;
+        for (int i = pool_live_count(pool) - 1; i >= 0; i--)
         {
-            WaterParticle *p = &scene->water_particles[i];
-            if (!p->active)
-            {
-                continue;
-            }
+            int slot = pool_live_slot(pool, i);
+            WaterParticle *p = &scene->water_particles[slot];
 
             p->life -= delta_time;
             if (p->life <= 0.0f)
             {
-                p->active = false;
+                pool_release(pool, slot);
                 continue;
             }
 
@@ -1202,466 +1137,213 @@ void scene_update(Scene *scene, float delta_time)
         }
     }
 
+    scene_end_subsystem(scene, SCENE_SUBSYSTEM_PARTICLES, mark);
+
     /* Update height-field based water simulation */
-    {
-        float new_h[WATER_SIZE][WATER_SIZE];
-        float new_v[WATER_SIZE][WATER_SIZE];
+    scene_begin_subsystem(SCENE_SUBSYSTEM_WATER, &mark);
+    pond_system_step(&scene->ponds, delta_time, scene->focus_x, scene->focus_y, scene->jobs);
+    scene_end_subsystem(scene, SCENE_SUBSYSTEM_WATER, mark);
 
-        for (int x = 0; x < WATER_SIZE; x++)
-        {
-            for (int y = 0; y < WATER_SIZE; y++)
-            {
-                new_h[x][y] = scene->water.h[x][y];
-                new_v[x][y] = scene->water.v[x][y];
-            }
-        }
+    /* Advance the rain and turn drops landing on a pond into splashes */
+    scene_begin_subsystem(SCENE_SUBSYSTEM_RAIN, &mark);
+    if (scene->rain_enabled)
+    {
+        rain_update(&scene->rain, delta_time, scene->focus_x, scene->focus_y);
+        rain_splash_ponds(&scene->rain, &scene->ponds);
+    }
+    scene_end_subsystem(scene, SCENE_SUBSYSTEM_RAIN, mark);
 
-        for (int x = 1; x < WATER_SIZE - 1; x++)
-        {
-            for (int y = 1; y < WATER_SIZE - 1; y++)
-            {
-                float center = scene->water.h[x][y];
+    /* Update all bananas */
+    scene_begin_subsystem(SCENE_SUBSYSTEM_BANANAS, &mark);
+    SceneBananas *b = &scene->bananas;
+
+    bananas_update_grounded(b, delta_time);
+    bananas_integrate_airborne(b, delta_time);
+
+    /*
+     * Collision and eating checks for airborne bananas.
+     * Removing or landing a banana swaps another unprocessed airborne
+     * banana into slot i, so i only advances when the banana stays.
+     */
+    int i = 0;
+    while (i < b->airborne_count)
+    {
+        const float banana_r = 0.14f * b->scale[i];
 
-                float avg =
-                    scene->water.h[x - 1][y] +
-                    scene->water.h[x + 1][y] +
-                    scene->water.h[x][y - 1] +
-                    scene->water.h[x][y + 1];
+        float x = b->x[i];
+        float y = b->y[i];
+        float z = b->z[i];
 
-                avg *= 0.25f;
+        float vx = b->vx[i];
+        float vy = b->vy[i];
+        float vz = b->vz[i];
 
-                float acc = (avg - center) * 0.25f;
+        float next_x = x + vx * delta_time;
+        float next_y = y + vy * delta_time;
+        float next_z = z + vz * delta_time;
 
-                new_v[x][y] += acc * delta_time * 60.0f;
-                new_v[x][y] *= 0.98f;
+        bool eaten = false;
 
-                if (new_v[x][y] > 0.08f)
-                    new_v[x][y] = 0.08f;
-                if (new_v[x][y] < -0.08f)
-                    new_v[x][y] = -0.08f;
+        /* Check whether the banana reaches any monkey's eating area */
+        for (int j = 0; j < scene->monkey_count; j++)
+        {
+            SceneMonkey *m = &scene->monkeys[j];
+            if (!m->active)
+                continue;
 
-                new_h[x][y] += new_v[x][y] * delta_time * 60.0f;
+            float a = deg2radf(m->yaw_deg);
+            float fx = cosf(a);
+            float fy = sinf(a);
 
-                if (new_h[x][y] > 0.18f)
-                    new_h[x][y] = 0.18f;
-                if (new_h[x][y] < -0.18f)
-                    new_h[x][y] = -0.18f;
+            float mouth_x = m->x + fx * (0.42f * m->scale);
+            float mouth_y = m->y + fy * (0.42f * m->scale);
+            float mouth_z = m->z + 1.05f * m->scale;
 
-                new_h[x][y] *= 0.998f;
-            }
-        }
+            float eat_r = m->eat_radius + 0.58f * m->scale;
 
-        for (int x = 1; x < WATER_SIZE - 1; x++)
-        {
-            for (int y = 1; y < WATER_SIZE - 1; y++)
+            if (segment_sphere_hit(
+                    x, y, z,
+                    next_x, next_y, next_z,
+                    mouth_x, mouth_y, mouth_z,
+                    eat_r))
             {
-                scene->water.h[x][y] = new_h[x][y];
-                scene->water.v[x][y] = new_v[x][y];
+                m->state = MONKEY_EATING;
+                scene->eaten_banana_count++;
+                eaten = true;
+                break;
             }
         }
-    }
 
-    /* Update falling rain and create splashes when raindrops hit the pond */
-    if (scene->rain_enabled)
-    {
-        for (int i = 0; i < MAX_RAIN_DROPS; i++)
+        if (eaten)
         {
-            RainDrop *d = &scene->rain_drops[i];
-            if (!d->active)
-                continue;
-
-            d->z -= d->speed * delta_time;
-
-            if (d->z <= 0.0f)
-            {
-                if (scene->pond_enabled && point_in_pond(scene, d->x, d->y))
-                {
-                    if ((rand() % 100) < 20)
-                    {
-                        water_splash(scene, d->x, d->y);
-                    }
-                }
-
-                reset_raindrop(d, 0.0f, 0.0f);
-            }
+            bananas_remove_airborne(b, i);
+            continue;
         }
-    }
 
-    /* Update all bananas */
-    for (int i = 0; i < scene->banana_count; i++)
-    {
-        SceneBanana *b = &scene->bananas[i];
-        if (!b->active)
-            continue;
+        /* Collision with obstacles */
+        bool hit_any = banana_hits_any_obstacle(scene, next_x, next_y, next_z, banana_r);
 
-        if (!b->on_ground)
+        if (!hit_any)
         {
-            /* Airborne banana physics */
-            b->vz -= 9.81f * delta_time;
-
-            b->pitch_deg += b->ang_vel_pitch * delta_time;
-            b->roll_deg += b->ang_vel_roll * delta_time;
-
-            b->vx *= powf(0.995f, delta_time * 60.0f);
-            b->vy *= powf(0.995f, delta_time * 60.0f);
-
-            const float banana_r = 0.14f * b->scale;
-
-            float next_x = b->x + b->vx * delta_time;
-            float next_y = b->y + b->vy * delta_time;
-            float next_z = b->z + b->vz * delta_time;
-
-            bool eaten = false;
-
-            /* Check whether the banana reaches any monkey's eating area */
-            for (int j = 0; j < scene->monkey_count; j++)
+            x = next_x;
+            y = next_y;
+            z = next_z;
+        }
+        else
+        {
+            float try_x = x + vx * delta_time;
+            if (!banana_hits_any_obstacle(scene, try_x, y, z, banana_r))
             {
-                SceneMonkey *m = &scene->monkeys[j];
-                if (!m->active)
-                    continue;
-
-                float a = deg2radf(m->yaw_deg);
-                float fx = cosf(a);
-                float fy = sinf(a);
-
-                float mouth_x = m->x + fx * (0.42f * m->scale);
-                float mouth_y = m->y + fy * (0.42f * m->scale);
-                float mouth_z = m->z + 1.05f * m->scale;
-
-                float eat_r = m->eat_radius + 0.58f * m->scale;
-
-                if (segment_sphere_hit(
-                        b->x, b->y, b->z,
-                        next_x, next_y, next_z,
-                        mouth_x, mouth_y, mouth_z,
-                        eat_r))
-                {
-                    m->state = MONKEY_EATING;
-                    b->active = false;
-                    scene->eaten_banana_count++;
-                    eaten = true;
-                    break;
-                }
+                x = try_x;
+            }
+            else
+            {
+                vx *= -0.28f;
             }
 
-            if (eaten)
-                continue;
-
-            /* Collision with obstacles */
-            bool hit_any = banana_hits_any_obstacle(scene, next_x, next_y, next_z, banana_r);
-
-            if (!hit_any)
+            float try_y = y + vy * delta_time;
+            if (!banana_hits_any_obstacle(scene, x, try_y, z, banana_r))
             {
-                b->x = next_x;
-                b->y = next_y;
-                b->z = next_z;
+                y = try_y;
             }
             else
             {
-                float try_x = b->x + b->vx * delta_time;
-                if (!banana_hits_any_obstacle(scene, try_x, b->y, b->z, banana_r))
-                {
-                    b->x = try_x;
-                }
-                else
-                {
-                    b->vx *= -0.28f;
-                }
-
-                float try_y = b->y + b->vy * delta_time;
-                if (!banana_hits_any_obstacle(scene, b->x, try_y, b->z, banana_r))
-                {
-                    b->y = try_y;
-                }
-                else
-                {
-                    b->vy *= -0.28f;
-                }
-
-                float try_z = b->z + b->vz * delta_time;
-                if (!banana_hits_any_obstacle(scene, b->x, b->y, try_z, banana_r))
-                {
-                    b->z = try_z;
-                }
-                else
-                {
-                    b->vz *= -0.18f;
-                }
-
-                b->vx *= 0.72f;
-                b->vy *= 0.72f;
-                b->vz *= 0.72f;
-
-                b->ang_vel_pitch *= 0.75f;
-                b->ang_vel_roll *= 0.75f;
+                vy *= -0.28f;
             }
 
-            /* Ground / pond handling */
-            if (b->z < 0.0f)
+            float try_z = z + vz * delta_time;
+            if (!banana_hits_any_obstacle(scene, x, y, try_z, banana_r))
             {
-                if (scene->pond_enabled && point_in_pond(scene, b->x, b->y))
-                {
-                    water_splash(scene, b->x, b->y);
-                    b->active = false;
-                    continue;
-                }
-
-                b->z = 0.0f;
-
-                if (fabsf(b->vz) > 1.0f)
-                {
-                    b->vz = -b->vz * 0.18f;
-                    b->vx *= 0.82f;
-                    b->vy *= 0.82f;
-
-                    b->ang_vel_pitch *= 0.72f;
-                    b->ang_vel_roll *= 0.72f;
-                }
-                else
-                {
-                    b->z = 0.0f;
-                    b->vz = 0.0f;
-                    b->on_ground = true;
-                }
+                z = try_z;
+            }
+            else
+            {
+                vz *= -0.18f;
             }
-        }
-        else
-        {
-            /* Banana resting on the ground with small residual sliding/spinning */
-            b->z = 0.0f;
-
-            b->vx *= powf(0.08f, delta_time * 60.0f);
-            b->vy *= powf(0.08f, delta_time * 60.0f);
-
-            if (fabsf(b->vx) < 0.03f)
-                b->vx = 0.0f;
-            if (fabsf(b->vy) < 0.03f)
-                b->vy = 0.0f;
-
-            b->x += b->vx * delta_time;
-            b->y += b->vy * delta_time;
-
-            b->ang_vel_pitch *= 0.85f;
-            b->ang_vel_roll *= 0.85f;
-
-            if (fabsf(b->ang_vel_pitch) < 8.0f)
-                b->ang_vel_pitch = 0.0f;
-            if (fabsf(b->ang_vel_roll) < 8.0f)
-                b->ang_vel_roll = 0.0f;
-
-            b->pitch_deg += b->ang_vel_pitch * delta_time;
-            b->roll_deg += b->ang_vel_roll * delta_time;
-        }
-    }
-}
-
-/*
- * Render the entire scene:
- * ground, fences, boxes, pond, rain, rocks, gates, trees, monkeys and bananas.
- */
-void scene_render(const Scene *scene)
-{
-    draw_ground(scene->ground_half_size, 0.0f);
-
-    /* fences */
-    for (int i = 0; i < scene->fence_count; i++)
-    {
-        const SceneFence *f = &scene->fences[i];
-        glPushMatrix();
-        glTranslatef(f->cx, f->cy, 0.0f);
-        draw_fence_visual(f->half_size, f->wall_height);
-        glPopMatrix();
-    }
-
-    /* simple boxes */
-    glEnable(GL_LIGHTING);
-    for (int i = 0; i < scene->box_count; i++)
-    {
-        const SceneBox *b = &scene->boxes[i];
-        glColor3f(b->color.r, b->color.g, b->color.b);
-        draw_box(b->cx, b->cy, b->cz, b->sx, b->sy, b->sz);
-    }
-
-    /* pond and rain */
-    if (scene->pond_enabled)
-    {
-        draw_pond_bed(scene);
-        draw_water_mesh(scene);
-        draw_pond_edge_fill(scene);
-        draw_pond_border(scene);
-        draw_water_particles(scene);
-    }
 
-    if (scene->rain_enabled)
-    {
-        draw_rain(scene);
-    }
+            vx *= 0.72f;
+            vy *= 0.72f;
+            vz *= 0.72f;
 
-    /* rocks */
-    if (scene->rock_model)
-    {
-        for (int i = 0; i < scene->rock_count; i++)
-        {
-            const SceneRock *r = &scene->rocks[i];
-
-            glPushMatrix();
-            glTranslatef(r->x, r->y, r->z);
-            glRotatef(r->yaw_deg, 0.0f, 0.0f, 1.0f);
-            glScalef(r->scale, r->scale, r->scale);
-            model_draw(scene->rock_model);
-            glPopMatrix();
+            b->ang_vel_pitch[i] *= 0.75f;
+            b->ang_vel_roll[i] *= 0.75f;
         }
-    }
-
-    /* gates */
-    for (int gi = 0; gi < scene->gate_count; gi++)
-    {
-        const SceneGate *g = &scene->gates[gi];
-        if (!g->exists)
-            continue;
 
-        glEnable(GL_LIGHTING);
-        glColor3f(g->color.r, g->color.g, g->color.b);
+        bool landed = false;
 
-        glPushMatrix();
-        glTranslatef(g->hx, g->hy, g->hz);
-        glRotatef(g->angle_deg, 0.0f, 0.0f, 1.0f);
-        draw_box(g->w * 0.5f, 0.0f, g->h * 0.5f, g->w, g->t, g->h);
-        glPopMatrix();
-    }
-
-    /* trees */
-    if (scene->tree_model)
-    {
-        for (int i = 0; i < scene->tree_count; i++)
+        /* Ground / pond handling */
+        if (z < 0.0f)
         {
-            const SceneTree *t = &scene->trees[i];
-
-            float z_lift = -scene->tree_model->local_bounds.minz * t->scale;
-            float extra_lift = 0.15f * t->scale;
-
-            glPushMatrix();
-            glTranslatef(t->x, t->y, t->z + z_lift + extra_lift);
-            glRotatef(t->yaw_deg, 0.0f, 0.0f, 1.0f);
-            glRotatef(90.0f, 1.0f, 0.0f, 0.0f);
-            glScalef(t->scale, t->scale, t->scale);
-            model_draw(scene->tree_model);
-            glPopMatrix();
-        }
-    }
-
-    /* monkeys */
-    if (scene->monkey_model)
-    {
-        for (int i = 0; i < scene->monkey_count; i++)
-        {
-            const SceneMonkey *m = &scene->monkeys[i];
-            if (!m->active)
+            if (pond_system_splash(&scene->ponds, x, y))
+            {
+                bananas_remove_airborne(b, i);
                 continue;
+            }
 
-            float z_lift = -scene->monkey_model->local_bounds.minz * m->scale;
-
-            glPushMatrix();
-            float z_offset = 0.0f;
-            float extra_yaw = 0.0f;
-            float extra_pitch = 0.0f;
+            z = 0.0f;
 
-            if (m->state == MONKEY_IDLE)
+            if (fabsf(vz) > 1.0f)
             {
-                z_offset = sinf(m->anim_time * 2.0f) * 0.05f;
-                extra_yaw = sinf(m->anim_time * 1.5f) * 10.0f;
+                vz = -vz * 0.18f;
+                vx *= 0.82f;
+                vy *= 0.82f;
+
+                b->ang_vel_pitch[i] *= 0.72f;
+                b->ang_vel_roll[i] *= 0.72f;
             }
-            else if (m->state == MONKEY_EATING)
+            else
             {
-                z_offset = sinf(m->anim_time * 10.0f) * 0.08f;
-                extra_pitch = sinf(m->anim_time * 12.0f) * 15.0f;
+                vz = 0.0f;
+                landed = true;
             }
-
-            glTranslatef(m->x, m->y, m->z + z_lift + z_offset);
-            glRotatef(m->yaw_deg + extra_yaw, 0, 0, 1);
-            glRotatef(extra_pitch, 1, 0, 0);
-            glRotatef(90.0f, 1.0f, 0.0f, 0.0f);
-            glScalef(m->scale, m->scale, m->scale);
-            model_draw(scene->monkey_model);
-            glPopMatrix();
         }
-    }
-
-    /* bananas */
-    if (scene->banana_model)
-    {
-        for (int i = 0; i < scene->banana_count; i++)
-        {
-            const SceneBanana *b = &scene->bananas[i];
-            if (!b->active)
-                continue;
-
-            float z_lift = -scene->banana_model->local_bounds.minz * b->scale;
 
-            glPushMatrix();
-            glTranslatef(b->x, b->y, b->z + z_lift);
+        b->x[i] = x;
+        b->y[i] = y;
+        b->z[i] = z;
 
-            glRotatef(b->yaw_deg, 0.0f, 0.0f, 1.0f);
-            glRotatef(b->pitch_deg, 1.0f, 0.0f, 0.0f);
-            glRotatef(b->roll_deg, 0.0f, 1.0f, 0.0f);
+        b->vx[i] = vx;
+        b->vy[i] = vy;
+        b->vz[i] = vz;
 
-            glScalef(b->scale, b->scale, b->scale);
-            model_draw(scene->banana_model);
-            glPopMatrix();
+        if (landed)
+        {
+            bananas_land(b, i);
+            continue;
         }
+
+        i++;
     }
+
+    scene_end_subsystem(scene, SCENE_SUBSYSTEM_BANANAS, mark);
 }
 
 /*
- * Draw all obstacle AABBs as red wireframes for debugging.
+ * Names in SceneSubsystem order.
  */
-void scene_debug_draw_obstacles(const Scene *scene)
+const char *scene_subsystem_name(SceneSubsystem subsystem)
 {
-    glDisable(GL_LIGHTING);
-    glColor3f(1, 0, 0);
+    static const char *names[SCENE_SUBSYSTEM_COUNT] = {
+        "obstacles",
+        "animation",
+        "particles",
+        "water",
+        "rain",
+        "bananas"};
+
+    if (subsystem < 0 || subsystem >= SCENE_SUBSYSTEM_COUNT)
+        return "?";
+
+    return names[subsystem];
+}
 
-    for (int i = 0; i < scene->obstacle_count; i++)
-    {
-        const AABB *b = &scene->obstacles[i];
-
-        float x0 = b->minx, x1 = b->maxx;
-        float y0 = b->miny, y1 = b->maxy;
-        float z0 = b->minz, z1 = b->maxz;
-
-        glBegin(GL_LINES);
-
-        /* bottom rectangle */
-        glVertex3f(x0, y0, z0);
-        glVertex3f(x1, y0, z0);
-        glVertex3f(x1, y0, z0);
-        glVertex3f(x1, y1, z0);
-        glVertex3f(x1, y1, z0);
-        glVertex3f(x0, y1, z0);
-        glVertex3f(x0, y1, z0);
-        glVertex3f(x0, y0, z0);
-
-        /* top rectangle */
-        glVertex3f(x0, y0, z1);
-        glVertex3f(x1, y0, z1);
-        glVertex3f(x1, y0, z1);
-        glVertex3f(x1, y1, z1);
-        glVertex3f(x1, y1, z1);
-        glVertex3f(x0, y1, z1);
-        glVertex3f(x0, y1, z1);
-        glVertex3f(x0, y0, z1);
-
-        /* vertical edges */
-        glVertex3f(x0, y0, z0);
-        glVertex3f(x0, y0, z1);
-        glVertex3f(x1, y0, z0);
-        glVertex3f(x1, y0, z1);
-        glVertex3f(x1, y1, z0);
-        glVertex3f(x1, y1, z1);
-        glVertex3f(x0, y1, z0);
-        glVertex3f(x0, y1, z1);
-
-        glEnd();
-    }
+/*
+ * Zero every subsystem accumulator.
+ */
+void scene_reset_subsystem_times(Scene *scene)
+{
+    for (int i = 0; i < SCENE_SUBSYSTEM_COUNT; i++)
+        scene->subsystem_ticks[i] = 0;
 }
 
 /*
@@ -1672,6 +1354,8 @@ bool scene_resolve_circle_2d(const Scene *scene, float *cx, float *cy, float r)
 {
     bool moved = false;
 
+    stats_add(STAT_COLLISION_QUERIES, 1);
+
     for (int iter = 0; iter < 4; iter++)
     {
         bool any = false;
@@ -1749,60 +1433,76 @@ bool scene_resolve_circle_2d(const Scene *scene, float *cx, float *cy, float r)
     return moved;
 }
 
+/*
+ * Resize the banana storage.
+ */
+bool scene_set_banana_capacity(Scene *scene, int capacity)
+{
+    SceneBananas *b = &scene->bananas;
+
+    if (capacity < 0)
+        capacity = 0;
+
+    /* Drop grounded bananas first, then airborne ones */
+    if (b->count > capacity)
+        b->count = capacity;
+    if (b->airborne_count > b->count)
+        b->airborne_count = b->count;
+
+    return bananas_reserve(b, capacity);
+}
+
 /*
  * Spawn a thrown banana with initial velocity and random spin.
+ * The new banana is appended to the airborne range; the first grounded
+ * banana is moved to the end to make room for it.
  */
 void scene_throw_banana(Scene *scene, float x, float y, float z, float vx, float vy, float vz)
 {
-    for (int i = 0; i < SCENE_MAX_BANANAS; i++)
-    {
-        SceneBanana *b = &scene->bananas[i];
+    SceneBananas *b = &scene->bananas;
 
-        if (!b->active)
-        {
-            b->active = true;
-            b->on_ground = false;
+    if (b->count >= b->capacity)
+        return;
 
-            b->x = x;
-            b->y = y;
-            b->z = z;
+    int i = b->airborne_count;
+    if (b->count > i)
+        bananas_move(b, b->count, i);
 
-            b->vx = vx;
-            b->vy = vy;
-            b->vz = vz;
+    b->airborne_count++;
+    b->count++;
 
-            b->scale = 1.0f;
+    b->x[i] = x;
+    b->y[i] = y;
+    b->z[i] = z;
 
-            b->yaw_deg = atan2f(vy, vx) * 180.0f / (float)M_PI + randf_range(-12.0f, 12.0f);
-            b->pitch_deg = randf_range(-20.0f, 20.0f);
-            b->roll_deg = randf_range(-25.0f, 25.0f);
+    b->vx[i] = vx;
+    b->vy[i] = vy;
+    b->vz[i] = vz;
 
-            b->ang_vel_pitch = randf_range(320.0f, 620.0f);
-            b->ang_vel_roll = randf_range(-260.0f, 260.0f);
+    b->scale[i] = 1.0f;
 
-            /* Thrown bananas are not part of the player collision system */
-            b->collidable = false;
+    Rng *rng = &scene->rng;
 
-            if (i >= scene->banana_count)
-                scene->banana_count = i + 1;
+    b->yaw_deg[i] = atan2f(vy, vx) * 180.0f / (float)M_PI + rng_range(rng, -12.0f, 12.0f);
+    b->pitch_deg[i] = rng_range(rng, -20.0f, 20.0f);
+    b->roll_deg[i] = rng_range(rng, -25.0f, 25.0f);
 
-            return;
-        }
-    }
+    b->ang_vel_pitch[i] = rng_range(rng, 320.0f, 620.0f);
+    b->ang_vel_roll[i] = rng_range(rng, -260.0f, 260.0f);
+
+    bananas_store_previous_one(b, i);
+
+    /* Thrown bananas are not part of the player collision system */
+    b->collidable[i] = false;
 }
 
 /*
- * Count currently active bananas.
+ * Return the number of live bananas.
+ * Storage is dense, so this is simply the element count.
  */
 int scene_get_active_banana_count(const Scene *scene)
 {
-    int count = 0;
-    for (int i = 0; i < scene->banana_count; i++)
-    {
-        if (scene->bananas[i].active)
-            count++;
-    }
-    return count;
+    return scene->bananas.count;
 }
 
 /*
@@ -1855,16 +1555,27 @@ void scene_set_banana_model(Scene *scene, const Model *banana_model)
  */
 void scene_add_banana(Scene *scene, float x, float y, float z, float scale, float yaw_deg, bool collidable)
 {
-    if (scene->banana_count >= SCENE_MAX_BANANAS)
+    SceneBananas *b = &scene->bananas;
+    if (b->count >= b->capacity)
         return;
-    SceneBanana *b = &scene->bananas[scene->banana_count++];
-    b->x = x;
-    b->y = y;
-    b->z = z;
-    b->scale = scale;
-    b->yaw_deg = yaw_deg;
-    b->collidable = collidable;
-    b->active = true;
+
+    /* Static bananas start at rest in the grounded range */
+    int i = b->count++;
+    b->x[i] = x;
+    b->y[i] = y;
+    b->z[i] = z;
+    b->vx[i] = 0.0f;
+    b->vy[i] = 0.0f;
+    b->vz[i] = 0.0f;
+    b->scale[i] = scale;
+    b->yaw_deg[i] = yaw_deg;
+    b->pitch_deg[i] = 0.0f;
+    b->roll_deg[i] = 0.0f;
+    b->ang_vel_pitch[i] = 0.0f;
+    b->ang_vel_roll[i] = 0.0f;
+    b->collidable[i] = collidable;
+
+    bananas_store_previous_one(b, i);
 }
 
 /*
@@ -1873,6 +1584,7 @@ void scene_add_banana(Scene *scene, float x, float y, float z, float scale, floa
 void scene_set_tree_model(Scene *scene, const Model *tree_model)
 {
     scene->tree_model = tree_model;
+    scene->static_revision++;
 }
 
 /*
@@ -1891,6 +1603,7 @@ void scene_add_tree(Scene *scene, float x, float y, float z, float scale, float
     t->scale = scale;
     t->yaw_deg = yaw_deg;
     t->collidable = collidable;
+    scene->static_revision++;
 }
 
 /*
@@ -0,0 +1,1203 @@
+#include "scene.h"
+#include "model.h"
+#include "renderer.h"
+#include "stats.h"
+
+#include <GL/gl.h>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Draw a simple box primitive centered at (cx, cy, cz).
+ * This is used for fences, gates, debug geometry and simple scene objects.
+ */
+static void draw_box(float cx, float cy, float cz, float sx, float sy, float sz)
+{
+    float x0 = cx - sx * 0.5f, x1 = cx + sx * 0.5f;
+    float y0 = cy - sy * 0.5f, y1 = cy + sy * 0.5f;
+    float z0 = cz - sz * 0.5f, z1 = cz + sz * 0.5f;
+
+    glBegin(GL_QUADS);
+
+    /* top */
+    glNormal3f(0.0f, 0.0f, 1.0f);
+    glVertex3f(x0, y0, z1);
+    glVertex3f(x1, y0, z1);
+    glVertex3f(x1, y1, z1);
+    glVertex3f(x0, y1, z1);
+
+    /* bottom */
+    glNormal3f(0.0f, 0.0f, -1.0f);
+    glVertex3f(x0, y1, z0);
+    glVertex3f(x1, y1, z0);
+    glVertex3f(x1, y0, z0);
+    glVertex3f(x0, y0, z0);
+
+    /* front (+Y) */
+    glNormal3f(0.0f, 1.0f, 0.0f);
+    glVertex3f(x0, y1, z0);
+    glVertex3f(x0, y1, z1);
+    glVertex3f(x1, y1, z1);
+    glVertex3f(x1, y1, z0);
+
+    /* back (-Y) */
+    glNormal3f(0.0f, -1.0f, 0.0f);
+    glVertex3f(x0, y0, z0);
+    glVertex3f(x1, y0, z0);
+    glVertex3f(x1, y0, z1);
+    glVertex3f(x0, y0, z1);
+
+    /* left (-X) */
+    glNormal3f(-1.0f, 0.0f, 0.0f);
+    glVertex3f(x0, y0, z0);
+    glVertex3f(x0, y0, z1);
+    glVertex3f(x0, y1, z1);
+    glVertex3f(x0, y1, z0);
+
+    /* right (+X) */
+    glNormal3f(1.0f, 0.0f, 0.0f);
+    glVertex3f(x1, y0, z0);
+    glVertex3f(x1, y1, z0);
+    glVertex3f(x1, y1, z1);
+    glVertex3f(x1, y0, z1);
+
+    glEnd();
+    stats_draw(24);
+}
+
+/*
+ * Distance of a point in front of the camera along the view direction,
+ * from the column-major camera view matrix.
+ */
+static float view_depth(const float *mv, float x, float y, float z)
+{
+    return -(mv[2] * x + mv[6] * y + mv[10] * z + mv[14]);
+}
+
+/*
+ * Make room for count entries in the draw lists. On failure the old lists
+ * are kept and the caller draws in scene order.
+ */
+static bool context_reserve(SceneRenderContext *context, int count)
+{
+    if (count <= context->capacity)
+        return true;
+
+    int capacity = context->capacity > 0 ? context->capacity : 64;
+    while (capacity < count)
+        capacity *= 2;
+
+    DrawItem *items = realloc(context->items, (size_t)capacity * sizeof(DrawItem));
+    if (!items)
+        return false;
+    context->items = items;
+
+    DrawItem *scratch = realloc(context->scratch, (size_t)capacity * sizeof(DrawItem));
+    if (!scratch)
+        return false;
+    context->scratch = scratch;
+
+    context->capacity = capacity;
+    return true;
+}
+
+/*
+ * Upper limit of mesh vertices per pond side.
+ * Larger simulation grids are sampled with a stride when drawn.
+ */
+#define WATER_MESH_MAX_VERTS 128
+
+/*
+ * Draw the animated pond water mesh based on the height field simulation.
+ */
+static void draw_water_mesh(const Pond *pond)
+{
+    float cx = pond->x;
+    float cy = pond->y;
+    float z = pond->z;
+    float rx = pond->rx;
+    float ry = pond->ry;
+
+    const int n = pond->water.size;
+    if (n < 2)
+        return;
+
+    const float *height = water_sim_height(&pond->water);
+
+    const int step = (n + WATER_MESH_MAX_VERTS - 1) / WATER_MESH_MAX_VERTS;
+    const int m = (n - 1) / step + 1;
+
+    renderer_set_lighting(true);
+    renderer_set_texturing(0, false);
+    renderer_set_blending(true);
+
+    for (int x = 0; x < m - 1; x++)
+    {
+        int vertices = 0;
+
+        glBegin(GL_TRIANGLE_STRIP);
+
+        for (int y = 0; y < m; y++)
+        {
+            for (int k = 0; k < 2; k++)
+            {
+                int xx = x + k;
+                int yy = y;
+
+                float fx = (float)xx / (float)(m - 1);
+                float fy = (float)yy / (float)(m - 1);
+
+                float nx = (fx - 0.5f) * 2.0f;
+                float ny = (fy - 0.5f) * 2.0f;
+
+                float inside = nx * nx + ny * ny;
+                if (inside > 1.0f)
+                {
+                    continue;
+                }
+
+                int hx = (int)(fx * (float)(n - 1) + 0.5f);
+                int hy = (int)(fy * (float)(n - 1) + 0.5f);
+
+                float wx = cx + nx * rx;
+                float wy = cy + ny * ry;
+                float h = height[hx * n + hy];
+
+                /* Slight color variation based on edge distance and wave height */
+                float edge = inside;
+                float r = 0.10f + 0.05f * (1.0f - edge) + h * 0.10f;
+                float g = 0.28f + 0.10f * (1.0f - edge) + h * 0.12f;
+                float b = 0.52f + 0.18f * (1.0f - edge) + h * 0.08f;
+
+                glColor4f(r, g, b, 0.88f);
+                glNormal3f(0.0f, 0.0f, 1.0f);
+                glVertex3f(wx, wy, z + h * 0.28f);
+                vertices++;
+            }
+        }
+
+        glEnd();
+        stats_draw((uint32_t)vertices);
+    }
+
+    renderer_set_blending(false);
+}
+
+/*
+ * Draw a line loop around the pond border.
+ */
+static void draw_pond_border(const Pond *pond)
+{
+    const int segments = 64;
+
+    renderer_set_lighting(false);
+    renderer_set_texturing(0, false);
+
+    glColor3f(0.08f, 0.16f, 0.22f);
+    renderer_set_line_width(2.0f);
+
+    glBegin(GL_LINE_LOOP);
+    for (int i = 0; i < segments; i++)
+    {
+        float a = (2.0f * (float)M_PI * (float)i) / (float)segments;
+        float x = pond->x + cosf(a) * pond->rx;
+        float y = pond->y + sinf(a) * pond->ry;
+        glVertex3f(x, y, pond->z + 0.01f);
+    }
+    glEnd();
+    stats_draw((uint32_t)segments);
+}
+
+/*
+ * Draw small particles above the water, farthest first.
+ */
+static void draw_water_particles(const Scene *scene, SceneRenderContext *context)
+{
+    renderer_set_lighting(false);
+    renderer_set_texturing(0, false);
+    renderer_set_blending(true);
+
+    renderer_set_point_size(4.0f);
+
+    const SlotPool *pool = &scene->water_particle_pool;
+    int count = pool_live_count(pool);
+    bool sorted = context_reserve(context, count);
+
+    if (sorted)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            int slot = pool_live_slot(pool, i);
+            const WaterParticle *p = &scene->water_particles[slot];
+            float depth = view_depth(context->view, p->x, p->y, p->z);
+            context->items[i].key = draw_depth_key(depth, RENDERER_Z_FAR, true);
+            context->items[i].id = (uint32_t)slot;
+        }
+        draw_sort(context->items, context->scratch, count);
+    }
+
+    glBegin(GL_POINTS);
+    for (int i = 0; i < count; i++)
+    {
+        int slot = sorted ? (int)context->items[i].id : pool_live_slot(pool, i);
+        const WaterParticle *p = &scene->water_particles[slot];
+
+        float a = p->life / p->max_life;
+        glColor4f(0.75f, 0.88f, 1.0f, a);
+        glVertex3f(p->x, p->y, p->z);
+    }
+    glEnd();
+    stats_draw((uint32_t)count);
+
+    renderer_set_blending(false);
+}
+
+/*
+ * Draw the rain effect as simple line segments.
+ */
+static void draw_rain(const Scene *scene)
+{
+    renderer_set_lighting(false);
+    renderer_set_texturing(0, false);
+    renderer_set_blending(true);
+
+    renderer_set_line_width(1.2f);
+
+    /* Drops are evaluated into a vertex array; there can be far too many for glVertex */
+    int vertex_count = rain_build_vertices(&scene->rain, scene->jobs);
+
+    glColor4f(0.75f, 0.82f, 0.95f, 0.75f);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, scene->rain.vertices);
+    glDrawArrays(GL_LINES, 0, vertex_count);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    stats_draw((uint32_t)vertex_count);
+
+    renderer_set_blending(false);
+}
+
+/*
+ * Draw the ground of the pond below the water surface.
+ */
+static void draw_pond_bed(const Pond *pond)
+{
+    const int segments = 64;
+
+    float cx = pond->x;
+    float cy = pond->y;
+    float z = pond->z - 0.35f;
+    float rx = pond->rx * 1.02f;
+    float ry = pond->ry * 1.02f;
+
+    renderer_set_lighting(true);
+    renderer_set_texturing(0, false);
+
+    glBegin(GL_TRIANGLE_FAN);
+    glColor3f(0.18f, 0.16f, 0.10f);
+    glNormal3f(0.0f, 0.0f, 1.0f);
+    glVertex3f(cx, cy, z);
+
+    for (int i = 0; i <= segments; i++)
+    {
+        float a = (2.0f * (float)M_PI * (float)i) / (float)segments;
+        float x = cx + cosf(a) * rx;
+        float y = cy + sinf(a) * ry;
+
+        glColor3f(0.28f, 0.24f, 0.14f);
+        glVertex3f(x, y, z + 0.10f);
+    }
+    glEnd();
+    stats_draw((uint32_t)segments + 2);
+}
+
+/*
+ * Fill the transition area between water and surrounding ground.
+ */
+static void draw_pond_edge_fill(const Pond *pond)
+{
+    const int segments = 96;
+
+    float cx = pond->x;
+    float cy = pond->y;
+    float z = pond->z;
+
+    float inner_rx = pond->rx * 0.96f;
+    float inner_ry = pond->ry * 0.96f;
+
+    float outer_rx = pond->rx * 1.02f;
+    float outer_ry = pond->ry * 1.02f;
+
+    renderer_set_lighting(true);
+    renderer_set_texturing(0, false);
+    renderer_set_blending(true);
+
+    glBegin(GL_TRIANGLE_STRIP);
+    for (int i = 0; i <= segments; i++)
+    {
+        float a = (2.0f * (float)M_PI * (float)i) / (float)segments;
+        float c = cosf(a);
+        float s = sinf(a);
+
+        glColor4f(0.10f, 0.30f, 0.52f, 0.92f);
+        glVertex3f(
+            cx + c * inner_rx,
+            cy + s * inner_ry,
+            z + 0.003f);
+
+        glColor4f(0.24f, 0.22f, 0.14f, 0.98f);
+        glVertex3f(
+            cx + c * outer_rx,
+            cy + s * outer_ry,
+            z - 0.02f);
+    }
+    glEnd();
+    stats_draw(2 * ((uint32_t)segments + 1));
+
+    renderer_set_blending(false);
+}
+
+/*
+ * Draw one rectangular ground patch with a fixed color.
+ */
+static void draw_ground_patch(float x0, float y0, float x1, float y1, float z, float r, float g, float b)
+{
+    glColor3f(r, g, b);
+    glBegin(GL_QUADS);
+    glNormal3f(0.0f, 0.0f, 1.0f);
+    glVertex3f(x0, y0, z);
+    glVertex3f(x1, y0, z);
+    glVertex3f(x1, y1, z);
+    glVertex3f(x0, y1, z);
+    glEnd();
+    stats_draw(4);
+}
+
+/*
+ * Draw one simple road segment made from two layered rectangular patches.
+ */
+static void draw_road_segment(float x0, float y0, float x1, float y1, float z)
+{
+    draw_ground_patch(
+        x0 - 1.5f, y0 - 1.5f,
+        x1 + 1.5f, y1 + 1.5f,
+        z,
+        0.48f, 0.50f, 0.30f);
+
+    draw_ground_patch(
+        x0, y0,
+        x1, y1,
+        z + 0.001f,
+        0.58f, 0.48f, 0.30f);
+}
+
+/*
+ * Draw the full ground with multiple colored areas and simple roads.
+ */
+static void draw_ground(float half_size, float z)
+{
+    /* base ground */
+    draw_ground_patch(-half_size, -half_size, half_size, half_size, z, 0.34f, 0.50f, 0.24f);
+
+    /* larger terrain variations */
+    draw_ground_patch(-half_size, -half_size, 0.0f, 0.0f, z + 0.001f, 0.30f, 0.46f, 0.22f);
+    draw_ground_patch(0.0f, -half_size, half_size, 0.0f, z + 0.001f, 0.32f, 0.48f, 0.23f);
+    draw_ground_patch(-half_size, 0.0f, 0.0f, half_size, z + 0.001f, 0.36f, 0.53f, 0.25f);
+    draw_ground_patch(0.0f, 0.0f, half_size, half_size, z + 0.001f, 0.33f, 0.49f, 0.24f);
+
+    /* lighter ground around enclosures */
+    draw_ground_patch(-30.0f, -30.0f, 30.0f, 30.0f, z + 0.002f, 0.38f, 0.47f, 0.24f);
+    draw_ground_patch(25.0f, -5.0f, 55.0f, 25.0f, z + 0.002f, 0.39f, 0.48f, 0.25f);
+    draw_ground_patch(-63.0f, -38.0f, -27.0f, -2.0f, z + 0.002f, 0.39f, 0.48f, 0.25f);
+
+    /* main road */
+    draw_road_segment(-3.0f, -95.0f, 3.0f, -25.0f, z + 0.004f);
+
+    /* road to right enclosure */
+    draw_road_segment(0.0f, -31.0f, 44.0f, -25.0f, z + 0.004f);
+    draw_road_segment(38.0f, -25.0f, 44.0f, -6.0f, z + 0.0045f);
+    draw_road_segment(36.0f, -6.0f, 44.0f, 0.0f, z + 0.005f);
+
+    /* road to left enclosure */
+    draw_road_segment(-46.0f, -36.0f, 0.0f, -30.0f, z + 0.004f);
+    draw_road_segment(-49.0f, -38.0f, -43.0f, -32.0f, z + 0.005f);
+
+    /* dry terrain patches */
+    draw_ground_patch(10.0f, 20.0f, 28.0f, 32.0f, z + 0.003f, 0.46f, 0.50f, 0.26f);
+    draw_ground_patch(-80.0f, 18.0f, -55.0f, 35.0f, z + 0.003f, 0.44f, 0.49f, 0.25f);
+    draw_ground_patch(60.0f, -50.0f, 88.0f, -30.0f, z + 0.003f, 0.45f, 0.50f, 0.26f);
+}
+
+/*
+ * Draw one fence enclosure visually.
+ * This includes walls, posts and the gate posts.
+ */
+static void draw_fence_visual(float half_size, float wall_height)
+{
+    const float t = 0.25f;
+    const float post = 0.35f;
+    const float step = 4.0f;
+    const float gate_w = 3.0f;
+
+    /* fence walls */
+    glColor3f(0.35f, 0.25f, 0.12f);
+
+    /* +Y wall */
+    draw_box(0.0f, half_size, wall_height * 0.5f, half_size * 2.0f, t, wall_height);
+
+    /* -Y wall split for gate */
+    float gap = gate_w + post;
+    float total = half_size * 2.0f;
+    float side_len = (total - gap) * 0.5f;
+    if (side_len < 0.5f)
+        side_len = 0.5f;
+
+    float left_cx = -(gap * 0.5f + side_len * 0.5f);
+    float right_cx = +(gap * 0.5f + side_len * 0.5f);
+
+    draw_box(left_cx, -half_size, wall_height * 0.5f, side_len, t, wall_height);
+    draw_box(right_cx, -half_size, wall_height * 0.5f, side_len, t, wall_height);
+
+    /* +X wall */
+    draw_box(half_size, 0.0f, wall_height * 0.5f, t, half_size * 2.0f, wall_height);
+
+    /* -X wall */
+    draw_box(-half_size, 0.0f, wall_height * 0.5f, t, half_size * 2.0f, wall_height);
+
+    /* posts */
+    glColor3f(0.25f, 0.18f, 0.08f);
+    float gate_clear = gate_w * 0.5f + post * 0.6f;
+
+    for (float x = -half_size; x <= half_size; x += step)
+    {
+        draw_box(x, half_size, wall_height * 0.5f, post, post, wall_height);
+        if (fabsf(x) > gate_clear)
+        {
+            draw_box(x, -half_size, wall_height * 0.5f, post, post, wall_height);
+        }
+    }
+
+    for (float y = -half_size; y <= half_size; y += step)
+    {
+        draw_box(half_size, y, wall_height * 0.5f, post, post, wall_height);
+        draw_box(-half_size, y, wall_height * 0.5f, post, post, wall_height);
+    }
+
+    /* gate posts */
+    glColor3f(0.40f, 0.30f, 0.15f);
+    float gate_y = -half_size - t * 0.6f;
+    float gate_x0 = -gate_w * 0.5f;
+    float gate_x1 = gate_w * 0.5f;
+
+    draw_box(gate_x0, gate_y, wall_height * 0.5f, post, post, wall_height);
+    draw_box(gate_x1, gate_y, wall_height * 0.5f, post, post, wall_height);
+}
+
+/*
+ * Whether a sphere overlaps a caster box; always true without a box.
+ * The instance loops center their spheres on the translated model origin,
+ * so they are tested without building the full transform.
+ */
+static bool caster_in_box(const SceneCasterBox *box, float x, float y, float z, float radius)
+{
+    if (!box)
+        return true;
+
+    const float *m = box->light_view;
+    float lx = m[0] * x + m[4] * y + m[8] * z + m[12];
+    float ly = m[1] * x + m[5] * y + m[9] * z + m[13];
+
+    return lx + radius >= box->min_x && lx - radius <= box->max_x &&
+           ly + radius >= box->min_y && ly - radius <= box->max_y;
+}
+
+/*
+ * Distance from a model's origin to the farthest corner of its bounds.
+ */
+static float model_radius(const Model *model)
+{
+    const AABB *b = &model->local_bounds;
+    float x = fmaxf(fabsf(b->minx), fabsf(b->maxx));
+    float y = fmaxf(fabsf(b->miny), fabsf(b->maxy));
+    float z = fmaxf(fabsf(b->minz), fabsf(b->maxz));
+    return sqrtf(x * x + y * y + z * z);
+}
+
+/*
+ * Fence enclosures.
+ */
+static void render_fences(const Scene *scene, const SceneCasterBox *box)
+{
+    for (int i = 0; i < scene->fence_count; i++)
+    {
+        const SceneFence *f = &scene->fences[i];
+        float radius = f->half_size * 1.5f + f->wall_height;
+        if (!caster_in_box(box, f->cx, f->cy, 0.0f, radius))
+            continue;
+
+        glPushMatrix();
+        glTranslatef(f->cx, f->cy, 0.0f);
+        draw_fence_visual(f->half_size, f->wall_height);
+        glPopMatrix();
+    }
+}
+
+/*
+ * Simple colored boxes.
+ */
+static void render_boxes(const Scene *scene, const SceneCasterBox *box)
+{
+    for (int i = 0; i < scene->box_count; i++)
+    {
+        const SceneBox *b = &scene->boxes[i];
+        float radius = 0.5f * sqrtf(b->sx * b->sx + b->sy * b->sy + b->sz * b->sz);
+        if (!caster_in_box(box, b->cx, b->cy, b->cz, radius))
+            continue;
+
+        glColor3f(b->color.r, b->color.g, b->color.b);
+        draw_box(b->cx, b->cy, b->cz, b->sx, b->sy, b->sz);
+    }
+}
+
+/*
+ * Ground, fences and simple boxes.
+ */
+static void render_ground_pass(const Scene *scene)
+{
+    renderer_set_lighting(true);
+    renderer_set_texturing(0, false);
+
+    draw_ground(scene->ground_half_size, 0.0f);
+    render_fences(scene, NULL);
+    render_boxes(scene, NULL);
+}
+
+/*
+ * Model instances with at least this many vertices are heavy enough to be
+ * laid down in the depth pre-pass.
+ */
+#define SCENE_PREPASS_MIN_VERTICES 3000
+
+/*
+ * Instances in the sorted draw lists. A draw id holds the kind in its top
+ * byte and the instance index below it.
+ */
+typedef enum
+{
+    SCENE_DRAW_ROCK,
+    SCENE_DRAW_GATE,
+    SCENE_DRAW_TREE,
+    SCENE_DRAW_MONKEY,
+    SCENE_DRAW_BANANA
+} SceneDrawKind;
+
+#define SCENE_DRAW_ID(kind, index) (((uint32_t)(kind) << 24) | (uint32_t)(index))
+
+/*
+ * Ponds are drawn back to front, bed, water, edge and border each, so a
+ * far pond never blends over a nearer one.
+ */
+static void render_water_pass(const Scene *scene, SceneRenderContext *context)
+{
+    int pond_count = scene->ponds.count;
+    bool sorted = context_reserve(context, pond_count);
+
+    if (sorted)
+    {
+        for (int i = 0; i < pond_count; i++)
+        {
+            const Pond *pond = &scene->ponds.ponds[i];
+            float depth = view_depth(context->view, pond->x, pond->y, pond->z);
+            context->items[i].key = draw_depth_key(depth, RENDERER_Z_FAR, true);
+            context->items[i].id = (uint32_t)i;
+        }
+        draw_sort(context->items, context->scratch, pond_count);
+    }
+
+    for (int i = 0; i < pond_count; i++)
+    {
+        int index = sorted ? (int)context->items[i].id : i;
+        const Pond *pond = &scene->ponds.ponds[index];
+        draw_pond_bed(pond);
+        draw_water_mesh(pond);
+        draw_pond_edge_fill(pond);
+        draw_pond_border(pond);
+    }
+
+    draw_water_particles(scene, context);
+}
+
+/*
+ * Rain streaks around the focus point.
+ */
+static void render_rain_pass(const Scene *scene)
+{
+    if (scene->rain_enabled)
+    {
+        draw_rain(scene);
+    }
+}
+
+/*
+ * Model instances are drawn through one of these: model_draw for the
+ * scene, model_draw_depth for shadow maps and the depth pre-pass.
+ */
+typedef void (*SceneModelDraw)(const Model *model);
+
+/*
+ * One rock instance.
+ */
+static void draw_rock(const Scene *scene, int index, SceneModelDraw draw)
+{
+    const SceneRock *r = &scene->rocks[index];
+
+    glPushMatrix();
+    glTranslatef(r->x, r->y, r->z);
+    glRotatef(r->yaw_deg, 0.0f, 0.0f, 1.0f);
+    glScalef(r->scale, r->scale, r->scale);
+    draw(scene->rock_model);
+    glPopMatrix();
+}
+
+/*
+ * One gate between its previous and current angle.
+ */
+static void draw_gate(const Scene *scene, int index, float alpha)
+{
+    const SceneGate *g = &scene->gates[index];
+
+    glColor3f(g->color.r, g->color.g, g->color.b);
+
+    float angle = g->prev_angle_deg + (g->angle_deg - g->prev_angle_deg) * alpha;
+
+    glPushMatrix();
+    glTranslatef(g->hx, g->hy, g->hz);
+    glRotatef(angle, 0.0f, 0.0f, 1.0f);
+    draw_box(g->w * 0.5f, 0.0f, g->h * 0.5f, g->w, g->t, g->h);
+    glPopMatrix();
+}
+
+/*
+ * One tree instance, lifted so its base rests on the ground.
+ */
+static void draw_tree(const Scene *scene, int index, SceneModelDraw draw)
+{
+    const SceneTree *t = &scene->trees[index];
+
+    float z_lift = -scene->tree_model->local_bounds.minz * t->scale;
+    float extra_lift = 0.15f * t->scale;
+
+    glPushMatrix();
+    glTranslatef(t->x, t->y, t->z + z_lift + extra_lift);
+    glRotatef(t->yaw_deg, 0.0f, 0.0f, 1.0f);
+    glRotatef(90.0f, 1.0f, 0.0f, 0.0f);
+    glScalef(t->scale, t->scale, t->scale);
+    draw(scene->tree_model);
+    glPopMatrix();
+}
+
+/*
+ * One monkey with its idle or eating animation.
+ */
+static void draw_monkey(const Scene *scene, int index, SceneModelDraw draw)
+{
+    const SceneMonkey *m = &scene->monkeys[index];
+
+    float z_lift = -scene->monkey_model->local_bounds.minz * m->scale;
+
+    glPushMatrix();
+    float z_offset = 0.0f;
+    float extra_yaw = 0.0f;
+    float extra_pitch = 0.0f;
+
+    if (m->state == MONKEY_IDLE)
+    {
+        z_offset = sinf(m->anim_time * 2.0f) * 0.05f;
+        extra_yaw = sinf(m->anim_time * 1.5f) * 10.0f;
+    }
+    else if (m->state == MONKEY_EATING)
+    {
+        z_offset = sinf(m->anim_time * 10.0f) * 0.08f;
+        extra_pitch = sinf(m->anim_time * 12.0f) * 15.0f;
+    }
+
+    glTranslatef(m->x, m->y, m->z + z_lift + z_offset);
+    glRotatef(m->yaw_deg + extra_yaw, 0, 0, 1);
+    glRotatef(extra_pitch, 1, 0, 0);
+    glRotatef(90.0f, 1.0f, 0.0f, 0.0f);
+    glScalef(m->scale, m->scale, m->scale);
+    draw(scene->monkey_model);
+    glPopMatrix();
+}
+
+/*
+ * Position of a banana between its previous and current pose.
+ */
+static void banana_position(const SceneBananas *b, int index, float alpha, float *x, float *y, float *z)
+{
+    *x = b->prev_x[index] + (b->x[index] - b->prev_x[index]) * alpha;
+    *y = b->prev_y[index] + (b->y[index] - b->prev_y[index]) * alpha;
+    *z = b->prev_z[index] + (b->z[index] - b->prev_z[index]) * alpha;
+}
+
+/*
+ * One banana between its previous and current pose.
+ */
+static void draw_banana(const Scene *scene, int index, float alpha, SceneModelDraw draw)
+{
+    const SceneBananas *b = &scene->bananas;
+
+    float z_lift = -scene->banana_model->local_bounds.minz * b->scale[index];
+
+    float x, y, z;
+    banana_position(b, index, alpha, &x, &y, &z);
+    float pitch = b->prev_pitch_deg[index] + (b->pitch_deg[index] - b->prev_pitch_deg[index]) * alpha;
+    float roll = b->prev_roll_deg[index] + (b->roll_deg[index] - b->prev_roll_deg[index]) * alpha;
+
+    glPushMatrix();
+    glTranslatef(x, y, z + z_lift);
+
+    glRotatef(b->yaw_deg[index], 0.0f, 0.0f, 1.0f);
+    glRotatef(pitch, 1.0f, 0.0f, 0.0f);
+    glRotatef(roll, 0.0f, 1.0f, 0.0f);
+
+    glScalef(b->scale[index], b->scale[index], b->scale[index]);
+    draw(scene->banana_model);
+    glPopMatrix();
+}
+
+/*
+ * Rock instances.
+ */
+static void render_rocks(const Scene *scene, SceneModelDraw draw, const SceneCasterBox *box)
+{
+    if (!scene->rock_model)
+        return;
+
+    float radius = model_radius(scene->rock_model);
+
+    for (int i = 0; i < scene->rock_count; i++)
+    {
+        const SceneRock *r = &scene->rocks[i];
+        if (caster_in_box(box, r->x, r->y, r->z, radius * r->scale))
+            draw_rock(scene, i, draw);
+    }
+}
+
+/*
+ * Gates that exist.
+ */
+static void render_gates(const Scene *scene, float alpha, const SceneCasterBox *box)
+{
+    for (int gi = 0; gi < scene->gate_count; gi++)
+    {
+        const SceneGate *g = &scene->gates[gi];
+        if (!g->exists)
+            continue;
+
+        /* The leaf swings around its hinge */
+        float radius = sqrtf(g->w * g->w + g->t * g->t + g->h * g->h);
+        if (caster_in_box(box, g->hx, g->hy, g->hz, radius))
+            draw_gate(scene, gi, alpha);
+    }
+}
+
+/*
+ * Tree instances.
+ */
+static void render_trees(const Scene *scene, SceneModelDraw draw, const SceneCasterBox *box)
+{
+    if (!scene->tree_model)
+        return;
+
+    float radius = model_radius(scene->tree_model);
+
+    for (int i = 0; i < scene->tree_count; i++)
+    {
+        const SceneTree *t = &scene->trees[i];
+        float z = t->z + (0.15f - scene->tree_model->local_bounds.minz) * t->scale;
+        if (caster_in_box(box, t->x, t->y, z, radius * t->scale))
+            draw_tree(scene, i, draw);
+    }
+}
+
+/*
+ * Active monkeys.
+ */
+static void render_monkeys(const Scene *scene, SceneModelDraw draw, const SceneCasterBox *box)
+{
+    if (!scene->monkey_model)
+        return;
+
+    float radius = model_radius(scene->monkey_model);
+
+    for (int i = 0; i < scene->monkey_count; i++)
+    {
+        const SceneMonkey *m = &scene->monkeys[i];
+        if (!m->active)
+            continue;
+
+        float z = m->z - scene->monkey_model->local_bounds.minz * m->scale;
+        if (caster_in_box(box, m->x, m->y, z, radius * m->scale + 0.1f))
+            draw_monkey(scene, i, draw);
+    }
+}
+
+/*
+ * Bananas.
+ */
+static void render_bananas(const Scene *scene, float alpha, SceneModelDraw draw, const SceneCasterBox *box)
+{
+    if (!scene->banana_model)
+        return;
+
+    const SceneBananas *b = &scene->bananas;
+    float radius = model_radius(scene->banana_model);
+
+    for (int i = 0; i < b->count; i++)
+    {
+        float x, y, z;
+        banana_position(b, i, alpha, &x, &y, &z);
+        z -= scene->banana_model->local_bounds.minz * b->scale[i];
+
+        if (caster_in_box(box, x, y, z, radius * b->scale[i]))
+            draw_banana(scene, i, alpha, draw);
+    }
+}
+
+/*
+ * Whether instances of a model go into the depth pre-pass.
+ */
+static bool model_is_heavy(const Model *model)
+{
+    return model && model->vert_count >= SCENE_PREPASS_MIN_VERTICES;
+}
+
+/*
+ * Whether the pre-pass draws instances of a kind.
+ */
+static bool kind_is_heavy(const Scene *scene, SceneDrawKind kind)
+{
+    switch (kind)
+    {
+    case SCENE_DRAW_ROCK:
+        return model_is_heavy(scene->rock_model);
+    case SCENE_DRAW_TREE:
+        return model_is_heavy(scene->tree_model);
+    case SCENE_DRAW_MONKEY:
+        return model_is_heavy(scene->monkey_model);
+    case SCENE_DRAW_BANANA:
+        return model_is_heavy(scene->banana_model);
+    default:
+        return false;
+    }
+}
+
+/*
+ * Append one instance to the draw list, keyed by its view depth.
+ */
+static void push_object(SceneRenderContext *context, int *count, float x, float y, float z, SceneDrawKind kind, int index)
+{
+    DrawItem *item = &context->items[(*count)++];
+    item->key = draw_depth_key(view_depth(context->view, x, y, z), RENDERER_Z_FAR, false);
+    item->id = SCENE_DRAW_ID(kind, index);
+}
+
+/*
+ * Fill the draw list with the object instances, nearest first. Returns
+ * the number of entries, or -1 if the list cannot grow and the caller
+ * should draw in scene order.
+ */
+static int sort_objects(const Scene *scene, SceneRenderContext *context, float alpha)
+{
+    bool rocks = scene->rock_model != NULL;
+    bool trees = scene->tree_model != NULL;
+    bool monkeys = scene->monkey_model != NULL;
+    bool bananas = scene->banana_model != NULL;
+
+    int needed = (rocks ? scene->rock_count : 0) +
+                 scene->gate_count +
+                 (trees ? scene->tree_count : 0) +
+                 (monkeys ? scene->monkey_count : 0) +
+                 (bananas ? scene->bananas.count : 0);
+    if (!context_reserve(context, needed))
+        return -1;
+
+    int count = 0;
+
+    for (int i = 0; rocks && i < scene->rock_count; i++)
+    {
+        const SceneRock *r = &scene->rocks[i];
+        push_object(context, &count, r->x, r->y, r->z, SCENE_DRAW_ROCK, i);
+    }
+
+    for (int i = 0; i < scene->gate_count; i++)
+    {
+        const SceneGate *g = &scene->gates[i];
+        if (g->exists)
+            push_object(context, &count, g->hx, g->hy, g->hz, SCENE_DRAW_GATE, i);
+    }
+
+    for (int i = 0; trees && i < scene->tree_count; i++)
+    {
+        const SceneTree *t = &scene->trees[i];
+        push_object(context, &count, t->x, t->y, t->z, SCENE_DRAW_TREE, i);
+    }
+
+    for (int i = 0; monkeys && i < scene->monkey_count; i++)
+    {
+        const SceneMonkey *m = &scene->monkeys[i];
+        if (m->active)
+            push_object(context, &count, m->x, m->y, m->z, SCENE_DRAW_MONKEY, i);
+    }
+
+    for (int i = 0; bananas && i < scene->bananas.count; i++)
+    {
+        float x, y, z;
+        banana_position(&scene->bananas, i, alpha, &x, &y, &z);
+        push_object(context, &count, x, y, z, SCENE_DRAW_BANANA, i);
+    }
+
+    draw_sort(context->items, context->scratch, count);
+    return count;
+}
+
+/*
+ * Draw one entry of the sorted objects list. Gates set their own
+ * untextured state, the models theirs in model_draw.
+ */
+static void draw_object(const Scene *scene, uint32_t id, float alpha, SceneModelDraw draw)
+{
+    int index = (int)(id & 0xffffffu);
+
+    switch ((SceneDrawKind)(id >> 24))
+    {
+    case SCENE_DRAW_ROCK:
+        draw_rock(scene, index, draw);
+        break;
+    case SCENE_DRAW_GATE:
+        renderer_set_lighting(true);
+        renderer_set_texturing(0, false);
+        renderer_set_texturing(1, false);
+        draw_gate(scene, index, alpha);
+        break;
+    case SCENE_DRAW_TREE:
+        draw_tree(scene, index, draw);
+        break;
+    case SCENE_DRAW_MONKEY:
+        draw_monkey(scene, index, draw);
+        break;
+    case SCENE_DRAW_BANANA:
+        draw_banana(scene, index, alpha, draw);
+        break;
+    }
+}
+
+/*
+ * Rocks, gates, trees, monkeys and bananas, nearest first so hidden
+ * fragments fail the depth test before they are shaded. The list the
+ * pre-pass sorted is used as is.
+ * Moving bananas and gates are drawn between their previous and current
+ * simulation pose; alpha is the fraction of a step since the last update.
+ */
+static void render_objects_pass(const Scene *scene, SceneRenderContext *context, float alpha)
+{
+    int count = context->object_count >= 0 ? context->object_count : sort_objects(scene, context, alpha);
+    context->object_count = -1;
+
+    if (count >= 0)
+    {
+        for (int i = 0; i < count; i++)
+            draw_object(scene, context->items[i].id, alpha, model_draw);
+    }
+    else
+    {
+        render_rocks(scene, model_draw, NULL);
+
+        renderer_set_lighting(true);
+        renderer_set_texturing(0, false);
+        renderer_set_texturing(1, false);
+        render_gates(scene, alpha, NULL);
+
+        render_trees(scene, model_draw, NULL);
+        render_monkeys(scene, model_draw, NULL);
+        render_bananas(scene, alpha, model_draw, NULL);
+    }
+
+    /* Untextured drawing must not pick up the models' AO */
+    renderer_set_texturing(1, false);
+}
+
+/*
+ * Depth only, nearest first; the color passes that follow then shade each
+ * covered pixel of a heavy mesh once. All objects are sorted, and the
+ * heavy ones picked from the list, which the objects pass then reuses.
+ */
+void scene_render_depth_prepass(const Scene *scene, SceneRenderContext *context, float alpha)
+{
+    bool heavy[SCENE_DRAW_BANANA + 1];
+    bool any = false;
+    for (int kind = 0; kind <= SCENE_DRAW_BANANA; kind++)
+    {
+        heavy[kind] = kind_is_heavy(scene, (SceneDrawKind)kind);
+        any = any || heavy[kind];
+    }
+
+    if (!any)
+        return;
+
+    int count = sort_objects(scene, context, alpha);
+    context->object_count = count;
+
+    renderer_set_color_write(false);
+
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t id = context->items[i].id;
+        if (heavy[id >> 24])
+            draw_object(scene, id, alpha, model_draw_depth);
+    }
+
+    renderer_set_color_write(true);
+}
+
+/*
+ * The lists are allocated by the first pass that sorts.
+ */
+void scene_render_context_init(SceneRenderContext *context)
+{
+    memset(context, 0, sizeof(*context));
+    context->view[0] = context->view[5] = context->view[10] = context->view[15] = 1.0f;
+    context->object_count = -1;
+}
+
+/*
+ * Safe on a context that never sorted anything.
+ */
+void scene_render_context_free(SceneRenderContext *context)
+{
+    free(context->items);
+    free(context->scratch);
+    scene_render_context_init(context);
+}
+
+/*
+ * Forget what the last frame left in the lists.
+ */
+void scene_render_context_begin(SceneRenderContext *context, const float *view)
+{
+    memcpy(context->view, view, sizeof(context->view));
+    context->object_count = -1;
+}
+
+/*
+ * Dispatch one pass to its draw function.
+ */
+void scene_render_pass(const Scene *scene, SceneRenderContext *context, ScenePass pass, float alpha)
+{
+    switch (pass)
+    {
+    case SCENE_PASS_GROUND:
+        render_ground_pass(scene);
+        break;
+    case SCENE_PASS_WATER:
+        render_water_pass(scene, context);
+        break;
+    case SCENE_PASS_RAIN:
+        render_rain_pass(scene);
+        break;
+    case SCENE_PASS_OBJECTS:
+        render_objects_pass(scene, context, alpha);
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * Static casters never need alpha; dynamic ones are interpolated like in
+ * the objects pass.
+ */
+void scene_render_casters(const Scene *scene, SceneCasters casters, float alpha, const SceneCasterBox *box)
+{
+    if (casters == SCENE_CASTERS_STATIC)
+    {
+        render_fences(scene, box);
+        render_boxes(scene, box);
+        render_rocks(scene, model_draw_depth, box);
+        render_trees(scene, model_draw_depth, box);
+    }
+    else
+    {
+        render_gates(scene, alpha, box);
+        render_monkeys(scene, model_draw_depth, box);
+        render_bananas(scene, alpha, model_draw_depth, box);
+    }
+}
+
+/*
+ * Render the entire scene:
+ * ground, fences, boxes, then rocks, gates, trees, monkeys and bananas
+ * nearest first, then ponds and rain.
+ */
+void scene_render(const Scene *scene, SceneRenderContext *context, float alpha)
+{
+    for (int pass = 0; pass < SCENE_PASS_COUNT; pass++)
+        scene_render_pass(scene, context, (ScenePass)pass, alpha);
+}
+
+/*
+ * Draw all obstacle AABBs as red wireframes for debugging.
+ */
+void scene_debug_draw_obstacles(const Scene *scene)
+{
+    renderer_set_lighting(false);
+    renderer_set_texturing(0, false);
+    glColor3f(1, 0, 0);
+
+    for (int i = 0; i < scene->obstacle_count; i++)
+    {
+        const AABB *b = &scene->obstacles[i];
+
+        float x0 = b->minx, x1 = b->maxx;
+        float y0 = b->miny, y1 = b->maxy;
+        float z0 = b->minz, z1 = b->maxz;
+
+        glBegin(GL_LINES);
+
+        /* bottom rectangle */
+        glVertex3f(x0, y0, z0);
+        glVertex3f(x1, y0, z0);
+        glVertex3f(x1, y0, z0);
+        glVertex3f(x1, y1, z0);
+        glVertex3f(x1, y1, z0);
+        glVertex3f(x0, y1, z0);
+        glVertex3f(x0, y1, z0);
+        glVertex3f(x0, y0, z0);
+
+        /* top rectangle */
+        glVertex3f(x0, y0, z1);
+        glVertex3f(x1, y0, z1);
+        glVertex3f(x1, y0, z1);
+        glVertex3f(x1, y1, z1);
+        glVertex3f(x1, y1, z1);
+        glVertex3f(x0, y1, z1);
+        glVertex3f(x0, y1, z1);
+        glVertex3f(x0, y0, z1);
+
+        /* vertical edges */
+        glVertex3f(x0, y0, z0);
+        glVertex3f(x0, y0, z1);
+        glVertex3f(x1, y0, z0);
+        glVertex3f(x1, y0, z1);
+        glVertex3f(x1, y1, z0);
+        glVertex3f(x1, y1, z1);
+        glVertex3f(x0, y1, z0);
+        glVertex3f(x0, y1, z1);
+
+        glEnd();
+        stats_draw(24);
+    }
+}
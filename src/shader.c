@@ -0,0 +1,320 @@
+#include "shader.h"
+#include "stats.h"
+
+#include <GL/gl.h>
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Tokens missing from the OpenGL 1.1 headers shipped on Windows.
+ */
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#endif
+#ifndef GL_VERTEX_SHADER
+#define GL_VERTEX_SHADER 0x8B31
+#endif
+#ifndef GL_COMPILE_STATUS
+#define GL_COMPILE_STATUS 0x8B81
+#endif
+#ifndef GL_LINK_STATUS
+#define GL_LINK_STATUS 0x8B82
+#endif
+#ifndef GL_INFO_LOG_LENGTH
+#define GL_INFO_LOG_LENGTH 0x8B84
+#endif
+#ifndef GL_SHADING_LANGUAGE_VERSION
+#define GL_SHADING_LANGUAGE_VERSION 0x8B8C
+#endif
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+/*
+ * OpenGL 2.0 shader entry points, loaded at run time because the Windows
+ * headers stop at OpenGL 1.1.
+ */
+typedef GLuint(APIENTRY *ShaderCreateShaderProc)(GLenum type);
+typedef void(APIENTRY *ShaderShaderSourceProc)(GLuint shader, GLsizei count, const char *const *strings, const GLint *lengths);
+typedef void(APIENTRY *ShaderCompileShaderProc)(GLuint shader);
+typedef void(APIENTRY *ShaderGetShaderivProc)(GLuint shader, GLenum name, GLint *value);
+typedef void(APIENTRY *ShaderGetShaderInfoLogProc)(GLuint shader, GLsizei size, GLsizei *length, char *log);
+typedef void(APIENTRY *ShaderDeleteShaderProc)(GLuint shader);
+typedef GLuint(APIENTRY *ShaderCreateProgramProc)(void);
+typedef void(APIENTRY *ShaderAttachShaderProc)(GLuint program, GLuint shader);
+typedef void(APIENTRY *ShaderLinkProgramProc)(GLuint program);
+typedef void(APIENTRY *ShaderGetProgramivProc)(GLuint program, GLenum name, GLint *value);
+typedef void(APIENTRY *ShaderGetProgramInfoLogProc)(GLuint program, GLsizei size, GLsizei *length, char *log);
+typedef void(APIENTRY *ShaderDeleteProgramProc)(GLuint program);
+typedef void(APIENTRY *ShaderUseProgramProc)(GLuint program);
+typedef GLint(APIENTRY *ShaderGetUniformLocationProc)(GLuint program, const char *name);
+typedef void(APIENTRY *ShaderUniform1iProc)(GLint location, GLint v0);
+typedef void(APIENTRY *ShaderUniform1fProc)(GLint location, GLfloat v0);
+typedef void(APIENTRY *ShaderUniform2fProc)(GLint location, GLfloat v0, GLfloat v1);
+typedef void(APIENTRY *ShaderUniform3fProc)(GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
+typedef void(APIENTRY *ShaderUniformMatrix4fvProc)(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value);
+
+static ShaderCreateShaderProc shader_gl_create_shader;
+static ShaderShaderSourceProc shader_gl_shader_source;
+static ShaderCompileShaderProc shader_gl_compile_shader;
+static ShaderGetShaderivProc shader_gl_get_shaderiv;
+static ShaderGetShaderInfoLogProc shader_gl_get_shader_info_log;
+static ShaderDeleteShaderProc shader_gl_delete_shader;
+static ShaderCreateProgramProc shader_gl_create_program;
+static ShaderAttachShaderProc shader_gl_attach_shader;
+static ShaderLinkProgramProc shader_gl_link_program;
+static ShaderGetProgramivProc shader_gl_get_programiv;
+static ShaderGetProgramInfoLogProc shader_gl_get_program_info_log;
+static ShaderDeleteProgramProc shader_gl_delete_program;
+static ShaderUseProgramProc shader_gl_use_program;
+static ShaderGetUniformLocationProc shader_gl_get_uniform_location;
+static ShaderUniform1iProc shader_gl_uniform1i;
+static ShaderUniform1fProc shader_gl_uniform1f;
+static ShaderUniform2fProc shader_gl_uniform2f;
+static ShaderUniform3fProc shader_gl_uniform3f;
+static ShaderUniformMatrix4fvProc shader_gl_uniform_matrix4fv;
+
+/*
+ * 0 until checked, then 1 if shaders can be used, else -1.
+ */
+static int shader_support;
+
+/*
+ * Program last made current through shader_use.
+ */
+static unsigned int shader_current;
+
+/*
+ * Look up an entry point. Copied through memcpy, as ISO C has no
+ * conversion from an object pointer to a function pointer. Returns false
+ * if the driver does not have it.
+ */
+static bool shader_load_proc(void *out_proc, const char *name)
+{
+    void *proc = SDL_GL_GetProcAddress(name);
+    memcpy(out_proc, &proc, sizeof(proc));
+    return proc != NULL;
+}
+
+/*
+ * Version strings start with "major.minor", optionally followed by more.
+ */
+static bool shader_version_at_least(const char *version, int major, int minor)
+{
+    int have_major = 0;
+    int have_minor = 0;
+
+    if (!version || sscanf(version, "%d.%d", &have_major, &have_minor) != 2)
+        return false;
+
+    return have_major > major || (have_major == major && have_minor >= minor);
+}
+
+/*
+ * Load every entry point; any missing one disables shaders.
+ */
+bool shader_available(void)
+{
+    if (shader_support != 0)
+        return shader_support > 0;
+
+    shader_support = -1;
+
+    if (!shader_version_at_least((const char *)glGetString(GL_VERSION), 2, 0))
+        return false;
+
+    if (!shader_version_at_least((const char *)glGetString(GL_SHADING_LANGUAGE_VERSION), 1, 20))
+        return false;
+
+    bool ok = true;
+    ok = shader_load_proc(&shader_gl_create_shader, "glCreateShader") && ok;
+    ok = shader_load_proc(&shader_gl_shader_source, "glShaderSource") && ok;
+    ok = shader_load_proc(&shader_gl_compile_shader, "glCompileShader") && ok;
+    ok = shader_load_proc(&shader_gl_get_shaderiv, "glGetShaderiv") && ok;
+    ok = shader_load_proc(&shader_gl_get_shader_info_log, "glGetShaderInfoLog") && ok;
+    ok = shader_load_proc(&shader_gl_delete_shader, "glDeleteShader") && ok;
+    ok = shader_load_proc(&shader_gl_create_program, "glCreateProgram") && ok;
+    ok = shader_load_proc(&shader_gl_attach_shader, "glAttachShader") && ok;
+    ok = shader_load_proc(&shader_gl_link_program, "glLinkProgram") && ok;
+    ok = shader_load_proc(&shader_gl_get_programiv, "glGetProgramiv") && ok;
+    ok = shader_load_proc(&shader_gl_get_program_info_log, "glGetProgramInfoLog") && ok;
+    ok = shader_load_proc(&shader_gl_delete_program, "glDeleteProgram") && ok;
+    ok = shader_load_proc(&shader_gl_use_program, "glUseProgram") && ok;
+    ok = shader_load_proc(&shader_gl_get_uniform_location, "glGetUniformLocation") && ok;
+    ok = shader_load_proc(&shader_gl_uniform1i, "glUniform1i") && ok;
+    ok = shader_load_proc(&shader_gl_uniform1f, "glUniform1f") && ok;
+    ok = shader_load_proc(&shader_gl_uniform2f, "glUniform2f") && ok;
+    ok = shader_load_proc(&shader_gl_uniform3f, "glUniform3f") && ok;
+    ok = shader_load_proc(&shader_gl_uniform_matrix4fv, "glUniformMatrix4fv") && ok;
+
+    if (ok)
+        shader_support = 1;
+
+    return ok;
+}
+
+/*
+ * Print a shader or program info log, if there is one.
+ */
+static void shader_print_log(const char *name, const char *stage, GLuint object, bool program)
+{
+    GLint length = 0;
+    if (program)
+        shader_gl_get_programiv(object, GL_INFO_LOG_LENGTH, &length);
+    else
+        shader_gl_get_shaderiv(object, GL_INFO_LOG_LENGTH, &length);
+
+    if (length <= 1)
+        return;
+
+    char *log = malloc((size_t)length);
+    if (!log)
+        return;
+
+    if (program)
+        shader_gl_get_program_info_log(object, length, NULL, log);
+    else
+        shader_gl_get_shader_info_log(object, length, NULL, log);
+
+    fprintf(stderr, "%s %s:\n%s\n", name, stage, log);
+    free(log);
+}
+
+/*
+ * Compile one stage. Returns the shader, or 0 on failure.
+ */
+static GLuint shader_compile(const char *name, GLenum type, const char *source)
+{
+    GLuint shader = shader_gl_create_shader(type);
+    if (!shader)
+        return 0;
+
+    shader_gl_shader_source(shader, 1, &source, NULL);
+    shader_gl_compile_shader(shader);
+
+    GLint status = GL_FALSE;
+    shader_gl_get_shaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE)
+    {
+        shader_print_log(name, type == GL_VERTEX_SHADER ? "vertex shader" : "fragment shader", shader, false);
+        shader_gl_delete_shader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+/*
+ * The shaders are flagged for deletion right after linking; the program
+ * keeps them alive.
+ */
+unsigned int shader_build(const char *name, const char *vertex_source, const char *fragment_source)
+{
+    if (!shader_available())
+        return 0;
+
+    GLuint vertex = shader_compile(name, GL_VERTEX_SHADER, vertex_source);
+    GLuint fragment = shader_compile(name, GL_FRAGMENT_SHADER, fragment_source);
+
+    GLuint program = 0;
+    if (vertex && fragment)
+        program = shader_gl_create_program();
+
+    if (program)
+    {
+        shader_gl_attach_shader(program, vertex);
+        shader_gl_attach_shader(program, fragment);
+        shader_gl_link_program(program);
+
+        GLint status = GL_FALSE;
+        shader_gl_get_programiv(program, GL_LINK_STATUS, &status);
+        if (status != GL_TRUE)
+        {
+            shader_print_log(name, "link", program, true);
+            shader_gl_delete_program(program);
+            program = 0;
+        }
+    }
+
+    if (vertex)
+        shader_gl_delete_shader(vertex);
+    if (fragment)
+        shader_gl_delete_shader(fragment);
+
+    return program;
+}
+
+/*
+ * Skip the call when the program is already current.
+ */
+void shader_use(unsigned int program)
+{
+    if (program == shader_current || shader_support <= 0)
+        return;
+
+    shader_gl_use_program(program);
+    shader_current = program;
+    stats_add(STAT_STATE_CHANGES, 1);
+}
+
+/*
+ * Look up a uniform by name.
+ */
+int shader_uniform(unsigned int program, const char *name)
+{
+    if (!program || shader_support <= 0)
+        return -1;
+
+    return shader_gl_get_uniform_location(program, name);
+}
+
+/*
+ * Uniform setters. GL ignores -1 itself, but the check also keeps them
+ * safe to call when shaders are not available.
+ */
+void shader_set_int(int location, int value)
+{
+    if (location >= 0)
+        shader_gl_uniform1i(location, value);
+}
+
+void shader_set_float(int location, float value)
+{
+    if (location >= 0)
+        shader_gl_uniform1f(location, value);
+}
+
+void shader_set_vec2(int location, float x, float y)
+{
+    if (location >= 0)
+        shader_gl_uniform2f(location, x, y);
+}
+
+void shader_set_vec3(int location, float x, float y, float z)
+{
+    if (location >= 0)
+        shader_gl_uniform3f(location, x, y, z);
+}
+
+void shader_set_mat4(int location, int count, const float *matrices)
+{
+    if (location >= 0)
+        shader_gl_uniform_matrix4fv(location, count, GL_FALSE, matrices);
+}
+
+/*
+ * Delete a program, leaving fixed function current if it was in use.
+ */
+void shader_delete(unsigned int program)
+{
+    if (!program || shader_support <= 0)
+        return;
+
+    if (program == shader_current)
+        shader_use(0);
+
+    shader_gl_delete_program(program);
+}
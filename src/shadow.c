@@ -0,0 +1,666 @@
+#include "shadow.h"
+#include "renderer.h"
+#include "shader.h"
+#include "stats.h"
+#include "texture.h"
+
+#include <GL/gl.h>
+#include <SDL2/SDL.h>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Tokens missing from the OpenGL 1.1 headers shipped on Windows.
+ */
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+#ifndef GL_DEPTH_COMPONENT24
+#define GL_DEPTH_COMPONENT24 0x81A6
+#endif
+#ifndef GL_TEXTURE_COMPARE_MODE
+#define GL_TEXTURE_COMPARE_MODE 0x884C
+#endif
+#ifndef GL_TEXTURE_COMPARE_FUNC
+#define GL_TEXTURE_COMPARE_FUNC 0x884D
+#endif
+#ifndef GL_COMPARE_R_TO_TEXTURE
+#define GL_COMPARE_R_TO_TEXTURE 0x884E
+#endif
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER 0x8D40
+#endif
+#ifndef GL_DEPTH_ATTACHMENT
+#define GL_DEPTH_ATTACHMENT 0x8D00
+#endif
+#ifndef GL_FRAMEBUFFER_COMPLETE
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+/*
+ * Framebuffer object entry points: core in OpenGL 3.0 and
+ * ARB_framebuffer_object, with an EXT suffix in EXT_framebuffer_object.
+ * The tokens are the same.
+ */
+typedef void(APIENTRY *ShadowGenFramebuffersProc)(GLsizei n, GLuint *framebuffers);
+typedef void(APIENTRY *ShadowDeleteFramebuffersProc)(GLsizei n, const GLuint *framebuffers);
+typedef void(APIENTRY *ShadowBindFramebufferProc)(GLenum target, GLuint framebuffer);
+typedef void(APIENTRY *ShadowFramebufferTexture2DProc)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+typedef GLenum(APIENTRY *ShadowCheckFramebufferStatusProc)(GLenum target);
+
+static ShadowGenFramebuffersProc shadow_gl_gen_framebuffers;
+static ShadowDeleteFramebuffersProc shadow_gl_delete_framebuffers;
+static ShadowBindFramebufferProc shadow_gl_bind_framebuffer;
+static ShadowFramebufferTexture2DProc shadow_gl_framebuffer_texture_2d;
+static ShadowCheckFramebufferStatusProc shadow_gl_check_framebuffer_status;
+
+/*
+ * Blend between logarithmic (1) and even (0) cascade splits.
+ */
+#define SHADOW_SPLIT_LAMBDA 0.75f
+
+/*
+ * Casters reach at most this high above the ground; with the ground size
+ * it bounds the depth range of every cascade.
+ */
+#define SHADOW_SCENE_HEIGHT 40.0f
+
+/*
+ * Slope-scaled depth offset applied while rendering casters, against
+ * surfaces shadowing themselves.
+ */
+#define SHADOW_OFFSET_FACTOR 2.0f
+#define SHADOW_OFFSET_UNITS 4.0f
+
+/*
+ * The two maps: static and dynamic casters.
+ */
+#define SHADOW_MAP_STATIC 0
+#define SHADOW_MAP_DYNAMIC 1
+#define SHADOW_MAP_COUNT 2
+
+/*
+ * The static map of a cascade covers this many times the cascade radius,
+ * so the camera can move by the difference before it has to be drawn
+ * again. Static shadows lose the same factor in resolution.
+ */
+#define SHADOW_STATIC_SCALE 1.5f
+
+/*
+ * Region the static map of a cascade was last rendered for. While the
+ * cascade stays inside it and the light and the scene layout do not
+ * change, the static casters are not drawn again.
+ */
+typedef struct ShadowCascadeKey
+{
+    bool valid;
+    float x;
+    float y;
+    float radius;
+    float dir[3];
+    uint32_t revision;
+} ShadowCascadeKey;
+
+static bool shadow_ready;
+static GLuint shadow_framebuffers[SHADOW_MAP_COUNT];
+static GLuint shadow_maps[SHADOW_MAP_COUNT];
+static ShadowCascadeKey shadow_keys[SHADOW_CASCADES];
+static ShadowCascades shadow_result;
+
+/*
+ * Framebuffer and cascade rectangle as last set by shadow_render, so the
+ * switches only send changes.
+ */
+static GLuint shadow_bound_framebuffer;
+static int shadow_bound_cascade = -1;
+
+/*
+ * Look up name followed by suffix. Copied through memcpy, as ISO C has no
+ * conversion from an object pointer to a function pointer.
+ */
+static bool shadow_load_proc(void *out_proc, const char *name, const char *suffix)
+{
+    char full[64];
+    snprintf(full, sizeof(full), "%s%s", name, suffix);
+
+    void *proc = SDL_GL_GetProcAddress(full);
+    memcpy(out_proc, &proc, sizeof(proc));
+    return proc != NULL;
+}
+
+/*
+ * Load the framebuffer object entry points under whichever names the
+ * driver has them.
+ */
+static bool shadow_load_framebuffer_procs(void)
+{
+    int major = 0;
+    const char *version = (const char *)glGetString(GL_VERSION);
+    if (version)
+        sscanf(version, "%d", &major);
+
+    const char *suffix;
+    if (major >= 3 || SDL_GL_ExtensionSupported("GL_ARB_framebuffer_object"))
+        suffix = "";
+    else if (SDL_GL_ExtensionSupported("GL_EXT_framebuffer_object"))
+        suffix = "EXT";
+    else
+        return false;
+
+    bool ok = true;
+    ok = shadow_load_proc(&shadow_gl_gen_framebuffers, "glGenFramebuffers", suffix) && ok;
+    ok = shadow_load_proc(&shadow_gl_delete_framebuffers, "glDeleteFramebuffers", suffix) && ok;
+    ok = shadow_load_proc(&shadow_gl_bind_framebuffer, "glBindFramebuffer", suffix) && ok;
+    ok = shadow_load_proc(&shadow_gl_framebuffer_texture_2d, "glFramebufferTexture2D", suffix) && ok;
+    ok = shadow_load_proc(&shadow_gl_check_framebuffer_status, "glCheckFramebufferStatus", suffix) && ok;
+    return ok;
+}
+
+/*
+ * One depth texture holding every cascade side by side, compared against
+ * the looked-up depth with bilinear filtering, and a framebuffer drawing
+ * into it.
+ */
+static bool shadow_create_map(int map)
+{
+    glGenTextures(1, &shadow_maps[map]);
+    texture_bind(shadow_maps[map]);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24,
+                 SHADOW_MAP_SIZE * SHADOW_CASCADES, SHADOW_MAP_SIZE, 0,
+                 GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    texture_bind(0);
+
+    shadow_gl_gen_framebuffers(1, &shadow_framebuffers[map]);
+    shadow_gl_bind_framebuffer(GL_FRAMEBUFFER, shadow_framebuffers[map]);
+    shadow_gl_framebuffer_texture_2d(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, shadow_maps[map], 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    bool complete = shadow_gl_check_framebuffer_status(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    shadow_gl_bind_framebuffer(GL_FRAMEBUFFER, 0);
+    return complete;
+}
+
+/*
+ * Depth textures and the comparison are core since OpenGL 1.4, well
+ * below what the scene shader needs.
+ */
+bool shadow_init(void)
+{
+    if (shadow_ready)
+        return true;
+
+    if (!shader_available())
+    {
+        fprintf(stderr, "Shadows need GLSL 1.20, drawing without them.\n");
+        return false;
+    }
+
+    if (!texture_shader_units_available())
+    {
+        fprintf(stderr, "Shadow maps need %d texture units, drawing without shadows.\n", TEXTURE_UNITS);
+        return false;
+    }
+
+    GLint max_texture_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    if (max_texture_size < SHADOW_MAP_SIZE * SHADOW_CASCADES)
+    {
+        fprintf(stderr, "Shadow maps of %d pixels are not supported, drawing without shadows.\n",
+                SHADOW_MAP_SIZE * SHADOW_CASCADES);
+        return false;
+    }
+
+    if (!shadow_load_framebuffer_procs())
+    {
+        fprintf(stderr, "Framebuffer objects are not available, drawing without shadows.\n");
+        return false;
+    }
+
+    shadow_ready = true;
+
+    for (int map = 0; map < SHADOW_MAP_COUNT; map++)
+    {
+        if (!shadow_create_map(map))
+        {
+            fprintf(stderr, "Shadow map framebuffer is incomplete, drawing without shadows.\n");
+            shadow_shutdown();
+            return false;
+        }
+    }
+
+    memset(shadow_keys, 0, sizeof(shadow_keys));
+    shadow_result.static_map = shadow_maps[SHADOW_MAP_STATIC];
+    shadow_result.dynamic_map = shadow_maps[SHADOW_MAP_DYNAMIC];
+
+    printf("Shadows: %d cascades of %dx%d up to %.0f units\n",
+           SHADOW_CASCADES, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, (double)SHADOW_DISTANCE);
+    return true;
+}
+
+/*
+ * The maps are unbound from the shadow units first, so the bind cache
+ * never holds a deleted name.
+ */
+void shadow_shutdown(void)
+{
+    if (!shadow_ready)
+        return;
+
+    if (texture_select_unit(TEXTURE_UNIT_SHADOW_STATIC))
+        texture_bind(0);
+    if (texture_select_unit(TEXTURE_UNIT_SHADOW_DYNAMIC))
+        texture_bind(0);
+    texture_select_unit(0);
+
+    for (int map = 0; map < SHADOW_MAP_COUNT; map++)
+    {
+        if (shadow_framebuffers[map])
+            shadow_gl_delete_framebuffers(1, &shadow_framebuffers[map]);
+        if (shadow_maps[map])
+            glDeleteTextures(1, &shadow_maps[map]);
+
+        shadow_framebuffers[map] = 0;
+        shadow_maps[map] = 0;
+    }
+
+    shadow_ready = false;
+}
+
+/*
+ * out = a * b, all column-major.
+ */
+static void shadow_multiply(float *out, const float *a, const float *b)
+{
+    float m[16];
+
+    for (int c = 0; c < 4; c++)
+    {
+        for (int r = 0; r < 4; r++)
+        {
+            m[c * 4 + r] = a[0 * 4 + r] * b[c * 4 + 0] +
+                           a[1 * 4 + r] * b[c * 4 + 1] +
+                           a[2 * 4 + r] * b[c * 4 + 2] +
+                           a[3 * 4 + r] * b[c * 4 + 3];
+        }
+    }
+
+    memcpy(out, m, sizeof(m));
+}
+
+/*
+ * Inverse of a view matrix made of rotations and a translation only, as
+ * camera_apply_view builds it.
+ */
+static void shadow_invert_view(float *out, const float *m)
+{
+    memset(out, 0, 16 * sizeof(float));
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+            out[j * 4 + i] = m[i * 4 + j];
+
+        out[12 + i] = -(m[i * 4 + 0] * m[12] + m[i * 4 + 1] * m[13] + m[i * 4 + 2] * m[14]);
+    }
+
+    out[15] = 1.0f;
+}
+
+/*
+ * Light view: a rotation only, with z pointing at the light, so that the
+ * light looks down -z like a GL camera. The origin stays at the world
+ * origin, which keeps snapped cascade positions comparable across frames.
+ */
+static void shadow_light_view(float *out, const float *dir)
+{
+    float ref[3] = {0.0f, 0.0f, 1.0f};
+    if (fabsf(dir[2]) > 0.9f)
+    {
+        ref[1] = 1.0f;
+        ref[2] = 0.0f;
+    }
+
+    /* right = normalize(ref x dir), up = dir x right */
+    float rx = ref[1] * dir[2] - ref[2] * dir[1];
+    float ry = ref[2] * dir[0] - ref[0] * dir[2];
+    float rz = ref[0] * dir[1] - ref[1] * dir[0];
+    float len = sqrtf(rx * rx + ry * ry + rz * rz);
+    rx /= len;
+    ry /= len;
+    rz /= len;
+
+    float ux = dir[1] * rz - dir[2] * ry;
+    float uy = dir[2] * rx - dir[0] * rz;
+    float uz = dir[0] * ry - dir[1] * rx;
+
+    memset(out, 0, 16 * sizeof(float));
+    out[0] = rx;
+    out[4] = ry;
+    out[8] = rz;
+    out[1] = ux;
+    out[5] = uy;
+    out[9] = uz;
+    out[2] = dir[0];
+    out[6] = dir[1];
+    out[10] = dir[2];
+    out[15] = 1.0f;
+}
+
+/*
+ * Orthographic projection, as glOrtho builds it.
+ */
+static void shadow_ortho(float *out, float l, float r, float b, float t, float n, float f)
+{
+    memset(out, 0, 16 * sizeof(float));
+    out[0] = 2.0f / (r - l);
+    out[5] = 2.0f / (t - b);
+    out[10] = -2.0f / (f - n);
+    out[12] = -(r + l) / (r - l);
+    out[13] = -(t + b) / (t - b);
+    out[14] = -(f + n) / (f - n);
+    out[15] = 1.0f;
+}
+
+/*
+ * View depths where the cascades start and end: a blend of logarithmic
+ * and even splits between the near plane and SHADOW_DISTANCE.
+ */
+static void shadow_splits(float *splits)
+{
+    const float n = RENDERER_Z_NEAR;
+    const float f = SHADOW_DISTANCE;
+
+    splits[0] = n;
+    for (int i = 1; i <= SHADOW_CASCADES; i++)
+    {
+        float t = (float)i / (float)SHADOW_CASCADES;
+        float log_split = n * powf(f / n, t);
+        float even_split = n + (f - n) * t;
+        splits[i] = SHADOW_SPLIT_LAMBDA * log_split + (1.0f - SHADOW_SPLIT_LAMBDA) * even_split;
+    }
+}
+
+/*
+ * Depth range of the scene along the light direction: the extremes of
+ * the ground square up to SHADOW_SCENE_HEIGHT. The same for every
+ * cascade and frame, so only the x-y position of a cascade decides
+ * whether its static map is still valid.
+ */
+static void shadow_scene_depth(const Scene *scene, const float *dir, float *out_near, float *out_far)
+{
+    float h = scene->ground_half_size;
+    float lo = 0.0f;
+    float hi = 0.0f;
+
+    for (int i = 0; i < 8; i++)
+    {
+        float x = (i & 1) ? h : -h;
+        float y = (i & 2) ? h : -h;
+        float z = (i & 4) ? SHADOW_SCENE_HEIGHT : 0.0f;
+        float d = x * dir[0] + y * dir[1] + z * dir[2];
+
+        if (i == 0 || d < lo)
+            lo = d;
+        if (i == 0 || d > hi)
+            hi = d;
+    }
+
+    /* The light looks down -z, so the nearest point has the largest z */
+    *out_near = -hi - 1.0f;
+    *out_far = -lo + 1.0f;
+}
+
+/*
+ * Bounding sphere of the frustum slice between two view depths: centered
+ * on the view axis, which keeps its radius constant as the camera turns.
+ * The radius is rounded up to a whole unit so it does not jitter either.
+ */
+static float shadow_slice_sphere(float near_depth, float far_depth, float aspect, float *center_depth)
+{
+    float tan_half = tanf(RENDERER_FOV_Y * 0.5f * (float)M_PI / 180.0f);
+    float center = (near_depth + far_depth) * 0.5f;
+    float radius = 0.0f;
+
+    float depths[2] = {near_depth, far_depth};
+    for (int i = 0; i < 2; i++)
+    {
+        float hh = depths[i] * tan_half;
+        float hw = hh * aspect;
+        float dz = depths[i] - center;
+        float r = sqrtf(hw * hw + hh * hh + dz * dz);
+        if (r > radius)
+            radius = r;
+    }
+
+    *center_depth = center;
+    return ceilf(radius);
+}
+
+/*
+ * Draw into a map's framebuffer, or 0 for the window.
+ */
+static void shadow_bind_framebuffer(GLuint framebuffer)
+{
+    if (framebuffer == shadow_bound_framebuffer)
+        return;
+
+    shadow_gl_bind_framebuffer(GL_FRAMEBUFFER, framebuffer);
+    shadow_bound_framebuffer = framebuffer;
+    stats_add(STAT_STATE_CHANGES, 1);
+}
+
+/*
+ * Viewport and scissor on one cascade's third of the maps.
+ */
+static void shadow_select_cascade(int cascade)
+{
+    if (cascade == shadow_bound_cascade)
+        return;
+
+    glViewport(cascade * SHADOW_MAP_SIZE, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
+    glScissor(cascade * SHADOW_MAP_SIZE, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
+    shadow_bound_cascade = cascade;
+    stats_add(STAT_STATE_CHANGES, 1);
+}
+
+/*
+ * Enter or leave map drawing: scissored to the cascade, depth offset
+ * against acne, no blending. Leaving restores the window's viewport,
+ * scissor and framebuffer.
+ */
+static void shadow_set_pass_state(bool enabled)
+{
+    if (enabled)
+    {
+        glPushAttrib(GL_VIEWPORT_BIT | GL_SCISSOR_BIT);
+        glEnable(GL_SCISSOR_TEST);
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(SHADOW_OFFSET_FACTOR, SHADOW_OFFSET_UNITS);
+        renderer_set_blending(false);
+    }
+    else
+    {
+        shadow_bind_framebuffer(0);
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glPopAttrib();
+        shadow_bound_cascade = -1;
+    }
+
+    stats_add(STAT_STATE_CHANGES, 1);
+}
+
+/*
+ * Clear one cascade of a map and draw the casters of a group that fall
+ * inside the box into it, seen through the box's orthographic projection.
+ */
+static void shadow_draw_cascade(int map, int cascade, const Scene *scene, SceneCasters casters, float alpha,
+                                const SceneCasterBox *box, float depth_near, float depth_far)
+{
+    float projection[16];
+    shadow_ortho(projection, box->min_x, box->max_x, box->min_y, box->max_y, depth_near, depth_far);
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixf(projection);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadMatrixf(box->light_view);
+
+    shadow_bind_framebuffer(shadow_framebuffers[map]);
+    shadow_select_cascade(cascade);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    scene_render_casters(scene, casters, alpha, box);
+}
+
+/*
+ * Whether the static map of a cascade still holds the static casters for
+ * a cascade square at (lx, ly) with the given radius.
+ */
+static bool shadow_static_valid(const ShadowCascadeKey *key, float lx, float ly, float radius, const float *dir,
+                                uint32_t revision)
+{
+    if (!key->valid || key->revision != revision || key->radius != radius * SHADOW_STATIC_SCALE)
+        return false;
+
+    if (key->dir[0] != dir[0] || key->dir[1] != dir[1] || key->dir[2] != dir[2])
+        return false;
+
+    return lx - radius >= key->x - key->radius && lx + radius <= key->x + key->radius &&
+           ly - radius >= key->y - key->radius && ly + radius <= key->y + key->radius;
+}
+
+/*
+ * Each cascade covers the bounding sphere of its frustum slice. The
+ * sphere center is snapped to whole shadow map texels in light space, so
+ * the map content only shifts by whole texels as the camera moves and
+ * shadow edges stay still. The static map covers a larger square that
+ * stays put until the cascade leaves it; static_fit takes the cascade's
+ * map coordinates into that square.
+ */
+const ShadowCascades *shadow_render(const Scene *scene, const float *view, float alpha)
+{
+    if (!shadow_ready)
+        return NULL;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    float aspect = viewport[3] > 0 ? (float)viewport[2] / (float)viewport[3] : 1.0f;
+
+    float inverse_view[16];
+    shadow_invert_view(inverse_view, view);
+
+    float dir[3];
+    renderer_light_direction(dir);
+
+    float light_view[16];
+    shadow_light_view(light_view, dir);
+
+    float depth_near;
+    float depth_far;
+    shadow_scene_depth(scene, dir, &depth_near, &depth_far);
+
+    float splits[SHADOW_CASCADES + 1];
+    shadow_splits(splits);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+
+    shader_use(0);
+    shadow_set_pass_state(true);
+
+    for (int i = 0; i < SHADOW_CASCADES; i++)
+    {
+        float center_depth;
+        float radius = shadow_slice_sphere(splits[i], splits[i + 1], aspect, &center_depth);
+
+        /* Sphere center: on the view axis, taken to world space */
+        float cx = inverse_view[12] - inverse_view[8] * center_depth;
+        float cy = inverse_view[13] - inverse_view[9] * center_depth;
+        float cz = inverse_view[14] - inverse_view[10] * center_depth;
+
+        float lx = light_view[0] * cx + light_view[4] * cy + light_view[8] * cz;
+        float ly = light_view[1] * cx + light_view[5] * cy + light_view[9] * cz;
+
+        float texel = 2.0f * radius / (float)SHADOW_MAP_SIZE;
+        lx = floorf(lx / texel) * texel;
+        ly = floorf(ly / texel) * texel;
+
+        ShadowCascadeKey *key = &shadow_keys[i];
+        if (!shadow_static_valid(key, lx, ly, radius, dir, scene->static_revision))
+        {
+            float static_radius = radius * SHADOW_STATIC_SCALE;
+            float static_texel = 2.0f * static_radius / (float)SHADOW_MAP_SIZE;
+
+            key->valid = true;
+            key->x = floorf(lx / static_texel) * static_texel;
+            key->y = floorf(ly / static_texel) * static_texel;
+            key->radius = static_radius;
+            key->dir[0] = dir[0];
+            key->dir[1] = dir[1];
+            key->dir[2] = dir[2];
+            key->revision = scene->static_revision;
+
+            SceneCasterBox static_box = {light_view, key->x - key->radius, key->x + key->radius,
+                                         key->y - key->radius, key->y + key->radius};
+            shadow_draw_cascade(SHADOW_MAP_STATIC, i, scene, SCENE_CASTERS_STATIC, alpha, &static_box,
+                                depth_near, depth_far);
+            stats_add(STAT_STATIC_SHADOW_PASSES, 1);
+        }
+
+        SceneCasterBox box = {light_view, lx - radius, lx + radius, ly - radius, ly + radius};
+        shadow_draw_cascade(SHADOW_MAP_DYNAMIC, i, scene, SCENE_CASTERS_DYNAMIC, alpha, &box, depth_near, depth_far);
+
+        float projection[16];
+        shadow_ortho(projection, lx - radius, lx + radius, ly - radius, ly + radius, depth_near, depth_far);
+
+        /* Both squares share the light view and depth range, so only x and y scale and shift */
+        float scale = radius / key->radius;
+        float *fit = shadow_result.static_fit[i];
+        fit[0] = scale;
+        fit[1] = ((float)i * (1.0f - scale) + (lx - radius - key->x + key->radius) / (2.0f * key->radius)) /
+                 (float)SHADOW_CASCADES;
+        fit[2] = (ly - radius - key->y + key->radius) / (2.0f * key->radius);
+
+        /* Clip space to this cascade's third of the map, depth to [0, 1] */
+        float bias[16] = {0};
+        bias[0] = 0.5f / (float)SHADOW_CASCADES;
+        bias[5] = 0.5f;
+        bias[10] = 0.5f;
+        bias[12] = (0.5f + (float)i) / (float)SHADOW_CASCADES;
+        bias[13] = 0.5f;
+        bias[14] = 0.5f;
+        bias[15] = 1.0f;
+
+        float *m = shadow_result.eye_to_map[i];
+        shadow_multiply(m, bias, projection);
+        shadow_multiply(m, m, light_view);
+        shadow_multiply(m, m, inverse_view);
+
+        shadow_result.split_far[i] = splits[i + 1];
+    }
+
+    shadow_set_pass_state(false);
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+
+    return &shadow_result;
+}
@@ -0,0 +1,123 @@
+#include "stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool stats_enabled = false;
+uint32_t stats_counters[STAT_COUNT];
+
+/*
+ * Counters of the last completed frame and the frame time ring.
+ */
+static uint32_t stats_last_counters[STAT_COUNT];
+static float stats_history[STATS_HISTORY];
+static int stats_history_pos;
+static int stats_history_count;
+
+/*
+ * Reset everything when counting is switched on, so the overlay never
+ * shows numbers from before it was opened.
+ */
+void stats_set_enabled(bool enabled)
+{
+    if (enabled && !stats_enabled)
+    {
+        memset(stats_counters, 0, sizeof(stats_counters));
+        memset(stats_last_counters, 0, sizeof(stats_last_counters));
+        stats_history_pos = 0;
+        stats_history_count = 0;
+    }
+
+    stats_enabled = enabled;
+}
+
+/*
+ * Snapshot and clear the counters and record the frame time.
+ */
+void stats_end_frame(float frame_ms)
+{
+    if (!stats_enabled)
+        return;
+
+    memcpy(stats_last_counters, stats_counters, sizeof(stats_counters));
+    memset(stats_counters, 0, sizeof(stats_counters));
+
+    stats_history[stats_history_pos] = frame_ms;
+    stats_history_pos = (stats_history_pos + 1) % STATS_HISTORY;
+    if (stats_history_count < STATS_HISTORY)
+        stats_history_count++;
+}
+
+/*
+ * Read one snapshot counter.
+ */
+uint32_t stats_last(StatCounter counter)
+{
+    if (counter < 0 || counter >= STAT_COUNT)
+        return 0;
+
+    return stats_last_counters[counter];
+}
+
+/*
+ * Names in StatCounter order.
+ */
+const char *stats_counter_name(StatCounter counter)
+{
+    static const char *names[STAT_COUNT] = {
+        "draw calls",
+        "vertices",
+        "state changes",
+        "collision queries",
+        "static shadows"};
+
+    if (counter < 0 || counter >= STAT_COUNT)
+        return "?";
+
+    return names[counter];
+}
+
+/*
+ * Unroll the ring into chronological order.
+ */
+int stats_frame_history(float *out)
+{
+    int oldest = (stats_history_pos + STATS_HISTORY - stats_history_count) % STATS_HISTORY;
+
+    for (int i = 0; i < stats_history_count; i++)
+        out[i] = stats_history[(oldest + i) % STATS_HISTORY];
+
+    return stats_history_count;
+}
+
+/*
+ * qsort comparison for ascending floats.
+ */
+static int compare_float(const void *a, const void *b)
+{
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Nearest-rank percentile over a sorted copy of the history. Sorting 240
+ * floats once per overlay frame is cheap next to drawing the overlay.
+ */
+float stats_frame_percentile(float p)
+{
+    float sorted[STATS_HISTORY];
+    int n = stats_frame_history(sorted);
+    if (n == 0)
+        return 0.0f;
+
+    qsort(sorted, (size_t)n, sizeof(float), compare_float);
+
+    int rank = (int)(p / 100.0f * (float)n + 0.999f) - 1;
+    if (rank < 0)
+        rank = 0;
+    if (rank >= n)
+        rank = n - 1;
+
+    return sorted[rank];
+}
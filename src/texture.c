@@ -1,39 +1,606 @@
 #include "texture.h"
+#include "stats.h"
 
 #include <GL/gl.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 
 /*
- * Convert SDL surface pixel format to an OpenGL format.
- * (Currently always returns RGBA, since we convert everything to ABGR8888.)
+ * Extension tokens missing from the OpenGL 1.1 headers shipped on Windows.
  */
-static GLenum surface_format_to_gl(const SDL_PixelFormat *fmt)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_TEXTURE_COMPRESSED_IMAGE_SIZE
+#define GL_TEXTURE_COMPRESSED_IMAGE_SIZE 0x86A0
+#endif
+#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
+#endif
+#ifndef GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
+#endif
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+#ifndef GL_TEXTURE_BASE_LEVEL
+#define GL_TEXTURE_BASE_LEVEL 0x813C
+#endif
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_WRITE_ONLY
+#define GL_WRITE_ONLY 0x88B9
+#endif
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0 0x84C0
+#endif
+#ifndef GL_MAX_TEXTURE_UNITS
+#define GL_MAX_TEXTURE_UNITS 0x84E2
+#endif
+#ifndef GL_MAX_TEXTURE_COORDS
+#define GL_MAX_TEXTURE_COORDS 0x8871
+#endif
+#ifndef GL_MAX_TEXTURE_IMAGE_UNITS
+#define GL_MAX_TEXTURE_IMAGE_UNITS 0x8872
+#endif
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+/*
+ * Multitexture entry points (OpenGL 1.3 / ARB_multitexture).
+ */
+typedef void(APIENTRY *TextureActiveTextureProc)(GLenum unit);
+
+/*
+ * Buffer object entry points (OpenGL 1.5 / ARB_vertex_buffer_object),
+ * loaded at run time because the Windows headers stop at OpenGL 1.1.
+ */
+typedef void(APIENTRY *TextureGenBuffersProc)(GLsizei n, GLuint *buffers);
+typedef void(APIENTRY *TextureDeleteBuffersProc)(GLsizei n, const GLuint *buffers);
+typedef void(APIENTRY *TextureBindBufferProc)(GLenum target, GLuint buffer);
+typedef void(APIENTRY *TextureBufferDataProc)(GLenum target, ptrdiff_t size, const void *data, GLenum usage);
+typedef void *(APIENTRY *TextureMapBufferProc)(GLenum target, GLenum access);
+typedef GLboolean(APIENTRY *TextureUnmapBufferProc)(GLenum target);
+
+/*
+ * Highest anisotropy requested. Beyond 8 the gain on ground-level views
+ * of the zoo is small and the sampling cost keeps growing.
+ */
+#define TEXTURE_MAX_ANISOTROPY 8.0f
+
+static bool texture_compression = true;
+
+/*
+ * Whether the driver supports S3TC: 0 until checked, then 1 or -1. The
+ * extension string does not change for the lifetime of the context.
+ */
+static int texture_s3tc;
+static bool texture_disk_cache = true;
+static bool texture_streaming = false;
+
+/*
+ * Converted image file written next to each source image: a fixed header,
+ * then the RGBA8 mip chain exactly as texture_create uploads it, starting
+ * on the first multiple of TEXTURE_FILE_ALIGN after the header. Fields are
+ * in the byte order of the machine that wrote it; a file from another
+ * machine fails the magic check and is simply rebuilt.
+ */
+#define TEXTURE_FILE_SUFFIX ".mzt"
+#define TEXTURE_FILE_MAGIC 0x58545A4Du /* "MZTX" read as little-endian */
+#define TEXTURE_FILE_VERSION 1u
+#define TEXTURE_FILE_ALIGN 64
+
+/*
+ * Header of a converted image file.
+ *
+ * source_size   - size of the source file when it was converted
+ * source_mtime  - modification time of the source file then
+ * hash          - hash of the source file contents, for the texture cache
+ * data_size     - bytes of pixel data after the header
+ * level_*       - mip chain layout, offsets relative to the pixel data
+ */
+typedef struct TextureFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t level_count;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t hash;
+    uint64_t data_size;
+    uint32_t opaque;
+    uint32_t reserved;
+    uint64_t level_offset[TEXTURE_MAX_LEVELS];
+    uint32_t level_width[TEXTURE_MAX_LEVELS];
+    uint32_t level_height[TEXTURE_MAX_LEVELS];
+} TextureFileHeader;
+
+/*
+ * Start of the pixel data: the header rounded up to the alignment.
+ */
+#define TEXTURE_FILE_DATA_OFFSET \
+    ((sizeof(TextureFileHeader) + TEXTURE_FILE_ALIGN - 1) / TEXTURE_FILE_ALIGN * TEXTURE_FILE_ALIGN)
+
+/*
+ * Texture last bound through texture_bind on each unit, and the unit
+ * selected. Every bind in the program goes through this file, so they
+ * always match the GL state.
+ */
+static unsigned int texture_bound[TEXTURE_UNITS];
+static int texture_unit;
+
+/*
+ * Whether more than one texture unit can be used: 0 until checked, then
+ * 1 or -1.
+ */
+static int texture_multitexture;
+
+/*
+ * Whether shaders can use all TEXTURE_UNITS units: 0 until checked, then
+ * 1 or -1.
+ */
+static int texture_shader_units;
+static TextureActiveTextureProc texture_gl_active_texture;
+static TextureActiveTextureProc texture_gl_client_active_texture;
+
+/*
+ * Longest canonical path kept by the texture cache.
+ */
+#define TEXTURE_PATH_MAX 512
+
+/*
+ * One shared texture.
+ *
+ * path         - canonical path it was first loaded from
+ * hash         - hash of the file contents, unknown while streaming
+ * format       - internal format the image was uploaded in
+ * image_bytes  - size of the decoded RGBA8 mip chain
+ * texture      - the texture handed out to every user
+ * refs         - number of handles not yet freed
+ * streaming    - still a placeholder with its levels on the way
+ * stream_hits  - hits while streaming, counted as saved once it finishes
+ */
+typedef struct TextureCacheEntry
+{
+    char path[TEXTURE_PATH_MAX];
+    uint64_t hash;
+    GLenum format;
+    size_t image_bytes;
+    Texture2D texture;
+    int refs;
+    bool streaming;
+    int stream_hits;
+} TextureCacheEntry;
+
+/*
+ * Another canonical path that loaded the same contents as a cached
+ * texture, so loading it again needs no decode.
+ *
+ * path  - canonical path of the copy
+ * id    - texture object of the entry it shares
+ */
+typedef struct TextureCacheAlias
+{
+    char path[TEXTURE_PATH_MAX];
+    unsigned int id;
+} TextureCacheAlias;
+
+/*
+ * A texture being streamed in.
+ *
+ * path      - source file
+ * id        - texture object the levels go into
+ * image     - decoded image, valid once decoded is set and ok is true
+ * thread    - decoding thread, NULL once joined
+ * decoded   - set by the decoding thread when it is done
+ * ok        - whether decoding succeeded
+ * started   - level storage has been set up for the image
+ * level     - level being uploaded; levels above it are resident
+ * row       - next row of that level to upload
+ * format    - internal format of the levels
+ * bytes     - video memory of the resident levels
+ * next      - next stream in request order
+ */
+typedef struct TextureStream
+{
+    char path[TEXTURE_PATH_MAX];
+    unsigned int id;
+    TextureImage image;
+    SDL_Thread *thread;
+    SDL_atomic_t decoded;
+    bool ok;
+    bool started;
+    int level;
+    int row;
+    GLenum format;
+    size_t bytes;
+    struct TextureStream *next;
+} TextureStream;
+
+/*
+ * Streams in request order, and the pixel unpack buffer they upload
+ * through. Only used from the thread that owns the GL context.
+ */
+static TextureStream *texture_streams;
+static int texture_stream_count;
+static GLuint texture_stream_buffer;
+static bool texture_stream_buffer_checked;
+
+static TextureGenBuffersProc texture_gl_gen_buffers;
+static TextureDeleteBuffersProc texture_gl_delete_buffers;
+static TextureBindBufferProc texture_gl_bind_buffer;
+static TextureBufferDataProc texture_gl_buffer_data;
+static TextureMapBufferProc texture_gl_map_buffer;
+static TextureUnmapBufferProc texture_gl_unmap_buffer;
+
+/*
+ * The cache: a small array searched linearly, as a scene only has a
+ * handful of textures. Only used from the thread that owns the GL context.
+ */
+static TextureCacheEntry *texture_cache;
+static int texture_cache_count;
+static int texture_cache_capacity;
+static int texture_cache_hits;
+static size_t texture_cache_bytes_saved;
+static TextureCacheAlias *texture_aliases;
+static int texture_alias_count;
+static int texture_alias_capacity;
+
+/*
+ * Check the extension string for a whole extension name.
+ */
+static bool texture_has_extension(const char *name)
+{
+    const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+    if (!extensions)
+        return false;
+
+    size_t len = strlen(name);
+    const char *p = extensions;
+
+    while ((p = strstr(p, name)) != NULL)
+    {
+        bool starts = p == extensions || p[-1] == ' ';
+        bool ends = p[len] == ' ' || p[len] == '\0';
+        if (starts && ends)
+            return true;
+
+        p += len;
+    }
+
+    return false;
+}
+
+/*
+ * Resolve a path to an absolute one without . or .. parts, so different
+ * spellings of the same file share a cache entry. Falls back to the path
+ * as given if it cannot be resolved.
+ */
+static void texture_canonical_path(const char *path, char *out, size_t size)
 {
-    (void)fmt;
-    return GL_RGBA;
+#ifdef _WIN32
+    if (_fullpath(out, path, size))
+        return;
+#else
+    char *resolved = realpath(path, NULL);
+    if (resolved)
+    {
+        snprintf(out, size, "%s", resolved);
+        free(resolved);
+        return;
+    }
+#endif
+
+    snprintf(out, size, "%s", path);
 }
 
 /*
- * Load an image from file and create an OpenGL texture.
+ * 64-bit FNV-1a.
  */
-bool texture_load(Texture2D *out_tex, const char *file_path)
+static uint64_t texture_hash_bytes(const unsigned char *data, size_t size)
 {
-    if (!out_tex)
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/*
+ * Find the entry that owns a GL texture id, or -1.
+ */
+static int texture_cache_find_id(unsigned int id)
+{
+    for (int i = 0; i < texture_cache_count; i++)
+    {
+        if (texture_cache[i].texture.id == id)
+            return i;
+    }
+    return -1;
+}
+
+/*
+ * Hand out another handle to an entry and count the hit. A streaming
+ * entry still holds the placeholder, so its saving is only known once
+ * the last level is in.
+ */
+static void texture_cache_share(Texture2D *out_tex, int index)
+{
+    TextureCacheEntry *entry = &texture_cache[index];
+
+    entry->refs++;
+    texture_cache_hits++;
+    if (entry->streaming)
+        entry->stream_hits++;
+    else
+        texture_cache_bytes_saved += entry->texture.bytes;
+
+    *out_tex = entry->texture;
+}
+
+/*
+ * Add a texture to the cache with a single reference. Returns NULL if the
+ * cache cannot grow.
+ */
+static TextureCacheEntry *texture_cache_add(const Texture2D *tex, uint64_t hash, const char *file_path)
+{
+    if (texture_cache_count == texture_cache_capacity)
+    {
+        int capacity = texture_cache_capacity > 0 ? texture_cache_capacity * 2 : 16;
+        TextureCacheEntry *entries = realloc(texture_cache, (size_t)capacity * sizeof(*entries));
+        if (!entries)
+            return NULL;
+
+        texture_cache = entries;
+        texture_cache_capacity = capacity;
+    }
+
+    TextureCacheEntry *entry = &texture_cache[texture_cache_count++];
+    texture_canonical_path(file_path, entry->path, sizeof(entry->path));
+    entry->hash = hash;
+    entry->format = 0;
+    entry->image_bytes = 0;
+    entry->texture = *tex;
+    entry->refs = 1;
+    entry->streaming = false;
+    entry->stream_hits = 0;
+    return entry;
+}
+
+/*
+ * Remember that a canonical path holds the same contents as the texture
+ * with the given id. Losing an alias to a failed allocation only costs
+ * the next load of that path a decode.
+ */
+static void texture_alias_add(const char *canonical_path, unsigned int id)
+{
+    if (texture_alias_count == texture_alias_capacity)
+    {
+        int capacity = texture_alias_capacity > 0 ? texture_alias_capacity * 2 : 16;
+        TextureCacheAlias *aliases = realloc(texture_aliases, (size_t)capacity * sizeof(*aliases));
+        if (!aliases)
+            return;
+
+        texture_aliases = aliases;
+        texture_alias_capacity = capacity;
+    }
+
+    TextureCacheAlias *alias = &texture_aliases[texture_alias_count++];
+    snprintf(alias->path, sizeof(alias->path), "%s", canonical_path);
+    alias->id = id;
+}
+
+/*
+ * Forget every alias of a texture that is being deleted.
+ */
+static void texture_alias_remove(unsigned int id)
+{
+    for (int i = 0; i < texture_alias_count;)
+    {
+        if (texture_aliases[i].id == id)
+            texture_aliases[i] = texture_aliases[--texture_alias_count];
+        else
+            i++;
+    }
+}
+
+/*
+ * Halve a level with a 2x2 box filter. Odd edges repeat their last
+ * row or column, so every source pixel contributes.
+ */
+static void texture_downsample(const unsigned char *src, int sw, int sh, unsigned char *dst, int dw, int dh)
+{
+    for (int y = 0; y < dh; y++)
+    {
+        int y0 = 2 * y < sh ? 2 * y : sh - 1;
+        int y1 = 2 * y + 1 < sh ? 2 * y + 1 : sh - 1;
+
+        for (int x = 0; x < dw; x++)
+        {
+            int x0 = 2 * x < sw ? 2 * x : sw - 1;
+            int x1 = 2 * x + 1 < sw ? 2 * x + 1 : sw - 1;
+
+            const unsigned char *a = src + ((size_t)y0 * sw + x0) * 4;
+            const unsigned char *b = src + ((size_t)y0 * sw + x1) * 4;
+            const unsigned char *c = src + ((size_t)y1 * sw + x0) * 4;
+            const unsigned char *d = src + ((size_t)y1 * sw + x1) * 4;
+
+            unsigned char *out = dst + ((size_t)y * dw + x) * 4;
+            for (int i = 0; i < 4; i++)
+                out[i] = (unsigned char)((a[i] + b[i] + c[i] + d[i] + 2) >> 2);
+        }
+    }
+}
+
+/*
+ * Path of the converted file for a source image.
+ */
+static bool texture_file_path(const char *file_path, char *out, size_t size)
+{
+    int len = snprintf(out, size, "%s" TEXTURE_FILE_SUFFIX, file_path);
+    return len > 0 && (size_t)len < size;
+}
+
+/*
+ * Map the converted file and use its pixels in place if it was made from
+ * the source as it is now: same size and modification time. Every level
+ * must lie inside the file, so a truncated or foreign file is a miss.
+ */
+static bool texture_file_load(TextureImage *out_image, const char *cache_path, const struct stat *source)
+{
+    MappedFile file;
+    if (!mapped_file_open(&file, cache_path))
         return false;
 
-    // Reset texture structure
-    out_tex->id = 0;
-    out_tex->width = 0;
-    out_tex->height = 0;
-    out_tex->valid = false;
+    TextureFileHeader header;
+    bool ok = file.size >= TEXTURE_FILE_DATA_OFFSET;
+    if (ok)
+    {
+        memcpy(&header, file.data, sizeof(header));
+        ok = header.magic == TEXTURE_FILE_MAGIC &&
+             header.version == TEXTURE_FILE_VERSION &&
+             header.header_size == sizeof(header) &&
+             header.source_size == (uint64_t)source->st_size &&
+             header.source_mtime == (int64_t)source->st_mtime &&
+             header.level_count >= 1 &&
+             header.level_count <= TEXTURE_MAX_LEVELS &&
+             header.data_size <= file.size - TEXTURE_FILE_DATA_OFFSET;
+    }
 
-    /*
-     * Load image using SDL_image
-     */
-    SDL_Surface *loaded = IMG_Load(file_path);
+    for (uint32_t level = 0; ok && level < header.level_count; level++)
+    {
+        uint64_t bytes = (uint64_t)header.level_width[level] * header.level_height[level] * 4;
+        ok = header.level_width[level] > 0 &&
+             header.level_height[level] > 0 &&
+             header.level_offset[level] <= header.data_size &&
+             bytes <= header.data_size - header.level_offset[level];
+    }
+
+    if (!ok)
+    {
+        mapped_file_close(&file);
+        return false;
+    }
+
+    memset(out_image, 0, sizeof(*out_image));
+    out_image->mapping = file;
+    out_image->pixels = (unsigned char *)file.data + TEXTURE_FILE_DATA_OFFSET;
+    out_image->level_count = (int)header.level_count;
+    out_image->opaque = header.opaque != 0;
+    out_image->hash = header.hash;
+
+    for (int level = 0; level < out_image->level_count; level++)
+    {
+        out_image->level_offset[level] = (size_t)header.level_offset[level];
+        out_image->level_width[level] = (int)header.level_width[level];
+        out_image->level_height[level] = (int)header.level_height[level];
+    }
+
+    return true;
+}
+
+/*
+ * Write the converted file under a temporary name and rename it into
+ * place, so a reader never maps a half-written file. Failure only costs
+ * the next start another decode.
+ */
+static void texture_file_save(const TextureImage *image, const char *cache_path, const struct stat *source)
+{
+    TextureFileHeader header;
+    memset(&header, 0, sizeof(header));
+
+    header.magic = TEXTURE_FILE_MAGIC;
+    header.version = TEXTURE_FILE_VERSION;
+    header.header_size = sizeof(header);
+    header.level_count = (uint32_t)image->level_count;
+    header.source_size = (uint64_t)source->st_size;
+    header.source_mtime = (int64_t)source->st_mtime;
+    header.hash = image->hash;
+    header.opaque = image->opaque ? 1u : 0u;
+
+    for (int level = 0; level < image->level_count; level++)
+    {
+        header.level_offset[level] = image->level_offset[level];
+        header.level_width[level] = (uint32_t)image->level_width[level];
+        header.level_height[level] = (uint32_t)image->level_height[level];
+    }
+
+    int last = image->level_count - 1;
+    header.data_size = image->level_offset[last] + (size_t)image->level_width[last] * image->level_height[last] * 4;
+
+    char temp_path[TEXTURE_PATH_MAX];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", cache_path) >= (int)sizeof(temp_path))
+        return;
+
+    FILE *f = fopen(temp_path, "wb");
+    if (!f)
+        return;
+
+    static const unsigned char padding[TEXTURE_FILE_ALIGN];
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(padding, 1, TEXTURE_FILE_DATA_OFFSET - sizeof(header), f);
+    fwrite(image->pixels, 1, (size_t)header.data_size, f);
+
+    bool ok = !ferror(f);
+    ok = fclose(f) == 0 && ok;
+
+#ifdef _WIN32
+    /* rename does not replace an existing file on Windows */
+    remove(cache_path);
+#endif
+
+    if (!ok || rename(temp_path, cache_path) != 0)
+        remove(temp_path);
+}
+
+/*
+ * With the disk cache on, a converted file that still matches the source
+ * is mapped and used as is. Otherwise read the file once, hash its bytes
+ * for the cache, decode it from memory with SDL_image, convert to RGBA8,
+ * fill the levels below the first by repeated halving and write the
+ * result out for the next start.
+ */
+bool texture_image_load(TextureImage *out_image, const char *file_path)
+{
+    memset(out_image, 0, sizeof(*out_image));
+
+    struct stat source;
+    char cache_path[TEXTURE_PATH_MAX];
+    bool use_cache = texture_disk_cache &&
+                     stat(file_path, &source) == 0 &&
+                     texture_file_path(file_path, cache_path, sizeof(cache_path));
+
+    if (use_cache && texture_file_load(out_image, cache_path, &source))
+        return true;
+
+    size_t file_size = 0;
+    void *file_data = SDL_LoadFile(file_path, &file_size);
+    if (!file_data)
+    {
+        fprintf(stderr, "Could not read '%s' : %s\n", file_path, SDL_GetError());
+        return false;
+    }
+
+    uint64_t file_hash = texture_hash_bytes((const unsigned char *)file_data, file_size);
+
+    SDL_Surface *loaded = IMG_Load_RW(SDL_RWFromConstMem(file_data, (int)file_size), 1);
+    SDL_free(file_data);
     if (!loaded)
     {
         fprintf(stderr, "IMG_Load failed for: '%s' : %s\n", file_path, IMG_GetError());
@@ -41,7 +608,7 @@ bool texture_load(Texture2D *out_tex, const char *file_path)
     }
 
     /*
-     * Convert surface to a known pixel format (RGBA-like)
+     * Convert surface to a known pixel format (RGBA bytes in memory)
      */
     SDL_Surface *surf = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ABGR8888, 0);
     SDL_FreeSurface(loaded);
@@ -51,71 +618,992 @@ bool texture_load(Texture2D *out_tex, const char *file_path)
         return false;
     }
 
-    /*
-     * Generate and bind OpenGL texture
-     */
-    GLuint tex_id = 0;
-    glGenTextures(1, &tex_id);
-    glBindTexture(GL_TEXTURE_2D, tex_id);
+    bool ok = texture_image_from_pixels(out_image, surf->pixels, surf->w, surf->h, surf->pitch, TEXTURE_MAX_LEVELS);
+    SDL_FreeSurface(surf);
 
-    /*
-     * Set texture parameters (filtering and wrapping)
-     */
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    if (!ok)
+    {
+        fprintf(stderr, "Out of memory for the mip chain of '%s'\n", file_path);
+        return false;
+    }
 
-    /*
-     * Upload pixel data to GPU
-     */
-    GLenum gl_fmt = surface_format_to_gl(surf->format);
-    (void)gl_fmt;
+    /* The cache identifies files by their encoded bytes */
+    out_image->hash = file_hash;
 
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-    glTexImage2D(
-        GL_TEXTURE_2D,
-        0,
-        GL_RGBA,
-        surf->w,
-        surf->h,
-        0,
-        GL_RGBA,
-        GL_UNSIGNED_BYTE,
-        surf->pixels);
+    if (use_cache)
+        texture_file_save(out_image, cache_path, &source);
 
-    /*
-     * Unbind texture
-     */
-    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
 
-    /*
-     * Fill output structure
-     */
-    out_tex->id = tex_id;
-    out_tex->width = surf->w;
-    out_tex->height = surf->h;
-    out_tex->valid = true;
+/*
+ * Lay out the chain, copy the first level row by row (the source pitch
+ * may be padded) and fill the others by repeated halving.
+ */
+bool texture_image_from_pixels(TextureImage *out_image, const void *pixels, int width, int height, int pitch, int max_levels)
+{
+    memset(out_image, 0, sizeof(*out_image));
+
+    if (max_levels > TEXTURE_MAX_LEVELS)
+        max_levels = TEXTURE_MAX_LEVELS;
+    if (max_levels < 1)
+        max_levels = 1;
+
+    size_t total = 0;
+    int w = width;
+    int h = height;
+
+    while (out_image->level_count < max_levels)
+    {
+        int level = out_image->level_count++;
+        out_image->level_offset[level] = total;
+        out_image->level_width[level] = w;
+        out_image->level_height[level] = h;
+        total += (size_t)w * h * 4;
+
+        if (w == 1 && h == 1)
+            break;
+
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+
+    out_image->pixels = malloc(total);
+    if (!out_image->pixels)
+    {
+        out_image->level_count = 0;
+        return false;
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        memcpy(out_image->pixels + (size_t)y * width * 4,
+               (const unsigned char *)pixels + (size_t)y * pitch,
+               (size_t)width * 4);
+    }
+
+    size_t base_bytes = (size_t)width * height * 4;
+    out_image->hash = texture_hash_bytes(out_image->pixels, base_bytes);
+
+    out_image->opaque = true;
+    for (size_t i = 3; i < base_bytes; i += 4)
+    {
+        if (out_image->pixels[i] != 255)
+        {
+            out_image->opaque = false;
+            break;
+        }
+    }
+
+    for (int level = 1; level < out_image->level_count; level++)
+    {
+        texture_downsample(
+            out_image->pixels + out_image->level_offset[level - 1],
+            out_image->level_width[level - 1],
+            out_image->level_height[level - 1],
+            out_image->pixels + out_image->level_offset[level],
+            out_image->level_width[level],
+            out_image->level_height[level]);
+    }
 
-    SDL_FreeSurface(surf);
     return true;
 }
 
 /*
- * Delete the OpenGL texture and reset its data.
+ * Release the pixel block, or unmap the converted file it lives in, and
+ * reset the image.
  */
-void texture_free(Texture2D *tex)
+void texture_image_free(TextureImage *image)
 {
-    if (!tex)
+    if (!image)
         return;
 
-    if (tex->valid && tex->id != 0)
-    {
-        glDeleteTextures(1, &tex->id);
-    }
+    if (image->mapping.data)
+        mapped_file_close(&image->mapping);
+    else
+        free(image->pixels);
+    memset(image, 0, sizeof(*image));
+}
+
+/*
+ * Size of a level in the given internal format: four bytes per pixel, or
+ * 8 (DXT1) or 16 (DXT5) bytes per 4x4 block.
+ */
+static size_t texture_level_bytes(int w, int h, GLenum format)
+{
+    if (format == GL_RGBA8)
+        return (size_t)w * h * 4;
+
+    size_t block = format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+    return (size_t)((w + 3) / 4) * (size_t)((h + 3) / 4) * block;
+}
+
+/*
+ * Bytes the driver reports for one compressed level, or the S3TC block
+ * size if it does not report any.
+ */
+static size_t texture_compressed_level_bytes(int level, int w, int h, GLenum format)
+{
+    GLint size = 0;
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+    if (glGetError() == GL_NO_ERROR && size > 0)
+        return (size_t)size;
 
-    tex->id = 0;
-    tex->width = 0;
-    tex->height = 0;
-    tex->valid = false;
-}
\ No newline at end of file
+    return texture_level_bytes(w, h, format);
+}
+
+/*
+ * With compression on and S3TC available, the driver encodes each level
+ * as it is uploaded: DXT1 for opaque images, DXT5 where alpha matters.
+ */
+static GLenum texture_internal_format(bool opaque)
+{
+    if (!texture_compression)
+        return GL_RGBA8;
+
+    if (texture_s3tc == 0)
+        texture_s3tc = texture_has_extension("GL_EXT_texture_compression_s3tc") ? 1 : -1;
+    if (texture_s3tc < 0)
+        return GL_RGBA8;
+
+    return opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+}
+
+/*
+ * Generate and bind a texture object with trilinear filtering over the
+ * mip chain, anisotropic where supported.
+ */
+static GLuint texture_generate(int max_level)
+{
+    GLuint tex_id = 0;
+    glGenTextures(1, &tex_id);
+    glBindTexture(GL_TEXTURE_2D, tex_id);
+    texture_bound[texture_unit] = tex_id;
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, max_level);
+
+    if (texture_has_extension("GL_EXT_texture_filter_anisotropic"))
+    {
+        GLfloat max_anisotropy = 1.0f;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &max_anisotropy);
+        if (max_anisotropy > TEXTURE_MAX_ANISOTROPY)
+            max_anisotropy = TEXTURE_MAX_ANISOTROPY;
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, max_anisotropy);
+    }
+
+    return tex_id;
+}
+
+/*
+ * Create the texture object and upload every level.
+ */
+bool texture_create(Texture2D *out_tex, const TextureImage *image)
+{
+    if (!out_tex)
+        return false;
+
+    // Reset texture structure
+    memset(out_tex, 0, sizeof(*out_tex));
+
+    if (!image || !image->pixels || image->level_count == 0)
+        return false;
+
+    GLenum internal_format = texture_internal_format(image->opaque);
+    bool compress = internal_format != GL_RGBA8;
+
+    GLuint tex_id = texture_generate(image->level_count - 1);
+
+    /*
+     * Upload pixel data to GPU, one call per level
+     */
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    size_t bytes = 0;
+    for (int level = 0; level < image->level_count; level++)
+    {
+        int w = image->level_width[level];
+        int h = image->level_height[level];
+
+        glTexImage2D(
+            GL_TEXTURE_2D,
+            level,
+            (GLint)internal_format,
+            w,
+            h,
+            0,
+            GL_RGBA,
+            GL_UNSIGNED_BYTE,
+            image->pixels + image->level_offset[level]);
+
+        if (compress)
+            bytes += texture_compressed_level_bytes(level, w, h, internal_format);
+        else
+            bytes += (size_t)w * h * 4;
+    }
+
+    /*
+     * Unbind texture
+     */
+    glBindTexture(GL_TEXTURE_2D, 0);
+    texture_bound[texture_unit] = 0;
+
+    /*
+     * Fill output structure
+     */
+    out_tex->id = tex_id;
+    out_tex->width = image->level_width[0];
+    out_tex->height = image->level_height[0];
+    out_tex->levels = image->level_count;
+    out_tex->compressed = compress;
+    out_tex->bytes = bytes;
+    out_tex->valid = true;
+
+    return true;
+}
+
+/*
+ * Look up the canonical path first; only a miss reads and decodes the file.
+ */
+bool texture_load(Texture2D *out_tex, const char *file_path)
+{
+    if (!out_tex)
+        return false;
+
+    if (texture_cache_acquire(out_tex, file_path))
+        return true;
+
+    TextureImage image;
+    if (!texture_image_load(&image, file_path))
+    {
+        memset(out_tex, 0, sizeof(*out_tex));
+        return false;
+    }
+
+    bool ok = texture_create_cached(out_tex, &image, file_path);
+    texture_image_free(&image);
+    return ok;
+}
+
+/*
+ * Match the canonical path against every entry, then against the paths
+ * known to hold a copy of one.
+ */
+bool texture_cache_acquire(Texture2D *out_tex, const char *file_path)
+{
+    char path[TEXTURE_PATH_MAX];
+    texture_canonical_path(file_path, path, sizeof(path));
+
+    for (int i = 0; i < texture_cache_count; i++)
+    {
+        if (strcmp(texture_cache[i].path, path) == 0)
+        {
+            texture_cache_share(out_tex, i);
+            return true;
+        }
+    }
+
+    for (int i = 0; i < texture_alias_count; i++)
+    {
+        if (strcmp(texture_aliases[i].path, path) != 0)
+            continue;
+
+        int index = texture_cache_find_id(texture_aliases[i].id);
+        if (index < 0)
+            return false;
+
+        texture_cache_share(out_tex, index);
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * Size of a decoded image: its levels are packed largest first, so the
+ * chain ends where the last level does.
+ */
+static size_t texture_image_bytes(const TextureImage *image)
+{
+    int last = image->level_count - 1;
+    return image->level_offset[last] + (size_t)image->level_width[last] * image->level_height[last] * 4;
+}
+
+/*
+ * Whether an entry holds the image: the hash alone could collide, so the
+ * size, format and decoded byte count have to agree as well. The caller
+ * works out the image's format and byte count once per lookup.
+ */
+static bool texture_cache_matches(const TextureCacheEntry *entry, const TextureImage *image, GLenum format,
+                                  size_t image_bytes)
+{
+    return !entry->streaming &&
+           entry->hash == image->hash &&
+           entry->texture.width == image->level_width[0] &&
+           entry->texture.height == image->level_height[0] &&
+           entry->format == format &&
+           entry->image_bytes == image_bytes;
+}
+
+/*
+ * A file reached under another path, or a copy of it, is found by its
+ * contents and shares the existing texture; the decoded image is then
+ * simply not uploaded, and the path is remembered so that loading it
+ * again skips the decode too.
+ */
+bool texture_create_cached(Texture2D *out_tex, const TextureImage *image, const char *file_path)
+{
+    if (!image || image->level_count == 0)
+        return texture_create(out_tex, image);
+
+    const GLenum format = texture_internal_format(image->opaque);
+    const size_t image_bytes = texture_image_bytes(image);
+
+    for (int i = 0; i < texture_cache_count; i++)
+    {
+        if (texture_cache_matches(&texture_cache[i], image, format, image_bytes))
+        {
+            char path[TEXTURE_PATH_MAX];
+            texture_canonical_path(file_path, path, sizeof(path));
+            if (strcmp(path, texture_cache[i].path) != 0)
+                texture_alias_add(path, texture_cache[i].texture.id);
+
+            texture_cache_share(out_tex, i);
+            return true;
+        }
+    }
+
+    if (!texture_create(out_tex, image))
+        return false;
+
+    /* Still usable if it cannot be added, just not shared */
+    TextureCacheEntry *entry = texture_cache_add(out_tex, image->hash, file_path);
+    if (entry)
+    {
+        entry->format = format;
+        entry->image_bytes = image_bytes;
+    }
+    return true;
+}
+
+/*
+ * Thread entry: decode the image and build its mip chain.
+ */
+static int texture_stream_decode(void *arg)
+{
+    TextureStream *stream = (TextureStream *)arg;
+    stream->ok = texture_image_load(&stream->image, stream->path);
+    SDL_AtomicSet(&stream->decoded, 1);
+    return 0;
+}
+
+/*
+ * Look up an entry point, with the ARB suffix when only the extension is
+ * there. Copied through memcpy, as ISO C has no conversion from an object
+ * pointer to a function pointer.
+ */
+static void texture_load_proc(void *out_proc, const char *name, bool arb)
+{
+    char full[64];
+    snprintf(full, sizeof(full), "%s%s", name, arb ? "ARB" : "");
+
+    void *proc = SDL_GL_GetProcAddress(full);
+    memcpy(out_proc, &proc, sizeof(proc));
+}
+
+/*
+ * Create the pixel unpack buffer on first use. Pixel buffer objects are
+ * core in OpenGL 2.1 and otherwise need ARB_pixel_buffer_object; without
+ * them, streaming uploads from client memory instead.
+ */
+static void texture_stream_init_buffer(void)
+{
+    if (texture_stream_buffer_checked)
+        return;
+
+    texture_stream_buffer_checked = true;
+
+    const char *version = (const char *)glGetString(GL_VERSION);
+    bool core = version && (version[0] > '2' || (version[0] == '2' && version[2] >= '1'));
+    if (!core && !texture_has_extension("GL_ARB_pixel_buffer_object"))
+        return;
+
+    texture_load_proc(&texture_gl_gen_buffers, "glGenBuffers", !core);
+    texture_load_proc(&texture_gl_delete_buffers, "glDeleteBuffers", !core);
+    texture_load_proc(&texture_gl_bind_buffer, "glBindBuffer", !core);
+    texture_load_proc(&texture_gl_buffer_data, "glBufferData", !core);
+    texture_load_proc(&texture_gl_map_buffer, "glMapBuffer", !core);
+    texture_load_proc(&texture_gl_unmap_buffer, "glUnmapBuffer", !core);
+
+    if (!texture_gl_gen_buffers || !texture_gl_delete_buffers || !texture_gl_bind_buffer ||
+        !texture_gl_buffer_data || !texture_gl_map_buffer || !texture_gl_unmap_buffer)
+        return;
+
+    texture_gl_gen_buffers(1, &texture_stream_buffer);
+}
+
+/*
+ * A placeholder texture with a single grey texel is created and cached
+ * right away; the file is decoded on a helper thread, or inline if no
+ * thread can be started.
+ */
+bool texture_stream_load(Texture2D *out_tex, const char *file_path)
+{
+    if (!texture_streaming || !out_tex || !file_path)
+        return false;
+
+    if (texture_cache_acquire(out_tex, file_path))
+        return true;
+
+    TextureStream *stream = calloc(1, sizeof(*stream));
+    if (!stream)
+        return false;
+
+    if (snprintf(stream->path, sizeof(stream->path), "%s", file_path) >= (int)sizeof(stream->path))
+    {
+        free(stream);
+        return false;
+    }
+
+    static const unsigned char placeholder[4] = {128, 128, 128, 255};
+
+    GLuint tex_id = texture_generate(0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+
+    Texture2D tex = {
+        .id = tex_id,
+        .width = 1,
+        .height = 1,
+        .levels = 1,
+        .compressed = false,
+        .bytes = 4,
+        .valid = true};
+
+    TextureCacheEntry *entry = texture_cache_add(&tex, 0, file_path);
+    if (!entry)
+    {
+        texture_free(&tex);
+        free(stream);
+        return false;
+    }
+
+    entry->streaming = true;
+
+    stream->id = tex_id;
+    SDL_AtomicSet(&stream->decoded, 0);
+
+    stream->thread = SDL_CreateThread(texture_stream_decode, "texture", stream);
+    if (!stream->thread)
+        texture_stream_decode(stream);
+
+    TextureStream **tail = &texture_streams;
+    while (*tail)
+        tail = &(*tail)->next;
+    *tail = stream;
+    texture_stream_count++;
+
+    *out_tex = tex;
+    return true;
+}
+
+/*
+ * Upload rows [row, row + rows) of the stream's current level. The rows
+ * are copied into the unpack buffer, orphaning its previous contents so
+ * the copy never waits for the driver to finish reading the last band;
+ * glTexSubImage2D then returns at once and the driver transfers from the
+ * buffer on its own time.
+ */
+static void texture_stream_upload_rows(const TextureStream *stream, int rows)
+{
+    int level = stream->level;
+    int w = stream->image.level_width[level];
+    size_t bytes = (size_t)w * rows * 4;
+    const unsigned char *src = stream->image.pixels + stream->image.level_offset[level] + (size_t)stream->row * w * 4;
+
+    bool buffered = false;
+    if (texture_stream_buffer)
+    {
+        texture_gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, texture_stream_buffer);
+        texture_gl_buffer_data(GL_PIXEL_UNPACK_BUFFER, (ptrdiff_t)bytes, NULL, GL_STREAM_DRAW);
+
+        void *dst = texture_gl_map_buffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+        if (dst)
+        {
+            memcpy(dst, src, bytes);
+            buffered = texture_gl_unmap_buffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+        }
+
+        if (!buffered)
+            texture_gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    /* With the buffer bound, the pointer is an offset into it */
+    glTexSubImage2D(GL_TEXTURE_2D, level, 0, stream->row, w, rows, GL_RGBA, GL_UNSIGNED_BYTE, buffered ? NULL : src);
+
+    if (buffered)
+        texture_gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+/*
+ * Describe the levels resident so far, from base_level down to 1x1, in
+ * the stream's cache entry, so handles refreshed while it streams report
+ * what is actually in video memory.
+ */
+static void texture_stream_describe(const TextureStream *stream, int base_level)
+{
+    int index = texture_cache_find_id(stream->id);
+    if (index < 0)
+        return;
+
+    Texture2D *tex = &texture_cache[index].texture;
+    tex->width = stream->image.level_width[base_level];
+    tex->height = stream->image.level_height[base_level];
+    tex->levels = stream->image.level_count - base_level;
+    tex->compressed = stream->format != GL_RGBA8;
+    tex->bytes = stream->bytes;
+}
+
+/*
+ * Upload from the smallest level up. Each level is allocated empty, filled
+ * in bands of rows, and only made visible by lowering the base level once
+ * complete, so the texture is a complete mip chain throughout: first the
+ * placeholder, then ever sharper versions of the image. Returns the bytes
+ * uploaded.
+ */
+static size_t texture_stream_step(TextureStream *stream, size_t budget)
+{
+    texture_bind(stream->id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (!stream->started)
+    {
+        stream->format = texture_internal_format(stream->image.opaque);
+        stream->level = stream->image.level_count - 1;
+        stream->row = 0;
+        stream->started = true;
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, stream->level);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, stream->level);
+    }
+
+    size_t used = 0;
+    while (stream->level >= 0 && used < budget)
+    {
+        int level = stream->level;
+        int w = stream->image.level_width[level];
+        int h = stream->image.level_height[level];
+        size_t row_bytes = (size_t)w * 4;
+
+        if (stream->row == 0)
+            glTexImage2D(GL_TEXTURE_2D, level, (GLint)stream->format, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+        /* Compressed levels only take updates in whole 4x4 blocks */
+        size_t fit = (budget - used) / row_bytes / 4 * 4;
+        int rows = fit < 4 ? 4 : (fit > (size_t)h ? h : (int)fit);
+        if (rows > h - stream->row)
+            rows = h - stream->row;
+
+        texture_stream_upload_rows(stream, rows);
+        stream->row += rows;
+        used += (size_t)rows * row_bytes;
+
+        if (stream->row == h)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+            stream->bytes += texture_level_bytes(w, h, stream->format);
+            texture_stream_describe(stream, level);
+            stream->level--;
+            stream->row = 0;
+        }
+    }
+
+    return used;
+}
+
+/*
+ * Release a stream that is done or no longer wanted.
+ */
+static void texture_stream_destroy(TextureStream *stream)
+{
+    if (stream->thread)
+        SDL_WaitThread(stream->thread, NULL);
+
+    if (stream->ok)
+        texture_image_free(&stream->image);
+
+    free(stream);
+    texture_stream_count--;
+}
+
+/*
+ * The last level uploaded already described the full texture; only what
+ * identifies its contents is left to fill in. A file that failed to decode keeps the
+ * placeholder.
+ */
+static void texture_stream_finish(TextureStream *stream)
+{
+    int index = texture_cache_find_id(stream->id);
+    if (index >= 0)
+    {
+        TextureCacheEntry *entry = &texture_cache[index];
+
+        if (stream->ok)
+        {
+            entry->hash = stream->image.hash;
+            entry->format = stream->format;
+            entry->image_bytes = texture_image_bytes(&stream->image);
+        }
+
+        texture_cache_bytes_saved += (size_t)entry->stream_hits * entry->texture.bytes;
+        entry->stream_hits = 0;
+        entry->streaming = false;
+    }
+
+    texture_stream_destroy(stream);
+}
+
+/*
+ * Drop the stream of a texture whose last handle is being freed.
+ */
+static void texture_stream_cancel(unsigned int id)
+{
+    for (TextureStream **link = &texture_streams; *link; link = &(*link)->next)
+    {
+        if ((*link)->id == id)
+        {
+            TextureStream *stream = *link;
+            *link = stream->next;
+            texture_stream_destroy(stream);
+            return;
+        }
+    }
+}
+
+/*
+ * Decoded streams are served in request order; one still decoding lets
+ * the ones behind it go first.
+ */
+int texture_stream_update(size_t byte_budget)
+{
+    if (!texture_streams)
+        return 0;
+
+    texture_stream_init_buffer();
+
+    size_t used = 0;
+    TextureStream **link = &texture_streams;
+
+    while (*link && used < byte_budget)
+    {
+        TextureStream *stream = *link;
+
+        if (!SDL_AtomicGet(&stream->decoded))
+        {
+            link = &stream->next;
+            continue;
+        }
+
+        if (stream->thread)
+        {
+            SDL_WaitThread(stream->thread, NULL);
+            stream->thread = NULL;
+        }
+
+        if (stream->ok)
+            used += texture_stream_step(stream, byte_budget - used);
+
+        if (!stream->ok || stream->level < 0)
+        {
+            *link = stream->next;
+            texture_stream_finish(stream);
+        }
+    }
+
+    return texture_stream_count;
+}
+
+/*
+ * Count the streams not yet finished.
+ */
+int texture_stream_pending(void)
+{
+    return texture_stream_count;
+}
+
+/*
+ * Delete the unpack buffer. A later stream creates it again.
+ */
+void texture_stream_shutdown(void)
+{
+    if (texture_stream_buffer)
+        texture_gl_delete_buffers(1, &texture_stream_buffer);
+
+    texture_stream_buffer = 0;
+    texture_stream_buffer_checked = false;
+}
+
+/*
+ * Copy the entry's current description into the handle.
+ */
+bool texture_refresh(Texture2D *tex)
+{
+    if (!tex || !tex->valid)
+        return true;
+
+    int index = texture_cache_find_id(tex->id);
+    if (index < 0)
+        return true;
+
+    *tex = texture_cache[index].texture;
+    return !texture_cache[index].streaming;
+}
+
+/*
+ * Only cached textures are reference counted.
+ */
+bool texture_retain(const Texture2D *tex)
+{
+    if (!tex || !tex->valid)
+        return false;
+
+    int index = texture_cache_find_id(tex->id);
+    if (index < 0)
+        return false;
+
+    texture_cache[index].refs++;
+    return true;
+}
+
+/*
+ * Sum the live entries; hits and savings accumulate since startup.
+ */
+void texture_cache_stats(TextureCacheStats *out_stats)
+{
+    memset(out_stats, 0, sizeof(*out_stats));
+
+    for (int i = 0; i < texture_cache_count; i++)
+    {
+        out_stats->references += texture_cache[i].refs;
+        out_stats->bytes += texture_cache[i].texture.bytes;
+    }
+
+    out_stats->entries = texture_cache_count;
+    out_stats->hits = texture_cache_hits;
+    out_stats->bytes_saved = texture_cache_bytes_saved;
+}
+
+/*
+ * Skip the call when the texture is already bound.
+ */
+bool texture_bind(unsigned int id)
+{
+    if (id == texture_bound[texture_unit])
+        return false;
+
+    glBindTexture(GL_TEXTURE_2D, id);
+    texture_bound[texture_unit] = id;
+    stats_add(STAT_STATE_CHANGES, 1);
+    return true;
+}
+
+/*
+ * Multitexturing is core in OpenGL 1.3 and otherwise needs
+ * ARB_multitexture. Checked once, on the first call.
+ */
+bool texture_multitexture_available(void)
+{
+    if (texture_multitexture != 0)
+        return texture_multitexture > 0;
+
+    texture_multitexture = -1;
+
+    const char *version = (const char *)glGetString(GL_VERSION);
+    bool core = version && (version[0] > '1' || (version[0] == '1' && version[2] >= '3'));
+    if (!core && !texture_has_extension("GL_ARB_multitexture"))
+        return false;
+
+    texture_load_proc(&texture_gl_active_texture, "glActiveTexture", !core);
+    texture_load_proc(&texture_gl_client_active_texture, "glClientActiveTexture", !core);
+
+    GLint units = 1;
+    glGetIntegerv(GL_MAX_TEXTURE_UNITS, &units);
+
+    if (texture_gl_active_texture && texture_gl_client_active_texture && units >= TEXTURE_COLOR_UNITS)
+        texture_multitexture = 1;
+
+    return texture_multitexture > 0;
+}
+
+/*
+ * Fixed function is limited to GL_MAX_TEXTURE_UNITS, but a shader samples
+ * up to GL_MAX_TEXTURE_IMAGE_UNITS. texture_select_unit also switches the
+ * client unit, which GL_MAX_TEXTURE_COORDS limits, so both must cover the
+ * highest unit.
+ */
+bool texture_shader_units_available(void)
+{
+    if (texture_shader_units != 0)
+        return texture_shader_units > 0;
+
+    texture_shader_units = -1;
+
+    if (!texture_multitexture_available())
+        return false;
+
+    GLint image_units = 0;
+    GLint coords = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &image_units);
+    glGetIntegerv(GL_MAX_TEXTURE_COORDS, &coords);
+
+    if (image_units >= TEXTURE_UNITS && coords >= TEXTURE_UNITS)
+        texture_shader_units = 1;
+
+    return texture_shader_units > 0;
+}
+
+/*
+ * Switches the server and the client (vertex array) unit together.
+ */
+bool texture_select_unit(int unit)
+{
+    if (unit < 0 || unit >= TEXTURE_UNITS)
+        return false;
+
+    if (unit == texture_unit)
+        return true;
+
+    if (!texture_multitexture_available())
+        return false;
+
+    if (unit >= TEXTURE_COLOR_UNITS && !texture_shader_units_available())
+        return false;
+
+    texture_gl_active_texture(GL_TEXTURE0 + (GLenum)unit);
+    texture_gl_client_active_texture(GL_TEXTURE0 + (GLenum)unit);
+    texture_unit = unit;
+    stats_add(STAT_STATE_CHANGES, 1);
+    return true;
+}
+
+/*
+ * glGetTexImage decodes compressed textures, so this works for every
+ * texture created by texture_create.
+ */
+bool texture_read_pixels(const Texture2D *tex, unsigned char *out_rgba)
+{
+    if (!tex || !tex->valid)
+        return false;
+
+    texture_bind(tex->id);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, out_rgba);
+    return glGetError() == GL_NO_ERROR;
+}
+
+/*
+ * The image is loaded from the entry's path, so a texture created from
+ * memory fails to load like a missing file would. Streaming entries have
+ * no hash to check against yet. The hash and size of the reloaded image
+ * must match the entry's.
+ */
+bool texture_cache_image(const Texture2D *tex, TextureImage *out_image)
+{
+    memset(out_image, 0, sizeof(*out_image));
+
+    if (!tex || !tex->valid)
+        return false;
+
+    int index = texture_cache_find_id(tex->id);
+    if (index < 0 || texture_cache[index].streaming || texture_cache[index].hash == 0)
+        return false;
+
+    const TextureCacheEntry *entry = &texture_cache[index];
+    if (!texture_image_load(out_image, entry->path))
+        return false;
+
+    if (out_image->hash != entry->hash ||
+        out_image->level_width[0] != entry->texture.width ||
+        out_image->level_height[0] != entry->texture.height)
+    {
+        texture_image_free(out_image);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Applies to textures created after the call.
+ */
+void texture_set_compression(bool enabled)
+{
+    texture_compression = enabled;
+}
+
+/*
+ * Applies to loads started after the call.
+ */
+void texture_set_streaming(bool enabled)
+{
+    texture_streaming = enabled;
+}
+
+/*
+ * Read by the decode threads, so set it before loading starts.
+ */
+void texture_set_disk_cache(bool enabled)
+{
+    texture_disk_cache = enabled;
+}
+
+/*
+ * Four bytes per pixel of the first level.
+ */
+size_t texture_base_bytes(const Texture2D *tex)
+{
+    if (!tex || !tex->valid)
+        return 0;
+
+    return (size_t)tex->width * tex->height * 4;
+}
+
+/*
+ * Delete the OpenGL texture and reset its data.
+ */
+void texture_free(Texture2D *tex)
+{
+    if (!tex)
+        return;
+
+    if (tex->valid && tex->id != 0)
+    {
+        int index = texture_cache_find_id(tex->id);
+
+        /* Deleting a bound texture makes GL fall back to texture 0 */
+        for (int unit = 0; unit < TEXTURE_UNITS; unit++)
+        {
+            if (texture_bound[unit] == tex->id && (index < 0 || texture_cache[index].refs == 1))
+                texture_bound[unit] = 0;
+        }
+
+        if (index < 0)
+        {
+            glDeleteTextures(1, &tex->id);
+        }
+        else if (--texture_cache[index].refs == 0)
+        {
+            if (texture_cache[index].streaming)
+                texture_stream_cancel(tex->id);
+
+            texture_alias_remove(tex->id);
+            glDeleteTextures(1, &tex->id);
+            texture_cache[index] = texture_cache[--texture_cache_count];
+        }
+    }
+
+    memset(tex, 0, sizeof(*tex));
+}
@@ -1,4 +1,6 @@
 #include "ui.h"
+#include "profiler.h"
+#include "stats.h"
 
 #include <GL/gl.h>
 #include <stdio.h>
@@ -95,7 +97,7 @@ void ui_draw_help_overlay(
     ui_begin_2d(screen_w, screen_h);
 
     /* Background panel */
-    ui_draw_rect(20.0f, 20.0f, 460.0f, 290.0f, 0.0f, 0.0f, 0.0f, 0.72f);
+    ui_draw_rect(20.0f, 20.0f, 460.0f, 350.0f, 0.0f, 0.0f, 0.0f, 0.72f);
 
     /* Help text */
     ui_draw_text(35.0f, 40.0f, "MONKEY ZOO - HASZNALAT", 1.0f, 1.0f, 0.8f);
@@ -108,17 +110,264 @@ void ui_draw_help_overlay(
     ui_draw_text(35.0f, 190.0f, "Q         - banan dobas", 1.0f, 1.0f, 1.0f);
     ui_draw_text(35.0f, 210.0f, "+ / -     - fenyero", 1.0f, 1.0f, 1.0f);
     ui_draw_text(35.0f, 230.0f, "F1        - help ki/be", 1.0f, 1.0f, 1.0f);
-    ui_draw_text(35.0f, 250.0f, "ESC       - kilepes", 1.0f, 1.0f, 1.0f);
+    ui_draw_text(35.0f, 250.0f, "F2        - statisztika ki/be", 1.0f, 1.0f, 1.0f);
+    ui_draw_text(35.0f, 270.0f, "F3        - profiler ki/be", 1.0f, 1.0f, 1.0f);
+    ui_draw_text(35.0f, 290.0f, "F4        - profiler trace mentes", 1.0f, 1.0f, 1.0f);
+    ui_draw_text(35.0f, 310.0f, "ESC       - kilepes", 1.0f, 1.0f, 1.0f);
 
     /* Dynamic status values */
     snprintf(line, sizeof(line), "Fenyerosseg: %.1f", light_intensity);
-    ui_draw_text(35.0f, 275.0f, line, 0.8f, 1.0f, 0.8f);
+    ui_draw_text(35.0f, 335.0f, line, 0.8f, 1.0f, 0.8f);
 
     snprintf(line, sizeof(line), "Aktiv bananok: %d", active_bananas);
-    ui_draw_text(250.0f, 275.0f, line, 1.0f, 1.0f, 0.7f);
+    ui_draw_text(250.0f, 335.0f, line, 1.0f, 1.0f, 0.7f);
 
     snprintf(line, sizeof(line), "Megevett bananok: %d", eaten_bananas);
-    ui_draw_text(250.0f, 295.0f, line, 1.0f, 0.9f, 0.6f);
+    ui_draw_text(250.0f, 355.0f, line, 1.0f, 0.9f, 0.6f);
 
     ui_end_2d();
-}
\ No newline at end of file
+}
+
+/*
+ * Height of one nesting row of the profiler flame graph, in pixels.
+ */
+#define UI_PROFILER_ROW 16.0f
+
+/*
+ * Approximate pixel width of a text line. The bundled stb_easy_font has
+ * stb_easy_font_width disabled; its glyphs average about 6 pixels.
+ */
+static float ui_text_width(const char *text)
+{
+    return (float)strlen(text) * 6.0f;
+}
+
+/*
+ * Pick a bar color from a small palette by hashing the zone name, so a
+ * zone keeps its color from frame to frame.
+ */
+static void ui_zone_color(const char *name, float *r, float *g, float *b)
+{
+    static const float palette[6][3] = {
+        {0.85f, 0.45f, 0.30f},
+        {0.35f, 0.65f, 0.85f},
+        {0.55f, 0.80f, 0.40f},
+        {0.85f, 0.75f, 0.30f},
+        {0.70f, 0.50f, 0.85f},
+        {0.40f, 0.80f, 0.75f}};
+
+    unsigned int h = 2166136261u;
+    for (const char *c = name; *c; c++)
+        h = (h ^ (unsigned char)*c) * 16777619u;
+
+    const float *color = palette[h % 6u];
+    *r = color[0];
+    *g = color[1];
+    *b = color[2];
+}
+
+/*
+ * Draw the last profiled frame as a flame graph: time runs left to right
+ * over the whole frame and nested zones stack downwards. Zones wide enough
+ * get their name and duration printed on the bar; the top-level zones are
+ * also listed with their times below the graph.
+ */
+void ui_draw_profiler_overlay(int screen_w, int screen_h, const ProfileFrame *frame)
+{
+    char line[128];
+
+    ui_begin_2d(screen_w, screen_h);
+
+    const float x0 = 20.0f;
+    const float width = (float)screen_w - 40.0f;
+
+    if (!frame || frame->end <= frame->start)
+    {
+        ui_draw_rect(x0, 20.0f, 300.0f, 30.0f, 0.0f, 0.0f, 0.0f, 0.72f);
+        ui_draw_text(x0 + 10.0f, 30.0f, "Profiler: nincs adat", 1.0f, 1.0f, 0.8f);
+        ui_end_2d();
+        return;
+    }
+
+    int max_depth = 0;
+    int top_level = 0;
+    for (int i = 0; i < frame->zone_count; i++)
+    {
+        if (frame->zones[i].depth > max_depth)
+            max_depth = frame->zones[i].depth;
+        if (frame->zones[i].depth == 0)
+            top_level++;
+    }
+
+    const float graph_y = 45.0f;
+    const float graph_h = (float)(max_depth + 1) * UI_PROFILER_ROW;
+    const float list_h = (float)top_level * 14.0f;
+    const double frame_ms = profiler_ms(frame->end - frame->start);
+    const double px_per_tick = (double)width / (double)(frame->end - frame->start);
+
+    ui_draw_rect(x0 - 10.0f, 20.0f, width + 20.0f, graph_h + list_h + 40.0f, 0.0f, 0.0f, 0.0f, 0.72f);
+
+    snprintf(line, sizeof(line), "Frame: %.2f ms   (F3: profiler ki/be, F4: trace mentes)", frame_ms);
+    ui_draw_text(x0, 28.0f, line, 1.0f, 1.0f, 0.8f);
+
+    for (int i = 0; i < frame->zone_count; i++)
+    {
+        const ProfileZone *zone = &frame->zones[i];
+
+        float x = x0 + (float)((double)(zone->start - frame->start) * px_per_tick);
+        float w = (float)((double)(zone->end - zone->start) * px_per_tick);
+        float y = graph_y + (float)zone->depth * UI_PROFILER_ROW;
+
+        if (w < 1.0f)
+            w = 1.0f;
+
+        float r;
+        float g;
+        float b;
+        ui_zone_color(zone->name, &r, &g, &b);
+        ui_draw_rect(x, y, w, UI_PROFILER_ROW - 2.0f, r, g, b, 0.9f);
+
+        snprintf(line, sizeof(line), "%s %.2f", zone->name, profiler_ms(zone->end - zone->start));
+        if (ui_text_width(line) + 4.0f < w)
+            ui_draw_text(x + 2.0f, y + 3.0f, line, 0.0f, 0.0f, 0.0f);
+    }
+
+    float list_y = graph_y + graph_h + 6.0f;
+    for (int i = 0; i < frame->zone_count; i++)
+    {
+        const ProfileZone *zone = &frame->zones[i];
+        if (zone->depth != 0)
+            continue;
+
+        snprintf(line, sizeof(line), "%-18s %7.3f ms", zone->name, profiler_ms(zone->end - zone->start));
+        ui_draw_text(x0, list_y, line, 1.0f, 1.0f, 1.0f);
+        list_y += 14.0f;
+    }
+
+    ui_end_2d();
+}
+
+/*
+ * Size of the statistics panel and its frame time graph, in pixels. The
+ * graph has one column per frame of history and tops out at
+ * UI_STATS_GRAPH_MS.
+ */
+#define UI_STATS_WIDTH 280.0f
+#define UI_STATS_GRAPH_H 60.0f
+#define UI_STATS_GRAPH_MS 50.0f
+
+/*
+ * Height of one text line in the statistics panel.
+ */
+#define UI_STATS_LINE 14.0f
+
+/*
+ * Graph y coordinate of a frame time, clamped to the graph area.
+ */
+static float ui_stats_graph_y(float graph_bottom, float ms)
+{
+    if (ms > UI_STATS_GRAPH_MS)
+        ms = UI_STATS_GRAPH_MS;
+
+    return graph_bottom - ms / UI_STATS_GRAPH_MS * UI_STATS_GRAPH_H;
+}
+
+/*
+ * The panel sits in the top right corner, clear of the help panel. Bars
+ * are green within a 60 FPS frame time, yellow within 30 FPS and red
+ * above.
+ */
+void ui_draw_stats_overlay(int screen_w, int screen_h, const UiStatsCounts *counts)
+{
+    char line[128];
+    float history[STATS_HISTORY];
+
+    int frames = stats_frame_history(history);
+
+    const float lines = 4.0f + (float)STAT_COUNT + 4.0f;
+    const float panel_h = UI_STATS_GRAPH_H + lines * UI_STATS_LINE + 30.0f;
+    const float x0 = (float)screen_w - UI_STATS_WIDTH - 20.0f;
+    const float y0 = 20.0f;
+
+    ui_begin_2d(screen_w, screen_h);
+
+    ui_draw_rect(x0, y0, UI_STATS_WIDTH, panel_h, 0.0f, 0.0f, 0.0f, 0.72f);
+
+    float x = x0 + 10.0f;
+    float y = y0 + 8.0f;
+
+    ui_draw_text(x, y, "Statisztika (F2)", 1.0f, 1.0f, 0.8f);
+    y += UI_STATS_LINE;
+
+    if (frames == 0)
+    {
+        ui_draw_text(x, y, "nincs adat", 1.0f, 1.0f, 1.0f);
+        ui_end_2d();
+        return;
+    }
+
+    float last = history[frames - 1];
+    snprintf(line, sizeof(line), "Frame: %.2f ms   FPS: %.0f", last, last > 0.0f ? 1000.0f / last : 0.0f);
+    ui_draw_text(x, y, line, 1.0f, 1.0f, 1.0f);
+    y += UI_STATS_LINE;
+
+    snprintf(line, sizeof(line), "p50 %.2f  p95 %.2f  p99 %.2f ms",
+             stats_frame_percentile(50.0f),
+             stats_frame_percentile(95.0f),
+             stats_frame_percentile(99.0f));
+    ui_draw_text(x, y, line, 1.0f, 1.0f, 1.0f);
+    y += UI_STATS_LINE + 4.0f;
+
+    /* frame time graph, newest frame on the right */
+    const float graph_w = UI_STATS_WIDTH - 20.0f;
+    const float column = graph_w / (float)STATS_HISTORY;
+    const float graph_bottom = y + UI_STATS_GRAPH_H;
+
+    ui_draw_rect(x, y, graph_w, UI_STATS_GRAPH_H, 0.15f, 0.15f, 0.15f, 0.8f);
+
+    for (int i = 0; i < frames; i++)
+    {
+        float ms = history[i];
+        float top = ui_stats_graph_y(graph_bottom, ms);
+        float bx = x + graph_w - (float)(frames - i) * column;
+
+        if (ms < 16.7f)
+            ui_draw_rect(bx, top, column, graph_bottom - top, 0.3f, 0.9f, 0.3f, 0.9f);
+        else if (ms < 33.3f)
+            ui_draw_rect(bx, top, column, graph_bottom - top, 0.95f, 0.85f, 0.2f, 0.9f);
+        else
+            ui_draw_rect(bx, top, column, graph_bottom - top, 0.95f, 0.3f, 0.2f, 0.9f);
+    }
+
+    /* 60 and 30 FPS guide lines */
+    ui_draw_rect(x, ui_stats_graph_y(graph_bottom, 16.7f), graph_w, 1.0f, 1.0f, 1.0f, 1.0f, 0.5f);
+    ui_draw_rect(x, ui_stats_graph_y(graph_bottom, 33.3f), graph_w, 1.0f, 1.0f, 1.0f, 1.0f, 0.5f);
+
+    y = graph_bottom + 6.0f;
+
+    for (int c = 0; c < STAT_COUNT; c++)
+    {
+        snprintf(line, sizeof(line), "%-18s %8u", stats_counter_name((StatCounter)c), (unsigned)stats_last((StatCounter)c));
+        ui_draw_text(x, y, line, 0.8f, 1.0f, 0.8f);
+        y += UI_STATS_LINE;
+    }
+
+    y += 4.0f;
+
+    snprintf(line, sizeof(line), "%-18s %8d", "obstacles", counts->obstacles);
+    ui_draw_text(x, y, line, 1.0f, 1.0f, 0.7f);
+    y += UI_STATS_LINE;
+
+    snprintf(line, sizeof(line), "%-18s %8d", "water particles", counts->particles);
+    ui_draw_text(x, y, line, 1.0f, 1.0f, 0.7f);
+    y += UI_STATS_LINE;
+
+    snprintf(line, sizeof(line), "%-18s %8d", "rain drops", counts->rain_drops);
+    ui_draw_text(x, y, line, 1.0f, 1.0f, 0.7f);
+    y += UI_STATS_LINE;
+
+    snprintf(line, sizeof(line), "%-18s %4d / %d", "bananas airborne", counts->airborne_bananas, counts->bananas);
+    ui_draw_text(x, y, line, 1.0f, 1.0f, 0.7f);
+
+    ui_end_2d();
+}
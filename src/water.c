@@ -0,0 +1,611 @@
+#include "water.h"
+
+#include <SDL2/SDL.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define WATER_HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+/*
+ * Tiles handed to one job batch at minimum.
+ */
+#define WATER_MIN_TILES_PER_BATCH 4
+
+/*
+ * Per-tile result flags written by the stencil pass.
+ * CALM means every cell stayed below the sleep epsilon; the EDGE flags
+ * mean the border cells on that side can move the neighbouring tile.
+ */
+#define WATER_TILE_CALM 0x01
+#define WATER_TILE_EDGE_X0 0x02
+#define WATER_TILE_EDGE_X1 0x04
+#define WATER_TILE_EDGE_Y0 0x08
+#define WATER_TILE_EDGE_Y1 0x10
+
+/*
+ * Stencil kernel for cells [y0, y1) of one grid row.
+ * h is the row itself, hl/hr the rows on either side; results are
+ * written to out_h/out_v. k is delta_time * 60.
+ */
+typedef void (*WaterRowFunc)(
+    const float *h, const float *hl, const float *hr, const float *v,
+    float *out_h, float *out_v, int y0, int y1, float k);
+
+/*
+ * Arguments of one stencil pass, shared by all tile batches.
+ */
+typedef struct
+{
+    WaterSim *water;
+    const float *h;
+    const float *v;
+    float *out_h;
+    float *out_v;
+    float delta_time;
+    WaterRowFunc row;
+} WaterStepJob;
+
+/*
+ * Scalar reference kernel.
+ * The SIMD kernels use it for the cells left over after the last vector.
+ */
+static void water_row_scalar(
+    const float *h, const float *hl, const float *hr, const float *v,
+    float *out_h, float *out_v, int y0, int y1, float k)
+{
+    for (int y = y0; y < y1; y++)
+    {
+        float center = h[y];
+
+        float avg = hl[y] + hr[y] + h[y - 1] + h[y + 1];
+        avg *= 0.25f;
+
+        float acc = (avg - center) * 0.25f;
+
+        float nv = v[y] + acc * k;
+        nv *= 0.98f;
+
+        if (nv > 0.08f)
+            nv = 0.08f;
+        if (nv < -0.08f)
+            nv = -0.08f;
+
+        float nh = center + nv * k;
+
+        if (nh > 0.18f)
+            nh = 0.18f;
+        if (nh < -0.18f)
+            nh = -0.18f;
+
+        out_v[y] = nv;
+        out_h[y] = nh * 0.998f;
+    }
+}
+
+#ifdef WATER_HAVE_X86_KERNELS
+
+/*
+ * SSE2 kernel, 4 cells per iteration.
+ * Operations are done in the same order as the scalar code and the
+ * clamps use min/max instead of branches, so results match it exactly.
+ */
+__attribute__((target("sse2"))) static void water_row_sse2(
+    const float *h, const float *hl, const float *hr, const float *v,
+    float *out_h, float *out_v, int y0, int y1, float k)
+{
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    const __m128 kk = _mm_set1_ps(k);
+    const __m128 v_damp = _mm_set1_ps(0.98f);
+    const __m128 h_damp = _mm_set1_ps(0.998f);
+    const __m128 v_max = _mm_set1_ps(0.08f);
+    const __m128 v_min = _mm_set1_ps(-0.08f);
+    const __m128 h_max = _mm_set1_ps(0.18f);
+    const __m128 h_min = _mm_set1_ps(-0.18f);
+
+    int y = y0;
+    for (; y + 4 <= y1; y += 4)
+    {
+        __m128 center = _mm_loadu_ps(h + y);
+
+        __m128 avg = _mm_add_ps(_mm_loadu_ps(hl + y), _mm_loadu_ps(hr + y));
+        avg = _mm_add_ps(avg, _mm_loadu_ps(h + y - 1));
+        avg = _mm_add_ps(avg, _mm_loadu_ps(h + y + 1));
+        avg = _mm_mul_ps(avg, quarter);
+
+        __m128 acc = _mm_mul_ps(_mm_sub_ps(avg, center), quarter);
+
+        __m128 nv = _mm_add_ps(_mm_loadu_ps(v + y), _mm_mul_ps(acc, kk));
+        nv = _mm_mul_ps(nv, v_damp);
+        nv = _mm_max_ps(_mm_min_ps(nv, v_max), v_min);
+
+        __m128 nh = _mm_add_ps(center, _mm_mul_ps(nv, kk));
+        nh = _mm_max_ps(_mm_min_ps(nh, h_max), h_min);
+
+        _mm_storeu_ps(out_v + y, nv);
+        _mm_storeu_ps(out_h + y, _mm_mul_ps(nh, h_damp));
+    }
+
+    water_row_scalar(h, hl, hr, v, out_h, out_v, y, y1, k);
+}
+
+/*
+ * AVX2 kernel, 8 cells per iteration. FMA is deliberately not enabled
+ * so the rounding stays identical to the scalar and SSE2 kernels.
+ */
+__attribute__((target("avx2"))) static void water_row_avx2(
+    const float *h, const float *hl, const float *hr, const float *v,
+    float *out_h, float *out_v, int y0, int y1, float k)
+{
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    const __m256 kk = _mm256_set1_ps(k);
+    const __m256 v_damp = _mm256_set1_ps(0.98f);
+    const __m256 h_damp = _mm256_set1_ps(0.998f);
+    const __m256 v_max = _mm256_set1_ps(0.08f);
+    const __m256 v_min = _mm256_set1_ps(-0.08f);
+    const __m256 h_max = _mm256_set1_ps(0.18f);
+    const __m256 h_min = _mm256_set1_ps(-0.18f);
+
+    int y = y0;
+    for (; y + 8 <= y1; y += 8)
+    {
+        __m256 center = _mm256_loadu_ps(h + y);
+
+        __m256 avg = _mm256_add_ps(_mm256_loadu_ps(hl + y), _mm256_loadu_ps(hr + y));
+        avg = _mm256_add_ps(avg, _mm256_loadu_ps(h + y - 1));
+        avg = _mm256_add_ps(avg, _mm256_loadu_ps(h + y + 1));
+        avg = _mm256_mul_ps(avg, quarter);
+
+        __m256 acc = _mm256_mul_ps(_mm256_sub_ps(avg, center), quarter);
+
+        __m256 nv = _mm256_add_ps(_mm256_loadu_ps(v + y), _mm256_mul_ps(acc, kk));
+        nv = _mm256_mul_ps(nv, v_damp);
+        nv = _mm256_max_ps(_mm256_min_ps(nv, v_max), v_min);
+
+        __m256 nh = _mm256_add_ps(center, _mm256_mul_ps(nv, kk));
+        nh = _mm256_max_ps(_mm256_min_ps(nh, h_max), h_min);
+
+        _mm256_storeu_ps(out_v + y, nv);
+        _mm256_storeu_ps(out_h + y, _mm256_mul_ps(nh, h_damp));
+    }
+
+    /* The remainder is legacy SSE code; clear the upper halves first */
+    _mm256_zeroupper();
+    water_row_scalar(h, hl, hr, v, out_h, out_v, y, y1, k);
+}
+
+#endif
+
+/*
+ * Map a kernel id to its row function, falling back to scalar code.
+ */
+static WaterRowFunc water_row_func(WaterKernel kernel)
+{
+#ifdef WATER_HAVE_X86_KERNELS
+    if (kernel == WATER_KERNEL_AVX2)
+        return water_row_avx2;
+    if (kernel == WATER_KERNEL_SSE2)
+        return water_row_sse2;
+#endif
+    (void)kernel;
+    return water_row_scalar;
+}
+
+/*
+ * Check compile-time and runtime support for a kernel.
+ */
+bool water_kernel_available(WaterKernel kernel)
+{
+    switch (kernel)
+    {
+    case WATER_KERNEL_SCALAR:
+        return true;
+#ifdef WATER_HAVE_X86_KERNELS
+    case WATER_KERNEL_SSE2:
+        return SDL_HasSSE2() == SDL_TRUE;
+    case WATER_KERNEL_AVX2:
+        return SDL_HasAVX2() == SDL_TRUE;
+#endif
+    default:
+        return false;
+    }
+}
+
+/*
+ * SSE2 is preferred over AVX2: the kernel is bound by memory bandwidth,
+ * and on a 1024 grid --bench-water shows AVX2 no faster than SSE2, at
+ * times slower. AVX2 stays available for the benchmark.
+ */
+WaterKernel water_kernel_best(void)
+{
+    if (water_kernel_available(WATER_KERNEL_SSE2))
+        return WATER_KERNEL_SSE2;
+    return WATER_KERNEL_SCALAR;
+}
+
+/*
+ * Printable kernel names, used by the benchmark output.
+ */
+const char *water_kernel_name(WaterKernel kernel)
+{
+    switch (kernel)
+    {
+    case WATER_KERNEL_SCALAR:
+        return "scalar";
+    case WATER_KERNEL_SSE2:
+        return "sse2";
+    case WATER_KERNEL_AVX2:
+        return "avx2";
+    default:
+        return "unknown";
+    }
+}
+
+/*
+ * Allocate both buffer pairs in one zeroed block, and the per-tile
+ * bookkeeping in a second one.
+ */
+bool water_sim_init(WaterSim *water, int size)
+{
+    memset(water, 0, sizeof(*water));
+
+    if (size < 4)
+        return false;
+
+    size_t cells = (size_t)size * (size_t)size;
+    float *block = calloc(cells * 4, sizeof(float));
+    if (!block)
+        return false;
+
+    int tps = (size + WATER_TILE_SIZE - 1) / WATER_TILE_SIZE;
+    size_t tiles = (size_t)tps * (size_t)tps;
+
+    int *active = malloc(tiles * sizeof(int));
+    unsigned char *flags = calloc(tiles * 3, 1);
+    if (!active || !flags)
+    {
+        free(block);
+        free(active);
+        free(flags);
+        return false;
+    }
+
+    water->size = size;
+    water->h[0] = block;
+    water->h[1] = block + cells;
+    water->v[0] = block + cells * 2;
+    water->v[1] = block + cells * 3;
+    water->current = 0;
+    water->kernel = water_kernel_best();
+
+    water->tiles_per_side = tps;
+    water->tile_awake = flags;
+    water->tile_calm = flags + tiles;
+    water->tile_report = flags + tiles * 2;
+    water->active_tiles = active;
+    water->active_count = 0;
+    water->sleep_enabled = true;
+
+    return true;
+}
+
+/*
+ * Free the buffer and tile blocks.
+ */
+void water_sim_free(WaterSim *water)
+{
+    free(water->h[0]);
+    free(water->active_tiles);
+    free(water->tile_awake);
+    memset(water, 0, sizeof(*water));
+}
+
+/*
+ * Only the buffer the surface is drawn from is filled; dst reads it as
+ * its current one.
+ */
+bool water_sim_copy_heights(WaterSim *dst, const WaterSim *src)
+{
+    if (dst->size != src->size)
+    {
+        water_sim_free(dst);
+        if (src->size == 0)
+            return true;
+        if (!water_sim_init(dst, src->size))
+            return false;
+    }
+
+    if (src->size > 0)
+    {
+        size_t cells = (size_t)src->size * (size_t)src->size;
+        memcpy(dst->h[0], water_sim_height(src), cells * sizeof(float));
+    }
+
+    dst->current = 0;
+    return true;
+}
+
+/*
+ * Compute the interior cell range [x0, x1) x [y0, y1) of a tile.
+ * The outermost grid rows and columns are borders and never simulated.
+ */
+static void water_tile_bounds(const WaterSim *water, int tile, int *x0, int *x1, int *y0, int *y1)
+{
+    const int n = water->size;
+    const int tps = water->tiles_per_side;
+
+    int tx = tile / tps;
+    int ty = tile % tps;
+
+    *x0 = tx * WATER_TILE_SIZE;
+    *x1 = *x0 + WATER_TILE_SIZE;
+    *y0 = ty * WATER_TILE_SIZE;
+    *y1 = *y0 + WATER_TILE_SIZE;
+
+    if (*x0 < 1)
+        *x0 = 1;
+    if (*y0 < 1)
+        *y0 = 1;
+    if (*x1 > n - 1)
+        *x1 = n - 1;
+    if (*y1 > n - 1)
+        *y1 = n - 1;
+}
+
+/*
+ * Run the stencil on one tile and report whether it is calm and which
+ * of its borders are active enough to disturb a neighbour.
+ */
+static void water_step_tile(const WaterStepJob *job, int tile)
+{
+    const WaterSim *water = job->water;
+    const int n = water->size;
+    const float k = job->delta_time * 60.0f;
+
+    int x0, x1, y0, y1;
+    water_tile_bounds(water, tile, &x0, &x1, &y0, &y1);
+
+    float peak = 0.0f;
+    unsigned char report = 0;
+
+    for (int x = x0; x < x1; x++)
+    {
+        const float *h = job->h + x * n;
+        float *out_h = job->out_h + x * n;
+        float *out_v = job->out_v + x * n;
+
+        job->row(h, h - n, h + n, job->v + x * n, out_h, out_v, y0, y1, k);
+
+        float row_peak = 0.0f;
+        for (int y = y0; y < y1; y++)
+        {
+            float a = fabsf(out_h[y]);
+            float b = fabsf(out_v[y]);
+            row_peak = a > row_peak ? a : row_peak;
+            row_peak = b > row_peak ? b : row_peak;
+        }
+
+        if (row_peak > peak)
+            peak = row_peak;
+
+        /* Neighbours only feel the height of the cells next to them */
+        if (fabsf(out_h[y0]) > WATER_WAKE_THRESHOLD)
+            report |= WATER_TILE_EDGE_Y0;
+        if (fabsf(out_h[y1 - 1]) > WATER_WAKE_THRESHOLD)
+            report |= WATER_TILE_EDGE_Y1;
+
+        if (x == x0 || x == x1 - 1)
+        {
+            for (int y = y0; y < y1; y++)
+            {
+                if (fabsf(out_h[y]) > WATER_WAKE_THRESHOLD)
+                {
+                    report |= x == x0 ? WATER_TILE_EDGE_X0 : 0;
+                    report |= x == x1 - 1 ? WATER_TILE_EDGE_X1 : 0;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (peak < WATER_SLEEP_EPSILON)
+        report |= WATER_TILE_CALM;
+
+    water->tile_report[tile] = report;
+}
+
+/*
+ * Job callback: step the active tiles at list positions [begin, end).
+ */
+static void water_step_tiles(void *data, int begin, int end)
+{
+    const WaterStepJob *job = (const WaterStepJob *)data;
+
+    for (int i = begin; i < end; i++)
+        water_step_tile(job, job->water->active_tiles[i]);
+}
+
+/*
+ * Zero a tile in both buffer pairs so it can sleep consistently.
+ */
+static void water_clear_tile(WaterSim *water, int tile)
+{
+    const int n = water->size;
+
+    int x0, x1, y0, y1;
+    water_tile_bounds(water, tile, &x0, &x1, &y0, &y1);
+
+    for (int b = 0; b < 2; b++)
+    {
+        for (int x = x0; x < x1; x++)
+        {
+            memset(water->h[b] + x * n + y0, 0, (size_t)(y1 - y0) * sizeof(float));
+            memset(water->v[b] + x * n + y0, 0, (size_t)(y1 - y0) * sizeof(float));
+        }
+    }
+}
+
+/*
+ * Wake a tile and restart its calm counter.
+ */
+static void water_wake_tile(WaterSim *water, int tile)
+{
+    water->tile_awake[tile] = 1;
+    water->tile_calm[tile] = 0;
+}
+
+/*
+ * Apply the tile reports of the last step: put long-calm tiles to sleep
+ * first, then wake the neighbours of tiles with active borders, so a
+ * tile that is still being disturbed never stays asleep.
+ */
+static void water_update_tiles(WaterSim *water)
+{
+    const int tps = water->tiles_per_side;
+
+    for (int i = 0; i < water->active_count; i++)
+    {
+        int t = water->active_tiles[i];
+
+        if (!(water->tile_report[t] & WATER_TILE_CALM))
+        {
+            water->tile_calm[t] = 0;
+            continue;
+        }
+
+        if (water->tile_calm[t] < 255)
+            water->tile_calm[t]++;
+
+        if (water->tile_calm[t] >= WATER_SLEEP_STEPS)
+        {
+            water->tile_awake[t] = 0;
+            water_clear_tile(water, t);
+        }
+    }
+
+    for (int i = 0; i < water->active_count; i++)
+    {
+        int t = water->active_tiles[i];
+        unsigned char r = water->tile_report[t];
+        int tx = t / tps;
+        int ty = t % tps;
+
+        if ((r & WATER_TILE_EDGE_X0) && tx > 0 && !water->tile_awake[t - tps])
+            water_wake_tile(water, t - tps);
+        if ((r & WATER_TILE_EDGE_X1) && tx < tps - 1 && !water->tile_awake[t + tps])
+            water_wake_tile(water, t + tps);
+        if ((r & WATER_TILE_EDGE_Y0) && ty > 0 && !water->tile_awake[t - 1])
+            water_wake_tile(water, t - 1);
+        if ((r & WATER_TILE_EDGE_Y1) && ty < tps - 1 && !water->tile_awake[t + 1])
+            water_wake_tile(water, t + 1);
+    }
+}
+
+/*
+ * Gather the tiles to simulate this step.
+ */
+static void water_collect_active(WaterSim *water)
+{
+    const int tiles = water->tiles_per_side * water->tiles_per_side;
+
+    water->active_count = 0;
+
+    for (int t = 0; t < tiles; t++)
+    {
+        if (water->tile_awake[t] || !water->sleep_enabled)
+            water->active_tiles[water->active_count++] = t;
+    }
+}
+
+/*
+ * Read the current buffers, write the other pair for awake tiles,
+ * flip, then update which tiles sleep.
+ */
+void water_sim_step(WaterSim *water, float delta_time, JobPool *jobs)
+{
+    if (!water->h[0])
+        return;
+
+    water_collect_active(water);
+
+    if (water->active_count == 0)
+        return;
+
+    int cur = water->current;
+    int next = cur ^ 1;
+
+    WaterStepJob job = {
+        water,
+        water->h[cur],
+        water->v[cur],
+        water->h[next],
+        water->v[next],
+        delta_time,
+        water_row_func(water->kernel)};
+
+    if (water->size >= WATER_PARALLEL_MIN_SIZE)
+        jobs_parallel_for(jobs, water->active_count, WATER_MIN_TILES_PER_BATCH, water_step_tiles, &job);
+    else
+        water_step_tiles(&job, 0, water->active_count);
+
+    water->current = next;
+
+    if (water->sleep_enabled)
+        water_update_tiles(water);
+}
+
+/*
+ * Add a radial velocity impulse around the given grid position and wake
+ * the tiles it touches. At the default 64x64 resolution this is the
+ * original 5x5 splash.
+ */
+void water_sim_splash(WaterSim *water, float u, float v)
+{
+    if (!water->h[0])
+        return;
+
+    const int n = water->size;
+    const int tps = water->tiles_per_side;
+    float *vel = water->v[water->current];
+
+    int radius = (2 * n + WATER_DEFAULT_SIZE / 2) / WATER_DEFAULT_SIZE;
+    if (radius < 2)
+        radius = 2;
+
+    float falloff = 0.04f * 4.0f / (float)(radius * radius);
+
+    int ix = (int)(u * (float)(n - 1));
+    int iy = (int)(v * (float)(n - 1));
+
+    for (int dx = -radius; dx <= radius; dx++)
+    {
+        for (int dy = -radius; dy <= radius; dy++)
+        {
+            int x = ix + dx;
+            int y = iy + dy;
+
+            if (x <= 1 || x >= n - 1 || y <= 1 || y >= n - 1)
+                continue;
+
+            float d2 = (float)(dx * dx + dy * dy);
+            float impulse = 0.28f - falloff * d2;
+
+            if (impulse > 0.0f)
+            {
+                float *c = &vel[x * n + y];
+                *c += impulse;
+
+                if (*c > 0.08f)
+                    *c = 0.08f;
+                if (*c < -0.08f)
+                    *c = -0.08f;
+
+                water_wake_tile(water, (x / WATER_TILE_SIZE) * tps + y / WATER_TILE_SIZE);
+            }
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#include "zoo.h"
+
+#include <math.h>
+
+/*
+ * Scatter count trees over the park, away from the enclosures and ponds.
+ */
+static void generate_trees(Scene *scene, Rng *rng, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        float x;
+        float y;
+        int tries = 0;
+
+        do
+        {
+            x = rng_range(rng, -90.0f, 90.0f);
+            y = rng_range(rng, -90.0f, 90.0f);
+            tries++;
+        } while (
+            tries < 100 &&
+            ((fabsf(x) < 32.0f && fabsf(y) < 32.0f) ||
+             (fabsf(x - 40.0f) < 18.0f && fabsf(y - 10.0f) < 18.0f) ||
+             (fabsf(x + 45.0f) < 20.0f && fabsf(y + 20.0f) < 20.0f) ||
+             pond_system_find(&scene->ponds, x, y) >= 0));
+
+        scene_add_tree(
+            scene,
+            x,
+            y,
+            0.0f,
+            rng_range(rng, 5.0f, 8.0f),
+            rng_range(rng, 0.0f, 360.0f),
+            true);
+    }
+}
+
+/*
+ * Line the park border with slightly jittered trees.
+ */
+static void generate_border_trees(Scene *scene, Rng *rng)
+{
+    const float min_x = -95.0f;
+    const float max_x = 95.0f;
+    const float min_y = -95.0f;
+    const float max_y = 95.0f;
+    const float step = 7.0f;
+
+    for (float x = min_x; x <= max_x; x += step)
+    {
+        scene_add_tree(scene, x + rng_range(rng, -1.5f, 1.5f), max_y + rng_range(rng, -1.0f, 1.0f), 0.0f, rng_range(rng, 5.0f, 7.5f), rng_range(rng, 0.0f, 360.0f), true);
+        scene_add_tree(scene, x + rng_range(rng, -1.5f, 1.5f), min_y + rng_range(rng, -1.0f, 1.0f), 0.0f, rng_range(rng, 5.0f, 7.5f), rng_range(rng, 0.0f, 360.0f), true);
+    }
+
+    for (float y = min_y + step; y <= max_y - step; y += step)
+    {
+        scene_add_tree(scene, min_x + rng_range(rng, -1.0f, 1.0f), y + rng_range(rng, -1.5f, 1.5f), 0.0f, rng_range(rng, 5.0f, 7.5f), rng_range(rng, 0.0f, 360.0f), true);
+        scene_add_tree(scene, max_x + rng_range(rng, -1.0f, 1.0f), y + rng_range(rng, -1.5f, 1.5f), 0.0f, rng_range(rng, 5.0f, 7.5f), rng_range(rng, 0.0f, 360.0f), true);
+    }
+}
+
+/*
+ * Ponds, rocks, fences, monkeys, trees and gates of the zoo.
+ * Model-based objects are only placed when their model is set.
+ */
+void zoo_build(Scene *scene, Rng *rng)
+{
+    /* Ponds first, so tree placement can avoid them */
+    scene_add_pond(scene, 18.0f, -55.0f, 0.06f, 8.0f, 5.0f, WATER_DEFAULT_SIZE);
+    scene_add_pond(scene, -22.0f, 52.0f, 0.06f, 6.0f, 4.0f, 32);
+    scene_add_pond(scene, 140.0f, -120.0f, 0.06f, 14.0f, 9.0f, 96);
+
+    if (scene->rock_model)
+    {
+        scene_add_rock(scene, 5.0f, 6.0f, 2.0f, 8.0f, 25.0f, true);
+        scene_add_rock(scene, -8.0f, 4.0f, 0.5f, 0.7f, -10.0f, true);
+        scene_add_rock(scene, 12.0f, -3.0f, 0.7f, 1.1f, 70.0f, true);
+        scene_add_rock(scene, -10.0f, 10.0f, 0.6f, 1.0f, 15.0f, true);
+        scene_add_rock(scene, 8.0f, 11.0f, 0.5f, 0.9f, 120.0f, true);
+        scene_add_rock(scene, 42.0f, 6.0f, 0.4f, 0.8f, 45.0f, true);
+        scene_add_rock(scene, 36.0f, 14.0f, 0.5f, 1.0f, -20.0f, true);
+        scene_add_rock(scene, -48.0f, -16.0f, 0.4f, 0.8f, 80.0f, true);
+        scene_add_rock(scene, -39.0f, -24.0f, 0.5f, 1.1f, 150.0f, true);
+    }
+
+    scene_add_fence(scene, 0.0f, 0.0f, 25.0f, 2.0f, true);
+    scene_add_fence(scene, 40.0f, 10.0f, 12.0f, 2.0f, true);
+    scene_add_fence(scene, -45.0f, -20.0f, 15.0f, 2.0f, true);
+
+    if (scene->monkey_model)
+    {
+        scene_add_monkey(scene, 6.0f, 2.0f, 0.0f, 3.5f, 180.0f, 1.8f, true);
+        scene_add_monkey(scene, -5.0f, 5.0f, 0.0f, 3.2f, 45.0f, 1.8f, true);
+
+        scene_add_monkey(scene, 10.0f, -8.0f, 0.0f, 3.1f, 230.0f, 1.8f, true);
+        scene_add_monkey(scene, -12.0f, -6.0f, 0.0f, 3.4f, 300.0f, 1.8f, true);
+
+        scene_add_monkey(scene, 39.0f, 8.0f, 0.0f, 2.8f, 90.0f, 1.6f, true);
+        scene_add_monkey(scene, 44.0f, 13.0f, 0.0f, 2.9f, 210.0f, 1.6f, true);
+
+        scene_add_monkey(scene, -46.0f, -18.0f, 0.0f, 3.0f, 120.0f, 1.7f, true);
+        scene_add_monkey(scene, -40.0f, -24.0f, 0.0f, 2.7f, 20.0f, 1.6f, true);
+    }
+
+    if (scene->tree_model)
+    {
+        generate_border_trees(scene, rng);
+        generate_trees(scene, rng, 64);
+    }
+
+    scene_add_gate(scene, -1.5f, -25.0f, 0.0f, 3.0f, 0.12f, 2.0f, (Color3){0.40f, 0.30f, 0.15f}, 0.0f, 90.0f);
+    scene_add_gate(scene, 38.5f, -2.0f, 0.0f, 3.0f, 0.12f, 2.0f, (Color3){0.40f, 0.30f, 0.15f}, 0.0f, 90.0f);
+    scene_add_gate(scene, -46.5f, -35.0f, 0.0f, 3.0f, 0.12f, 2.0f, (Color3){0.40f, 0.30f, 0.15f}, 0.0f, 90.0f);
+}